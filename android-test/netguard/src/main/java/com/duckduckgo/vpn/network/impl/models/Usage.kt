@@ -27,6 +27,7 @@ class Usage {
     var Uid = 0
     var Sent: Long = 0
     var Received: Long = 0
+    var Name: String? = null
 
     override fun toString(): String {
         return (
@@ -44,7 +45,8 @@ class Usage {
                 " out " +
                 Sent +
                 " in " +
-                Received
+                Received +
+                (if (Name == null) "" else " $Name")
             )
     }
 
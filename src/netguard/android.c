@@ -37,6 +37,8 @@ Java_com_duckduckgo_vpn_network_impl_RealVpnNetwork_jni_1init(
     socks5_port = 0;
     *socks5_username = 0;
     *socks5_password = 0;
+    socks5_optimistic = 0;
+    socks5_sockaddr_len = 0;
     pcap_file = NULL;
 
     if (pthread_mutex_init(&ctx->lock, NULL))
@@ -71,10 +73,13 @@ Java_com_duckduckgo_vpn_network_impl_RealVpnNetwork_jni_1start(
 
 JNIEXPORT void JNICALL
 Java_com_duckduckgo_vpn_network_impl_RealVpnNetwork_jni_1run(
-        JNIEnv *env, jobject instance, jlong context, jint tun, jboolean fwd53, jint rcode) {
+        JNIEnv *env, jobject instance, jlong context, jint tun, jboolean fwd53, jint rcode,
+        jint mtu) {
     struct context *ctx = (struct context *) context;
 
-    log_print(PLATFORM_LOG_PRIORITY_WARN, "Running tun %d fwd53 %d level %d", tun, fwd53, loglevel);
+    log_print(PLATFORM_LOG_PRIORITY_WARN, "Running tun %d fwd53 %d level %d mtu %d",
+              tun, fwd53, loglevel, mtu);
+    set_mtu(mtu);
 
     // Set blocking
     int flags = fcntl(tun, F_GETFL, 0);
@@ -90,6 +95,7 @@ Java_com_duckduckgo_vpn_network_impl_RealVpnNetwork_jni_1run(
     args->fwd53 = fwd53;
     args->rcode = rcode;
     args->ctx = ctx;
+    negotiate_tun_offload(args);
     handle_events(args);
 }
 
@@ -164,6 +170,130 @@ Java_com_duckduckgo_vpn_network_impl_RealVpnNetwork_jni_1get_1stats(
     return jarray;
 }
 
+JNIEXPORT jlongArray JNICALL
+Java_com_duckduckgo_vpn_network_impl_RealVpnNetwork_jni_1get_1dns_1cache_1stats(
+        JNIEnv *env, jobject instance) {
+    long long stats[DNS_CACHE_STATS];
+    get_dns_cache_stats(stats);
+
+    jlongArray jarray = (*env)->NewLongArray(env, DNS_CACHE_STATS);
+    jlong *jstats = (*env)->GetLongArrayElements(env, jarray, NULL);
+    for (int i = 0; i < DNS_CACHE_STATS; i++)
+        jstats[i] = (jlong) stats[i];
+    (*env)->ReleaseLongArrayElements(env, jarray, jstats, 0);
+    return jarray;
+}
+
+JNIEXPORT jlongArray JNICALL
+Java_com_duckduckgo_vpn_network_impl_RealVpnNetwork_jni_1get_1dns_1names_1stats(
+        JNIEnv *env, jobject instance) {
+    long long stats[DNS_NAMES_STATS];
+    get_dns_names_stats(stats);
+
+    jlongArray jarray = (*env)->NewLongArray(env, DNS_NAMES_STATS);
+    jlong *jstats = (*env)->GetLongArrayElements(env, jarray, NULL);
+    for (int i = 0; i < DNS_NAMES_STATS; i++)
+        jstats[i] = (jlong) stats[i];
+    (*env)->ReleaseLongArrayElements(env, jarray, jstats, 0);
+    return jarray;
+}
+
+JNIEXPORT jlongArray JNICALL
+Java_com_duckduckgo_vpn_network_impl_RealVpnNetwork_jni_1get_1ip_1frag_1stats(
+        JNIEnv *env, jobject instance) {
+    long long stats[IP_FRAG_STATS];
+    get_ip_frag_stats(stats);
+
+    jlongArray jarray = (*env)->NewLongArray(env, IP_FRAG_STATS);
+    jlong *jstats = (*env)->GetLongArrayElements(env, jarray, NULL);
+    for (int i = 0; i < IP_FRAG_STATS; i++)
+        jstats[i] = (jlong) stats[i];
+    (*env)->ReleaseLongArrayElements(env, jarray, jstats, 0);
+    return jarray;
+}
+
+JNIEXPORT jint JNICALL
+Java_com_duckduckgo_vpn_network_impl_RealVpnNetwork_jni_1set_1rules(
+        JNIEnv *env, jobject instance, jintArray jvalues, jobjectArray jaddrs) {
+    // Per rule the values uid, protocol, prefix, port min, port max, action and redirect port
+    // and the strings address and redirect address
+    if (jvalues == NULL || jaddrs == NULL)
+        return set_rules(NULL, 0);
+
+    jsize length = (*env)->GetArrayLength(env, jvalues);
+    int count = length / 7;
+    if (length % 7 != 0 || count > RULES_MAX ||
+        (*env)->GetArrayLength(env, jaddrs) != count * 2) {
+        log_print(PLATFORM_LOG_PRIORITY_ERROR, "Rules arrays invalid");
+        return -1;
+    }
+
+    struct rule *rules = ng_calloc(count > 0 ? (size_t) count : 1, sizeof(struct rule), "jni rules");
+    jint *values = (*env)->GetIntArrayElements(env, jvalues, NULL);
+    int err = 0;
+    for (int i = 0; i < count && !err; i++) {
+        struct rule *r = &rules[i];
+        const jint *v = values + i * 7;
+        r->uid = v[0];
+        r->protocol = (uint8_t) v[1];
+        r->prefix = (uint8_t) v[2];
+        r->port_min = (uint16_t) v[3];
+        r->port_max = (uint16_t) v[4];
+        r->action = (uint8_t) v[5];
+        r->rport = (uint16_t) v[6];
+        // Checked before narrowing, a truncated value could match a different rule
+        err = (v[1] < 0 || v[1] > 255 || v[2] < 0 || v[2] > 128 ||
+               v[3] < 0 || v[4] > 65535 || v[3] > v[4] ||
+               v[5] < 0 || v[5] > 255 || v[6] < 0 || v[6] > 65535);
+
+        jstring jaddr = (*env)->GetObjectArrayElement(env, jaddrs, i * 2);
+        if (jaddr == NULL)
+            err = 1;
+        else {
+            const char *addr = (*env)->GetStringUTFChars(env, jaddr, NULL);
+            if (inet_pton(AF_INET, addr, r->addr) == 1)
+                r->version = 4;
+            else if (inet_pton(AF_INET6, addr, r->addr) == 1)
+                r->version = 6;
+            else
+                err = 1;
+            (*env)->ReleaseStringUTFChars(env, jaddr, addr);
+            (*env)->DeleteLocalRef(env, jaddr);
+        }
+
+        jstring jraddr = (*env)->GetObjectArrayElement(env, jaddrs, i * 2 + 1);
+        if (jraddr != NULL) {
+            const char *raddr = (*env)->GetStringUTFChars(env, jraddr, NULL);
+            strncpy(r->raddr, raddr, sizeof(r->raddr) - 1);
+            (*env)->ReleaseStringUTFChars(env, jraddr, raddr);
+            (*env)->DeleteLocalRef(env, jraddr);
+        }
+
+        if (err)
+            log_print(PLATFORM_LOG_PRIORITY_ERROR, "Rule %d invalid", i);
+    }
+    (*env)->ReleaseIntArrayElements(env, jvalues, values, JNI_ABORT);
+
+    if (!err)
+        err = set_rules(rules, count);
+    ng_free(rules, __FILE__, __LINE__);
+    return (err ? -1 : 0);
+}
+
+JNIEXPORT jlongArray JNICALL
+Java_com_duckduckgo_vpn_network_impl_RealVpnNetwork_jni_1get_1rules_1stats(
+        JNIEnv *env, jobject instance) {
+    long long stats[RULES_STATS];
+    get_rules_stats(stats);
+
+    jlongArray jarray = (*env)->NewLongArray(env, RULES_STATS);
+    jlong *jstats = (*env)->GetLongArrayElements(env, jarray, NULL);
+    for (int i = 0; i < RULES_STATS; i++)
+        jstats[i] = (jlong) stats[i];
+    (*env)->ReleaseLongArrayElements(env, jarray, jstats, 0);
+    return jarray;
+}
+
 JNIEXPORT void JNICALL
 Java_com_duckduckgo_vpn_network_impl_RealVpnNetwork_jni_1pcap(
         JNIEnv *env, jclass type,
@@ -240,6 +370,7 @@ Java_com_duckduckgo_vpn_network_impl_RealVpnNetwork_jni_1socks5(JNIEnv *env, job
 
     log_print(PLATFORM_LOG_PRIORITY_WARN, "SOCKS5 %s:%d user=%s",
                 socks5_addr, socks5_port, socks5_username);
+    resolve_socks5();
 
     (*env)->ReleaseStringUTFChars(env, addr_, addr);
     (*env)->ReleaseStringUTFChars(env, username_, username);
@@ -249,6 +380,65 @@ Java_com_duckduckgo_vpn_network_impl_RealVpnNetwork_jni_1socks5(JNIEnv *env, job
     ng_delete_alloc(password, __FILE__, __LINE__);
 }
 
+JNIEXPORT void JNICALL
+Java_com_duckduckgo_vpn_network_impl_RealVpnNetwork_jni_1socks5_1optimistic(
+        JNIEnv *env, jobject instance, jboolean enabled) {
+    socks5_optimistic = enabled;
+    log_print(PLATFORM_LOG_PRIORITY_WARN, "SOCKS5 optimistic %d", socks5_optimistic);
+}
+
+JNIEXPORT void JNICALL
+Java_com_duckduckgo_vpn_network_impl_RealVpnNetwork_jni_1socks5_1udp(
+        JNIEnv *env, jobject instance, jboolean enabled) {
+    socks5_udp = enabled;
+    log_print(PLATFORM_LOG_PRIORITY_WARN, "SOCKS5 UDP %d", socks5_udp);
+}
+
+JNIEXPORT void JNICALL
+Java_com_duckduckgo_vpn_network_impl_RealVpnNetwork_jni_1tls_1ports(
+        JNIEnv *env, jobject instance, jintArray ports_) {
+    jsize count = (*env)->GetArrayLength(env, ports_);
+    jint *ports = (*env)->GetIntArrayElements(env, ports_, NULL);
+    set_tls_ports(ports, count);
+    (*env)->ReleaseIntArrayElements(env, ports_, ports, JNI_ABORT);
+    log_print(PLATFORM_LOG_PRIORITY_WARN, "TLS inspection ports %d", count);
+}
+
+JNIEXPORT void JNICALL
+Java_com_duckduckgo_vpn_network_impl_RealVpnNetwork_jni_1udp_1mux(
+        JNIEnv *env, jobject instance, jboolean enabled) {
+    udp_mux = enabled;
+    log_print(PLATFORM_LOG_PRIORITY_WARN, "UDP mux %d", udp_mux);
+}
+
+JNIEXPORT void JNICALL
+Java_com_duckduckgo_vpn_network_impl_RealVpnNetwork_jni_1udp_1gso(
+        JNIEnv *env, jobject instance, jboolean enabled) {
+    udp_gso = enabled;
+    log_print(PLATFORM_LOG_PRIORITY_WARN, "UDP GSO/GRO %d", udp_gso);
+}
+
+JNIEXPORT void JNICALL
+Java_com_duckduckgo_vpn_network_impl_RealVpnNetwork_jni_1socket_1pool(
+        JNIEnv *env, jobject instance, jboolean enabled) {
+    socket_pool = enabled;
+    log_print(PLATFORM_LOG_PRIORITY_WARN, "Socket pool %d", socket_pool);
+}
+
+JNIEXPORT void JNICALL
+Java_com_duckduckgo_vpn_network_impl_RealVpnNetwork_jni_1tcp_1early_1synack(
+        JNIEnv *env, jobject instance, jboolean enabled) {
+    tcp_early_synack = enabled;
+    log_print(PLATFORM_LOG_PRIORITY_WARN, "TCP early SYN-ACK %d", tcp_early_synack);
+}
+
+JNIEXPORT void JNICALL
+Java_com_duckduckgo_vpn_network_impl_RealVpnNetwork_jni_1tcp_1fastopen(
+        JNIEnv *env, jobject instance, jboolean enabled) {
+    tcp_fastopen = enabled;
+    log_print(PLATFORM_LOG_PRIORITY_WARN, "TCP fast open %d", tcp_fastopen);
+}
+
 JNIEXPORT void JNICALL
 Java_com_duckduckgo_vpn_network_impl_RealVpnNetwork_jni_1done(
         JNIEnv *env, jobject instance, jlong context) {
@@ -265,6 +455,10 @@ Java_com_duckduckgo_vpn_network_impl_RealVpnNetwork_jni_1done(
             log_print(PLATFORM_LOG_PRIORITY_ERROR, "Close pipe error %d: %s", errno, strerror(errno));
 
     cleanup_uid_cache();
+    cleanup_dns_cache();
+    cleanup_dns_names();
+    cleanup_rules();
+    cleanup_tcp_fastopen();
 
     ng_free(ctx, __FILE__, __LINE__);
 }
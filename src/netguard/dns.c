@@ -23,221 +23,139 @@
 // Definitions
 ///////////////////////////////////////////////////////////////////////////////
 
-#define DNS_QCLASS_IN 1
-#define DNS_QTYPE_A 1 // IPv4
-#define DNS_QTYPE_AAAA 28 // IPv6
+#define DNS_TTL (10 * 60) // seconds
 
-#define DNS_SVCB 64
-#define DNS_HTTPS 65
+#define DNS_COALESCE_MAX 32 // waiting queries
 
-#define DNS_QNAME_MAX 255
-#define DNS_TTL (10 * 60) // seconds
+#define DNS_ALLOWED_MAX 8 // queries per TCP session
 
-typedef struct dns_rr {
-    __be16 qname_ptr;
-    __be16 qtype;
-    __be16 qclass;
-    __be32 ttl;
-    __be16 rdlength;
-} __packed dns_rr;
-
-struct dns_header {
-    uint16_t id; // identification number
-# if __BYTE_ORDER == __LITTLE_ENDIAN
-    uint16_t rd :1; // recursion desired
-    uint16_t tc :1; // truncated message
-    uint16_t aa :1; // authoritive answer
-    uint16_t opcode :4; // purpose of message
-    uint16_t qr :1; // query/response flag
-    uint16_t rcode :4; // response code
-    uint16_t cd :1; // checking disabled
-    uint16_t ad :1; // authenticated data
-    uint16_t z :1; // its z! reserved
-    uint16_t ra :1; // recursion available
-#elif __BYTE_ORDER == __BIG_ENDIAN
-    uint16_t qr :1; // query/response flag
-    uint16_t opcode :4; // purpose of message
-    uint16_t aa :1; // authoritive answer
-    uint16_t tc :1; // truncated message
-    uint16_t rd :1; // recursion desired
-    uint16_t ra :1; // recursion available
-    uint16_t z :1; // its z! reserved
-    uint16_t ad :1; // authenticated data
-    uint16_t cd :1; // checking disabled
-    uint16_t rcode :4; // response code
-# else
-# error "Adjust your <bits/endian.h> defines"
-#endif
-    uint16_t q_count; // number of question entries
-    uint16_t ans_count; // number of answer entries
-    uint16_t auth_count; // number of authority entries
-    uint16_t add_count; // number of resource entries
-} __packed;
-
-static int32_t get_qname(const uint8_t *data, const size_t datalen, uint16_t off, char *qname);
+struct dns_waiter {
+    struct udp_session udp;
+    uint8_t *query; // header and question
+    size_t qlen;
+    struct dns_waiter *next;
+};
 
-///////////////////////////////////////////////////////////////////////////////
+struct dns_query {
+    char qname[DNS_QNAME_MAX + 1];
+    uint16_t qtype;
+    uint16_t qclass;
+    size_t qlen;
+    struct dns_upstream upstream;
+    struct dns_verdict verdict;
+    int count;
+    struct dns_waiter *waiters;
+};
 
-static int32_t get_qname(const uint8_t *data, const size_t datalen, uint16_t off, char *qname) {
-    *qname = 0;
-
-    if (off >= datalen)
-        return -1;
-
-    uint16_t c = 0;
-    uint8_t noff = 0;
-    uint16_t ptr = off;
-    uint8_t len = *(data + ptr);
-    uint8_t count = 0;
-    while (len) {
-        if (count++ > 25)
-            break;
-
-        if (ptr + 1 < datalen && (len & 0xC0)) {
-            uint16_t jump = (uint16_t) ((len & 0x3F) * 256 + *(data + ptr + 1));
-            if (jump >= datalen) {
-                log_print(PLATFORM_LOG_PRIORITY_DEBUG, "DNS invalid jump");
-                break;
-            }
-            ptr = jump;
-            len = *(data + ptr);
-            log_print(PLATFORM_LOG_PRIORITY_DEBUG, "DNS qname compression ptr %d len %d", ptr, len);
-            if (!c) {
-                c = 1;
-                off += 2;
-            }
-        } else if (ptr + 1 + len < datalen && noff + len <= DNS_QNAME_MAX) {
-            memcpy(qname + noff, data + ptr + 1, len);
-            *(qname + noff + len) = '.';
-            noff += (len + 1);
-
-            uint16_t jump = (uint16_t) (ptr + 1 + len);
-            if (jump >= datalen) {
-                log_print(PLATFORM_LOG_PRIORITY_DEBUG, "DNS invalid jump");
-                break;
-            }
-            ptr = jump;
-            len = *(data + ptr);
-        } else
-            break;
-    }
-    ptr++;
+struct dns_allowed {
+    struct dns_verdict verdict[DNS_ALLOWED_MAX];
+    int count; // the oldest is overwritten
+};
 
-    if (len > 0 || noff == 0) {
-        log_print(PLATFORM_LOG_PRIORITY_ERROR, "DNS qname invalid len %d noff %d", len, noff);
-        return -1;
-    }
+static int32_t parse_dns_query(const uint8_t *data, size_t datalen,
+                               char *qname, uint16_t *qtype, uint16_t *qclass);
 
-    *(qname + noff - 1) = 0;
-    log_print(PLATFORM_LOG_PRIORITY_DEBUG, "qname %s", qname);
+static uint32_t hash_dns_question(const char *qname, uint16_t qtype, uint16_t qclass);
 
-    return (c ? off : ptr);
-}
+static int is_dns_allowed(const struct ng_session *s, uint16_t id, uint32_t question);
+
+static void log_dns_blocked(const struct arguments *args, const struct ng_session *s,
+                            uint16_t qtype, const char *qname, int rcode);
+
+static void report_dns_answer(const struct arguments *args, const struct dns_message *msg,
+                              int a, const char *qname);
+
+static void free_dns_waiters(struct dns_query *q);
+
+static int is_tracked_question(const struct dns_query *q, const struct dns_message *msg);
+
+static void put_dns_names(const struct dns_message *msg);
+
+///////////////////////////////////////////////////////////////////////////////
 
 int parse_dns_response(const struct arguments *args, const struct ng_session *s,
                         const uint8_t *data, size_t *datalen) {
-    if (*datalen < sizeof(struct dns_header) + 1) {
-        log_print(PLATFORM_LOG_PRIORITY_WARN, "DNS response length %d", *datalen);
+    // http://tools.ietf.org/html/rfc1035
+    struct dns_message msg;
+    int err = parse_dns_message(&msg, data, *datalen);
+    if (msg.sections < 2) {
+        log_print(PLATFORM_LOG_PRIORITY_WARN, "DNS response invalid %d length %d", err, *datalen);
         return 0;
     }
+    if (err < 0)
+        log_print(PLATFORM_LOG_PRIORITY_WARN, "DNS response sections %d invalid %d",
+                  msg.sections, err);
 
     // Check if standard DNS query
-    // TODO multiple qnames
     struct dns_header *dns = (struct dns_header *) data;
-    int qcount = ntohs(dns->q_count);
-    int acount = ntohs(dns->ans_count);
+    int qcount = msg.count[DNS_SECTION_QUESTION];
+    int acount = msg.count[DNS_SECTION_ANSWER];
     if (dns->qr == 1 && dns->opcode == 0 && qcount > 0 && acount > 0) {
         log_print(PLATFORM_LOG_PRIORITY_DEBUG, "DNS response qcount %d acount %d", qcount, acount);
         if (qcount > 1)
             log_print(PLATFORM_LOG_PRIORITY_WARN, "DNS response qcount %d acount %d", qcount, acount);
 
-        // http://tools.ietf.org/html/rfc1035
+        // Names are copied only for the questions and the addresses
         char name[DNS_QNAME_MAX + 1];
-        int32_t off = sizeof(struct dns_header);
-
-        uint16_t qtype;
-        uint16_t qclass;
         char qname[DNS_QNAME_MAX + 1];
+        uint16_t qtype = msg.rr[0].type;
+        uint16_t qclass = msg.rr[0].class;
+        if (get_dns_name(&msg, msg.rr[0].name, qname) <= 0) {
+            log_print(PLATFORM_LOG_PRIORITY_WARN, "DNS response Q invalid qname");
+            return 0;
+        }
+        log_print(PLATFORM_LOG_PRIORITY_DEBUG, "DNS question 0 qtype %d qclass %d qname %s",
+                  qtype, qclass, qname);
 
-        for (int q = 0; q < 1; q++) {
-            off = get_qname(data, *datalen, (uint16_t) off, name);
-            if (off > 0 && off + 4 <= *datalen) {
-                // TODO multiple qnames?
-                if (q == 0) {
-                    strcpy(qname, name);
-                    qtype = ntohs(*((uint16_t *) (data + off)));
-                    qclass = ntohs(*((uint16_t *) (data + off + 2)));
-                    log_print(PLATFORM_LOG_PRIORITY_DEBUG,
-                                "DNS question %d qtype %d qclass %d qname %s",
-                                q, qtype, qclass, qname);
-                }
-                off += 4;
-            } else {
+        short svcb = 0;
+        uint16_t ttl_off[DNS_CACHE_MAX_RR];
+        int ttl_count = 0;
+        uint32_t min_ttl = UINT32_MAX;
+        for (int a = 0; a < acount && qcount + a < msg.rr_count; a++) {
+            const struct dns_rr_view *rr = &msg.rr[qcount + a];
+            if (ttl_count < DNS_CACHE_MAX_RR)
+                ttl_off[ttl_count] = (uint16_t) (rr->rdata - 6);
+            ttl_count++;
+            if (rr->ttl < min_ttl)
+                min_ttl = rr->ttl;
+
+            if (rr->class == DNS_QCLASS_IN &&
+                (rr->type == DNS_QTYPE_A || rr->type == DNS_QTYPE_AAAA))
+                report_dns_answer(args, &msg, qcount + a, qname);
+            else if (rr->class == DNS_QCLASS_IN &&
+                       (rr->type == DNS_SVCB || rr->type == DNS_HTTPS)) {
+                // https://tools.ietf.org/id/draft-ietf-dnsop-svcb-https-01.html
+                svcb = 1;
                 log_print(PLATFORM_LOG_PRIORITY_WARN,
-                            "DNS response Q invalid off %d datalen %d", off, *datalen);
-                return 0;
-            }
+                            "SVCB answer %d qname %s qtype %d", a, qname, rr->type);
+            } else
+                log_print(PLATFORM_LOG_PRIORITY_DEBUG,
+                            "DNS answer %d qclass %d qtype %d ttl %d length %d",
+                            a, rr->class, rr->type, rr->ttl, rr->rdlength);
         }
 
-        short svcb = 0;
-        int32_t aoff = off;
-        for (int a = 0; a < acount; a++) {
-            off = get_qname(data, *datalen, (uint16_t) off, name);
-            if (off > 0 && off + 10 <= *datalen) {
-                uint16_t qtype = ntohs(*((uint16_t *) (data + off)));
-                uint16_t qclass = ntohs(*((uint16_t *) (data + off + 2)));
-                uint32_t ttl = ntohl(*((uint32_t *) (data + off + 4)));
-                uint16_t rdlength = ntohs(*((uint16_t *) (data + off + 8)));
-                off += 10;
-
-                if (off + rdlength <= *datalen) {
-                    if (qclass == DNS_QCLASS_IN &&
-                        (qtype == DNS_QTYPE_A || qtype == DNS_QTYPE_AAAA)) {
-
-                        char rd[INET6_ADDRSTRLEN + 1];
-                        if (qtype == DNS_QTYPE_A) {
-                            if (off + sizeof(__be32) <= *datalen)
-                                inet_ntop(AF_INET, data + off, rd, sizeof(rd));
-                            else
-                                return 0;
-                        } else if (qclass == DNS_QCLASS_IN && qtype == DNS_QTYPE_AAAA) {
-                            if (off + sizeof(struct in6_addr) <= *datalen)
-                                inet_ntop(AF_INET6, data + off, rd, sizeof(rd));
-                            else
-                                return 0;
-                        }
-
-                        dns_resolved(args, qname, name, rd, ttl);
-                        log_print(PLATFORM_LOG_PRIORITY_DEBUG,
-                                    "DNS answer %d qname %s qtype %d ttl %d data %s",
-                                    a, name, qtype, ttl, rd);
-                    } else if (qclass == DNS_QCLASS_IN &&
-                               (qtype == DNS_SVCB || qtype == DNS_HTTPS)) {
-                        // https://tools.ietf.org/id/draft-ietf-dnsop-svcb-https-01.html
-                        svcb = 1;
-                        log_print(PLATFORM_LOG_PRIORITY_WARN,
-                                    "SVCB answer %d qname %s qtype %d", a, name, qtype);
-                    } else
-                        log_print(PLATFORM_LOG_PRIORITY_DEBUG,
-                                    "DNS answer %d qname %s qclass %d qtype %d ttl %d length %d",
-                                    a, name, qclass, qtype, ttl, rdlength);
-
-                    off += rdlength;
-                } else {
-                    log_print(PLATFORM_LOG_PRIORITY_WARN,
-                                "DNS response A invalid off %d rdlength %d datalen %d",
-                                off, rdlength, *datalen);
-                    return 0;
+        // Any blocked question blocks the response
+        jint uid = (s->protocol == IPPROTO_UDP ? s->udp.uid : s->tcp.uid);
+        int allowed = is_dns_allowed(s, dns->id, hash_dns_question(qname, qtype, qclass));
+        int blocked = svcb;
+        for (int q = 0; q < qcount && q < msg.rr_count && !blocked; q++) {
+            if (q > 0) {
+                if (get_dns_name(&msg, msg.rr[q].name, name) <= 0)
+                    continue;
+                log_print(PLATFORM_LOG_PRIORITY_DEBUG, "DNS question %d qtype %d qclass %d qname %s",
+                          q, msg.rr[q].type, msg.rr[q].class, name);
+            } else if (allowed)
+                continue;
+            if (is_domain_blocked(args, q > 0 ? name : qname, uid)) {
+                blocked = 1;
+                if (q > 0) {
+                    strcpy(qname, name);
+                    qtype = msg.rr[q].type;
                 }
-            } else {
-                log_print(PLATFORM_LOG_PRIORITY_WARN,
-                            "DNS response A invalid off %d datalen %d", off, *datalen);
-                return 0;
             }
         }
 
-        if (qcount > 0 &&
-            (svcb || is_domain_blocked(args, qname, s->udp.uid))) {
+        if (blocked) {
             dns->qr = 1;
             dns->aa = 0;
             dns->tc = 0;
@@ -250,56 +168,22 @@ int parse_dns_response(const struct arguments *args, const struct ng_session *s,
             dns->ans_count = 0;
             dns->auth_count = 0;
             dns->add_count = 0;
-            *datalen = aoff;
-
-            int version;
-            char source[INET6_ADDRSTRLEN + 1];
-            char dest[INET6_ADDRSTRLEN + 1];
-            uint16_t sport;
-            uint16_t dport;
-
-            if (s->protocol == IPPROTO_UDP) {
-                version = s->udp.version;
-                sport = ntohs(s->udp.source);
-                dport = ntohs(s->udp.dest);
-                if (s->udp.version == 4) {
-                    inet_ntop(AF_INET, &s->udp.saddr.ip4, source, sizeof(source));
-                    inet_ntop(AF_INET, &s->udp.daddr.ip4, dest, sizeof(dest));
-                } else {
-                    inet_ntop(AF_INET6, &s->udp.saddr.ip6, source, sizeof(source));
-                    inet_ntop(AF_INET6, &s->udp.daddr.ip6, dest, sizeof(dest));
-                }
-            } else {
-                version = s->tcp.version;
-                sport = ntohs(s->tcp.source);
-                dport = ntohs(s->tcp.dest);
-                if (s->tcp.version == 4) {
-                    inet_ntop(AF_INET, &s->tcp.saddr.ip4, source, sizeof(source));
-                    inet_ntop(AF_INET, &s->tcp.daddr.ip4, dest, sizeof(dest));
-                } else {
-                    inet_ntop(AF_INET6, &s->tcp.saddr.ip6, source, sizeof(source));
-                    inet_ntop(AF_INET6, &s->tcp.daddr.ip6, dest, sizeof(dest));
-                }
-            }
+            *datalen = msg.end[DNS_SECTION_QUESTION];
 
-            // Log qname
-            char name[DNS_QNAME_MAX + 40 + 1];
-            sprintf(name, "qtype %d qname %s rcode %d", qtype, qname, dns->rcode);
-            packet_t packet;
-            packet.version = version;
-            packet.protocol = s->protocol;
-            packet.flags = "";
-            packet.source = source;
-            packet.sport = sport;
-            packet.dest = dest;
-            packet.dport = dport;
-            packet.data = name;
-            packet.uid = 0;
-            packet.allowed = 0;
-            log_packet(args, &packet);
+            log_dns_blocked(args, s, qtype, qname, dns->rcode);
             // TODO this is a temporary hack to minimise heavy retries. We'll refactor DNS parsing later on
             return 1; // signal DNS request should be blocked
         }
+
+        put_dns_names(&msg);
+
+        // Cache the question with the answer section, if all answers were indexed
+        if (qcount == 1 && err == 0 && ttl_count == acount && s->protocol == IPPROTO_UDP &&
+            s->udp.dns != NULL && dns->tc == 0 && dns->rcode == 0)
+            dns_cache_put(&s->udp.dns->upstream,
+                          qname, qtype, qclass, data, msg.end[DNS_SECTION_ANSWER],
+                          msg.end[DNS_SECTION_QUESTION], ttl_off, ttl_count, min_ttl,
+                          s->udp.query_ms > 0 ? get_ms() - s->udp.query_ms : 0);
     } else if (acount > 0)
         log_print(PLATFORM_LOG_PRIORITY_WARN,
                     "DNS response qr %d opcode %d qcount %d acount %d",
@@ -307,3 +191,411 @@ int parse_dns_response(const struct arguments *args, const struct ng_session *s,
 
     return 0;
 }
+
+static void report_dns_answer(const struct arguments *args, const struct dns_message *msg,
+                              int a, const char *qname) {
+    // The parser checked the address length
+    const struct dns_rr_view *rr = &msg->rr[a];
+    char name[DNS_QNAME_MAX + 1];
+    char rd[INET6_ADDRSTRLEN + 1];
+    inet_ntop(rr->type == DNS_QTYPE_A ? AF_INET : AF_INET6,
+              msg->data + rr->rdata, rd, sizeof(rd));
+    get_dns_name(msg, rr->name, name);
+
+    dns_resolved(args, qname, name, rd, rr->ttl);
+    log_print(PLATFORM_LOG_PRIORITY_DEBUG,
+              "DNS answer %d qname %s qtype %d ttl %d data %s",
+              a - msg->count[DNS_SECTION_QUESTION], name, rr->type, rr->ttl, rd);
+}
+
+static int32_t parse_dns_query(const uint8_t *data, size_t datalen,
+                               char *qname, uint16_t *qtype, uint16_t *qclass) {
+    // Only standard queries with a single question, records after it may be invalid
+    struct dns_message msg;
+    int err = parse_dns_message(&msg, data, datalen);
+    if (msg.sections < 1 || (msg.flags & 0xf800) != 0 || msg.count[DNS_SECTION_QUESTION] != 1)
+        return 0;
+    if (get_dns_name(&msg, msg.rr[0].name, qname) <= 0) {
+        log_print(PLATFORM_LOG_PRIORITY_WARN, "DNS query invalid %d datalen %d", err, datalen);
+        return 0;
+    }
+    *qtype = msg.rr[0].type;
+    *qclass = msg.rr[0].class;
+
+    return msg.end[DNS_SECTION_QUESTION];
+}
+
+static uint32_t hash_dns_question(const char *qname, uint16_t qtype, uint16_t qclass) {
+    uint32_t h = hash_fnv1a_lower(HASH_FNV1A_BASIS, qname);
+    h = hash_fnv1a(h, &qtype, sizeof(qtype));
+    return hash_fnv1a(h, &qclass, sizeof(qclass));
+}
+
+static int is_dns_allowed(const struct ng_session *s, uint16_t id, uint32_t question) {
+    if (s->protocol == IPPROTO_UDP) {
+        const struct dns_query *q = s->udp.dns;
+        return (q != NULL && q->verdict.allowed &&
+                q->verdict.id == id && q->verdict.question == question);
+    }
+
+    const struct dns_allowed *a = s->tcp.dns_allowed;
+    if (a != NULL)
+        for (int i = 0; i < a->count && i < DNS_ALLOWED_MAX; i++)
+            if (a->verdict[i].id == id && a->verdict[i].question == question)
+                return 1;
+    return 0;
+}
+
+size_t block_dns_query(const struct arguments *args, const struct ng_session *s,
+                       const uint8_t *data, size_t datalen, uint8_t *response,
+                       struct dns_verdict *verdict) {
+    verdict->allowed = 0;
+
+    char qname[DNS_QNAME_MAX + 1];
+    uint16_t qtype;
+    uint16_t qclass;
+    int32_t off = parse_dns_query(data, datalen, qname, &qtype, &qclass);
+    if (off <= 0)
+        return 0;
+
+    jint uid = (s->protocol == IPPROTO_UDP ? s->udp.uid : s->tcp.uid);
+    if (!is_domain_blocked(args, qname, uid)) {
+        // Remembered until the response arrives
+        verdict->allowed = 1;
+        verdict->id = ((const struct dns_header *) data)->id;
+        verdict->question = hash_dns_question(qname, qtype, qclass);
+        return 0;
+    }
+
+    log_print(PLATFORM_LOG_PRIORITY_INFO, "DNS query qtype %d qclass %d qname %s blocked",
+              qtype, qclass, qname);
+
+    // Echo the header and question, drop anything after it (EDNS)
+    memcpy(response, data, (size_t) off);
+    struct dns_header *rdns = (struct dns_header *) response;
+    rdns->qr = 1;
+    rdns->aa = 0;
+    rdns->tc = 0;
+    rdns->ra = 1;
+    rdns->z = 0;
+    rdns->ad = 0;
+    rdns->cd = 0;
+    rdns->rcode = (uint16_t) args->rcode;
+    rdns->ans_count = 0;
+    rdns->auth_count = 0;
+    rdns->add_count = 0;
+
+    log_dns_blocked(args, s, qtype, qname, rdns->rcode);
+
+    return (size_t) off;
+}
+
+static void log_dns_blocked(const struct arguments *args, const struct ng_session *s,
+                            uint16_t qtype, const char *qname, int rcode) {
+    int version;
+    char source[INET6_ADDRSTRLEN + 1];
+    char dest[INET6_ADDRSTRLEN + 1];
+    uint16_t sport;
+    uint16_t dport;
+
+    if (s->protocol == IPPROTO_UDP) {
+        version = s->udp.version;
+        sport = ntohs(s->udp.source);
+        dport = ntohs(s->udp.dest);
+        if (s->udp.version == 4) {
+            inet_ntop(AF_INET, &s->udp.saddr.ip4, source, sizeof(source));
+            inet_ntop(AF_INET, &s->udp.daddr.ip4, dest, sizeof(dest));
+        } else {
+            inet_ntop(AF_INET6, &s->udp.saddr.ip6, source, sizeof(source));
+            inet_ntop(AF_INET6, &s->udp.daddr.ip6, dest, sizeof(dest));
+        }
+    } else {
+        version = s->tcp.version;
+        sport = ntohs(s->tcp.source);
+        dport = ntohs(s->tcp.dest);
+        if (s->tcp.version == 4) {
+            inet_ntop(AF_INET, &s->tcp.saddr.ip4, source, sizeof(source));
+            inet_ntop(AF_INET, &s->tcp.daddr.ip4, dest, sizeof(dest));
+        } else {
+            inet_ntop(AF_INET6, &s->tcp.saddr.ip6, source, sizeof(source));
+            inet_ntop(AF_INET6, &s->tcp.daddr.ip6, dest, sizeof(dest));
+        }
+    }
+
+    // Log qname
+    char name[DNS_QNAME_MAX + 40 + 1];
+    sprintf(name, "qtype %d qname %s rcode %d", qtype, qname, rcode);
+    packet_t packet;
+    packet.version = version;
+    packet.protocol = s->protocol;
+    packet.flags = "";
+    packet.source = source;
+    packet.sport = sport;
+    packet.dest = dest;
+    packet.daddr = (s->protocol == IPPROTO_UDP ? (const void *) &s->udp.daddr : &s->tcp.daddr);
+    packet.dport = dport;
+    packet.data = name;
+    packet.uid = 0;
+    packet.allowed = 0;
+    log_packet(args, &packet);
+}
+
+void get_dns_upstream(int version, const void *daddr, __be16 dest,
+                      const struct allowed *redirect, struct dns_upstream *upstream) {
+    memset(upstream, 0, sizeof(struct dns_upstream));
+    if (redirect == NULL) {
+        upstream->version = version;
+        memcpy(upstream->addr, daddr, version == 4 ? 4 : 16);
+        upstream->port = dest;
+    } else {
+        upstream->version = (strstr(redirect->raddr, ":") == NULL ? 4 : 6);
+        inet_pton(upstream->version == 4 ? AF_INET : AF_INET6, redirect->raddr, upstream->addr);
+        upstream->port = htons(redirect->rport);
+    }
+}
+
+size_t get_cached_dns_response(const struct arguments *args, const struct dns_upstream *upstream,
+                               const uint8_t *data, size_t datalen, uint8_t **response) {
+    char qname[DNS_QNAME_MAX + 1];
+    uint16_t qtype;
+    uint16_t qclass;
+    int32_t off = parse_dns_query(data, datalen, qname, &qtype, &qclass);
+    if (off <= 0)
+        return 0;
+
+    size_t len = dns_cache_get(upstream, qname, qtype, qclass, data, (size_t) off, response);
+
+    // Addresses answered from the cache keep their names, here and in Java
+    if (len > 0) {
+        struct dns_message msg;
+        if (parse_dns_message(&msg, *response, len) == 0) {
+            int last = msg.count[DNS_SECTION_QUESTION] + msg.count[DNS_SECTION_ANSWER];
+            for (int a = msg.count[DNS_SECTION_QUESTION]; a < last && a < msg.rr_count; a++)
+                if (msg.rr[a].class == DNS_QCLASS_IN &&
+                    (msg.rr[a].type == DNS_QTYPE_A || msg.rr[a].type == DNS_QTYPE_AAAA))
+                    report_dns_answer(args, &msg, a, qname);
+            put_dns_names(&msg);
+        }
+    }
+
+    return len;
+}
+
+/**
+ * Remember the names of the addresses of a response
+ * An address is named by the question its owner answers, directly or through CNAMEs
+ */
+static void put_dns_names(const struct dns_message *msg) {
+    int qcount = msg->count[DNS_SECTION_QUESTION];
+    int last = msg->count[DNS_SECTION_QUESTION] + msg->count[DNS_SECTION_ANSWER];
+    if (last > msg->rr_count)
+        last = msg->rr_count;
+
+    for (int a = qcount; a < last; a++) {
+        const struct dns_rr_view *rr = &msg->rr[a];
+        if (rr->class != DNS_QCLASS_IN ||
+            (rr->type != DNS_QTYPE_A && rr->type != DNS_QTYPE_AAAA))
+            continue;
+
+        // Follow the CNAMEs back from the owner of the address to a question
+        char names[DNS_NAMES_MAX_CHAIN][DNS_QNAME_MAX + 1];
+        const char *chain[DNS_NAMES_MAX_CHAIN];
+        int chain_count = 0;
+        uint16_t owner = rr->name;
+        int question = -1;
+        while (question < 0) {
+            for (int q = 0; q < qcount && q < msg->rr_count && question < 0; q++)
+                if (is_dns_name_equal(msg, msg->rr[q].name, owner))
+                    question = q;
+            if (question >= 0 || chain_count == DNS_NAMES_MAX_CHAIN)
+                break;
+
+            int cname = -1;
+            for (int c = qcount; c < last && cname < 0; c++)
+                if (msg->rr[c].type == DNS_QTYPE_CNAME &&
+                    is_dns_name_equal(msg, msg->rr[c].rdata, owner))
+                    cname = c;
+            if (cname < 0 || get_dns_name(msg, owner, names[chain_count]) <= 0)
+                break;
+            chain_count++;
+            owner = msg->rr[cname].name;
+        }
+        if (question < 0)
+            continue;
+
+        char qname[DNS_QNAME_MAX + 1];
+        if (get_dns_name(msg, msg->rr[question].name, qname) <= 0)
+            continue;
+        for (int i = 0; i < chain_count; i++)
+            chain[i] = names[chain_count - 1 - i];
+
+        dns_names_put(rr->type == DNS_QTYPE_A ? 4 : 6, msg->data + rr->rdata,
+                      qname, chain, chain_count, rr->ttl);
+    }
+}
+
+static void free_dns_waiters(struct dns_query *q) {
+    struct dns_waiter *w = q->waiters;
+    while (w != NULL) {
+        struct dns_waiter *p = w;
+        w = w->next;
+        ng_free(p->query, __FILE__, __LINE__);
+        ng_free(p, __FILE__, __LINE__);
+    }
+    q->waiters = NULL;
+    q->count = 0;
+}
+
+void clear_dns_query(struct udp_session *cur) {
+    if (cur->dns != NULL) {
+        free_dns_waiters(cur->dns);
+        ng_free(cur->dns, __FILE__, __LINE__);
+        cur->dns = NULL;
+    }
+}
+
+void track_dns_query(struct udp_session *cur, const uint8_t *data, size_t datalen,
+                     const struct dns_upstream *upstream, const struct dns_verdict *verdict) {
+    // Only the first query of a session is shared
+    if (cur->dns != NULL)
+        return;
+
+    struct dns_query q;
+    int32_t off = parse_dns_query(data, datalen, q.qname, &q.qtype, &q.qclass);
+    if (off <= 0)
+        return;
+
+    cur->dns = ng_malloc(sizeof(struct dns_query), "dns query");
+    memcpy(cur->dns, &q, sizeof(struct dns_query));
+    cur->dns->qlen = (size_t) off;
+    cur->dns->upstream = *upstream;
+    cur->dns->verdict = *verdict;
+    cur->dns->count = 0;
+    cur->dns->waiters = NULL;
+}
+
+static int is_tracked_question(const struct dns_query *q, const struct dns_message *msg) {
+    char qname[DNS_QNAME_MAX + 1];
+    return (msg->sections >= 1 && msg->count[DNS_SECTION_QUESTION] == 1 &&
+            msg->end[DNS_SECTION_QUESTION] == q->qlen &&
+            msg->rr[0].type == q->qtype && msg->rr[0].class == q->qclass &&
+            get_dns_name(msg, msg->rr[0].name, qname) > 0 &&
+            strcasecmp(qname, q->qname) == 0);
+}
+
+int is_dns_question_tracked(const struct udp_session *cur, const uint8_t *data, size_t datalen) {
+    if (cur->dns == NULL)
+        return 0;
+    struct dns_message msg;
+    parse_dns_message(&msg, data, datalen);
+    return is_tracked_question(cur->dns, &msg);
+}
+
+int get_tracked_dns_upstream(const struct udp_session *cur, struct dns_upstream *upstream) {
+    if (cur->dns == NULL)
+        return 0;
+    *upstream = cur->dns->upstream;
+    return 1;
+}
+
+void allow_dns_query(struct tcp_session *cur, const struct dns_verdict *verdict) {
+    if (!verdict->allowed)
+        return;
+    if (cur->dns_allowed == NULL)
+        cur->dns_allowed = ng_calloc(1, sizeof(struct dns_allowed), "dns allowed");
+    struct dns_allowed *a = cur->dns_allowed;
+    a->verdict[a->count % DNS_ALLOWED_MAX] = *verdict;
+    if (++a->count == 2 * DNS_ALLOWED_MAX)
+        a->count = DNS_ALLOWED_MAX;
+}
+
+void clear_dns_allowed(struct tcp_session *cur) {
+    if (cur->dns_allowed != NULL) {
+        ng_free(cur->dns_allowed, __FILE__, __LINE__);
+        cur->dns_allowed = NULL;
+    }
+}
+
+int coalesce_dns_query(const struct arguments *args, const struct udp_session *cur,
+                       const struct dns_upstream *upstream,
+                       const uint8_t *data, size_t datalen) {
+    char qname[DNS_QNAME_MAX + 1];
+    uint16_t qtype;
+    uint16_t qclass;
+    int32_t off = parse_dns_query(data, datalen, qname, &qtype, &qclass);
+    if (off <= 0)
+        return 0;
+
+    // Find an outstanding upstream query for the same question to the same resolver
+    struct ng_session *s = args->ctx->ng_session;
+    while (s != NULL &&
+           !(s->protocol == IPPROTO_UDP &&
+             s->udp.state == UDP_ACTIVE &&
+             ntohs(s->udp.dest) == 53 &&
+             s->udp.dns != NULL &&
+             is_dns_upstream_equal(&s->udp.dns->upstream, upstream) &&
+             s->udp.dns->qtype == qtype &&
+             s->udp.dns->qclass == qclass &&
+             s->udp.dns->qlen == (size_t) off &&
+             s->udp.dns->count < DNS_COALESCE_MAX &&
+             strcasecmp(s->udp.dns->qname, qname) == 0))
+        s = s->next;
+    if (s == NULL)
+        return 0;
+
+    // A retransmit of a waiting query is answered once
+    for (struct dns_waiter *w = s->udp.dns->waiters; w != NULL; w = w->next)
+        if (w->udp.version == cur->version && w->udp.source == cur->source &&
+            memcmp(w->query, data, sizeof(uint16_t)) == 0 &&
+            (cur->version == 4 ? w->udp.saddr.ip4 == cur->saddr.ip4
+                               : memcmp(&w->udp.saddr.ip6, &cur->saddr.ip6, 16) == 0)) {
+            log_print(PLATFORM_LOG_PRIORITY_DEBUG, "DNS query qtype %d qname %s already waiting",
+                      qtype, qname);
+            return 1;
+        }
+
+    struct dns_waiter *w = ng_malloc(sizeof(struct dns_waiter), "dns waiter");
+    memcpy(&w->udp, cur, sizeof(struct udp_session));
+    w->udp.dns = NULL;
+    w->query = ng_malloc((size_t) off, "dns waiter query");
+    memcpy(w->query, data, (size_t) off);
+    w->qlen = (size_t) off;
+    w->next = s->udp.dns->waiters;
+    s->udp.dns->waiters = w;
+    s->udp.dns->count++;
+
+    log_print(PLATFORM_LOG_PRIORITY_INFO, "DNS query qtype %d qname %s coalesced waiting %d",
+              qtype, qname, s->udp.dns->count);
+    return 1;
+}
+
+void answer_dns_waiters(const struct arguments *args, struct udp_session *cur,
+                        const uint8_t *data, size_t datalen) {
+    struct dns_query *q = cur->dns;
+    if (q == NULL || q->waiters == NULL)
+        return;
+
+    // The response must be for the tracked question
+    struct dns_message msg;
+    parse_dns_message(&msg, data, datalen);
+    if (!(msg.flags & 0x8000) || !is_tracked_question(q, &msg)) {
+        log_print(PLATFORM_LOG_PRIORITY_WARN, "DNS response does not match qname %s", q->qname);
+        return;
+    }
+
+    uint8_t *response = ng_malloc(datalen, "dns fan out");
+    for (struct dns_waiter *w = q->waiters; w != NULL; w = w->next) {
+        // Copy the transaction ID and the question (case) of the waiting query
+        memcpy(response, data, datalen);
+        memcpy(response, w->query, sizeof(uint16_t));
+        memcpy(response + sizeof(struct dns_header),
+               w->query + sizeof(struct dns_header), w->qlen - sizeof(struct dns_header));
+        write_udp(args, &w->udp, response, datalen);
+    }
+    ng_free(response, __FILE__, __LINE__);
+
+    log_print(PLATFORM_LOG_PRIORITY_INFO, "DNS response qname %s fanned out to %d",
+              q->qname, q->count);
+
+    free_dns_waiters(q);
+}
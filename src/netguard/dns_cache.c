@@ -0,0 +1,245 @@
+#include "netguard.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// Definitions
+///////////////////////////////////////////////////////////////////////////////
+
+#define DNS_CACHE_BUCKETS 256
+
+struct dns_cache_entry {
+    struct dns_upstream upstream;
+    char qname[DNS_QNAME_MAX + 1];
+    uint16_t qtype;
+    uint16_t qclass;
+
+    long long stored; // milliseconds
+    long long expires; // milliseconds
+    long long rtt; // milliseconds
+
+    uint8_t *data;
+    size_t datalen;
+    size_t qlen;
+    uint16_t ttl_off[DNS_CACHE_MAX_RR];
+    int ttl_count;
+
+    struct dns_cache_entry *next; // bucket
+    struct dns_cache_entry *lru_prev;
+    struct dns_cache_entry *lru_next;
+};
+
+static struct dns_cache_entry *dns_cache[DNS_CACHE_BUCKETS];
+static struct dns_cache_entry *lru_head = NULL; // most recently used
+static struct dns_cache_entry *lru_tail = NULL;
+
+static size_t dns_cache_bytes = 0;
+static long long dns_cache_entries = 0;
+static long long dns_cache_hits = 0;
+static long long dns_cache_misses = 0;
+static long long dns_cache_saved = 0;
+static long long dns_cache_evictions = 0;
+
+static size_t entry_size(const struct dns_cache_entry *e);
+
+static uint32_t dns_cache_hash(const struct dns_upstream *upstream,
+                               const char *qname, uint16_t qtype, uint16_t qclass);
+
+static struct dns_cache_entry *dns_cache_find(const struct dns_upstream *upstream,
+                                              const char *qname, uint16_t qtype, uint16_t qclass);
+
+static void dns_cache_remove(struct dns_cache_entry *e);
+
+static void lru_unlink(struct dns_cache_entry *e);
+
+static void lru_push(struct dns_cache_entry *e);
+
+///////////////////////////////////////////////////////////////////////////////
+
+static size_t entry_size(const struct dns_cache_entry *e) {
+    return sizeof(struct dns_cache_entry) + e->datalen;
+}
+
+static uint32_t dns_cache_hash(const struct dns_upstream *upstream,
+                               const char *qname, uint16_t qtype, uint16_t qclass) {
+    // The resolver and the lower case name
+    uint32_t h = hash_endpoint(upstream->version, upstream->addr, upstream->port);
+    h = hash_fnv1a_lower(h, qname);
+    h = hash_fnv1a(h, &qtype, sizeof(qtype));
+    return hash_fnv1a(h, &qclass, sizeof(qclass)) % DNS_CACHE_BUCKETS;
+}
+
+static void lru_unlink(struct dns_cache_entry *e) {
+    if (e->lru_prev == NULL)
+        lru_head = e->lru_next;
+    else
+        e->lru_prev->lru_next = e->lru_next;
+    if (e->lru_next == NULL)
+        lru_tail = e->lru_prev;
+    else
+        e->lru_next->lru_prev = e->lru_prev;
+    e->lru_prev = NULL;
+    e->lru_next = NULL;
+}
+
+static void lru_push(struct dns_cache_entry *e) {
+    e->lru_prev = NULL;
+    e->lru_next = lru_head;
+    if (lru_head != NULL)
+        lru_head->lru_prev = e;
+    lru_head = e;
+    if (lru_tail == NULL)
+        lru_tail = e;
+}
+
+static struct dns_cache_entry *dns_cache_find(const struct dns_upstream *upstream,
+                                              const char *qname, uint16_t qtype, uint16_t qclass) {
+    struct dns_cache_entry *e = dns_cache[dns_cache_hash(upstream, qname, qtype, qclass)];
+    while (e != NULL &&
+           !(e->qtype == qtype && e->qclass == qclass &&
+             is_dns_upstream_equal(&e->upstream, upstream) && strcasecmp(e->qname, qname) == 0))
+        e = e->next;
+    return e;
+}
+
+static void dns_cache_remove(struct dns_cache_entry *e) {
+    struct dns_cache_entry **p = &dns_cache[dns_cache_hash(&e->upstream, e->qname, e->qtype, e->qclass)];
+    while (*p != NULL && *p != e)
+        p = &(*p)->next;
+    if (*p != NULL)
+        *p = e->next;
+
+    lru_unlink(e);
+
+    dns_cache_bytes -= entry_size(e);
+    dns_cache_entries--;
+
+    ng_free(e->data, __FILE__, __LINE__);
+    ng_free(e, __FILE__, __LINE__);
+}
+
+void dns_cache_put(const struct dns_upstream *upstream,
+                   const char *qname, uint16_t qtype, uint16_t qclass,
+                   const uint8_t *data, size_t datalen, size_t qlen,
+                   const uint16_t *ttl_off, int ttl_count, uint32_t ttl, long long rtt) {
+    if (ttl == 0 || ttl_count <= 0 || ttl_count > DNS_CACHE_MAX_RR ||
+        qlen < sizeof(struct dns_header) || qlen > datalen)
+        return;
+
+    if (sizeof(struct dns_cache_entry) + datalen > DNS_CACHE_MAX_BYTES / 16) {
+        log_print(PLATFORM_LOG_PRIORITY_DEBUG, "DNS cache skip qname %s length %d", qname, datalen);
+        return;
+    }
+
+    if (ttl > DNS_CACHE_MAX_TTL)
+        ttl = DNS_CACHE_MAX_TTL;
+
+    struct dns_cache_entry *e = dns_cache_find(upstream, qname, qtype, qclass);
+    if (e != NULL)
+        dns_cache_remove(e);
+
+    e = ng_malloc(sizeof(struct dns_cache_entry), "dns cache entry");
+    e->upstream = *upstream;
+    strncpy(e->qname, qname, DNS_QNAME_MAX);
+    e->qname[DNS_QNAME_MAX] = 0;
+    e->qtype = qtype;
+    e->qclass = qclass;
+    e->stored = get_ms();
+    e->expires = e->stored + (long long) ttl * 1000;
+    e->rtt = (rtt > 0 ? rtt : 0);
+
+    // Keep the answer section only
+    e->data = ng_malloc(datalen, "dns cache data");
+    memcpy(e->data, data, datalen);
+    e->datalen = datalen;
+    e->qlen = qlen;
+    struct dns_header *dns = (struct dns_header *) e->data;
+    dns->auth_count = 0;
+    dns->add_count = 0;
+
+    memcpy(e->ttl_off, ttl_off, ttl_count * sizeof(uint16_t));
+    e->ttl_count = ttl_count;
+
+    // Make room, least recently used first
+    while (lru_tail != NULL && dns_cache_bytes + entry_size(e) > DNS_CACHE_MAX_BYTES) {
+        dns_cache_evictions++;
+        dns_cache_remove(lru_tail);
+    }
+
+    uint32_t h = dns_cache_hash(upstream, qname, qtype, qclass);
+    e->next = dns_cache[h];
+    dns_cache[h] = e;
+    lru_push(e);
+
+    dns_cache_bytes += entry_size(e);
+    dns_cache_entries++;
+
+    log_print(PLATFORM_LOG_PRIORITY_DEBUG,
+              "DNS cache put qname %s qtype %d ttl %u rtt %lld entries %lld bytes %d",
+              qname, qtype, ttl, e->rtt, dns_cache_entries, dns_cache_bytes);
+}
+
+size_t dns_cache_get(const struct dns_upstream *upstream,
+                     const char *qname, uint16_t qtype, uint16_t qclass,
+                     const uint8_t *query, size_t qlen, uint8_t **response) {
+    struct dns_cache_entry *e = dns_cache_find(upstream, qname, qtype, qclass);
+
+    long long now = get_ms();
+    if (e != NULL && now >= e->expires) {
+        dns_cache_remove(e);
+        e = NULL;
+    }
+
+    // The question is copied from the query, compression pointers need the same layout
+    if (e == NULL || e->qlen != qlen) {
+        dns_cache_misses++;
+        return 0;
+    }
+
+    uint8_t *r = ng_malloc(e->datalen, "dns cache response");
+    memcpy(r, e->data, e->datalen);
+    memcpy(r + sizeof(struct dns_header),
+           query + sizeof(struct dns_header), qlen - sizeof(struct dns_header));
+
+    const struct dns_header *qdns = (const struct dns_header *) query;
+    struct dns_header *rdns = (struct dns_header *) r;
+    rdns->id = qdns->id;
+    rdns->rd = qdns->rd;
+    rdns->cd = qdns->cd;
+
+    uint32_t age = (uint32_t) ((now - e->stored) / 1000);
+    for (int i = 0; i < e->ttl_count; i++) {
+        uint32_t ttl = ntohl(*((uint32_t *) (e->data + e->ttl_off[i])));
+        ttl = (ttl > age ? ttl - age : 0);
+        *((uint32_t *) (r + e->ttl_off[i])) = htonl(ttl);
+    }
+
+    lru_unlink(e);
+    lru_push(e);
+
+    dns_cache_hits++;
+    dns_cache_saved += e->rtt;
+
+    log_print(PLATFORM_LOG_PRIORITY_DEBUG,
+              "DNS cache hit qname %s qtype %d age %u hits %lld misses %lld saved %lld ms",
+              qname, qtype, age, dns_cache_hits, dns_cache_misses, dns_cache_saved);
+
+    *response = r;
+    return e->datalen;
+}
+
+void get_dns_cache_stats(long long *stats) {
+    stats[0] = dns_cache_hits;
+    stats[1] = dns_cache_misses;
+    stats[2] = dns_cache_entries;
+    stats[3] = (long long) dns_cache_bytes;
+    stats[4] = dns_cache_saved;
+    stats[5] = dns_cache_evictions;
+}
+
+void cleanup_dns_cache() {
+    while (lru_head != NULL)
+        dns_cache_remove(lru_head);
+    dns_cache_hits = 0;
+    dns_cache_misses = 0;
+    dns_cache_saved = 0;
+    dns_cache_evictions = 0;
+}
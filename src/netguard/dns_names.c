@@ -0,0 +1,210 @@
+#include "netguard.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// Definitions
+///////////////////////////////////////////////////////////////////////////////
+
+#define DNS_NAMES_BUCKETS 1024
+
+struct dns_names_entry {
+    int version;
+    uint8_t addr[16];
+    long long expires; // milliseconds
+
+    char *names; // question, NUL, space separated chain, NUL
+    size_t size;
+
+    struct dns_names_entry *next; // bucket
+    struct dns_names_entry *lru_prev;
+    struct dns_names_entry *lru_next;
+};
+
+static struct dns_names_entry *dns_names[DNS_NAMES_BUCKETS];
+static struct dns_names_entry *lru_head = NULL; // most recently used
+static struct dns_names_entry *lru_tail = NULL;
+
+static size_t dns_names_bytes = 0;
+static long long dns_names_entries = 0;
+static long long dns_names_hits = 0;
+static long long dns_names_misses = 0;
+static long long dns_names_evictions = 0;
+
+static uint32_t dns_names_hash(int version, const uint8_t *addr);
+
+static struct dns_names_entry *dns_names_find(int version, const uint8_t *addr);
+
+static void dns_names_remove(struct dns_names_entry *e);
+
+static void lru_unlink(struct dns_names_entry *e);
+
+static void lru_push(struct dns_names_entry *e);
+
+static struct dns_names_entry *get_eviction_candidate();
+
+///////////////////////////////////////////////////////////////////////////////
+
+static uint32_t dns_names_hash(int version, const uint8_t *addr) {
+    return hash_fnv1a(HASH_FNV1A_BASIS, addr, version == 4 ? 4 : 16) % DNS_NAMES_BUCKETS;
+}
+
+static void lru_unlink(struct dns_names_entry *e) {
+    if (e->lru_prev == NULL)
+        lru_head = e->lru_next;
+    else
+        e->lru_prev->lru_next = e->lru_next;
+    if (e->lru_next == NULL)
+        lru_tail = e->lru_prev;
+    else
+        e->lru_next->lru_prev = e->lru_prev;
+    e->lru_prev = NULL;
+    e->lru_next = NULL;
+}
+
+static void lru_push(struct dns_names_entry *e) {
+    e->lru_prev = NULL;
+    e->lru_next = lru_head;
+    if (lru_head != NULL)
+        lru_head->lru_prev = e;
+    lru_head = e;
+    if (lru_tail == NULL)
+        lru_tail = e;
+}
+
+static struct dns_names_entry *dns_names_find(int version, const uint8_t *addr) {
+    struct dns_names_entry *e = dns_names[dns_names_hash(version, addr)];
+    while (e != NULL &&
+           !(e->version == version && memcmp(e->addr, addr, version == 4 ? 4 : 16) == 0))
+        e = e->next;
+    return e;
+}
+
+static void dns_names_remove(struct dns_names_entry *e) {
+    struct dns_names_entry **p = &dns_names[dns_names_hash(e->version, e->addr)];
+    while (*p != NULL && *p != e)
+        p = &(*p)->next;
+    if (*p != NULL)
+        *p = e->next;
+
+    lru_unlink(e);
+
+    dns_names_bytes -= sizeof(struct dns_names_entry) + e->size;
+    dns_names_entries--;
+
+    ng_free(e->names, __FILE__, __LINE__);
+    ng_free(e, __FILE__, __LINE__);
+}
+
+static struct dns_names_entry *get_eviction_candidate() {
+    // Of the least recently used entries, the one expiring first
+    struct dns_names_entry *candidate = lru_tail;
+    struct dns_names_entry *e = lru_tail;
+    for (int i = 0; e != NULL && i < DNS_NAMES_SAMPLE; i++, e = e->lru_prev)
+        if (e->expires < candidate->expires)
+            candidate = e;
+    return candidate;
+}
+
+void dns_names_put(int version, const void *addr, const char *qname,
+                   const char *const *chain, int chain_count, uint32_t ttl) {
+    if (chain_count > DNS_NAMES_MAX_CHAIN)
+        chain_count = DNS_NAMES_MAX_CHAIN;
+
+    size_t size = strlen(qname) + 1;
+    for (int i = 0; i < chain_count; i++)
+        size += strlen(chain[i]) + 1;
+    if (chain_count == 0)
+        size++;
+
+    struct dns_names_entry *e = dns_names_find(version, addr);
+    if (e != NULL)
+        dns_names_remove(e);
+
+    e = ng_malloc(sizeof(struct dns_names_entry), "dns names entry");
+    e->version = version;
+    memset(e->addr, 0, sizeof(e->addr));
+    memcpy(e->addr, addr, version == 4 ? 4 : 16);
+    if (ttl > DNS_CACHE_MAX_TTL)
+        ttl = DNS_CACHE_MAX_TTL;
+    e->expires = get_ms() + (long long) ttl * 1000;
+
+    e->names = ng_malloc(size, "dns names");
+    e->size = size;
+    char *p = stpcpy(e->names, qname) + 1;
+    *p = 0;
+    for (int i = 0; i < chain_count; i++) {
+        if (i > 0)
+            *p++ = ' ';
+        p = stpcpy(p, chain[i]);
+    }
+
+    // Make room, of the least recently used the first to expire
+    while (lru_tail != NULL &&
+           dns_names_bytes + sizeof(struct dns_names_entry) + size > DNS_NAMES_MAX_BYTES) {
+        dns_names_evictions++;
+        dns_names_remove(get_eviction_candidate());
+    }
+
+    uint32_t h = dns_names_hash(version, e->addr);
+    e->next = dns_names[h];
+    dns_names[h] = e;
+    lru_push(e);
+
+    dns_names_bytes += sizeof(struct dns_names_entry) + size;
+    dns_names_entries++;
+
+    log_print(PLATFORM_LOG_PRIORITY_DEBUG,
+              "DNS names put qname %s chain %d ttl %u entries %lld bytes %d",
+              qname, chain_count, ttl, dns_names_entries, (int) dns_names_bytes);
+}
+
+int dns_names_get(int version, const void *addr, struct dns_names *names) {
+    struct dns_names_entry *e = dns_names_find(version, addr);
+
+    // Applications keep using addresses for a while after they expire
+    if (e != NULL && get_ms() >= e->expires + DNS_NAMES_GRACE * 1000LL) {
+        dns_names_remove(e);
+        e = NULL;
+    }
+
+    if (e == NULL) {
+        dns_names_misses++;
+        return 0;
+    }
+
+    lru_unlink(e);
+    lru_push(e);
+    dns_names_hits++;
+
+    names->qname = e->names;
+    names->chain = e->names + strlen(e->names) + 1;
+    names->expires = e->expires;
+    return 1;
+}
+
+const char *get_dns_names_data(int version, const void *addr, char *data, size_t size) {
+    struct dns_names names;
+    *data = 0;
+    if (dns_names_get(version, addr, &names)) {
+        if (*names.chain)
+            snprintf(data, size, "qname %s cname %s", names.qname, names.chain);
+        else
+            snprintf(data, size, "qname %s", names.qname);
+    }
+    return data;
+}
+
+void get_dns_names_stats(long long *stats) {
+    stats[0] = dns_names_hits;
+    stats[1] = dns_names_misses;
+    stats[2] = dns_names_entries;
+    stats[3] = (long long) dns_names_bytes;
+    stats[4] = dns_names_evictions;
+}
+
+void cleanup_dns_names() {
+    while (lru_head != NULL)
+        dns_names_remove(lru_head);
+    dns_names_hits = 0;
+    dns_names_misses = 0;
+    dns_names_evictions = 0;
+}
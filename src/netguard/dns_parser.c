@@ -0,0 +1,251 @@
+#include <stdint.h>
+#include <string.h>
+#include "platform.h"
+#include "dns_parser.h"
+
+// http://tools.ietf.org/html/rfc1035#section-4.1
+
+#define DNS_TYPE_A 1
+#define DNS_TYPE_NS 2
+#define DNS_TYPE_CNAME 5
+#define DNS_TYPE_PTR 12
+#define DNS_TYPE_AAAA 28
+#define DNS_TYPE_DNAME 39
+
+static int next_dns_label(const uint8_t *data, size_t len, uint16_t *pos, uint16_t *limit);
+
+static int walk_dns_name(const uint8_t *data, size_t len, uint16_t off, uint16_t *end);
+
+static int check_dns_rdata(const uint8_t *data, size_t len, const struct dns_rr_view *rr);
+
+///////////////////////////////////////////////////////////////////////////////
+
+static uint8_t dns_lower(uint8_t c) {
+    return (uint8_t) (c >= 'A' && c <= 'Z' ? c + ('a' - 'A') : c);
+}
+
+/**
+ * Move to the next label of a name, following compression pointers
+ * Every pointer must point before the previous one, so a walk always ends
+ *
+ * @param pos offset of the label, set to its first byte on return
+ * @param limit offset the next pointer must point before, initially the start of the name
+ * @returns
+ *  >=0 length of the label, zero for the root
+ *  -2  name out of bounds
+ *  -3  reserved label type
+ *  -4  pointer not pointing backwards
+ */
+static int next_dns_label(const uint8_t *data, size_t len, uint16_t *pos, uint16_t *limit) {
+    while (1) {
+        if (*pos >= len)
+            return -2;
+        uint8_t b = data[*pos];
+        if ((b & 0xc0) == 0xc0) {
+            if (*pos + 1 >= len)
+                return -2;
+            uint16_t target = (uint16_t) (((b & 0x3f) << 8) | data[*pos + 1]);
+            if (target >= *limit)
+                return -4;
+            *limit = target;
+            *pos = target;
+        } else if (b & 0xc0)
+            return -3;
+        else {
+            if (*pos + 1 + b > len)
+                return -2;
+            (*pos)++;
+            return b;
+        }
+    }
+}
+
+/**
+ * Check a name, its wire length included
+ *
+ * @param end set to the offset after the name in place, which is after its first pointer
+ * @return zero if valid, a negative error code of next_dns_label or -5 if too long
+ */
+static int walk_dns_name(const uint8_t *data, size_t len, uint16_t off, uint16_t *end) {
+    uint16_t pos = off;
+    uint16_t limit = off;
+    size_t wire = 0;
+    *end = 0;
+    while (1) {
+        uint16_t start = pos;
+        int label = next_dns_label(data, len, &pos, &limit);
+        if (label < 0)
+            return label;
+
+        // The name in place ends at the first pointer or the root label
+        if (*end == 0 && pos - 1 != start)
+            *end = (uint16_t) (start + 2);
+
+        wire += 1 + label;
+        if (wire > DNS_NAME_MAX)
+            return -5;
+        if (label == 0)
+            break;
+        pos += label;
+    }
+    if (*end == 0)
+        *end = pos;
+    return 0;
+}
+
+/**
+ * Check the record data of types whose layout is used by consumers
+ *
+ * @return zero if valid, -9 otherwise
+ */
+static int check_dns_rdata(const uint8_t *data, size_t len, const struct dns_rr_view *rr) {
+    switch (rr->type) {
+        case DNS_TYPE_A:
+            return (rr->rdlength == 4 ? 0 : -9);
+        case DNS_TYPE_AAAA:
+            return (rr->rdlength == 16 ? 0 : -9);
+        case DNS_TYPE_NS:
+        case DNS_TYPE_CNAME:
+        case DNS_TYPE_PTR:
+        case DNS_TYPE_DNAME: {
+            // A single name, exactly filling the record data
+            uint16_t end;
+            if (rr->rdlength == 0 ||
+                walk_dns_name(data, rr->rdata + rr->rdlength, rr->rdata, &end) < 0 ||
+                end != rr->rdata + rr->rdlength)
+                return -9;
+            return 0;
+        }
+        default:
+            return 0;
+    }
+}
+
+/**
+ * @returns
+ *  0   valid message
+ *  -1  shorter than the header
+ *  -2  name out of bounds
+ *  -3  reserved label type
+ *  -4  compression pointer not pointing backwards
+ *  -5  name too long
+ *  -6  question truncated
+ *  -7  resource record truncated
+ *  -8  record data out of bounds
+ *  -9  invalid A, AAAA or name record data
+ */
+int parse_dns_message(struct dns_message *msg, const uint8_t *data, size_t len) {
+    msg->data = data;
+    msg->len = len;
+    msg->rr_count = 0;
+    msg->sections = 0;
+    if (len < DNS_HEADER_LEN)
+        return -1;
+
+    // Offsets are 16 bits, as are compression pointers
+    if (len > UINT16_MAX)
+        msg->len = len = UINT16_MAX;
+
+    msg->id = get_dns_u16(data);
+    msg->flags = get_dns_u16(data + 2);
+    for (int s = 0; s < 4; s++)
+        msg->count[s] = get_dns_u16(data + 4 + 2 * s);
+
+    uint16_t off = DNS_HEADER_LEN;
+    for (int s = 0; s < 4; s++) {
+        for (int i = 0; i < msg->count[s]; i++) {
+            struct dns_rr_view rr;
+            rr.name = off;
+            rr.section = (uint8_t) s;
+            int err = walk_dns_name(data, len, off, &off);
+            if (err < 0)
+                return err;
+
+            if (s == DNS_SECTION_QUESTION) {
+                if (off + 4 > len)
+                    return -6;
+                rr.type = get_dns_u16(data + off);
+                rr.class = get_dns_u16(data + off + 2);
+                off += 4;
+                rr.rdata = off;
+                rr.rdlength = 0;
+                rr.ttl = 0;
+            } else {
+                if (off + 10 > len)
+                    return -7;
+                rr.type = get_dns_u16(data + off);
+                rr.class = get_dns_u16(data + off + 2);
+                rr.ttl = get_dns_u32(data + off + 4);
+                rr.rdlength = get_dns_u16(data + off + 8);
+                off += 10;
+                if (off + rr.rdlength > len)
+                    return -8;
+                rr.rdata = off;
+                off += rr.rdlength;
+                if ((err = check_dns_rdata(data, len, &rr)) < 0)
+                    return err;
+            }
+
+            if (msg->rr_count < DNS_PARSE_MAX_RR)
+                msg->rr[msg->rr_count++] = rr;
+        }
+        msg->end[s] = off;
+        msg->sections++;
+    }
+
+    return 0;
+}
+
+int get_dns_name(const struct dns_message *msg, uint16_t off, char *name) {
+    uint16_t pos = off;
+    uint16_t limit = off;
+    int n = 0;
+    while (1) {
+        int label = next_dns_label(msg->data, msg->len, &pos, &limit);
+        if (label < 0 || n + label + 1 > DNS_NAME_MAX) {
+            *name = 0;
+            return -1;
+        }
+        if (label == 0)
+            break;
+        // Text names end at the first NUL
+        if (memchr(msg->data + pos, 0, (size_t) label) != NULL) {
+            *name = 0;
+            return -1;
+        }
+        if (n > 0)
+            name[n++] = '.';
+        memcpy(name + n, msg->data + pos, (size_t) label);
+        n += label;
+        pos += label;
+    }
+    name[n] = 0;
+    return n;
+}
+
+int is_dns_name_equal(const struct dns_message *msg, uint16_t off1, uint16_t off2) {
+    uint16_t pos1 = off1, limit1 = off1;
+    uint16_t pos2 = off2, limit2 = off2;
+    size_t wire = 0;
+    while (1) {
+        // Offsets are equal once both names reach the same suffix
+        if (pos1 == pos2)
+            return 1;
+
+        int label1 = next_dns_label(msg->data, msg->len, &pos1, &limit1);
+        int label2 = next_dns_label(msg->data, msg->len, &pos2, &limit2);
+        if (label1 < 0 || label2 < 0 || label1 != label2)
+            return 0;
+        if (label1 == 0)
+            return 1;
+
+        wire += 1 + label1;
+        if (wire > DNS_NAME_MAX)
+            return 0;
+        for (int i = 0; i < label1; i++)
+            if (dns_lower(msg->data[pos1 + i]) != dns_lower(msg->data[pos2 + i]))
+                return 0;
+        pos1 += label1;
+        pos2 += label2;
+    }
+}
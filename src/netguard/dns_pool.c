@@ -0,0 +1,361 @@
+#include "netguard.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// Definitions
+///////////////////////////////////////////////////////////////////////////////
+
+#define DNS_POOL_RESOLVERS 4 // upstream resolvers
+#define DNS_POOL_SOCKETS 2 // sockets per resolver
+#define DNS_POOL_PENDING 256 // outstanding queries per resolver
+#define DNS_POOL_TIMEOUT 15000 // milliseconds
+#define DNS_POOL_YIELD 10 // datagrams
+#define DNS_POOL_ROTATE 100 // queries per socket, for a fresh source port
+#define DNS_POOL_MAXMSG (IP_MAXPACKET - 20 - 8) // bytes
+
+struct dns_resolver;
+
+struct dns_pool_socket {
+    int socket;
+    struct epoll_event ev;
+    struct dns_resolver *resolver;
+    int queries; // sent since opened
+};
+
+struct dns_mapping {
+    uint16_t id; // upstream, network notation
+    uint16_t qid; // client, network notation
+    struct ng_session *session;
+    struct dns_pool_socket *ps;
+    long long time;
+};
+
+struct dns_resolver {
+    int version; // 0 = unused
+    union {
+        __be32 ip4; // network notation
+        struct in6_addr ip6;
+    } addr;
+    __be16 port; // network notation
+    long long used;
+    int next;
+    struct dns_pool_socket sockets[DNS_POOL_SOCKETS];
+    struct dns_mapping pending[DNS_POOL_PENDING];
+};
+
+static struct dns_resolver dns_pool[DNS_POOL_RESOLVERS];
+
+static struct dns_resolver *get_dns_resolver(const struct arguments *args,
+                                             const struct dns_upstream *upstream,
+                                             int epoll_fd);
+
+static int open_dns_pool_socket(const struct arguments *args,
+                                struct dns_resolver *r, struct dns_pool_socket *ps,
+                                int epoll_fd);
+
+static void close_dns_resolver(struct dns_resolver *r);
+
+static void rotate_dns_pool_socket(struct dns_resolver *r, struct dns_pool_socket *ps);
+
+///////////////////////////////////////////////////////////////////////////////
+
+static int open_dns_pool_socket(const struct arguments *args,
+                                struct dns_resolver *r, struct dns_pool_socket *ps,
+                                int epoll_fd) {
+    int sock = socket(r->version == 4 ? PF_INET : PF_INET6, SOCK_DGRAM, IPPROTO_UDP);
+    if (sock < 0) {
+        log_print(PLATFORM_LOG_PRIORITY_ERROR, "DNS pool socket error %d: %s",
+                  errno, strerror(errno));
+        return -1;
+    }
+
+    if (protect_socket(args, sock) < 0) {
+        close(sock);
+        return -1;
+    }
+
+    int flags = fcntl(sock, F_GETFL, 0);
+    if (flags < 0 || fcntl(sock, F_SETFL, flags | O_NONBLOCK) < 0)
+        log_print(PLATFORM_LOG_PRIORITY_ERROR, "DNS pool fcntl O_NONBLOCK error %d: %s",
+                  errno, strerror(errno));
+
+    // Connect so only answers of the resolver are received
+    int err;
+    if (r->version == 4) {
+        struct sockaddr_in addr4;
+        memset(&addr4, 0, sizeof(struct sockaddr_in));
+        addr4.sin_family = AF_INET;
+        addr4.sin_addr.s_addr = r->addr.ip4;
+        addr4.sin_port = r->port;
+        err = connect(sock, (const struct sockaddr *) &addr4, sizeof(struct sockaddr_in));
+    } else {
+        struct sockaddr_in6 addr6;
+        memset(&addr6, 0, sizeof(struct sockaddr_in6));
+        addr6.sin6_family = AF_INET6;
+        memcpy(&addr6.sin6_addr, &r->addr.ip6, 16);
+        addr6.sin6_port = r->port;
+        err = connect(sock, (const struct sockaddr *) &addr6, sizeof(struct sockaddr_in6));
+    }
+    if (err < 0) {
+        log_print(PLATFORM_LOG_PRIORITY_ERROR, "DNS pool connect error %d: %s",
+                  errno, strerror(errno));
+        close(sock);
+        return -1;
+    }
+
+    ps->socket = sock;
+    ps->resolver = r;
+    ps->queries = 0;
+    memset(&ps->ev, 0, sizeof(struct epoll_event));
+    ps->ev.events = EPOLLIN | EPOLLERR;
+    ps->ev.data.ptr = ps;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, sock, &ps->ev))
+        log_print(PLATFORM_LOG_PRIORITY_ERROR, "epoll add dns pool error %d: %s",
+                  errno, strerror(errno));
+
+    log_print(PLATFORM_LOG_PRIORITY_DEBUG, "DNS pool socket %d", sock);
+    return sock;
+}
+
+static void close_dns_resolver(struct dns_resolver *r) {
+    for (int i = 0; i < DNS_POOL_SOCKETS; i++)
+        if (r->sockets[i].socket >= 0) {
+            if (close(r->sockets[i].socket))
+                log_print(PLATFORM_LOG_PRIORITY_ERROR, "DNS pool close %d error %d: %s",
+                          r->sockets[i].socket, errno, strerror(errno));
+            r->sockets[i].socket = -1;
+        }
+    memset(r->pending, 0, sizeof(r->pending));
+    r->version = 0;
+}
+
+static void rotate_dns_pool_socket(struct dns_resolver *r, struct dns_pool_socket *ps) {
+    // Close a socket that sent its share of queries once its answers are in,
+    // so spoofed answers cannot count on a long-lived source port
+    if (ps->socket < 0 || ps->queries < DNS_POOL_ROTATE)
+        return;
+
+    long long now = get_ms();
+    for (int i = 0; i < DNS_POOL_PENDING; i++)
+        if (r->pending[i].session != NULL && r->pending[i].ps == ps &&
+            now - r->pending[i].time <= DNS_POOL_TIMEOUT)
+            return;
+
+    for (int i = 0; i < DNS_POOL_PENDING; i++)
+        if (r->pending[i].ps == ps)
+            r->pending[i].session = NULL;
+
+    log_print(PLATFORM_LOG_PRIORITY_DEBUG, "DNS pool rotating socket %d", ps->socket);
+    if (close(ps->socket))
+        log_print(PLATFORM_LOG_PRIORITY_ERROR, "DNS pool close %d error %d: %s",
+                  ps->socket, errno, strerror(errno));
+    ps->socket = -1;
+}
+
+static struct dns_resolver *get_dns_resolver(const struct arguments *args,
+                                             const struct dns_upstream *upstream,
+                                             int epoll_fd) {
+    // Find resolver, or the least recently used slot
+    int version = upstream->version;
+    struct dns_resolver *r = NULL;
+    struct dns_resolver *lru = NULL;
+    for (int i = 0; i < DNS_POOL_RESOLVERS && r == NULL; i++) {
+        struct dns_resolver *c = &dns_pool[i];
+        if (c->version == version && c->port == upstream->port &&
+            memcmp(&c->addr, upstream->addr, version == 4 ? 4 : 16) == 0)
+            r = c;
+        else if (lru == NULL || c->version == 0 ||
+                 (lru->version != 0 && c->used < lru->used))
+            lru = c;
+    }
+
+    if (r == NULL) {
+        if (lru->version != 0) {
+            log_print(PLATFORM_LOG_PRIORITY_WARN, "DNS pool replacing resolver");
+            close_dns_resolver(lru);
+        }
+        r = lru;
+        memset(r, 0, sizeof(struct dns_resolver));
+        r->version = version;
+        memcpy(&r->addr, upstream->addr, version == 4 ? 4 : 16);
+        r->port = upstream->port;
+        for (int i = 0; i < DNS_POOL_SOCKETS; i++)
+            r->sockets[i].socket = -1;
+    }
+
+    // (Re)open sockets
+    int opened = 0;
+    int available = 0;
+    for (int i = 0; i < DNS_POOL_SOCKETS; i++) {
+        rotate_dns_pool_socket(r, &r->sockets[i]);
+        if (r->sockets[i].socket < 0)
+            open_dns_pool_socket(args, r, &r->sockets[i], epoll_fd);
+        if (r->sockets[i].socket >= 0) {
+            opened++;
+            if (r->sockets[i].queries < DNS_POOL_ROTATE)
+                available++;
+        }
+    }
+    if (opened == 0) {
+        r->version = 0;
+        return NULL;
+    }
+    if (available == 0) {
+        log_print(PLATFORM_LOG_PRIORITY_WARN, "DNS pool sockets rotating");
+        return NULL;
+    }
+
+    r->used = get_ms();
+    return r;
+}
+
+int send_dns_pool(const struct arguments *args, struct ng_session *s,
+                  const uint8_t *data, size_t datalen,
+                  const struct dns_upstream *upstream, int epoll_fd) {
+    // Answers are accepted only for the question of the session
+    if (datalen < sizeof(struct dns_header) || !is_dns_question_tracked(&s->udp, data, datalen))
+        return 0;
+
+    struct dns_resolver *r = get_dns_resolver(args, upstream, epoll_fd);
+    if (r == NULL)
+        return 0;
+
+    // Get a free mapping and an unused transaction ID
+    long long now = get_ms();
+    struct dns_mapping *m = NULL;
+    for (int i = 0; i < DNS_POOL_PENDING && m == NULL; i++)
+        if (r->pending[i].session == NULL || now - r->pending[i].time > DNS_POOL_TIMEOUT)
+            m = &r->pending[i];
+    if (m == NULL) {
+        log_print(PLATFORM_LOG_PRIORITY_WARN, "DNS pool full");
+        return 0;
+    }
+
+    uint16_t id;
+    int used;
+    do {
+        arc4random_buf(&id, sizeof(id));
+        used = 0;
+        for (int i = 0; i < DNS_POOL_PENDING && !used; i++)
+            used = (r->pending[i].session != NULL && r->pending[i].id == id &&
+                    &r->pending[i] != m);
+    } while (used);
+
+    uint8_t *buffer = ng_malloc(datalen, "dns pool send");
+    memcpy(buffer, data, datalen);
+    memcpy(buffer, &id, sizeof(uint16_t));
+
+    // Round robin over the sockets of the resolver not being rotated
+    struct dns_pool_socket *ps = NULL;
+    for (int i = 0; i < DNS_POOL_SOCKETS && ps == NULL; i++) {
+        struct dns_pool_socket *c = &r->sockets[(r->next + i) % DNS_POOL_SOCKETS];
+        if (c->socket >= 0 && c->queries < DNS_POOL_ROTATE)
+            ps = c;
+    }
+    r->next = (r->next + 1) % DNS_POOL_SOCKETS;
+
+    ssize_t sent = send(ps->socket, buffer, datalen, MSG_NOSIGNAL);
+    ng_free(buffer, __FILE__, __LINE__);
+    if (sent != datalen) {
+        log_print(PLATFORM_LOG_PRIORITY_ERROR, "DNS pool send error %d: %s",
+                  errno, strerror(errno));
+        return 0;
+    }
+
+    ps->queries++;
+    m->id = id;
+    m->qid = *((uint16_t *) data);
+    m->session = s;
+    m->ps = ps;
+    m->time = now;
+
+    log_print(PLATFORM_LOG_PRIORITY_DEBUG, "DNS pool socket %d id %u qid %u",
+              ps->socket, ntohs(m->id), ntohs(m->qid));
+    return 1;
+}
+
+int is_dns_pool_socket(const void *ptr) {
+    return (ptr >= (const void *) &dns_pool[0] &&
+            ptr < (const void *) &dns_pool[DNS_POOL_RESOLVERS]);
+}
+
+void check_dns_pool_socket(const struct arguments *args, const struct epoll_event *ev) {
+    struct dns_pool_socket *ps = (struct dns_pool_socket *) ev->data.ptr;
+    struct dns_resolver *r = ps->resolver;
+
+    if (ev->events & EPOLLERR) {
+        int serr = 0;
+        socklen_t optlen = sizeof(int);
+        if (getsockopt(ps->socket, SOL_SOCKET, SO_ERROR, &serr, &optlen) == 0 && serr)
+            log_print(PLATFORM_LOG_PRIORITY_WARN, "DNS pool SO_ERROR %d: %s",
+                      serr, strerror(serr));
+
+        // The socket will be reopened on the next query, its answers are lost
+        for (int i = 0; i < DNS_POOL_PENDING; i++)
+            if (r->pending[i].ps == ps)
+                r->pending[i].session = NULL;
+        if (close(ps->socket))
+            log_print(PLATFORM_LOG_PRIORITY_ERROR, "DNS pool close %d error %d: %s",
+                      ps->socket, errno, strerror(errno));
+        ps->socket = -1;
+        return;
+    }
+
+    if (!(ev->events & EPOLLIN))
+        return;
+
+    uint8_t *buffer = ng_malloc(DNS_POOL_MAXMSG, "dns pool recv");
+    for (int count = 0; count < DNS_POOL_YIELD && !args->ctx->stopping; count++) {
+        ssize_t bytes = recv(ps->socket, buffer, DNS_POOL_MAXMSG, 0);
+        if (bytes < 0) {
+            if (errno != EINTR && errno != EAGAIN && errno != EWOULDBLOCK)
+                log_print(PLATFORM_LOG_PRIORITY_WARN, "DNS pool recv error %d: %s",
+                          errno, strerror(errno));
+            break;
+        }
+        if (bytes < sizeof(struct dns_header))
+            continue;
+
+        // Route the answer back to the originating flow
+        uint16_t id = *((uint16_t *) buffer);
+        struct dns_mapping *m = NULL;
+        for (int i = 0; i < DNS_POOL_PENDING && m == NULL; i++)
+            if (r->pending[i].session != NULL && r->pending[i].id == id && r->pending[i].ps == ps)
+                m = &r->pending[i];
+        if (m == NULL) {
+            log_print(PLATFORM_LOG_PRIORITY_WARN, "DNS pool unknown id %u", ntohs(id));
+            continue;
+        }
+
+        // A spoofed answer must also guess the question, the real answer may still come
+        if (!is_dns_question_tracked(&m->session->udp, buffer, (size_t) bytes)) {
+            log_print(PLATFORM_LOG_PRIORITY_WARN, "DNS pool id %u question mismatch", ntohs(id));
+            continue;
+        }
+
+        struct ng_session *s = m->session;
+        memcpy(buffer, &m->qid, sizeof(uint16_t));
+        m->session = NULL;
+
+        if (s->udp.state != UDP_ACTIVE)
+            continue;
+
+        s->udp.time = time(NULL);
+        forward_udp_data(args, s, buffer, (size_t) bytes);
+    }
+    ng_free(buffer, __FILE__, __LINE__);
+}
+
+void release_dns_pool(const struct udp_session *cur) {
+    for (int i = 0; i < DNS_POOL_RESOLVERS; i++)
+        if (dns_pool[i].version != 0)
+            for (int j = 0; j < DNS_POOL_PENDING; j++)
+                if (dns_pool[i].pending[j].session != NULL &&
+                    &dns_pool[i].pending[j].session->udp == cur)
+                    dns_pool[i].pending[j].session = NULL;
+}
+
+void cleanup_dns_pool() {
+    for (int i = 0; i < DNS_POOL_RESOLVERS; i++)
+        if (dns_pool[i].version != 0)
+            close_dns_resolver(&dns_pool[i]);
+}
@@ -0,0 +1,87 @@
+#include <stdint.h>
+#include <string.h>
+#include "memory.h"
+#include "dns_stream.h"
+
+// https://tools.ietf.org/html/rfc7766#section-8
+
+#define DNS_STREAM_MIN_SIZE 512
+
+static int reserve_dns_stream(struct dns_stream *ds, size_t len);
+
+///////////////////////////////////////////////////////////////////////////////
+
+static int reserve_dns_stream(struct dns_stream *ds, size_t len) {
+    if (ds->len + len <= ds->size)
+        return 0;
+
+    size_t size = (ds->size < DNS_STREAM_MIN_SIZE ? DNS_STREAM_MIN_SIZE : ds->size);
+    while (size < ds->len + len)
+        size *= 2;
+
+    uint8_t *data = ng_realloc(ds->data, size, "dns stream");
+    if (data == NULL)
+        return -1;
+    ds->data = data;
+    ds->size = size;
+    return 0;
+}
+
+int decode_dns_stream(struct dns_stream *ds, const uint8_t *data, size_t len,
+                      dns_stream_handler handler, void *ctx) {
+    if (reserve_dns_stream(ds, len) < 0)
+        return -1;
+    memcpy(ds->data + ds->len, data, len);
+    ds->len += len;
+
+    int messages = 0;
+    while (ds->len - ds->ready >= DNS_STREAM_PREFIX) {
+        uint8_t *prefix = ds->data + ds->ready;
+        size_t mlen = (size_t) ((prefix[0] << 8) | prefix[1]);
+        if (ds->len - ds->ready - DNS_STREAM_PREFIX < mlen)
+            break;
+
+        // Rewritten messages only shrink, close the gap after them
+        size_t rlen = (mlen > 0 ? handler(ctx, prefix + DNS_STREAM_PREFIX, mlen) : 0);
+        if (rlen < mlen) {
+            size_t end = ds->ready + DNS_STREAM_PREFIX + mlen;
+            memmove(prefix + DNS_STREAM_PREFIX + rlen, ds->data + end, ds->len - end);
+            ds->len -= mlen - rlen;
+            prefix[0] = (uint8_t) (rlen >> 8);
+            prefix[1] = (uint8_t) rlen;
+        }
+
+        ds->ready += DNS_STREAM_PREFIX + rlen;
+        ds->messages++;
+        messages++;
+    }
+
+    return messages;
+}
+
+size_t get_dns_stream_data(const struct dns_stream *ds, const uint8_t **data) {
+    *data = ds->data + ds->sent;
+    return ds->ready - ds->sent;
+}
+
+void consume_dns_stream(struct dns_stream *ds, size_t len) {
+    ds->sent += len;
+
+    // Keep the message being received at the start
+    if (ds->sent == ds->ready) {
+        memmove(ds->data, ds->data + ds->ready, ds->len - ds->ready);
+        ds->len -= ds->ready;
+        ds->ready = 0;
+        ds->sent = 0;
+    }
+}
+
+void free_dns_stream(struct dns_stream *ds) {
+    if (ds->data != NULL)
+        ng_free(ds->data, __FILE__, __LINE__);
+    ds->data = NULL;
+    ds->size = 0;
+    ds->len = 0;
+    ds->ready = 0;
+    ds->sent = 0;
+}
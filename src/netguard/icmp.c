@@ -363,7 +363,7 @@ ssize_t write_icmp(const struct arguments *args, const struct icmp_session *cur,
                 args->tun, dest, source, datalen,
                 icmp->icmp_type, icmp->icmp_code, icmp->icmp_id, icmp->icmp_seq);
 
-    ssize_t res = write(args->tun, buffer, len);
+    ssize_t res = write_tun(args, buffer, len, NULL);
 
     // Write PCAP record
     if (res >= 0) {
@@ -381,3 +381,83 @@ ssize_t write_icmp(const struct arguments *args, const struct icmp_session *cur,
 
     return res;
 }
+
+/**
+ * Report an upstream error to the client as the network would, with a destination unreachable
+ * quoting the IP header and the first eight bytes of the transport header of the flow
+ *
+ * @param saddr client address, daddr upstream address, network notation
+ * @param transport first eight bytes of the transport header the client sent
+ * @param err errno of the upstream socket
+ * @return bytes written, 0 if the error is not an unreachable destination, negative on error
+ */
+ssize_t write_icmp_unreachable(const struct arguments *args, int version, uint8_t protocol,
+                               const void *saddr, const void *daddr,
+                               const uint8_t *transport, int err) {
+    int code;
+    if (err == ECONNREFUSED)
+        code = (version == 4 ? ICMP_UNREACH_PORT : ICMP6_DST_UNREACH_NOPORT);
+    else if (err == EHOSTUNREACH)
+        code = (version == 4 ? ICMP_UNREACH_HOST : ICMP6_DST_UNREACH_ADDR);
+    else if (err == ENETUNREACH)
+        code = (version == 4 ? ICMP_UNREACH_NET : ICMP6_DST_UNREACH_NOROUTE);
+    else
+        return 0;
+
+    struct icmp_session sicmp;
+    memset(&sicmp, 0, sizeof(struct icmp_session));
+    sicmp.version = version;
+    memcpy(&sicmp.saddr, saddr, version == 4 ? 4 : 16);
+    memcpy(&sicmp.daddr, daddr, version == 4 ? 4 : 16);
+
+    // Message header, the quoted IP header and the start of the transport header
+    uint8_t buffer[8 + sizeof(struct ip6_hdr) + 8];
+    memset(buffer, 0, sizeof(buffer));
+    size_t len;
+    uint16_t csum = 0;
+    if (version == 4) {
+        struct iphdr *ip4 = (struct iphdr *) (buffer + 8);
+        ip4->version = 4;
+        ip4->ihl = sizeof(struct iphdr) >> 2;
+        ip4->tot_len = htons(sizeof(struct iphdr) + 8);
+        ip4->ttl = IPDEFTTL;
+        ip4->protocol = protocol;
+        ip4->saddr = sicmp.saddr.ip4;
+        ip4->daddr = sicmp.daddr.ip4;
+        ip4->check = ~calc_checksum(0, (uint8_t *) ip4, sizeof(struct iphdr));
+        memcpy(buffer + 8 + sizeof(struct iphdr), transport, 8);
+        len = 8 + sizeof(struct iphdr) + 8;
+
+        buffer[0] = ICMP_UNREACH;
+    } else {
+        struct ip6_hdr *ip6 = (struct ip6_hdr *) (buffer + 8);
+        ip6->ip6_ctlun.ip6_un1.ip6_un1_plen = htons(8);
+        ip6->ip6_ctlun.ip6_un1.ip6_un1_nxt = protocol;
+        ip6->ip6_ctlun.ip6_un1.ip6_un1_hlim = IPDEFTTL;
+        ip6->ip6_ctlun.ip6_un2_vfc = IPV6_VERSION;
+        memcpy(&ip6->ip6_src, &sicmp.saddr.ip6, 16);
+        memcpy(&ip6->ip6_dst, &sicmp.daddr.ip6, 16);
+        memcpy(buffer + 8 + sizeof(struct ip6_hdr), transport, 8);
+        len = 8 + sizeof(struct ip6_hdr) + 8;
+
+        buffer[0] = ICMP6_DST_UNREACH;
+
+        // The message goes from the upstream to the client
+        struct ip6_hdr_pseudo pseudo;
+        memset(&pseudo, 0, sizeof(struct ip6_hdr_pseudo));
+        memcpy(&pseudo.ip6ph_src, &sicmp.daddr.ip6, 16);
+        memcpy(&pseudo.ip6ph_dst, &sicmp.saddr.ip6, 16);
+        pseudo.ip6ph_len = htonl((uint32_t) len);
+        pseudo.ip6ph_nxt = IPPROTO_ICMPV6;
+        csum = calc_checksum(0, (uint8_t *) &pseudo, sizeof(struct ip6_hdr_pseudo));
+    }
+    buffer[1] = (uint8_t) code;
+
+    struct icmp *icmp = (struct icmp *) buffer;
+    icmp->icmp_cksum = ~calc_checksum(csum, buffer, len);
+
+    log_print(PLATFORM_LOG_PRIORITY_WARN, "ICMP unreachable v%d protocol %d code %d error %d: %s",
+              version, protocol, code, err, strerror(err));
+
+    return write_icmp(args, &sicmp, buffer, len);
+}
@@ -0,0 +1,56 @@
+#ifndef DNS_CACHE_H
+#define DNS_CACHE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#define DNS_CACHE_MAX_BYTES (256 * 1024) // bytes
+#define DNS_CACHE_MAX_TTL 3600 // seconds
+#define DNS_CACHE_MAX_RR 32 // answers per response
+
+#define DNS_CACHE_STATS 6
+
+// The resolver a query is sent to, after any redirect
+struct dns_upstream {
+    int version;
+    uint8_t addr[16]; // network notation
+    uint16_t port; // network notation
+};
+
+static inline int is_dns_upstream_equal(const struct dns_upstream *a, const struct dns_upstream *b) {
+    return (a->version == b->version && a->port == b->port &&
+            memcmp(a->addr, b->addr, a->version == 4 ? 4 : 16) == 0);
+}
+
+/**
+ * @brief Store a DNS response of a resolver for the given question.
+ * @param data the response, truncated after the answer section
+ * @param qlen length of the header and the question
+ * @param ttl_off offsets of the TTL fields of the answers in data
+ * @param rtt milliseconds the upstream resolver took to answer, 0 if unknown
+ */
+void dns_cache_put(const struct dns_upstream *upstream,
+                   const char *qname, uint16_t qtype, uint16_t qclass,
+                   const uint8_t *data, size_t datalen, size_t qlen,
+                   const uint16_t *ttl_off, int ttl_count, uint32_t ttl, long long rtt);
+
+/**
+ * @brief Build a response for a query from the cache.
+ * The transaction ID and the question are copied from the query and the TTLs are aged.
+ * @param query the query, of which the header and question are qlen bytes
+ * @param response set to a buffer allocated with ng_malloc on a hit
+ * @return length of the response, "0" on a miss
+ */
+size_t dns_cache_get(const struct dns_upstream *upstream,
+                     const char *qname, uint16_t qtype, uint16_t qclass,
+                     const uint8_t *query, size_t qlen, uint8_t **response);
+
+/**
+ * @brief Get cache counters: hits, misses, entries, bytes, milliseconds saved, evictions.
+ */
+void get_dns_cache_stats(long long *stats);
+
+void cleanup_dns_cache();
+
+#endif // DNS_CACHE_H
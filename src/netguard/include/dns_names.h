@@ -0,0 +1,50 @@
+#ifndef DNS_NAMES_H
+#define DNS_NAMES_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define DNS_NAMES_MAX_BYTES (128 * 1024) // bytes
+#define DNS_NAMES_MAX_CHAIN 8 // CNAMEs kept per address
+#define DNS_NAMES_GRACE (10 * 60) // seconds an expired address is still named
+#define DNS_NAMES_SAMPLE 8 // least recently used entries of which the first to expire is evicted
+#define DNS_NAMES_DATA_MAX 512 // bytes, packet data describing the names
+
+#define DNS_NAMES_STATS 5
+
+// Names an address was resolved for, valid until the next dns_names_put
+struct dns_names {
+    const char *qname;
+    const char *chain; // CNAMEs from the question to the address, space separated, or empty
+    long long expires; // milliseconds
+};
+
+/**
+ * @brief Remember the names an address was resolved for.
+ * @param addr IPv4 or IPv6 address, network notation
+ * @param chain CNAMEs from the question to the address, the owner of the address last
+ * @param ttl seconds, of the address record
+ */
+void dns_names_put(int version, const void *addr, const char *qname,
+                   const char *const *chain, int chain_count, uint32_t ttl);
+
+/**
+ * @brief Find the names an address was resolved for.
+ * @return 1 if found, 0 otherwise
+ */
+int dns_names_get(int version, const void *addr, struct dns_names *names);
+
+/**
+ * @brief Describe an address by its names as packet data: "qname <name> [cname <name> ...]".
+ * @return data, an empty string if the address is not known
+ */
+const char *get_dns_names_data(int version, const void *addr, char *data, size_t size);
+
+/**
+ * @brief Get counters: hits, misses, entries, bytes, evictions.
+ */
+void get_dns_names_stats(long long *stats);
+
+void cleanup_dns_names();
+
+#endif // DNS_NAMES_H
@@ -0,0 +1,72 @@
+#ifndef DNS_PARSER_H
+#define DNS_PARSER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define DNS_HEADER_LEN 12
+#define DNS_NAME_MAX 255 // bytes on the wire
+#define DNS_PARSE_MAX_RR 64 // records indexed per message, questions included
+
+#define DNS_SECTION_QUESTION 0
+#define DNS_SECTION_ANSWER 1
+#define DNS_SECTION_AUTHORITY 2
+#define DNS_SECTION_ADDITIONAL 3
+
+// A question or resource record, as offsets into the parsed message
+struct dns_rr_view {
+    uint16_t name; // owner name
+    uint16_t type;
+    uint16_t class;
+    uint16_t rdata; // end of the question, TTL of a resource record at rdata - 6
+    uint16_t rdlength;
+    uint32_t ttl;
+    uint8_t section;
+};
+
+// Index of a message, valid as long as the message is
+struct dns_message {
+    const uint8_t *data;
+    size_t len;
+    uint16_t id;
+    uint16_t flags;
+    uint16_t count[4]; // records per section, from the header
+    uint16_t end[4]; // offset after each section
+    int sections; // complete, all four for a valid message
+    int rr_count; // records indexed, more than DNS_PARSE_MAX_RR are checked only
+    struct dns_rr_view rr[DNS_PARSE_MAX_RR];
+};
+
+// Big endian, without alignment requirements
+static inline uint16_t get_dns_u16(const uint8_t *data) {
+    return (uint16_t) ((data[0] << 8) | data[1]);
+}
+
+static inline uint32_t get_dns_u32(const uint8_t *data) {
+    return ((uint32_t) data[0] << 24) | ((uint32_t) data[1] << 16) |
+           ((uint32_t) data[2] << 8) | data[3];
+}
+
+/**
+ * Check and index all sections of a DNS message in a single pass, without allocating
+ * Compression pointers must point backwards, which bounds every name walk
+ * When invalid, the sections before the invalid record stay indexed
+ *
+ * @return zero when the whole message is valid, a negative error code otherwise
+ */
+int parse_dns_message(struct dns_message *msg, const uint8_t *data, size_t len);
+
+/**
+ * Copy a name of an indexed message as dotted text, the root as an empty string
+ *
+ * @param name buffer of at least DNS_NAME_MAX + 1 bytes
+ * @return length of the name, negative if invalid or containing a NUL byte
+ */
+int get_dns_name(const struct dns_message *msg, uint16_t off, char *name);
+
+/**
+ * Compare two names of an indexed message case-insensitively, without copying
+ */
+int is_dns_name_equal(const struct dns_message *msg, uint16_t off1, uint16_t off2);
+
+#endif // DNS_PARSER_H
@@ -0,0 +1,57 @@
+#ifndef DNS_STREAM_H
+#define DNS_STREAM_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define DNS_STREAM_PREFIX 2 // length of a message over TCP
+
+/**
+ * Length-prefixed DNS messages of a TCP stream, in a single buffer:
+ * [0, sent) forwarded, [sent, ready) complete messages to forward,
+ * [ready, len) the message being received, its length prefix included
+ */
+struct dns_stream {
+    uint8_t *data;
+    size_t size;
+    size_t len;
+    size_t ready;
+    size_t sent;
+    long long messages;
+};
+
+/**
+ * Handle a complete message, which may be rewritten in place
+ *
+ * @return new length of the message, at most the old length
+ */
+typedef size_t (*dns_stream_handler)(void *ctx, uint8_t *message, size_t len);
+
+/**
+ * Append received bytes and handle every message they complete
+ *
+ * @return number of messages completed, -1 if out of memory
+ */
+int decode_dns_stream(struct dns_stream *ds, const uint8_t *data, size_t len,
+                      dns_stream_handler handler, void *ctx);
+
+/**
+ * @return number of bytes of complete messages to forward, from *data
+ */
+size_t get_dns_stream_data(const struct dns_stream *ds, const uint8_t **data);
+
+/**
+ * Mark bytes returned by get_dns_stream_data as forwarded
+ */
+void consume_dns_stream(struct dns_stream *ds, size_t len);
+
+/**
+ * @return number of bytes of an incomplete message
+ */
+static inline size_t get_dns_stream_partial(const struct dns_stream *ds) {
+    return ds->len - ds->ready;
+}
+
+void free_dns_stream(struct dns_stream *ds);
+
+#endif // DNS_STREAM_H
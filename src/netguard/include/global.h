@@ -20,8 +20,29 @@ extern char socks5_addr[];
 extern int socks5_port;
 extern char socks5_username[];
 extern char socks5_password[];
+extern int socks5_optimistic;
+extern struct sockaddr_storage socks5_sockaddr;
+extern socklen_t socks5_sockaddr_len;
 
 // defined in netguard.c
 extern int loglevel;
 
+// defined in tcp.c
+extern int tcp_early_synack;
+
+// defined in udp.c
+extern int udp_gso;
+
+// defined in udp_mux.c
+extern int udp_mux;
+
+// defined in socks5_udp.c
+extern int socks5_udp;
+
+// defined in tcp_fastopen.c
+extern int tcp_fastopen;
+
+// defined in socket_pool.c
+extern int socket_pool;
+
 #endif // GLOBAL_H
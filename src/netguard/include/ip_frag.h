@@ -0,0 +1,33 @@
+#ifndef IP_FRAG_H
+#define IP_FRAG_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+#define IP_FRAG_MAX_BYTES (256 * 1024) // bytes, all datagrams being reassembled
+#define IP_FRAG_MAX_QUEUES 64 // datagrams being reassembled
+#define IP_FRAG_MAX_PIECES 64 // fragments per datagram
+#define IP_FRAG_TIMEOUT (30 * 1000) // ms, from the first fragment
+
+#define IP_FRAG_STATS 6
+
+/**
+ * @brief Add an IPv4 fragment to the datagram it belongs to, by source, destination, id and protocol.
+ * Overlapping fragments drop the whole datagram, exact duplicates are ignored.
+ * @param pkt fragment, its total length checked by the caller
+ * @param ms current time, expiring datagrams not completed in time
+ * @param datagram set to the reassembled datagram, to be freed by the caller;
+ * the header is that of the first fragment, its checksum is not set
+ * @return length of the reassembled datagram, 0 if incomplete, negative if dropped
+ */
+ssize_t add_ip_fragment(const uint8_t *pkt, size_t length, long long ms, uint8_t **datagram);
+
+/**
+ * @brief Get counters: fragments, reassembled, timeouts, overlaps, evictions, invalid.
+ */
+void get_ip_frag_stats(long long *stats);
+
+void cleanup_ip_fragments();
+
+#endif // IP_FRAG_H
@@ -21,6 +21,7 @@
 #include <dlfcn.h>
 #include <sys/stat.h>
 #include <sys/resource.h>
+#include <sys/uio.h>
 
 #include <netdb.h>
 #include <arpa/inet.h>
@@ -32,6 +33,9 @@
 #include <netinet/tcp.h>
 #include <netinet/ip_icmp.h>
 #include <netinet/icmp6.h>
+#include <net/if.h>
+#include <linux/if_tun.h>
+#include <linux/virtio_net.h>
 
 #include <android/log.h>
 #include <sys/system_properties.h>
@@ -43,6 +47,16 @@
 #include "platform.h"
 #include "icmp.h"
 #include "udp.h"
+#include "socks5.h"
+#include "dns.h"
+#include "dns_parser.h"
+#include "dns_cache.h"
+#include "dns_names.h"
+#include "dns_stream.h"
+#include "ip_frag.h"
+#include "rules.h"
+#include "tls.h"
+#include "quic.h"
 #include "session.h"
 #include "pcap.h"
 
@@ -63,6 +77,8 @@ struct arguments {
     int tun;
     jboolean fwd53;
     jint rcode;
+    int vnet_hdr; // virtio net header length, 0 if none
+    unsigned int offload; // TUN_F_* flags
     struct context *ctx;
 };
 
@@ -74,6 +90,7 @@ typedef struct packet {
     const char *source;
     uint32_t sport;
     const char *dest;
+    const void *daddr; // dest in network notation
     uint32_t dport;
     const char *data;
     uint32_t uid;
@@ -125,43 +142,179 @@ int get_udp_timeout(const struct udp_session *u, int sessions, int maxsessions);
 
 int get_tcp_timeout(const struct tcp_session *t, int sessions, int maxsessions);
 
+void set_mtu(int mtu);
+
 uint16_t get_mtu();
 
 uint16_t get_default_mss(int version);
 
+void negotiate_tun_offload(struct arguments *args);
+
 int check_tun(const struct arguments *args,
               const struct epoll_event *ev,
               int epoll_fd,
               int sessions, int maxsessions);
 
+ssize_t write_tun(const struct arguments *args, const uint8_t *buffer, size_t length,
+                  const struct virtio_net_hdr *hdr);
+
 void check_icmp_socket(const struct arguments *args, const struct epoll_event *ev);
 
 void check_udp_socket(const struct arguments *args, const struct epoll_event *ev);
 
+void flush_udp(const struct arguments *args);
+
+void cleanup_udp_buffers();
+
+void forward_udp_data(const struct arguments *args, struct ng_session *s,
+                      uint8_t *buffer, size_t bytes);
+
+
+struct dns_verdict {
+    uint8_t allowed; // by is_domain_blocked on the query path
+    uint16_t id; // network notation
+    uint32_t question; // hash of the name, type and class
+};
 
 /**
 * @brief Parses the DNS response and returns "1" if marked as blocked or "0" if not.
+* Questions allowed on the query path are not checked again.
 */
 int parse_dns_response(const struct arguments *args, const struct ng_session *session,
                         const uint8_t *data, size_t *datalen);
 
+size_t block_dns_query(const struct arguments *args, const struct ng_session *s,
+                       const uint8_t *data, size_t datalen, uint8_t *response,
+                       struct dns_verdict *verdict);
+
+void get_dns_upstream(int version, const void *daddr, __be16 dest,
+                      const struct allowed *redirect, struct dns_upstream *upstream);
+
+/**
+* @brief Answer a query from the cache of its resolver, reporting the addresses to Java.
+*/
+size_t get_cached_dns_response(const struct arguments *args, const struct dns_upstream *upstream,
+                               const uint8_t *data, size_t datalen, uint8_t **response);
+
+void track_dns_query(struct udp_session *cur, const uint8_t *data, size_t datalen,
+                     const struct dns_upstream *upstream, const struct dns_verdict *verdict);
+
+int get_tracked_dns_upstream(const struct udp_session *cur, struct dns_upstream *upstream);
+
+/**
+* @brief Check a query or response carries the single question tracked for the session.
+*/
+int is_dns_question_tracked(const struct udp_session *cur, const uint8_t *data, size_t datalen);
+
+void allow_dns_query(struct tcp_session *cur, const struct dns_verdict *verdict);
+
+void clear_dns_allowed(struct tcp_session *cur);
+
+int coalesce_dns_query(const struct arguments *args, const struct udp_session *cur,
+                       const struct dns_upstream *upstream,
+                       const uint8_t *data, size_t datalen);
+
+void answer_dns_waiters(const struct arguments *args, struct udp_session *cur,
+                        const uint8_t *data, size_t datalen);
+
+void clear_dns_query(struct udp_session *cur);
+
+int send_dns_pool(const struct arguments *args, struct ng_session *s,
+                  const uint8_t *data, size_t datalen,
+                  const struct dns_upstream *upstream, int epoll_fd);
+
+int is_dns_pool_socket(const void *ptr);
+
+void check_dns_pool_socket(const struct arguments *args, const struct epoll_event *ev);
+
+void release_dns_pool(const struct udp_session *cur);
+
+void cleanup_dns_pool();
+
+int open_udp_mux(const struct arguments *args, struct ng_session *s, int epoll_fd);
+
+ssize_t send_udp_mux(const struct udp_session *cur, const uint8_t *data, size_t datalen);
+
+int is_udp_mux_socket(const void *ptr);
+
+void check_udp_mux_socket(const struct arguments *args, const struct epoll_event *ev);
+
+void release_udp_mux(struct udp_session *cur);
+
+void cleanup_udp_mux();
+
+int resolve_socks5();
+
+int start_socks5(struct ng_session *s, const char *session);
+
+int recv_socks5(struct ng_session *s, const char *session);
+
+int open_socks5_udp(const struct arguments *args, struct ng_session *s, int epoll_fd);
+
+ssize_t send_socks5_udp(const struct udp_session *cur, const uint8_t *data, size_t datalen);
+
+int is_socks5_udp_socket(const void *ptr);
+
+void check_socks5_udp_socket(const struct arguments *args, const struct epoll_event *ev,
+                             int epoll_fd);
+
+void release_socks5_udp(struct udp_session *cur);
+
+void cleanup_socks5_udp();
+
+int get_pool_socket(const struct arguments *args, int type, int version);
+
+void fill_socket_pool(const struct arguments *args);
+
+void cleanup_socket_pool();
+
+int can_tcp_fastopen(const struct tcp_session *cur);
+
+ssize_t send_tcp_fastopen(struct tcp_session *cur, int sock,
+                          const uint8_t *data, size_t datalen,
+                          const struct sockaddr *addr, socklen_t addrlen);
+
+void check_tcp_fastopen(const struct ng_session *s, int connected);
+
+void cleanup_tcp_fastopen();
+
 void check_tcp_socket(const struct arguments *args,
                       const struct epoll_event *ev,
                       int epoll_fd);
 
+void set_tls_ports(const jint *ports, int count);
+
 /**
- * Inspect for SNI header, if found check if domain should be blocked
+ * Initial SNI inspection state for a new session to the given port
+ */
+uint8_t get_tls_state(__be16 port);
+
+/**
+ * Inspect the first client data for an SNI header, if found check if domain should be blocked
+ * Segments are reassembled until the first TLS record is complete, up to TLS_HELLO_MAX bytes
  *
- * @return "0" when SNI header should NOT be blocked, any other value otherwise
+ * @return TLS_SNI_PENDING when more data is needed, otherwise the final inspection state
  */
-int is_sni_found_and_blocked(const struct arguments *args,
-                              const uint8_t *pkt,
-                              size_t length,
-                              void *daddr,
-                              uint8_t version,
-                              const uint8_t *tcp_payload,
-                              int uid
-);
+uint8_t inspect_tls_sni(const struct arguments *args,
+                        struct tcp_session *cur,
+                        uint32_t seq,
+                        const uint8_t *data,
+                        size_t datalen);
+
+void clear_tls_hello(struct tcp_session *cur);
+
+/**
+ * Inspect the client Initials of a QUIC flow for the server name, like inspect_tls_sni
+ * CRYPTO frames are collected over datagrams until the ClientHello is complete
+ *
+ * @return TLS_SNI_PENDING when more datagrams are needed, otherwise the final inspection state
+ */
+uint8_t inspect_quic_sni(const struct arguments *args,
+                         struct udp_session *cur,
+                         const uint8_t *data,
+                         size_t datalen);
+
+void clear_quic_hello(struct udp_session *cur);
 
 jboolean handle_icmp(const struct arguments *args,
                      const uint8_t *pkt, size_t length,
@@ -187,6 +340,8 @@ int check_dhcp(const struct arguments *args, const struct udp_session *u,
 
 void clear_tcp_data(struct tcp_session *cur);
 
+void clear_udp_data(struct udp_session *cur);
+
 jboolean handle_tcp(const struct arguments *args,
                     const uint8_t *pkt, size_t length,
                     const uint8_t *payload,
@@ -198,6 +353,10 @@ void write_rst(const struct arguments *args, struct tcp_session *cur);
 ssize_t write_icmp(const struct arguments *args, const struct icmp_session *cur,
                    uint8_t *data, size_t datalen);
 
+ssize_t write_icmp_unreachable(const struct arguments *args, int version, uint8_t protocol,
+                               const void *saddr, const void *daddr,
+                               const uint8_t *transport, int err);
+
 ssize_t write_udp(const struct arguments *args, const struct udp_session *cur,
                   uint8_t *data, size_t datalen);
 
@@ -245,6 +404,7 @@ jint get_uid_q(const struct arguments *args,
 struct allowed *is_address_allowed(const struct arguments *args, const packet_t *packet);
 
 void account_usage(const struct arguments *args, uint32_t version, uint32_t protocol,
-                   const char *daddr, uint32_t dport, uint32_t uid, uint64_t sent, uint64_t received);
+                   const char *daddr, uint32_t dport, uint32_t uid, uint64_t sent, uint64_t received,
+                   const char *name);
 
 #endif // NETGUARD_H
@@ -0,0 +1,46 @@
+#ifndef QUIC_H
+#define QUIC_H
+
+#include "tls.h"
+
+#define QUIC_VERSION_1 0x00000001
+#define QUIC_VERSION_2 0x6b3343cf
+
+#define QUIC_INITIAL_MIN 1200 // bytes, client Initial datagrams are padded to at least this
+#define QUIC_HELLO_MAX 4096 // bytes, ClientHello reassembly cap
+#define QUIC_CID_MAX 20
+
+// Client Initial packet protection
+struct quic_keys {
+    uint32_t key[44]; // expanded AES-128 key
+    uint8_t iv[12];
+    uint32_t hp[44]; // expanded AES-128 header protection key
+};
+
+// ClientHello collected from the CRYPTO frames of client Initial packets
+struct quic_hello {
+    uint32_t version; // of the keys, zero until derived
+    uint8_t dcid_len;
+    uint8_t dcid[QUIC_CID_MAX];
+    struct quic_keys keys;
+    size_t contiguous; // bytes available from offset zero
+    uint8_t filled[QUIC_HELLO_MAX / 8];
+    uint8_t record[TLS_HEADER_LEN + QUIC_HELLO_MAX]; // prefixed with a TLS record header
+};
+
+/**
+ * Decrypt the client Initial packets of a datagram and collect their CRYPTO frames
+ *
+ * @return number of CRYPTO bytes collected, negative if the datagram has no client Initial
+ */
+int add_quic_initial(struct quic_hello *hello, const uint8_t *data, size_t datalen);
+
+/**
+ * Find the server name in the collected ClientHello without copying
+ *
+ * @return length of the server name, -1 if more CRYPTO data is needed, another negative
+ *         value if the complete ClientHello has no server name
+ */
+int find_quic_server_name(struct quic_hello *hello, const uint8_t **server_name);
+
+#endif // QUIC_H
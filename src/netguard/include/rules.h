@@ -0,0 +1,57 @@
+#ifndef RULES_H
+#define RULES_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define RULE_ACTION_JAVA 0 // decided by isAddressAllowed, also when no rule matches
+#define RULE_ACTION_ALLOW 1
+#define RULE_ACTION_DENY 2
+#define RULE_ACTION_REDIRECT 3
+
+#define RULE_ANY_UID (-1)
+#define RULE_ANY_PROTOCOL 0
+
+#define RULES_MAX 16384
+#define RULES_STATS 5
+
+struct rule {
+    int32_t uid; // or RULE_ANY_UID
+    uint8_t protocol; // or RULE_ANY_PROTOCOL
+    uint8_t version;
+    uint8_t addr[16]; // network notation
+    uint8_t prefix; // bits
+    uint16_t port_min; // host notation, TCP and UDP only
+    uint16_t port_max;
+    uint8_t action;
+    char raddr[46]; // redirect
+    uint16_t rport;
+};
+
+/**
+ * @brief Replace all rules at once.
+ * A flow is decided by the rules with the longest matching address prefix,
+ * of which the first in order matching the uid, protocol and port.
+ * @param rules NULL or none to let isAddressAllowed decide every flow
+ * @return zero, negative if invalid, leaving the rules unchanged
+ */
+int set_rules(const struct rule *rules, int count);
+
+/**
+ * @brief Find the rule deciding a flow.
+ * @param daddr network notation
+ * @param dport host notation
+ * @param rule set to the matching rule unless RULE_ACTION_JAVA is returned
+ * @return action of the matching rule, RULE_ACTION_JAVA if none
+ */
+int match_rule(int version, int protocol, const void *daddr, uint16_t dport, int32_t uid,
+               struct rule *rule);
+
+/**
+ * @brief Get counters: rules, allowed, denied, redirected, decided by Java.
+ */
+void get_rules_stats(long long *stats);
+
+void cleanup_rules();
+
+#endif // RULES_H
@@ -11,9 +11,11 @@ struct tcp_session {
     jint uid;
     time_t time;
     int version;
-    uint16_t mss;
-    uint8_t recv_scale;
-    uint8_t send_scale;
+    uint16_t mss; // client, clamped to the tun
+    uint16_t recv_mss; // advertised
+    uint8_t wscale; // window scaling negotiated
+    uint8_t recv_scale; // ours
+    uint8_t send_scale; // client
     uint32_t recv_window; // host notation, scaled
     uint32_t send_window; // host notation, scaled
     uint16_t unconfirmed; // packets
@@ -43,6 +45,16 @@ struct tcp_session {
 
     uint8_t state;
     uint8_t socks5;
+    uint8_t socks5_command; // SOCKS5_CMD_*
+    uint8_t *socks5_reply; // handshake reply being received
+    uint16_t socks5_received;
+    uint8_t fastopen; // data sent with the SYN
+    uint8_t early; // SYN-ACK sent before the upstream connected
+    uint8_t tls; // SNI inspection state
+    uint8_t *tls_hello; // ClientHello being reassembled
+    uint16_t tls_received;
+    struct dns_stream *dns; // responses being received on port 53
+    struct dns_allowed *dns_allowed; // queries allowed on the query path
     struct segment *forward;
 };
 
@@ -68,6 +80,17 @@ struct udp_session {
     __be16 dest; // network notation
 
     uint8_t state;
+    long long query_ms; // last DNS query forwarded
+    struct dns_query *dns;
+    struct udp_mux_socket *mux;
+    struct socks5_udp_socket *socks5; // relay socket, when relayed through the SOCKS5 proxy
+    uint8_t connected;
+    uint8_t gro;
+    uint8_t tls; // QUIC SNI inspection state
+    struct quic_hello *quic; // ClientHello being collected
+    struct udp_datagram *queue;
+    struct udp_datagram *queue_tail;
+    uint16_t queued; // datagrams
 };
 
 struct icmp_session {
@@ -0,0 +1,15 @@
+#ifndef SOCKS5_H
+#define SOCKS5_H
+
+#define SOCKS5_NONE 1
+#define SOCKS5_HELLO 2
+#define SOCKS5_AUTH 3
+#define SOCKS5_CONNECT 4
+#define SOCKS5_CONNECTED 5
+
+#define SOCKS5_CMD_CONNECT 1
+#define SOCKS5_CMD_UDP_ASSOCIATE 3
+
+#define SOCKS5_REPLY_MAX (4 + 1 + 255 + 2) // bytes, CONNECT reply with a domain name
+
+#endif // SOCKS5_H
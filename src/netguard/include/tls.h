@@ -3,11 +3,36 @@
 
 #define FQDN_LENGTH 256
 
+#define TLS_HEADER_LEN 5 // size of the TLS Record Header
+#define TLS_HELLO_MAX 8192 // bytes, ClientHello reassembly cap
+
 #define TLS_TYPE_HANDSHAKE_RECORD 22
 #define TLS_TYPE_APPLICATION_DATA 23
 
 #define TLS_EXTENSION_TYPE_SERVER_NAME 0
 
+// SNI inspection state of a TCP session
+#define TLS_SNI_NONE 0 // not inspected, not TLS
+#define TLS_SNI_PENDING 1
+#define TLS_SNI_ALLOWED 2
+#define TLS_SNI_BLOCKED 3
+
+// Big endian, without alignment requirements
+static inline uint16_t get_tls_u16(const uint8_t *data) {
+    return (uint16_t) ((data[0] << 8) | data[1]);
+}
+
+/**
+ * Find the server name of a ClientHello without copying
+ *
+ * @return length of the server name pointed to by server_name, a negative error code otherwise
+ */
+int find_server_name(
+    const uint8_t *data,
+    size_t data_len,
+    const uint8_t **server_name
+);
+
 int get_server_name(
     const uint8_t *pkt,
     size_t length,
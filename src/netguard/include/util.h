@@ -3,6 +3,24 @@
 
 #include <stdint.h>
 
+#define HASH_FNV1A_BASIS 2166136261u
+
+#define ENDPOINT_FLOW_BUCKETS 256
+
+struct ng_session;
+struct udp_session;
+
+// UDP flows sharing an upstream socket, keyed by the socket and the remote endpoint
+struct endpoint_flow {
+    const void *owner; // upstream socket
+    struct ng_session *session;
+    struct endpoint_flow *next;
+};
+
+struct endpoint_flows {
+    struct endpoint_flow *buckets[ENDPOINT_FLOW_BUCKETS];
+};
+
 uint16_t calc_checksum(uint16_t start, const uint8_t *buffer, size_t length);
 
 int compare_u32(uint32_t seq1, uint32_t seq2);
@@ -19,24 +37,23 @@ long long get_ms();
 
 const char *strstate(const int state);
 
-/**
- * @brief Verifies if the provided str is valid UTF-8 encoded.
- * @return "1" if valid UTF-8, "0" otherwise.
- *
- * A character in UTF8 can be from 1 to 4 bytes long, subjected to the following rules:
- * - For 1-byte character, the first bit is a 0, followed by its unicode code.
- * - For n-bytes character, the first n-bits are all one’s, the n+1 bit is 0, followed by n-1 bytes with most significant 2 bits being 10.
- * The following table summarizes the range of UTF-8 encoding for different n.
- *
- *  +---------------------+-------------------------------------+
- *  | Char. number range  |        UTF-8 octet sequence         |
- *  +---------------------+-------------------------------------+
- *  | 0000 0000-0000 007F | 0xxxxxxx                            |
- *  | 0000 0080-0000 07FF | 110xxxxx 10xxxxxx                   |
- *  | 0000 0800-0000 FFFF | 1110xxxx 10xxxxxx 10xxxxxx          |
- *  | 0001 0000-0010 FFFF | 11110xxx 10xxxxxx 10xxxxxx 10xxxxxx |
- *  +---------------------+-------------------------------------+
- */
-int is_valid_utf8(const char *str);
+uint32_t hash_fnv1a(uint32_t h, const void *data, size_t len);
+
+uint32_t hash_fnv1a_lower(uint32_t h, const char *str);
+
+// Addresses and ports in network notation
+uint32_t hash_endpoint(int version, const void *addr, uint16_t port);
+
+int is_broadcast_or_multicast(int version, const void *addr);
+
+struct ng_session *find_endpoint_flow(const struct endpoint_flows *flows, const void *owner,
+                                      int version, const void *addr, uint16_t port);
+
+void add_endpoint_flow(struct endpoint_flows *flows, const void *owner, struct ng_session *s);
+
+int remove_endpoint_flow(struct endpoint_flows *flows, const void *owner,
+                         const struct udp_session *cur);
+
+void clear_endpoint_flows(struct endpoint_flows *flows, void (*release)(struct ng_session *s));
 
 #endif // UTIL_H
@@ -24,6 +24,11 @@
 // Definitions
 ///////////////////////////////////////////////////////////////////////////////
 
+#define TUN_MTU_DEFAULT 10000 // bytes
+#define TUN_MTU_MIN 1280 // bytes, IPv6 minimum
+#define TUN_GSO_MAX 65535 // bytes
+#define TUN_VNET_HDR_MAX 32 // bytes
+
 static int is_lower_layer(int protocol);
 
 static int is_upper_layer(int protocol);
@@ -37,8 +42,22 @@ static void handle_ip(const struct arguments *args,
 
 int max_tun_msg = 0;
 
+static uint16_t tun_mtu = TUN_MTU_DEFAULT;
+
+void set_mtu(int mtu) {
+    if (mtu <= 0)
+        tun_mtu = TUN_MTU_DEFAULT;
+    else if (mtu < TUN_MTU_MIN)
+        tun_mtu = TUN_MTU_MIN;
+    else if (mtu > TUN_GSO_MAX)
+        tun_mtu = TUN_GSO_MAX;
+    else
+        tun_mtu = (uint16_t) mtu;
+    log_print(PLATFORM_LOG_PRIORITY_WARN, "MTU %d requested %d", tun_mtu, mtu);
+}
+
 uint16_t get_mtu() {
-    return 10000;
+    return tun_mtu;
 }
 
 uint16_t get_default_mss(int version) {
@@ -67,8 +86,24 @@ int check_tun(const struct arguments *args,
 
     // Check tun read
     if (ev->events & EPOLLIN) {
-        uint8_t *buffer = ng_malloc(get_mtu(), "tun read");
-        ssize_t length = read(args->tun, buffer, get_mtu());
+        ssize_t length;
+        uint8_t *buffer;
+        if (args->vnet_hdr) {
+            // Offloaded packets can be up to the IP maximum and need not be checksummed
+            uint8_t vnet[TUN_VNET_HDR_MAX];
+            struct iovec iov[2];
+            buffer = ng_malloc(TUN_GSO_MAX, "tun read");
+            iov[0].iov_base = vnet;
+            iov[0].iov_len = (size_t) args->vnet_hdr;
+            iov[1].iov_base = buffer;
+            iov[1].iov_len = TUN_GSO_MAX;
+            length = readv(args->tun, iov, 2);
+            if (length >= 0)
+                length = (length > args->vnet_hdr ? length - args->vnet_hdr : 0);
+        } else {
+            buffer = ng_malloc(get_mtu(), "tun read");
+            length = read(args->tun, buffer, get_mtu());
+        }
         if (length < 0) {
             ng_free(buffer, __FILE__, __LINE__);
 
@@ -109,6 +144,74 @@ int check_tun(const struct arguments *args,
     return 0;
 }
 
+void negotiate_tun_offload(struct arguments *args) {
+    args->vnet_hdr = 0;
+    args->offload = 0;
+
+    struct ifreq ifr;
+    memset(&ifr, 0, sizeof(struct ifreq));
+    if (ioctl(args->tun, TUNGETIFF, &ifr)) {
+        log_print(PLATFORM_LOG_PRIORITY_WARN, "tun %d TUNGETIFF error %d: %s",
+                  args->tun, errno, strerror(errno));
+        return;
+    }
+
+    // The header is part of every read and write once the device was created with it
+    if (!(ifr.ifr_flags & IFF_VNET_HDR)) {
+        log_print(PLATFORM_LOG_PRIORITY_WARN, "tun %d without virtio net header", args->tun);
+        return;
+    }
+
+    int hdrlen = sizeof(struct virtio_net_hdr);
+    if (ioctl(args->tun, TUNGETVNETHDRSZ, &hdrlen))
+        log_print(PLATFORM_LOG_PRIORITY_WARN, "tun %d TUNGETVNETHDRSZ error %d: %s",
+                  args->tun, errno, strerror(errno));
+    if (hdrlen < (int) sizeof(struct virtio_net_hdr) || hdrlen > TUN_VNET_HDR_MAX) {
+        log_print(PLATFORM_LOG_PRIORITY_ERROR, "tun %d virtio net header length %d",
+                  args->tun, hdrlen);
+        return;
+    }
+    args->vnet_hdr = hdrlen;
+
+    // Prefer segmentation offload, fall back to checksum offload, then to none
+    unsigned int offload = TUN_F_CSUM | TUN_F_TSO4 | TUN_F_TSO6;
+    if (ioctl(args->tun, TUNSETOFFLOAD, offload)) {
+        log_print(PLATFORM_LOG_PRIORITY_WARN, "tun %d TUNSETOFFLOAD TSO error %d: %s",
+                  args->tun, errno, strerror(errno));
+        offload = TUN_F_CSUM;
+        if (ioctl(args->tun, TUNSETOFFLOAD, offload)) {
+            log_print(PLATFORM_LOG_PRIORITY_WARN, "tun %d TUNSETOFFLOAD CSUM error %d: %s",
+                      args->tun, errno, strerror(errno));
+            offload = 0;
+        }
+    }
+    args->offload = offload;
+
+    log_print(PLATFORM_LOG_PRIORITY_WARN, "tun %d virtio net header %d offload %x",
+              args->tun, args->vnet_hdr, args->offload);
+}
+
+ssize_t write_tun(const struct arguments *args, const uint8_t *buffer, size_t length,
+                  const struct virtio_net_hdr *hdr) {
+    if (!args->vnet_hdr)
+        return write(args->tun, buffer, length);
+
+    uint8_t vnet[TUN_VNET_HDR_MAX];
+    memset(vnet, 0, sizeof(vnet));
+    if (hdr != NULL)
+        memcpy(vnet, hdr, sizeof(struct virtio_net_hdr));
+
+    struct iovec iov[2];
+    iov[0].iov_base = vnet;
+    iov[0].iov_len = (size_t) args->vnet_hdr;
+    iov[1].iov_base = (void *) buffer;
+    iov[1].iov_len = length;
+    ssize_t res = writev(args->tun, iov, 2);
+    if (res < 0)
+        return res;
+    return (res > args->vnet_hdr ? res - args->vnet_hdr : 0);
+}
+
 // https://en.wikipedia.org/wiki/IPv6_packet#Extension_headers
 // http://www.iana.org/assignments/protocol-numbers/protocol-numbers.xhtml
 static int is_lower_layer(int protocol) {
@@ -140,7 +243,7 @@ static void handle_ip(const struct arguments *args,
     char source[INET6_ADDRSTRLEN + 1];
     char dest[INET6_ADDRSTRLEN + 1];
     char flags[10];
-    char data[16];
+    char data[DNS_NAMES_DATA_MAX];
     int flen = 0;
     uint8_t *payload;
 
@@ -158,12 +261,6 @@ static void handle_ip(const struct arguments *args,
         saddr = &ip4hdr->saddr;
         daddr = &ip4hdr->daddr;
 
-        if (ip4hdr->frag_off & IP_MF) {
-            log_print(PLATFORM_LOG_PRIORITY_ERROR, "IP fragment offset %u",
-                        (ip4hdr->frag_off & IP_OFFMASK) * 8);
-            return;
-        }
-
         uint8_t ipoptlen = (uint8_t) ((ip4hdr->ihl - 5) * 4);
         payload = (uint8_t *) (pkt + sizeof(struct iphdr) + ipoptlen);
 
@@ -179,6 +276,19 @@ static void handle_ip(const struct arguments *args,
                 return;
             }
         }
+
+        // Handle a reassembled datagram as if it arrived whole
+        if (ntohs(ip4hdr->frag_off) & (IP_MF | IP_OFFMASK)) {
+            uint8_t *datagram;
+            ssize_t dlen = add_ip_fragment(pkt, length, get_ms(), &datagram);
+            if (dlen > 0) {
+                struct iphdr *rip4 = (struct iphdr *) datagram;
+                rip4->check = ~calc_checksum(0, datagram, (size_t) rip4->ihl * 4);
+                handle_ip(args, datagram, (size_t) dlen, epoll_fd, sessions, maxsessions);
+                ng_free(datagram, __FILE__, __LINE__);
+            }
+            return;
+        }
     } else if (version == 6) {
         if (length < sizeof(struct ip6_hdr)) {
             log_print(PLATFORM_LOG_PRIORITY_WARN, "IP6 packet too short length %d", length);
@@ -318,6 +428,10 @@ static void handle_ip(const struct arguments *args,
     else if (protocol == IPPROTO_TCP && (!syn || (uid == 0 && dport == 53)))
         allowed = 1; // assume existing session
     else {
+        // New TCP and UDP flows are described by the names the address was resolved for
+        if (protocol == IPPROTO_TCP || protocol == IPPROTO_UDP)
+            get_dns_names_data(version, daddr, data, sizeof(data));
+
         packet_t packet;
         packet.version = version;
         packet.protocol = protocol;
@@ -325,6 +439,7 @@ static void handle_ip(const struct arguments *args,
         packet.source = source;
         packet.sport = sport;
         packet.dest = dest;
+        packet.daddr = daddr;
         packet.dport = dport;
         packet.data = data;
         packet.uid = uid;
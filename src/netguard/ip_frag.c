@@ -0,0 +1,260 @@
+#include <stdint.h>
+#include <string.h>
+#include <arpa/inet.h>
+#include <netinet/ip.h>
+#include "platform.h"
+#include "memory.h"
+#include "ip_frag.h"
+
+// https://tools.ietf.org/html/rfc791#section-3.2
+// https://tools.ietf.org/html/rfc815
+
+#define IP_MAX_LEN 65535
+
+struct ip_frag_queue {
+    uint32_t saddr; // network notation
+    uint32_t daddr;
+    uint16_t id;
+    uint8_t protocol;
+    long long time; // ms, first fragment
+
+    uint8_t header[60]; // of the first fragment
+    uint8_t hlen; // zero until the first fragment arrived
+
+    uint8_t *data; // payload
+    size_t size; // allocated
+    size_t total; // payload length, zero until the last fragment arrived
+    size_t received;
+
+    uint16_t start[IP_FRAG_MAX_PIECES];
+    uint16_t end[IP_FRAG_MAX_PIECES];
+    int pieces;
+
+    struct ip_frag_queue *prev;
+    struct ip_frag_queue *next;
+};
+
+static struct ip_frag_queue *frag_head = NULL; // oldest
+static struct ip_frag_queue *frag_tail = NULL;
+static int frag_queues = 0;
+static size_t frag_bytes = 0;
+
+static long long frag_fragments = 0;
+static long long frag_reassembled = 0;
+static long long frag_timeouts = 0;
+static long long frag_overlaps = 0;
+static long long frag_evictions = 0;
+static long long frag_invalid = 0;
+
+static void drop_ip_frag_queue(struct ip_frag_queue *q);
+
+static int reserve_ip_frag_queue(struct ip_frag_queue *q, size_t end, int last);
+
+///////////////////////////////////////////////////////////////////////////////
+
+static void drop_ip_frag_queue(struct ip_frag_queue *q) {
+    if (q->prev == NULL)
+        frag_head = q->next;
+    else
+        q->prev->next = q->next;
+    if (q->next == NULL)
+        frag_tail = q->prev;
+    else
+        q->next->prev = q->prev;
+
+    frag_queues--;
+    frag_bytes -= sizeof(struct ip_frag_queue) + q->size;
+
+    if (q->data != NULL)
+        ng_free(q->data, __FILE__, __LINE__);
+    ng_free(q, __FILE__, __LINE__);
+}
+
+static int reserve_ip_frag_queue(struct ip_frag_queue *q, size_t end, int last) {
+    if (end <= q->size)
+        return 0;
+
+    // Grow geometrically until the length is known, fragments mostly arrive in order
+    size_t size = (q->total > 0 ? q->total : last ? end : q->size * 2);
+    if (size < end)
+        size = end;
+    if (size > IP_MAX_LEN)
+        size = IP_MAX_LEN;
+
+    // Make room by dropping the oldest other datagrams
+    while (frag_bytes + (size - q->size) > IP_FRAG_MAX_BYTES &&
+           frag_head != NULL && frag_head != q) {
+        frag_evictions++;
+        drop_ip_frag_queue(frag_head);
+    }
+    if (frag_bytes + (size - q->size) > IP_FRAG_MAX_BYTES)
+        return -1;
+
+    uint8_t *data = ng_realloc(q->data, size, "ip fragments");
+    if (data == NULL)
+        return -1;
+    frag_bytes += size - q->size;
+    q->data = data;
+    q->size = size;
+    return 0;
+}
+
+ssize_t add_ip_fragment(const uint8_t *pkt, size_t length, long long ms, uint8_t **datagram) {
+    const struct iphdr *ip4 = (const struct iphdr *) pkt;
+    size_t hlen = (size_t) ip4->ihl * 4;
+    uint16_t frag_off = ntohs(ip4->frag_off);
+    size_t offset = (size_t) (frag_off & IP_OFFMASK) * 8;
+    int more = ((frag_off & IP_MF) != 0);
+
+    frag_fragments++;
+    *datagram = NULL;
+
+    // All fragments but the last carry a multiple of eight bytes
+    if (hlen < sizeof(struct iphdr) || hlen >= length ||
+        (more && (length - hlen) % 8 != 0) ||
+        hlen + offset + (length - hlen) > IP_MAX_LEN) {
+        frag_invalid++;
+        log_print(PLATFORM_LOG_PRIORITY_WARN, "IP fragment invalid offset %d length %d",
+                  (int) offset, (int) length);
+        return -1;
+    }
+    size_t end = offset + (length - hlen);
+
+    // Expire datagrams not completed in time
+    while (frag_head != NULL && frag_head->time + IP_FRAG_TIMEOUT < ms) {
+        frag_timeouts++;
+        log_print(PLATFORM_LOG_PRIORITY_WARN, "IP fragments id %u timeout received %d",
+                  ntohs(frag_head->id), (int) frag_head->received);
+        drop_ip_frag_queue(frag_head);
+    }
+
+    struct ip_frag_queue *q = frag_head;
+    while (q != NULL && !(q->id == ip4->id && q->saddr == ip4->saddr &&
+                          q->daddr == ip4->daddr && q->protocol == ip4->protocol))
+        q = q->next;
+
+    if (q == NULL) {
+        if (frag_queues >= IP_FRAG_MAX_QUEUES) {
+            frag_evictions++;
+            drop_ip_frag_queue(frag_head);
+        }
+
+        q = ng_malloc(sizeof(struct ip_frag_queue), "ip fragment queue");
+        q->saddr = ip4->saddr;
+        q->daddr = ip4->daddr;
+        q->id = ip4->id;
+        q->protocol = ip4->protocol;
+        q->time = ms;
+        q->hlen = 0;
+        q->data = NULL;
+        q->size = 0;
+        q->total = 0;
+        q->received = 0;
+        q->pieces = 0;
+
+        q->prev = frag_tail;
+        q->next = NULL;
+        if (frag_tail == NULL)
+            frag_head = q;
+        else
+            frag_tail->next = q;
+        frag_tail = q;
+        frag_queues++;
+        frag_bytes += sizeof(struct ip_frag_queue);
+    }
+
+    // The last fragment fixes the length, no data may be beyond it
+    int invalid = (q->pieces == IP_FRAG_MAX_PIECES);
+    if (!more)
+        invalid = invalid || (q->total > 0 && q->total != end);
+    else
+        invalid = invalid || (q->total > 0 && end > q->total);
+    for (int i = 0; i < q->pieces && !invalid; i++)
+        if (!more && q->end[i] > end)
+            invalid = 1;
+
+    // The header of the first fragment leads the reassembled datagram, which must fit its length
+    size_t first_hlen = (offset == 0 ? hlen : q->hlen);
+    if (first_hlen > 0) {
+        size_t max_end = IP_MAX_LEN - first_hlen;
+        invalid = invalid || end > max_end;
+        for (int i = 0; i < q->pieces && !invalid; i++)
+            if (q->end[i] > max_end)
+                invalid = 1;
+    }
+    if (invalid) {
+        frag_invalid++;
+        log_print(PLATFORM_LOG_PRIORITY_WARN, "IP fragments id %u inconsistent offset %d length %d",
+                  ntohs(q->id), (int) offset, (int) length);
+        drop_ip_frag_queue(q);
+        return -1;
+    }
+
+    // Overlapping fragments can hide data from inspection, drop them all
+    for (int i = 0; i < q->pieces; i++)
+        if (offset < q->end[i] && end > q->start[i]) {
+            if (offset == q->start[i] && end == q->end[i] &&
+                memcmp(q->data + offset, pkt + hlen, end - offset) == 0)
+                return 0; // duplicate
+
+            frag_overlaps++;
+            log_print(PLATFORM_LOG_PRIORITY_WARN, "IP fragments id %u overlap offset %d length %d",
+                      ntohs(q->id), (int) offset, (int) length);
+            drop_ip_frag_queue(q);
+            return -1;
+        }
+
+    if (reserve_ip_frag_queue(q, end, !more) < 0) {
+        frag_evictions++;
+        log_print(PLATFORM_LOG_PRIORITY_WARN, "IP fragments id %u no memory", ntohs(q->id));
+        drop_ip_frag_queue(q);
+        return -1;
+    }
+
+    memcpy(q->data + offset, pkt + hlen, end - offset);
+    q->start[q->pieces] = (uint16_t) offset;
+    q->end[q->pieces] = (uint16_t) end;
+    q->pieces++;
+    q->received += end - offset;
+    if (!more)
+        q->total = end;
+    if (offset == 0) {
+        memcpy(q->header, pkt, hlen);
+        q->hlen = (uint8_t) hlen;
+    }
+
+    if (q->total == 0 || q->received != q->total)
+        return 0;
+
+    // Without overlaps all fragments together are the whole datagram
+    size_t dlen = q->hlen + q->total;
+    *datagram = ng_malloc(dlen, "ip datagram");
+    memcpy(*datagram, q->header, q->hlen);
+    memcpy(*datagram + q->hlen, q->data, q->total);
+
+    struct iphdr *rip4 = (struct iphdr *) *datagram;
+    rip4->tot_len = htons((uint16_t) dlen);
+    rip4->frag_off = 0;
+    rip4->check = 0;
+
+    frag_reassembled++;
+    log_print(PLATFORM_LOG_PRIORITY_DEBUG, "IP fragments id %u reassembled pieces %d length %d",
+              ntohs(q->id), q->pieces, (int) dlen);
+    drop_ip_frag_queue(q);
+
+    return (ssize_t) dlen;
+}
+
+void get_ip_frag_stats(long long *stats) {
+    stats[0] = frag_fragments;
+    stats[1] = frag_reassembled;
+    stats[2] = frag_timeouts;
+    stats[3] = frag_overlaps;
+    stats[4] = frag_evictions;
+    stats[5] = frag_invalid;
+}
+
+void cleanup_ip_fragments() {
+    while (frag_head != NULL)
+        drop_ip_frag_queue(frag_head);
+}
@@ -504,6 +504,26 @@ jfieldID fidRport = NULL;
 struct allowed allowed;
 
 struct allowed *is_address_allowed(const struct arguments *args, const packet_t *packet) {
+    // Decide without Java when a pushed rule covers the flow
+    struct rule rule;
+    int action = match_rule(packet->version, packet->protocol, packet->daddr,
+                            (uint16_t) packet->dport, packet->uid, &rule);
+    if (action != RULE_ACTION_JAVA) {
+        log_print(PLATFORM_LOG_PRIORITY_DEBUG, "Rule action %d v%d p%d %s/%u uid %d",
+                  action, packet->version, packet->protocol, packet->dest, packet->dport,
+                  packet->uid);
+        if (action == RULE_ACTION_DENY)
+            return NULL;
+        if (action == RULE_ACTION_REDIRECT) {
+            strcpy(allowed.raddr, rule.raddr);
+            allowed.rport = rule.rport;
+        } else {
+            *allowed.raddr = 0;
+            allowed.rport = 0;
+        }
+        return &allowed;
+    }
+
 #ifdef PROFILE_JNI
     float mselapsed;
     struct timeval start, end;
@@ -694,9 +714,11 @@ jfieldID fidUsageDPort = NULL;
 jfieldID fidUsageUid = NULL;
 jfieldID fidUsageSent = NULL;
 jfieldID fidUsageReceived = NULL;
+jfieldID fidUsageName = NULL;
 
 void account_usage(const struct arguments *args, uint32_t version, uint32_t protocol,
-                   const char *daddr, uint32_t dport, uint32_t uid, uint64_t sent, uint64_t received) {
+                   const char *daddr, uint32_t dport, uint32_t uid, uint64_t sent, uint64_t received,
+                   const char *name) {
 #ifdef PROFILE_JNI
     float mselapsed;
     struct timeval start, end;
@@ -727,6 +749,11 @@ void account_usage(const struct arguments *args, uint32_t version, uint32_t prot
         fidUsageUid = jniGetFieldID(args->env, clsUsage, "Uid", "I");
         fidUsageSent = jniGetFieldID(args->env, clsUsage, "Sent", "J");
         fidUsageReceived = jniGetFieldID(args->env, clsUsage, "Received", "J");
+
+        // Optional, older models have no name
+        fidUsageName = (*args->env)->GetFieldID(args->env, clsUsage, "Name", string);
+        if (fidUsageName == NULL)
+            (*args->env)->ExceptionClear(args->env);
     }
 
     jlong jtime = time(NULL) * 1000LL;
@@ -742,9 +769,20 @@ void account_usage(const struct arguments *args, uint32_t version, uint32_t prot
     (*args->env)->SetLongField(args->env, jusage, fidUsageSent, sent);
     (*args->env)->SetLongField(args->env, jusage, fidUsageReceived, received);
 
+    jstring jname = NULL;
+    if (fidUsageName != NULL && name != NULL) {
+        jname = (*args->env)->NewStringUTF(args->env, name);
+        ng_add_alloc(jname, "jname");
+        (*args->env)->SetObjectField(args->env, jusage, fidUsageName, jname);
+    }
+
     (*args->env)->CallVoidMethod(args->env, args->instance, midAccountUsage, jusage);
     jniCheckException(args->env);
 
+    if (jname != NULL) {
+        (*args->env)->DeleteLocalRef(args->env, jname);
+        ng_delete_alloc(jname, __FILE__, __LINE__);
+    }
     (*args->env)->DeleteLocalRef(args->env, jdaddr);
     (*args->env)->DeleteLocalRef(args->env, jusage);
     (*args->env)->DeleteLocalRef(args->env, clsService);
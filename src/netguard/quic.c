@@ -0,0 +1,570 @@
+#include <stdint.h>
+#include <string.h>
+#include "platform.h"
+#include "memory.h"
+#include "quic.h"
+
+// https://www.rfc-editor.org/rfc/rfc9000
+// https://www.rfc-editor.org/rfc/rfc9001#section-5
+// https://www.rfc-editor.org/rfc/rfc9369#section-3.3
+
+#define QUIC_FRAME_PADDING 0x00
+#define QUIC_FRAME_PING 0x01
+#define QUIC_FRAME_ACK 0x02
+#define QUIC_FRAME_ACK_ECN 0x03
+#define QUIC_FRAME_CRYPTO 0x06
+#define QUIC_FRAME_CONNECTION_CLOSE 0x1c
+
+#define QUIC_TAG_LEN 16
+
+struct sha256 {
+    uint32_t h[8];
+    uint8_t block[64];
+    size_t used;
+    uint64_t total;
+};
+
+// HMAC with the padded key blocks already hashed
+struct hmac_sha256 {
+    struct sha256 inner;
+    struct sha256 outer;
+};
+
+static const uint8_t quic_v1_salt[20] = {
+        0x38, 0x76, 0x2c, 0xf7, 0xf5, 0x59, 0x34, 0xb3, 0x4d, 0x17,
+        0x9a, 0xe6, 0xa4, 0xc8, 0x0c, 0xad, 0xcc, 0xbb, 0x7f, 0x0a
+};
+
+static const uint8_t quic_v2_salt[20] = {
+        0x0d, 0xed, 0xe3, 0xde, 0xf7, 0x00, 0xa6, 0xdb, 0x81, 0x93,
+        0x81, 0xbe, 0x6e, 0x26, 0x9d, 0xcb, 0xf9, 0xbd, 0x2e, 0xd9
+};
+
+static const uint32_t sha256_k[64] = {
+        0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+        0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+        0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+        0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+        0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+        0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+        0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+        0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+static const uint8_t aes_sbox[256] = {
+        0x63, 0x7c, 0x77, 0x7b, 0xf2, 0x6b, 0x6f, 0xc5, 0x30, 0x01, 0x67, 0x2b, 0xfe, 0xd7, 0xab, 0x76,
+        0xca, 0x82, 0xc9, 0x7d, 0xfa, 0x59, 0x47, 0xf0, 0xad, 0xd4, 0xa2, 0xaf, 0x9c, 0xa4, 0x72, 0xc0,
+        0xb7, 0xfd, 0x93, 0x26, 0x36, 0x3f, 0xf7, 0xcc, 0x34, 0xa5, 0xe5, 0xf1, 0x71, 0xd8, 0x31, 0x15,
+        0x04, 0xc7, 0x23, 0xc3, 0x18, 0x96, 0x05, 0x9a, 0x07, 0x12, 0x80, 0xe2, 0xeb, 0x27, 0xb2, 0x75,
+        0x09, 0x83, 0x2c, 0x1a, 0x1b, 0x6e, 0x5a, 0xa0, 0x52, 0x3b, 0xd6, 0xb3, 0x29, 0xe3, 0x2f, 0x84,
+        0x53, 0xd1, 0x00, 0xed, 0x20, 0xfc, 0xb1, 0x5b, 0x6a, 0xcb, 0xbe, 0x39, 0x4a, 0x4c, 0x58, 0xcf,
+        0xd0, 0xef, 0xaa, 0xfb, 0x43, 0x4d, 0x33, 0x85, 0x45, 0xf9, 0x02, 0x7f, 0x50, 0x3c, 0x9f, 0xa8,
+        0x51, 0xa3, 0x40, 0x8f, 0x92, 0x9d, 0x38, 0xf5, 0xbc, 0xb6, 0xda, 0x21, 0x10, 0xff, 0xf3, 0xd2,
+        0xcd, 0x0c, 0x13, 0xec, 0x5f, 0x97, 0x44, 0x17, 0xc4, 0xa7, 0x7e, 0x3d, 0x64, 0x5d, 0x19, 0x73,
+        0x60, 0x81, 0x4f, 0xdc, 0x22, 0x2a, 0x90, 0x88, 0x46, 0xee, 0xb8, 0x14, 0xde, 0x5e, 0x0b, 0xdb,
+        0xe0, 0x32, 0x3a, 0x0a, 0x49, 0x06, 0x24, 0x5c, 0xc2, 0xd3, 0xac, 0x62, 0x91, 0x95, 0xe4, 0x79,
+        0xe7, 0xc8, 0x37, 0x6d, 0x8d, 0xd5, 0x4e, 0xa9, 0x6c, 0x56, 0xf4, 0xea, 0x65, 0x7a, 0xae, 0x08,
+        0xba, 0x78, 0x25, 0x2e, 0x1c, 0xa6, 0xb4, 0xc6, 0xe8, 0xdd, 0x74, 0x1f, 0x4b, 0xbd, 0x8b, 0x8a,
+        0x70, 0x3e, 0xb5, 0x66, 0x48, 0x03, 0xf6, 0x0e, 0x61, 0x35, 0x57, 0xb9, 0x86, 0xc1, 0x1d, 0x9e,
+        0xe1, 0xf8, 0x98, 0x11, 0x69, 0xd9, 0x8e, 0x94, 0x9b, 0x1e, 0x87, 0xe9, 0xce, 0x55, 0x28, 0xdf,
+        0x8c, 0xa1, 0x89, 0x0d, 0xbf, 0xe6, 0x42, 0x68, 0x41, 0x99, 0x2d, 0x0f, 0xb0, 0x54, 0xbb, 0x16
+};
+
+// SubBytes and MixColumns combined, the column of {2,1,1,3} times the S-box value
+static const uint32_t aes_te0[256] = {
+        0xc66363a5, 0xf87c7c84, 0xee777799, 0xf67b7b8d, 0xfff2f20d, 0xd66b6bbd,
+        0xde6f6fb1, 0x91c5c554, 0x60303050, 0x02010103, 0xce6767a9, 0x562b2b7d,
+        0xe7fefe19, 0xb5d7d762, 0x4dababe6, 0xec76769a, 0x8fcaca45, 0x1f82829d,
+        0x89c9c940, 0xfa7d7d87, 0xeffafa15, 0xb25959eb, 0x8e4747c9, 0xfbf0f00b,
+        0x41adadec, 0xb3d4d467, 0x5fa2a2fd, 0x45afafea, 0x239c9cbf, 0x53a4a4f7,
+        0xe4727296, 0x9bc0c05b, 0x75b7b7c2, 0xe1fdfd1c, 0x3d9393ae, 0x4c26266a,
+        0x6c36365a, 0x7e3f3f41, 0xf5f7f702, 0x83cccc4f, 0x6834345c, 0x51a5a5f4,
+        0xd1e5e534, 0xf9f1f108, 0xe2717193, 0xabd8d873, 0x62313153, 0x2a15153f,
+        0x0804040c, 0x95c7c752, 0x46232365, 0x9dc3c35e, 0x30181828, 0x379696a1,
+        0x0a05050f, 0x2f9a9ab5, 0x0e070709, 0x24121236, 0x1b80809b, 0xdfe2e23d,
+        0xcdebeb26, 0x4e272769, 0x7fb2b2cd, 0xea75759f, 0x1209091b, 0x1d83839e,
+        0x582c2c74, 0x341a1a2e, 0x361b1b2d, 0xdc6e6eb2, 0xb45a5aee, 0x5ba0a0fb,
+        0xa45252f6, 0x763b3b4d, 0xb7d6d661, 0x7db3b3ce, 0x5229297b, 0xdde3e33e,
+        0x5e2f2f71, 0x13848497, 0xa65353f5, 0xb9d1d168, 0x00000000, 0xc1eded2c,
+        0x40202060, 0xe3fcfc1f, 0x79b1b1c8, 0xb65b5bed, 0xd46a6abe, 0x8dcbcb46,
+        0x67bebed9, 0x7239394b, 0x944a4ade, 0x984c4cd4, 0xb05858e8, 0x85cfcf4a,
+        0xbbd0d06b, 0xc5efef2a, 0x4faaaae5, 0xedfbfb16, 0x864343c5, 0x9a4d4dd7,
+        0x66333355, 0x11858594, 0x8a4545cf, 0xe9f9f910, 0x04020206, 0xfe7f7f81,
+        0xa05050f0, 0x783c3c44, 0x259f9fba, 0x4ba8a8e3, 0xa25151f3, 0x5da3a3fe,
+        0x804040c0, 0x058f8f8a, 0x3f9292ad, 0x219d9dbc, 0x70383848, 0xf1f5f504,
+        0x63bcbcdf, 0x77b6b6c1, 0xafdada75, 0x42212163, 0x20101030, 0xe5ffff1a,
+        0xfdf3f30e, 0xbfd2d26d, 0x81cdcd4c, 0x180c0c14, 0x26131335, 0xc3ecec2f,
+        0xbe5f5fe1, 0x359797a2, 0x884444cc, 0x2e171739, 0x93c4c457, 0x55a7a7f2,
+        0xfc7e7e82, 0x7a3d3d47, 0xc86464ac, 0xba5d5de7, 0x3219192b, 0xe6737395,
+        0xc06060a0, 0x19818198, 0x9e4f4fd1, 0xa3dcdc7f, 0x44222266, 0x542a2a7e,
+        0x3b9090ab, 0x0b888883, 0x8c4646ca, 0xc7eeee29, 0x6bb8b8d3, 0x2814143c,
+        0xa7dede79, 0xbc5e5ee2, 0x160b0b1d, 0xaddbdb76, 0xdbe0e03b, 0x64323256,
+        0x743a3a4e, 0x140a0a1e, 0x924949db, 0x0c06060a, 0x4824246c, 0xb85c5ce4,
+        0x9fc2c25d, 0xbdd3d36e, 0x43acacef, 0xc46262a6, 0x399191a8, 0x319595a4,
+        0xd3e4e437, 0xf279798b, 0xd5e7e732, 0x8bc8c843, 0x6e373759, 0xda6d6db7,
+        0x018d8d8c, 0xb1d5d564, 0x9c4e4ed2, 0x49a9a9e0, 0xd86c6cb4, 0xac5656fa,
+        0xf3f4f407, 0xcfeaea25, 0xca6565af, 0xf47a7a8e, 0x47aeaee9, 0x10080818,
+        0x6fbabad5, 0xf0787888, 0x4a25256f, 0x5c2e2e72, 0x381c1c24, 0x57a6a6f1,
+        0x73b4b4c7, 0x97c6c651, 0xcbe8e823, 0xa1dddd7c, 0xe874749c, 0x3e1f1f21,
+        0x964b4bdd, 0x61bdbddc, 0x0d8b8b86, 0x0f8a8a85, 0xe0707090, 0x7c3e3e42,
+        0x71b5b5c4, 0xcc6666aa, 0x904848d8, 0x06030305, 0xf7f6f601, 0x1c0e0e12,
+        0xc26161a3, 0x6a35355f, 0xae5757f9, 0x69b9b9d0, 0x17868691, 0x99c1c158,
+        0x3a1d1d27, 0x279e9eb9, 0xd9e1e138, 0xebf8f813, 0x2b9898b3, 0x22111133,
+        0xd26969bb, 0xa9d9d970, 0x078e8e89, 0x339494a7, 0x2d9b9bb6, 0x3c1e1e22,
+        0x15878792, 0xc9e9e920, 0x87cece49, 0xaa5555ff, 0x50282878, 0xa5dfdf7a,
+        0x038c8c8f, 0x59a1a1f8, 0x09898980, 0x1a0d0d17, 0x65bfbfda, 0xd7e6e631,
+        0x844242c6, 0xd06868b8, 0x824141c3, 0x299999b0, 0x5a2d2d77, 0x1e0f0f11,
+        0x7bb0b0cb, 0xa85454fc, 0x6dbbbbd6, 0x2c16163a
+};
+
+static void sha256_init(struct sha256 *ctx);
+
+static void sha256_update(struct sha256 *ctx, const uint8_t *data, size_t len);
+
+static void sha256_final(struct sha256 *ctx, uint8_t *digest);
+
+static void hmac_sha256_init(struct hmac_sha256 *hmac, const uint8_t *key, size_t keylen);
+
+static void hmac_sha256(const struct hmac_sha256 *hmac,
+                        const uint8_t *data, size_t len, uint8_t *mac);
+
+static void hkdf_expand_label(const struct hmac_sha256 *secret, const char *label,
+                              uint8_t *out, size_t outlen);
+
+static void aes128_expand_key(const uint8_t *key, uint32_t *round_keys);
+
+static void aes128_encrypt(const uint32_t *round_keys, const uint8_t *in, uint8_t *out);
+
+static void derive_quic_keys(uint32_t version, const uint8_t *dcid, size_t dcid_len,
+                             struct quic_keys *keys);
+
+static int get_quic_varint(const uint8_t *data, size_t len, size_t *pos, uint64_t *value);
+
+static int parse_quic_frames(struct quic_hello *hello, const uint8_t *data, size_t len);
+
+static int decrypt_quic_initial(struct quic_hello *hello, const uint8_t *data, size_t len,
+                                size_t *packet_len);
+
+///////////////////////////////////////////////////////////////////////////////
+
+#define ROR32(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+static void sha256_transform(struct sha256 *ctx, const uint8_t *block) {
+    uint32_t w[64];
+    for (int i = 0; i < 16; i++)
+        w[i] = ((uint32_t) block[4 * i] << 24) | ((uint32_t) block[4 * i + 1] << 16) |
+               ((uint32_t) block[4 * i + 2] << 8) | block[4 * i + 3];
+    for (int i = 16; i < 64; i++) {
+        uint32_t s0 = ROR32(w[i - 15], 7) ^ ROR32(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        uint32_t s1 = ROR32(w[i - 2], 17) ^ ROR32(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    uint32_t a = ctx->h[0], b = ctx->h[1], c = ctx->h[2], d = ctx->h[3];
+    uint32_t e = ctx->h[4], f = ctx->h[5], g = ctx->h[6], h = ctx->h[7];
+    for (int i = 0; i < 64; i++) {
+        uint32_t t1 = h + (ROR32(e, 6) ^ ROR32(e, 11) ^ ROR32(e, 25)) +
+                      ((e & f) ^ (~e & g)) + sha256_k[i] + w[i];
+        uint32_t t2 = (ROR32(a, 2) ^ ROR32(a, 13) ^ ROR32(a, 22)) +
+                      ((a & b) ^ (a & c) ^ (b & c));
+        h = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+
+    ctx->h[0] += a;
+    ctx->h[1] += b;
+    ctx->h[2] += c;
+    ctx->h[3] += d;
+    ctx->h[4] += e;
+    ctx->h[5] += f;
+    ctx->h[6] += g;
+    ctx->h[7] += h;
+}
+
+static void sha256_init(struct sha256 *ctx) {
+    static const uint32_t h0[8] = {
+            0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+            0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+    memcpy(ctx->h, h0, sizeof(h0));
+    ctx->used = 0;
+    ctx->total = 0;
+}
+
+static void sha256_update(struct sha256 *ctx, const uint8_t *data, size_t len) {
+    ctx->total += len;
+    while (len > 0) {
+        size_t n = 64 - ctx->used;
+        if (n > len)
+            n = len;
+        memcpy(ctx->block + ctx->used, data, n);
+        ctx->used += n;
+        data += n;
+        len -= n;
+        if (ctx->used == 64) {
+            sha256_transform(ctx, ctx->block);
+            ctx->used = 0;
+        }
+    }
+}
+
+static void sha256_final(struct sha256 *ctx, uint8_t *digest) {
+    uint64_t bits = ctx->total * 8;
+    ctx->block[ctx->used++] = 0x80;
+    if (ctx->used > 56) {
+        memset(ctx->block + ctx->used, 0, 64 - ctx->used);
+        sha256_transform(ctx, ctx->block);
+        ctx->used = 0;
+    }
+    memset(ctx->block + ctx->used, 0, 56 - ctx->used);
+    for (int i = 0; i < 8; i++)
+        ctx->block[56 + i] = (uint8_t) (bits >> (56 - 8 * i));
+    sha256_transform(ctx, ctx->block);
+
+    for (int i = 0; i < 8; i++) {
+        digest[4 * i] = (uint8_t) (ctx->h[i] >> 24);
+        digest[4 * i + 1] = (uint8_t) (ctx->h[i] >> 16);
+        digest[4 * i + 2] = (uint8_t) (ctx->h[i] >> 8);
+        digest[4 * i + 3] = (uint8_t) ctx->h[i];
+    }
+}
+
+// Keys are salts and secrets, never longer than a block
+static void hmac_sha256_init(struct hmac_sha256 *hmac, const uint8_t *key, size_t keylen) {
+    uint8_t pad[64];
+
+    memset(pad, 0x36, sizeof(pad));
+    for (size_t i = 0; i < keylen; i++)
+        pad[i] ^= key[i];
+    sha256_init(&hmac->inner);
+    sha256_update(&hmac->inner, pad, sizeof(pad));
+
+    memset(pad, 0x5c, sizeof(pad));
+    for (size_t i = 0; i < keylen; i++)
+        pad[i] ^= key[i];
+    sha256_init(&hmac->outer);
+    sha256_update(&hmac->outer, pad, sizeof(pad));
+}
+
+static void hmac_sha256(const struct hmac_sha256 *hmac,
+                        const uint8_t *data, size_t len, uint8_t *mac) {
+    uint8_t inner[32];
+    struct sha256 ctx = hmac->inner;
+    sha256_update(&ctx, data, len);
+    sha256_final(&ctx, inner);
+
+    ctx = hmac->outer;
+    sha256_update(&ctx, inner, sizeof(inner));
+    sha256_final(&ctx, mac);
+}
+
+// https://www.rfc-editor.org/rfc/rfc8446#section-7.1, a single block of output at most
+static void hkdf_expand_label(const struct hmac_sha256 *secret, const char *label,
+                              uint8_t *out, size_t outlen) {
+    uint8_t info[2 + 1 + 6 + 32 + 1 + 1];
+    size_t llen = strlen(label);
+    size_t n = 0;
+    info[n++] = 0;
+    info[n++] = (uint8_t) outlen;
+    info[n++] = (uint8_t) (6 + llen);
+    memcpy(info + n, "tls13 ", 6);
+    n += 6;
+    memcpy(info + n, label, llen);
+    n += llen;
+    info[n++] = 0; // context
+    info[n++] = 1; // counter
+
+    uint8_t t[32];
+    hmac_sha256(secret, info, n, t);
+    memcpy(out, t, outlen);
+}
+
+#define GET_U32(p) (((uint32_t) (p)[0] << 24) | ((uint32_t) (p)[1] << 16) | \
+                     ((uint32_t) (p)[2] << 8) | (p)[3])
+
+static uint32_t aes_sub_word(uint32_t w) {
+    return ((uint32_t) aes_sbox[w >> 24] << 24) | ((uint32_t) aes_sbox[(w >> 16) & 0xff] << 16) |
+           ((uint32_t) aes_sbox[(w >> 8) & 0xff] << 8) | aes_sbox[w & 0xff];
+}
+
+static void aes128_expand_key(const uint8_t *key, uint32_t *round_keys) {
+    static const uint8_t rcon[10] = {0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80, 0x1b, 0x36};
+    for (int i = 0; i < 4; i++)
+        round_keys[i] = GET_U32(key + 4 * i);
+    for (int i = 4; i < 44; i++) {
+        uint32_t t = round_keys[i - 1];
+        if (i % 4 == 0)
+            t = aes_sub_word((t << 8) | (t >> 24)) ^ ((uint32_t) rcon[i / 4 - 1] << 24);
+        round_keys[i] = round_keys[i - 4] ^ t;
+    }
+}
+
+#define AES_TE(x, n) ROR32(aes_te0[(x) & 0xff], n)
+
+static void aes128_encrypt(const uint32_t *round_keys, const uint8_t *in, uint8_t *out) {
+    uint32_t s0 = GET_U32(in) ^ round_keys[0];
+    uint32_t s1 = GET_U32(in + 4) ^ round_keys[1];
+    uint32_t s2 = GET_U32(in + 8) ^ round_keys[2];
+    uint32_t s3 = GET_U32(in + 12) ^ round_keys[3];
+
+    for (int round = 1; round < 10; round++) {
+        const uint32_t *rk = round_keys + 4 * round;
+        uint32_t t0 = aes_te0[s0 >> 24] ^ AES_TE(s1 >> 16, 8) ^ AES_TE(s2 >> 8, 16) ^
+                      AES_TE(s3, 24) ^ rk[0];
+        uint32_t t1 = aes_te0[s1 >> 24] ^ AES_TE(s2 >> 16, 8) ^ AES_TE(s3 >> 8, 16) ^
+                      AES_TE(s0, 24) ^ rk[1];
+        uint32_t t2 = aes_te0[s2 >> 24] ^ AES_TE(s3 >> 16, 8) ^ AES_TE(s0 >> 8, 16) ^
+                      AES_TE(s1, 24) ^ rk[2];
+        uint32_t t3 = aes_te0[s3 >> 24] ^ AES_TE(s0 >> 16, 8) ^ AES_TE(s1 >> 8, 16) ^
+                      AES_TE(s2, 24) ^ rk[3];
+        s0 = t0;
+        s1 = t1;
+        s2 = t2;
+        s3 = t3;
+    }
+
+    // The last round has no MixColumns
+    uint32_t s[4] = {s0, s1, s2, s3};
+    for (int c = 0; c < 4; c++) {
+        uint32_t w = ((uint32_t) aes_sbox[s[c] >> 24] << 24) |
+                     ((uint32_t) aes_sbox[(s[(c + 1) % 4] >> 16) & 0xff] << 16) |
+                     ((uint32_t) aes_sbox[(s[(c + 2) % 4] >> 8) & 0xff] << 8) |
+                     aes_sbox[s[(c + 3) % 4] & 0xff];
+        w ^= round_keys[40 + c];
+        out[4 * c] = (uint8_t) (w >> 24);
+        out[4 * c + 1] = (uint8_t) (w >> 16);
+        out[4 * c + 2] = (uint8_t) (w >> 8);
+        out[4 * c + 3] = (uint8_t) w;
+    }
+}
+
+static void derive_quic_keys(uint32_t version, const uint8_t *dcid, size_t dcid_len,
+                             struct quic_keys *keys) {
+    struct hmac_sha256 hmac;
+    uint8_t secret[32];
+    uint8_t key[16];
+    uint8_t hp[16];
+
+    int v2 = (version == QUIC_VERSION_2);
+    hmac_sha256_init(&hmac, v2 ? quic_v2_salt : quic_v1_salt, 20);
+    hmac_sha256(&hmac, dcid, dcid_len, secret);
+    hmac_sha256_init(&hmac, secret, sizeof(secret));
+    hkdf_expand_label(&hmac, "client in", secret, sizeof(secret));
+    hmac_sha256_init(&hmac, secret, sizeof(secret));
+    hkdf_expand_label(&hmac, v2 ? "quicv2 key" : "quic key", key, sizeof(key));
+    hkdf_expand_label(&hmac, v2 ? "quicv2 iv" : "quic iv", keys->iv, sizeof(keys->iv));
+    hkdf_expand_label(&hmac, v2 ? "quicv2 hp" : "quic hp", hp, sizeof(hp));
+
+    aes128_expand_key(key, keys->key);
+    aes128_expand_key(hp, keys->hp);
+}
+
+static int get_quic_varint(const uint8_t *data, size_t len, size_t *pos, uint64_t *value) {
+    if (*pos >= len)
+        return -1;
+    size_t n = (size_t) 1 << (data[*pos] >> 6);
+    if (*pos + n > len)
+        return -1;
+    uint64_t v = data[*pos] & 0x3f;
+    for (size_t i = 1; i < n; i++)
+        v = (v << 8) | data[*pos + i];
+    *pos += n;
+    *value = v;
+    return 0;
+}
+
+static int parse_quic_frames(struct quic_hello *hello, const uint8_t *data, size_t len) {
+    int collected = 0;
+    size_t pos = 0;
+    while (pos < len) {
+        uint8_t type = data[pos++];
+        uint64_t v, count;
+        if (type == QUIC_FRAME_PADDING || type == QUIC_FRAME_PING)
+            continue;
+
+        else if (type == QUIC_FRAME_ACK || type == QUIC_FRAME_ACK_ECN) {
+            // Largest, delay, range count, first range, ranges, ECN counts
+            if (get_quic_varint(data, len, &pos, &v) || get_quic_varint(data, len, &pos, &v) ||
+                get_quic_varint(data, len, &pos, &count) || get_quic_varint(data, len, &pos, &v))
+                return -1;
+            if (count > len)
+                return -1;
+            for (uint64_t i = 0; i < 2 * count + (type == QUIC_FRAME_ACK_ECN ? 3 : 0); i++)
+                if (get_quic_varint(data, len, &pos, &v))
+                    return -1;
+
+        } else if (type == QUIC_FRAME_CRYPTO) {
+            uint64_t offset, length;
+            if (get_quic_varint(data, len, &pos, &offset) ||
+                get_quic_varint(data, len, &pos, &length) ||
+                length > len - pos)
+                return -1;
+
+            // Collect up to the cap, chunks may arrive in any order
+            if (offset < QUIC_HELLO_MAX) {
+                size_t n = (size_t) (length < QUIC_HELLO_MAX - offset
+                                     ? length : QUIC_HELLO_MAX - offset);
+                memcpy(hello->record + TLS_HEADER_LEN + offset, data + pos, n);
+                for (size_t i = (size_t) offset; i < offset + n; i++)
+                    hello->filled[i / 8] |= (uint8_t) (1 << (i % 8));
+                collected += n;
+            }
+            pos += length;
+
+        } else if (type == QUIC_FRAME_CONNECTION_CLOSE) {
+            if (get_quic_varint(data, len, &pos, &v) || get_quic_varint(data, len, &pos, &v) ||
+                get_quic_varint(data, len, &pos, &v) || v > len - pos)
+                return -1;
+            pos += v;
+
+        } else
+            return -1; // not allowed in Initial packets
+    }
+
+    while (hello->contiguous < QUIC_HELLO_MAX &&
+           (hello->filled[hello->contiguous / 8] & (1 << (hello->contiguous % 8))))
+        hello->contiguous++;
+
+    return collected;
+}
+
+static int decrypt_quic_initial(struct quic_hello *hello, const uint8_t *data, size_t len,
+                                size_t *packet_len) {
+    // Long header with fixed bit
+    if (len < 7 || (data[0] & 0xc0) != 0xc0)
+        return -1;
+
+    uint32_t version = ((uint32_t) data[1] << 24) | ((uint32_t) data[2] << 16) |
+                       ((uint32_t) data[3] << 8) | data[4];
+    uint8_t type = (uint8_t) ((data[0] >> 4) & 0x03);
+    if (!(version == QUIC_VERSION_1 && type == 0) && !(version == QUIC_VERSION_2 && type == 1))
+        return -1;
+
+    // Destination and source connection ID
+    size_t pos = 5;
+    size_t dcid_len = data[pos++];
+    if (dcid_len > QUIC_CID_MAX || pos + dcid_len + 1 > len)
+        return -1;
+    const uint8_t *dcid = data + pos;
+    pos += dcid_len;
+    size_t scid_len = data[pos++];
+    if (scid_len > QUIC_CID_MAX || pos + scid_len > len)
+        return -1;
+    pos += scid_len;
+
+    // Token and length of packet number and payload
+    uint64_t token_len, length;
+    if (get_quic_varint(data, len, &pos, &token_len) || token_len > len - pos)
+        return -1;
+    pos += token_len;
+    if (get_quic_varint(data, len, &pos, &length) || length > len - pos)
+        return -1;
+    size_t pn_offset = pos;
+    *packet_len = pn_offset + length;
+
+    // Header protection is sampled after the longest packet number
+    if (length < 4 + 16)
+        return -1;
+
+    // Keys depend on the first destination connection ID only, the same for the whole flow
+    struct quic_keys *keys = &hello->keys;
+    if (hello->version != version || hello->dcid_len != dcid_len ||
+        memcmp(hello->dcid, dcid, dcid_len) != 0) {
+        derive_quic_keys(version, dcid, dcid_len, keys);
+        hello->version = version;
+        hello->dcid_len = (uint8_t) dcid_len;
+        memcpy(hello->dcid, dcid, dcid_len);
+    }
+    // Remove header protection, Initial packet numbers are small enough to be used as is
+    uint8_t mask[16];
+    aes128_encrypt(keys->hp, data + pn_offset + 4, mask);
+
+    uint8_t first = (uint8_t) (data[0] ^ (mask[0] & 0x0f));
+    size_t pn_len = (size_t) (first & 0x03) + 1;
+    uint8_t nonce[16];
+    memcpy(nonce, keys->iv, 12);
+    for (size_t i = 0; i < pn_len; i++)
+        nonce[12 - pn_len + i] ^= data[pn_offset + i] ^ mask[1 + i];
+
+    // AES-GCM without checking the tag: the counter starts at 2 after the nonce
+    size_t clen = length - pn_len - QUIC_TAG_LEN;
+    const uint8_t *cipher = data + pn_offset + pn_len;
+    // Padded Initials fit on the stack, larger datagrams (up to 64 KiB) are decrypted on the heap
+    uint8_t buffer[2048];
+    uint8_t *plain = buffer;
+    if (clen > sizeof(buffer)) {
+        plain = ng_malloc(clen, "quic initial");
+        if (plain == NULL) {
+            log_print(PLATFORM_LOG_PRIORITY_WARN,
+                      "QUIC Initial payload %zu not inspected, out of memory", clen);
+            return -1;
+        }
+    }
+    nonce[12] = 0;
+    nonce[13] = 0;
+    nonce[14] = 0;
+    nonce[15] = 1;
+    for (size_t off = 0; off < clen; off += 16) {
+        uint8_t stream[16];
+        for (int i = 15; i >= 12 && ++nonce[i] == 0; i--);
+        aes128_encrypt(keys->key, nonce, stream);
+        for (size_t i = 0; i < 16 && off + i < clen; i++)
+            plain[off + i] = cipher[off + i] ^ stream[i];
+    }
+
+    int collected = parse_quic_frames(hello, plain, clen);
+    if (plain != buffer)
+        ng_free(plain, __FILE__, __LINE__);
+    return collected;
+}
+
+int add_quic_initial(struct quic_hello *hello, const uint8_t *data, size_t datalen) {
+    if (datalen < QUIC_INITIAL_MIN)
+        return -1;
+
+    // Initial packets can be coalesced with others in one datagram
+    int collected = -1;
+    size_t pos = 0;
+    while (pos < datalen) {
+        size_t packet_len;
+        int n = decrypt_quic_initial(hello, data + pos, datalen - pos, &packet_len);
+        if (n < 0)
+            break;
+        collected = (collected < 0 ? n : collected + n);
+        pos += packet_len;
+    }
+
+    return collected;
+}
+
+int find_quic_server_name(struct quic_hello *hello, const uint8_t **server_name) {
+    *server_name = NULL;
+    size_t available = hello->contiguous;
+    if (available < 4)
+        return -1;
+
+    // The TLS parser expects a handshake record
+    hello->record[0] = TLS_TYPE_HANDSHAKE_RECORD;
+    hello->record[1] = 3;
+    hello->record[2] = 1;
+    hello->record[3] = (uint8_t) (available >> 8);
+    hello->record[4] = (uint8_t) available;
+
+    int len = find_server_name(hello->record, TLS_HEADER_LEN + available, server_name);
+    if (len >= 0)
+        return len;
+
+    // A truncated ClientHello may have the server name further on
+    size_t hello_len = 4 + (((size_t) hello->record[TLS_HEADER_LEN + 1] << 16) |
+                            ((size_t) hello->record[TLS_HEADER_LEN + 2] << 8) |
+                            hello->record[TLS_HEADER_LEN + 3]);
+    if (available < hello_len && available < QUIC_HELLO_MAX)
+        return -1;
+    return (len == -1 ? -2 : len);
+}
@@ -0,0 +1,221 @@
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+#include <netinet/in.h>
+#include "platform.h"
+#include "memory.h"
+#include "rules.h"
+
+// Rules are pushed from Java and matched on the packet thread,
+// the compiled table is replaced as a whole
+
+struct rule_node {
+    int32_t child[2]; // zero for none, node zero is a root
+    int32_t first; // rule, -1 for none
+    int32_t last;
+};
+
+struct rule_table {
+    struct rule *rules;
+    int32_t *next; // rule of the same node, in order
+    int count;
+
+    // Binary trie of address prefixes, node 0 the IPv4 root, node 1 the IPv6 root
+    struct rule_node *nodes;
+    int node_count;
+    int node_size;
+};
+
+static struct rule_table *rule_table = NULL;
+static pthread_mutex_t rules_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static long long rules_allowed = 0;
+static long long rules_denied = 0;
+static long long rules_redirected = 0;
+static long long rules_java = 0;
+
+static int32_t add_rule_node(struct rule_table *t);
+
+static int add_rule(struct rule_table *t, int32_t r);
+
+static void free_rule_table(struct rule_table *t);
+
+static int is_rule_matching(const struct rule *r, int protocol, uint16_t dport, int32_t uid);
+
+///////////////////////////////////////////////////////////////////////////////
+
+static int32_t add_rule_node(struct rule_table *t) {
+    if (t->node_count == t->node_size) {
+        int size = (t->node_size == 0 ? 64 : t->node_size * 2);
+        struct rule_node *nodes = ng_realloc(t->nodes, size * sizeof(struct rule_node), "rule nodes");
+        if (nodes == NULL)
+            return -1;
+        t->nodes = nodes;
+        t->node_size = size;
+    }
+
+    struct rule_node *n = &t->nodes[t->node_count];
+    n->child[0] = 0;
+    n->child[1] = 0;
+    n->first = -1;
+    n->last = -1;
+    return t->node_count++;
+}
+
+static int add_rule(struct rule_table *t, int32_t r) {
+    const struct rule *rule = &t->rules[r];
+    int32_t n = (rule->version == 4 ? 0 : 1);
+    for (int b = 0; b < rule->prefix; b++) {
+        int bit = (rule->addr[b / 8] >> (7 - b % 8)) & 1;
+        if (t->nodes[n].child[bit] == 0) {
+            int32_t c = add_rule_node(t);
+            if (c < 0)
+                return -1;
+            t->nodes[n].child[bit] = c;
+        }
+        n = t->nodes[n].child[bit];
+    }
+
+    // Keep the order of equal prefixes
+    t->next[r] = -1;
+    if (t->nodes[n].first < 0)
+        t->nodes[n].first = r;
+    else
+        t->next[t->nodes[n].last] = r;
+    t->nodes[n].last = r;
+    return 0;
+}
+
+static void free_rule_table(struct rule_table *t) {
+    if (t == NULL)
+        return;
+    if (t->rules != NULL)
+        ng_free(t->rules, __FILE__, __LINE__);
+    if (t->next != NULL)
+        ng_free(t->next, __FILE__, __LINE__);
+    if (t->nodes != NULL)
+        ng_free(t->nodes, __FILE__, __LINE__);
+    ng_free(t, __FILE__, __LINE__);
+}
+
+int set_rules(const struct rule *rules, int count) {
+    if (rules == NULL)
+        count = 0;
+    if (count < 0 || count > RULES_MAX) {
+        log_print(PLATFORM_LOG_PRIORITY_ERROR, "Rules count %d invalid", count);
+        return -1;
+    }
+    for (int i = 0; i < count; i++) {
+        const struct rule *r = &rules[i];
+        if ((r->version != 4 && r->version != 6) ||
+            r->prefix > (r->version == 4 ? 32 : 128) ||
+            r->port_min > r->port_max ||
+            r->action > RULE_ACTION_REDIRECT ||
+            (r->action == RULE_ACTION_REDIRECT &&
+             (*r->raddr == 0 || memchr(r->raddr, 0, sizeof(r->raddr)) == NULL))) {
+            log_print(PLATFORM_LOG_PRIORITY_ERROR, "Rule %d invalid", i);
+            return -1;
+        }
+    }
+
+    struct rule_table *t = NULL;
+    if (count > 0) {
+        t = ng_calloc(1, sizeof(struct rule_table), "rule table");
+        t->rules = ng_malloc(count * sizeof(struct rule), "rules");
+        t->next = ng_malloc(count * sizeof(int32_t), "rule next");
+        memcpy(t->rules, rules, count * sizeof(struct rule));
+        t->count = count;
+
+        int err = (add_rule_node(t) < 0 || add_rule_node(t) < 0);
+        for (int32_t r = 0; r < count && !err; r++)
+            err = (add_rule(t, r) < 0);
+        if (err) {
+            log_print(PLATFORM_LOG_PRIORITY_ERROR, "Rules out of memory");
+            free_rule_table(t);
+            return -1;
+        }
+    }
+
+    pthread_mutex_lock(&rules_lock);
+    struct rule_table *old = rule_table;
+    rule_table = t;
+    pthread_mutex_unlock(&rules_lock);
+
+    free_rule_table(old);
+
+    log_print(PLATFORM_LOG_PRIORITY_WARN, "Rules %d nodes %d", count, t == NULL ? 0 : t->node_count);
+    return 0;
+}
+
+static int is_rule_matching(const struct rule *r, int protocol, uint16_t dport, int32_t uid) {
+    // Ports of other protocols are identifiers, not services
+    return ((r->uid == RULE_ANY_UID || r->uid == uid) &&
+            (r->protocol == RULE_ANY_PROTOCOL || r->protocol == protocol) &&
+            ((protocol != IPPROTO_TCP && protocol != IPPROTO_UDP) ||
+             (dport >= r->port_min && dport <= r->port_max)));
+}
+
+int match_rule(int version, int protocol, const void *daddr, uint16_t dport, int32_t uid,
+               struct rule *rule) {
+    const uint8_t *addr = daddr;
+    int action = RULE_ACTION_JAVA;
+
+    pthread_mutex_lock(&rules_lock);
+    const struct rule_table *t = rule_table;
+    if (t != NULL) {
+        // Nodes with rules along the address, the longest prefix last
+        int32_t path[129];
+        int depth = 0;
+        int32_t n = (version == 4 ? 0 : 1);
+        int bits = (version == 4 ? 32 : 128);
+        for (int b = 0; ; b++) {
+            if (t->nodes[n].first >= 0)
+                path[depth++] = n;
+            if (b == bits)
+                break;
+            n = t->nodes[n].child[(addr[b / 8] >> (7 - b % 8)) & 1];
+            if (n == 0)
+                break;
+        }
+
+        // A rule deferring to Java hides the shorter prefixes too
+        int found = 0;
+        for (int d = depth - 1; d >= 0 && !found; d--)
+            for (int32_t r = t->nodes[path[d]].first; r >= 0 && !found; r = t->next[r])
+                if (is_rule_matching(&t->rules[r], protocol, dport, uid)) {
+                    *rule = t->rules[r];
+                    action = rule->action;
+                    found = 1;
+                }
+    }
+    pthread_mutex_unlock(&rules_lock);
+
+    if (action == RULE_ACTION_ALLOW)
+        rules_allowed++;
+    else if (action == RULE_ACTION_DENY)
+        rules_denied++;
+    else if (action == RULE_ACTION_REDIRECT)
+        rules_redirected++;
+    else
+        rules_java++;
+
+    return action;
+}
+
+void get_rules_stats(long long *stats) {
+    pthread_mutex_lock(&rules_lock);
+    stats[0] = (rule_table == NULL ? 0 : rule_table->count);
+    pthread_mutex_unlock(&rules_lock);
+    stats[1] = rules_allowed;
+    stats[2] = rules_denied;
+    stats[3] = rules_redirected;
+    stats[4] = rules_java;
+}
+
+void cleanup_rules() {
+    set_rules(NULL, 0);
+    rules_allowed = 0;
+    rules_denied = 0;
+    rules_redirected = 0;
+    rules_java = 0;
+}
@@ -27,7 +27,6 @@
 #define EPOLL_EVENTS 20
 
 #define TUN_YIELD 10 // packets
-#define UDP_YIELD 10 // packets
 
 #define SESSION_LIMIT 40 // percent
 #define SESSION_MAX (1024 * SESSION_LIMIT / 100) // number
@@ -44,11 +43,20 @@ void clear(struct context *ctx) {
                         s->socket, errno, strerror(errno));
         if (s->protocol == IPPROTO_TCP)
             clear_tcp_data(&s->tcp);
+        else if (s->protocol == IPPROTO_UDP)
+            clear_udp_data(&s->udp);
         struct ng_session *p = s;
         s = s->next;
         ng_free(p, __FILE__, __LINE__);
     }
     ctx->ng_session = NULL;
+
+    cleanup_dns_pool();
+    cleanup_ip_fragments();
+    cleanup_udp_mux();
+    cleanup_socks5_udp();
+    cleanup_udp_buffers();
+    cleanup_socket_pool();
 }
 
 void *handle_events(void *a) {
@@ -177,6 +185,8 @@ void *handle_events(void *a) {
                     s = s->next;
                     if (c->protocol == IPPROTO_TCP)
                         clear_tcp_data(&c->tcp);
+                    else if (c->protocol == IPPROTO_UDP)
+                        clear_udp_data(&c->udp);
                     ng_free(c, __FILE__, __LINE__);
                 } else {
                     sl = s;
@@ -211,9 +221,12 @@ void *handle_events(void *a) {
             }
         }
 
-        if (ready == 0)
+        if (ready == 0) {
             log_print(PLATFORM_LOG_PRIORITY_DEBUG, "epoll timeout");
-        else {
+
+            // Prepare sockets for new sessions while idle
+            fill_socket_pool(args);
+        } else {
 
             if (pthread_mutex_lock(&args->ctx->lock))
                 log_print(PLATFORM_LOG_PRIORITY_ERROR, "pthread_mutex_lock failed");
@@ -230,6 +243,18 @@ void *handle_events(void *a) {
                     else
                         log_print(PLATFORM_LOG_PRIORITY_WARN, "Read pipe");
 
+                } else if (is_dns_pool_socket(ev[i].data.ptr)) {
+                    // Check shared DNS sockets
+                    check_dns_pool_socket(args, &ev[i]);
+
+                } else if (is_udp_mux_socket(ev[i].data.ptr)) {
+                    // Check shared UDP sockets
+                    check_udp_mux_socket(args, &ev[i]);
+
+                } else if (is_socks5_udp_socket(ev[i].data.ptr)) {
+                    // Check SOCKS5 UDP association
+                    check_socks5_udp_socket(args, &ev[i], epoll_fd);
+
                 } else if (ev[i].data.ptr == NULL) {
                     // Check upstream
                     log_print(PLATFORM_LOG_PRIORITY_DEBUG, "epoll ready %d/%d in %d out %d err %d hup %d",
@@ -247,6 +272,9 @@ void *handle_events(void *a) {
                             error = 1;
                     }
 
+                    // Send queued UDP datagrams
+                    flush_udp(args);
+
                 } else {
                     // Check downstream
                     log_print(PLATFORM_LOG_PRIORITY_DEBUG,
@@ -264,13 +292,9 @@ void *handle_events(void *a) {
                         session->protocol == IPPROTO_ICMPV6)
                         check_icmp_socket(args, &ev[i]);
                     else if (session->protocol == IPPROTO_UDP) {
-                        int count = 0;
-                        while (count < UDP_YIELD && !args->ctx->stopping &&
-                               !(ev[i].events & EPOLLERR) && (ev[i].events & EPOLLIN) &&
-                               is_readable(session->socket)) {
-                            count++;
+                        // Connected sockets report ICMP errors
+                        if (ev[i].events & (EPOLLIN | EPOLLERR))
                             check_udp_socket(args, &ev[i]);
-                        }
                     } else if (session->protocol == IPPROTO_TCP)
                         check_tcp_socket(args, &ev[i], epoll_fd);
                 }
@@ -295,6 +319,10 @@ void *handle_events(void *a) {
     log_print(PLATFORM_LOG_PRIORITY_WARN, "Stopped events tun=%d", args->tun);
 
     // Cleanup
+    cleanup_dns_pool();
+    cleanup_udp_mux();
+    cleanup_socks5_udp();
+    cleanup_socket_pool();
     ng_free(args, __FILE__, __LINE__);
 
     return NULL;
@@ -303,6 +331,7 @@ void *handle_events(void *a) {
 void check_allowed(const struct arguments *args) {
     char source[INET6_ADDRSTRLEN + 1];
     char dest[INET6_ADDRSTRLEN + 1];
+    char data[DNS_NAMES_DATA_MAX];
 
     struct ng_session *l = NULL;
     struct ng_session *s = args->ctx->ng_session;
@@ -324,6 +353,7 @@ void check_allowed(const struct arguments *args) {
                 packet.source = source;
                 packet.sport = 0;
                 packet.dest = dest;
+                packet.daddr = &s->icmp.daddr;
                 packet.dport = 0;
                 packet.data = "";
                 packet.uid = s->icmp.uid;
@@ -352,8 +382,9 @@ void check_allowed(const struct arguments *args) {
                 packet.source = source;
                 packet.sport = ntohs(s->udp.source);
                 packet.dest = dest;
+                packet.daddr = &s->udp.daddr;
                 packet.dport = ntohs(s->udp.dest);
-                packet.data = "";
+                packet.data = get_dns_names_data(s->udp.version, &s->udp.daddr, data, sizeof(data));
                 packet.uid = s->udp.uid;
                 packet.allowed = 0;
                 if (is_address_allowed(args, &packet) == NULL) {
@@ -392,8 +423,9 @@ void check_allowed(const struct arguments *args) {
                 packet.source = source;
                 packet.sport = ntohs(s->tcp.source);
                 packet.dest = dest;
+                packet.daddr = &s->tcp.daddr;
                 packet.dport = ntohs(s->tcp.dest);
-                packet.data = "";
+                packet.data = get_dns_names_data(s->tcp.version, &s->tcp.daddr, data, sizeof(data));
                 packet.uid = s->tcp.uid;
                 packet.allowed = 0;
                 if (is_address_allowed(args, &packet) == NULL) {
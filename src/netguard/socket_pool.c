@@ -0,0 +1,155 @@
+#include "netguard.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// Definitions
+///////////////////////////////////////////////////////////////////////////////
+
+#define SOCKET_POOL_MIN 2 // per type and address family
+#define SOCKET_POOL_MAX 16
+#define SOCKET_POOL_REFILL 4 // sockets per idle point
+#define SOCKET_POOL_WINDOW 1000 // ms
+#define SOCKET_POOL_INTERVAL 1000 // ms between refills
+#define SOCKET_POOL_BACKOFF 30000 // ms after a socket error
+
+struct socket_pool {
+    int type;
+    int version;
+    int sockets[SOCKET_POOL_MAX];
+    int count;
+    int target;
+    int taken; // in the current window
+    long long window;
+};
+
+int socket_pool = 0;
+
+static long long socket_pool_next = 0; // ms, next refill
+
+static struct socket_pool socket_pools[4] = {
+        {SOCK_STREAM, 4},
+        {SOCK_STREAM, 6},
+        {SOCK_DGRAM,  4},
+        {SOCK_DGRAM,  6}
+};
+
+static struct socket_pool *get_socket_pool(int type, int version);
+
+static int open_pool_socket(const struct arguments *args, int type, int version);
+
+///////////////////////////////////////////////////////////////////////////////
+
+static struct socket_pool *get_socket_pool(int type, int version) {
+    return &socket_pools[(type == SOCK_STREAM ? 0 : 2) + (version == 4 ? 0 : 1)];
+}
+
+static int open_pool_socket(const struct arguments *args, int type, int version) {
+    int sock = socket(version == 4 ? PF_INET : PF_INET6, type,
+                      type == SOCK_STREAM ? 0 : IPPROTO_UDP);
+    if (sock < 0) {
+        log_print(PLATFORM_LOG_PRIORITY_ERROR, "%s socket error %d: %s",
+                  type == SOCK_STREAM ? "TCP" : "UDP", errno, strerror(errno));
+        return -1;
+    }
+
+    // Protect
+    if (protect_socket(args, sock) < 0) {
+        close(sock);
+        return -1;
+    }
+
+    if (type == SOCK_STREAM) {
+        int on = 1;
+        if (setsockopt(sock, SOL_TCP, TCP_NODELAY, &on, sizeof(on)) < 0)
+            log_print(PLATFORM_LOG_PRIORITY_ERROR, "setsockopt TCP_NODELAY error %d: %s",
+                      errno, strerror(errno));
+    }
+
+    // Set non blocking
+    int flags = fcntl(sock, F_GETFL, 0);
+    if (flags < 0 || fcntl(sock, F_SETFL, flags | O_NONBLOCK) < 0) {
+        log_print(PLATFORM_LOG_PRIORITY_ERROR, "fcntl socket O_NONBLOCK error %d: %s",
+                  errno, strerror(errno));
+        close(sock);
+        return -1;
+    }
+
+    return sock;
+}
+
+int get_pool_socket(const struct arguments *args, int type, int version) {
+    struct socket_pool *p = get_socket_pool(type, version);
+    p->taken++;
+
+    if (p->count > 0) {
+        log_print(PLATFORM_LOG_PRIORITY_DEBUG, "%s%d pooled socket %d left %d",
+                  type == SOCK_STREAM ? "TCP" : "UDP", version,
+                  p->sockets[p->count - 1], p->count - 1);
+        return p->sockets[--p->count];
+    }
+
+    return open_pool_socket(args, type, version);
+}
+
+void fill_socket_pool(const struct arguments *args) {
+    if (!socket_pool)
+        return;
+
+    // Refill and shrink at most once an interval, after a socket error (EMFILE) much later
+    long long now = get_ms();
+    if (now < socket_pool_next)
+        return;
+    socket_pool_next = now + SOCKET_POOL_INTERVAL;
+
+    int opened = 0;
+    for (int i = 0; i < 4; i++) {
+        struct socket_pool *p = &socket_pools[i];
+
+        // Size to the sockets taken in the last window
+        if (now - p->window >= SOCKET_POOL_WINDOW) {
+            int target = p->taken;
+            if (target < SOCKET_POOL_MIN)
+                target = SOCKET_POOL_MIN;
+            if (target > SOCKET_POOL_MAX)
+                target = SOCKET_POOL_MAX;
+            if (target != p->target)
+                log_print(PLATFORM_LOG_PRIORITY_DEBUG, "%s%d socket pool target %d taken %d",
+                          p->type == SOCK_STREAM ? "TCP" : "UDP", p->version, target, p->taken);
+            p->target = target;
+            p->taken = 0;
+            p->window = now;
+        }
+
+        // Shrink slowly
+        if (p->count > p->target) {
+            if (close(p->sockets[--p->count]))
+                log_print(PLATFORM_LOG_PRIORITY_ERROR, "socket pool close error %d: %s",
+                          errno, strerror(errno));
+        }
+
+        while (p->count < p->target && opened < SOCKET_POOL_REFILL) {
+            int sock = open_pool_socket(args, p->type, p->version);
+            if (sock < 0) {
+                log_print(PLATFORM_LOG_PRIORITY_WARN, "socket pool refill paused %d ms",
+                          SOCKET_POOL_BACKOFF);
+                socket_pool_next = now + SOCKET_POOL_BACKOFF;
+                return;
+            }
+            p->sockets[p->count++] = sock;
+            opened++;
+        }
+    }
+}
+
+void cleanup_socket_pool() {
+    for (int i = 0; i < 4; i++) {
+        struct socket_pool *p = &socket_pools[i];
+        while (p->count > 0)
+            if (close(p->sockets[--p->count]))
+                log_print(PLATFORM_LOG_PRIORITY_ERROR, "socket pool close error %d: %s",
+                          errno, strerror(errno));
+        p->target = 0;
+        p->taken = 0;
+        p->window = 0;
+    }
+    socket_pool_next = 0;
+}
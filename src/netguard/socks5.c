@@ -1,4 +1,4 @@
-#include <netinet/in6.h>
+#include "netguard.h"
 
 ///////////////////////////////////////////////////////////////////////////////
 // Globals
@@ -8,3 +8,250 @@ char socks5_addr[INET6_ADDRSTRLEN + 1];
 int socks5_port = 0;
 char socks5_username[127 + 1];
 char socks5_password[127 + 1];
+
+int socks5_optimistic = 0;
+struct sockaddr_storage socks5_sockaddr;
+socklen_t socks5_sockaddr_len = 0;
+
+///////////////////////////////////////////////////////////////////////////////
+// Definitions
+///////////////////////////////////////////////////////////////////////////////
+
+static size_t build_socks5_hello(uint8_t *buffer);
+
+static size_t build_socks5_auth(uint8_t *buffer);
+
+static size_t build_socks5_connect(const struct tcp_session *cur, uint8_t *buffer);
+
+static int send_socks5(struct ng_session *s, const char *session,
+                       const uint8_t *buffer, size_t len, const char *what);
+
+static ssize_t get_socks5_reply_length(const struct tcp_session *cur);
+
+///////////////////////////////////////////////////////////////////////////////
+
+// https://tools.ietf.org/html/rfc1928
+// https://tools.ietf.org/html/rfc1929
+// https://en.wikipedia.org/wiki/SOCKS#SOCKS5
+
+int resolve_socks5() {
+    memset(&socks5_sockaddr, 0, sizeof(struct sockaddr_storage));
+    socks5_sockaddr_len = 0;
+    if (!*socks5_addr || !socks5_port)
+        return 0;
+
+    char port[8];
+    sprintf(port, "%d", socks5_port);
+
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(struct addrinfo));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_NUMERICSERV;
+
+    struct addrinfo *result = NULL;
+    int err = getaddrinfo(socks5_addr, port, &hints, &result);
+    if (err || result == NULL) {
+        log_print(PLATFORM_LOG_PRIORITY_ERROR, "SOCKS5 resolve %s error %d: %s",
+                  socks5_addr, err, gai_strerror(err));
+        return -1;
+    }
+
+    memcpy(&socks5_sockaddr, result->ai_addr, result->ai_addrlen);
+    socks5_sockaddr_len = result->ai_addrlen;
+    freeaddrinfo(result);
+
+    log_print(PLATFORM_LOG_PRIORITY_WARN, "SOCKS5 %s resolved IPv%d",
+              socks5_addr, socks5_sockaddr.ss_family == AF_INET ? 4 : 6);
+    return 0;
+}
+
+static size_t build_socks5_hello(uint8_t *buffer) {
+    *(buffer + 0) = 5; // version
+    if (socks5_optimistic) {
+        // Offer one method only, so the replies to follow are known in advance
+        *(buffer + 1) = 1;
+        *(buffer + 2) = (uint8_t) (*socks5_username ? 2 : 0);
+        return 3;
+    }
+    *(buffer + 1) = 2; // methods
+    *(buffer + 2) = 0; // no authentication
+    *(buffer + 3) = 2; // username/password
+    return 4;
+}
+
+static size_t build_socks5_auth(uint8_t *buffer) {
+    uint8_t ulen = (uint8_t) strlen(socks5_username);
+    uint8_t plen = (uint8_t) strlen(socks5_password);
+    *(buffer + 0) = 1; // Version
+    *(buffer + 1) = ulen;
+    memcpy(buffer + 2, socks5_username, ulen);
+    *(buffer + 2 + ulen) = plen;
+    memcpy(buffer + 2 + ulen + 1, socks5_password, plen);
+    return 2 + ulen + 1 + plen;
+}
+
+static size_t build_socks5_connect(const struct tcp_session *cur, uint8_t *buffer) {
+    *(buffer + 0) = 5; // version
+    *(buffer + 1) = cur->socks5_command;
+    *(buffer + 2) = 0; // reserved
+    *(buffer + 3) = (uint8_t) (cur->version == 4 ? 1 : 4);
+    if (cur->version == 4) {
+        memcpy(buffer + 4, &cur->daddr.ip4, 4);
+        *((__be16 *) (buffer + 4 + 4)) = cur->dest;
+    } else {
+        memcpy(buffer + 4, &cur->daddr.ip6, 16);
+        *((__be16 *) (buffer + 4 + 16)) = cur->dest;
+    }
+    return (cur->version == 4 ? 10 : 22);
+}
+
+static int send_socks5(struct ng_session *s, const char *session,
+                       const uint8_t *buffer, size_t len, const char *what) {
+    char *h = hex(buffer, len);
+    log_print(PLATFORM_LOG_PRIORITY_INFO, "%s sending SOCKS5 %s: %s", session, what, h);
+    ng_free(h, __FILE__, __LINE__);
+
+    // Handshake messages are small and the socket was just connected
+    ssize_t sent = send(s->socket, buffer, len, MSG_NOSIGNAL);
+    if (sent != len) {
+        log_print(PLATFORM_LOG_PRIORITY_ERROR, "%s send SOCKS5 %s %d/%d error %d: %s",
+                  session, what, sent, len, errno, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+int start_socks5(struct ng_session *s, const char *session) {
+    s->tcp.socks5 = SOCKS5_HELLO;
+    s->tcp.socks5_received = 0;
+    if (s->tcp.socks5_reply == NULL)
+        s->tcp.socks5_reply = ng_malloc(SOCKS5_REPLY_MAX, "socks5 reply");
+
+    uint8_t buffer[4 + 2 + 127 + 1 + 127 + 22];
+    size_t len = build_socks5_hello(buffer);
+    if (socks5_optimistic) {
+        // Pipeline greeting, authentication and connect request
+        if (*socks5_username)
+            len += build_socks5_auth(buffer + len);
+        len += build_socks5_connect(&s->tcp, buffer + len);
+    }
+    return send_socks5(s, session, buffer, len, socks5_optimistic ? "pipelined" : "hello");
+}
+
+static ssize_t get_socks5_reply_length(const struct tcp_session *cur) {
+    if (cur->socks5 == SOCKS5_HELLO || cur->socks5 == SOCKS5_AUTH)
+        return 2;
+    if (cur->socks5 != SOCKS5_CONNECT)
+        return -1;
+
+    // Version, reply, reserved, address type, address, port
+    if (cur->socks5_received < 5)
+        return 5;
+    uint8_t atyp = cur->socks5_reply[3];
+    if (atyp == 1)
+        return 4 + 4 + 2;
+    else if (atyp == 4)
+        return 4 + 16 + 2;
+    else if (atyp == 3)
+        return 4 + 1 + cur->socks5_reply[4] + 2;
+    return -1;
+}
+
+int recv_socks5(struct ng_session *s, const char *session) {
+    while (s->tcp.socks5 != SOCKS5_CONNECTED) {
+        ssize_t need = get_socks5_reply_length(&s->tcp);
+        if (need < 0 || need > SOCKS5_REPLY_MAX) {
+            log_print(PLATFORM_LOG_PRIORITY_ERROR, "%s recv SOCKS5 state %d invalid reply",
+                      session, s->tcp.socks5);
+            return -1;
+        }
+
+        // Read no further than the current reply, data after it belongs to the stream
+        if (s->tcp.socks5_received < need) {
+            ssize_t bytes = recv(s->socket, s->tcp.socks5_reply + s->tcp.socks5_received,
+                                 (size_t) (need - s->tcp.socks5_received), 0);
+            if (bytes < 0) {
+                if (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK)
+                    return 0;
+                log_print(PLATFORM_LOG_PRIORITY_ERROR, "%s recv SOCKS5 error %d: %s",
+                          session, errno, strerror(errno));
+                return -1;
+            } else if (bytes == 0) {
+                log_print(PLATFORM_LOG_PRIORITY_ERROR, "%s recv SOCKS5 eof", session);
+                return -1;
+            }
+            s->tcp.socks5_received += bytes;
+            continue;
+        }
+
+        uint8_t *reply = s->tcp.socks5_reply;
+        char *h = hex(reply, (size_t) need);
+        log_print(PLATFORM_LOG_PRIORITY_INFO, "%s recv SOCKS5 %s", session, h);
+        ng_free(h, __FILE__, __LINE__);
+        s->tcp.socks5_received = 0;
+
+        uint8_t buffer[2 + 127 + 1 + 127 + 22];
+        if (s->tcp.socks5 == SOCKS5_HELLO) {
+            int expected = (*socks5_username ? 2 : 0);
+            if (reply[0] != 5 || (reply[1] != 0 && reply[1] != 2) ||
+                (socks5_optimistic && reply[1] != expected)) {
+                log_print(PLATFORM_LOG_PRIORITY_ERROR, "%s SOCKS5 auth %d not supported",
+                          session, reply[1]);
+                return -1;
+            }
+            if (reply[1] == 2) {
+                s->tcp.socks5 = SOCKS5_AUTH;
+                if (!socks5_optimistic &&
+                    send_socks5(s, session, buffer, build_socks5_auth(buffer), "auth") < 0)
+                    return -1;
+            } else {
+                s->tcp.socks5 = SOCKS5_CONNECT;
+                if (!socks5_optimistic &&
+                    send_socks5(s, session, buffer, build_socks5_connect(&s->tcp, buffer),
+                                "connect") < 0)
+                    return -1;
+            }
+
+        } else if (s->tcp.socks5 == SOCKS5_AUTH) {
+            if ((reply[0] != 1 && reply[0] != 5) || reply[1] != 0) {
+                log_print(PLATFORM_LOG_PRIORITY_ERROR, "%s SOCKS5 auth error %d",
+                          session, reply[1]);
+                return -1;
+            }
+            log_print(PLATFORM_LOG_PRIORITY_WARN, "%s SOCKS5 auth OK", session);
+            s->tcp.socks5 = SOCKS5_CONNECT;
+            if (!socks5_optimistic &&
+                send_socks5(s, session, buffer, build_socks5_connect(&s->tcp, buffer),
+                            "connect") < 0)
+                return -1;
+
+        } else if (s->tcp.socks5 == SOCKS5_CONNECT) {
+            if (reply[0] != 5 || reply[1] != 0) {
+                log_print(PLATFORM_LOG_PRIORITY_ERROR, "%s SOCKS5 connect error %d",
+                          session, reply[1]);
+                /*
+                    0x00 = request granted
+                    0x01 = general failure
+                    0x02 = connection not allowed by ruleset
+                    0x03 = network unreachable
+                    0x04 = host unreachable
+                    0x05 = connection refused by destination host
+                    0x06 = TTL expired
+                    0x07 = command not supported / protocol error
+                    0x08 = address type not supported
+                 */
+                return -1;
+            }
+            log_print(PLATFORM_LOG_PRIORITY_WARN, "%s SOCKS5 connected", session);
+            s->tcp.socks5 = SOCKS5_CONNECTED;
+
+            // The reply to an association carries the relay address, released by the caller
+            if (s->tcp.socks5_command == SOCKS5_CMD_CONNECT) {
+                ng_free(s->tcp.socks5_reply, __FILE__, __LINE__);
+                s->tcp.socks5_reply = NULL;
+            }
+        }
+    }
+    return 1;
+}
@@ -0,0 +1,492 @@
+#include "netguard.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// Definitions
+///////////////////////////////////////////////////////////////////////////////
+
+#define SOCKS5_UDP_SOCKETS 64 // relay sockets, flows to the same remote endpoint each need one
+#define SOCKS5_UDP_PENDING 16 // datagrams queued while associating
+#define SOCKS5_UDP_BACKOFF 30 // seconds, after a failed association
+#define SOCKS5_UDP_YIELD 10 // datagrams
+#define SOCKS5_UDP_HEADER_MAX (4 + 16 + 2) // bytes, IPv6 destination
+#define SOCKS5_UDP_MAXMSG (IPV6_MAXPACKET - 40 - 8) // bytes
+
+struct socks5_udp_socket {
+    int socket;
+    int flows;
+    struct epoll_event ev;
+};
+
+struct socks5_udp_datagram {
+    const struct udp_session *cur;
+    uint8_t *data;
+    size_t len;
+};
+
+int socks5_udp = 0;
+
+// The association lasts as long as the control connection
+static struct ng_session socks5_control = {.socket = -1};
+static struct socks5_udp_socket socks5_relays[SOCKS5_UDP_SOCKETS];
+static struct sockaddr_storage socks5_relay_addr;
+static socklen_t socks5_relay_addrlen = 0; // zero while associating
+static time_t socks5_udp_backoff = 0;
+static int socks5_udp_initialized = 0;
+
+static struct endpoint_flows socks5_udp_flows;
+static struct socks5_udp_datagram socks5_udp_pending[SOCKS5_UDP_PENDING];
+static int socks5_udp_pending_count = 0;
+
+static void init_socks5_udp();
+
+static int open_socks5_control(const struct arguments *args, int epoll_fd);
+
+static int open_socks5_relay(const struct arguments *args, int epoll_fd);
+
+static int open_socks5_relay_socket(const struct arguments *args, struct socks5_udp_socket *r,
+                                    int epoll_fd);
+
+static void close_socks5_relay_socket(struct socks5_udp_socket *r);
+
+static void close_socks5_udp(const char *reason);
+
+static void release_socks5_udp_flow(struct ng_session *s);
+
+static ssize_t relay_socks5_udp(const struct udp_session *cur, const uint8_t *data, size_t datalen);
+
+static void check_socks5_control(const struct arguments *args, const struct epoll_event *ev,
+                                 int epoll_fd);
+
+static void check_socks5_relay(const struct arguments *args, struct socks5_udp_socket *r);
+
+///////////////////////////////////////////////////////////////////////////////
+
+// https://tools.ietf.org/html/rfc1928#section-7
+
+static void init_socks5_udp() {
+    if (socks5_udp_initialized)
+        return;
+    for (int i = 0; i < SOCKS5_UDP_SOCKETS; i++) {
+        socks5_relays[i].socket = -1;
+        socks5_relays[i].flows = 0;
+    }
+    memset(&socks5_udp_flows, 0, sizeof(socks5_udp_flows));
+    socks5_udp_initialized = 1;
+}
+
+static int open_socks5_control(const struct arguments *args, int epoll_fd) {
+    int version = (socks5_sockaddr.ss_family == AF_INET ? 4 : 6);
+    int sock = get_pool_socket(args, SOCK_STREAM, version);
+    if (sock < 0)
+        return -1;
+
+    if (connect(sock, (const struct sockaddr *) &socks5_sockaddr, socks5_sockaddr_len) &&
+        errno != EINPROGRESS) {
+        log_print(PLATFORM_LOG_PRIORITY_ERROR, "SOCKS5 UDP connect error %d: %s",
+                  errno, strerror(errno));
+        close(sock);
+        return -1;
+    }
+
+    // Request an association for datagrams from any address
+    memset(&socks5_control, 0, sizeof(struct ng_session));
+    socks5_control.protocol = IPPROTO_TCP;
+    socks5_control.tcp.version = 4;
+    socks5_control.tcp.daddr.ip4 = INADDR_ANY;
+    socks5_control.tcp.dest = 0;
+    socks5_control.tcp.socks5 = SOCKS5_NONE;
+    socks5_control.tcp.socks5_command = SOCKS5_CMD_UDP_ASSOCIATE;
+    socks5_control.tcp.socks5_reply = NULL;
+    socks5_control.socket = sock;
+
+    socks5_control.ev.events = EPOLLOUT | EPOLLERR;
+    socks5_control.ev.data.ptr = &socks5_control;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, sock, &socks5_control.ev)) {
+        log_print(PLATFORM_LOG_PRIORITY_ERROR, "epoll add SOCKS5 UDP error %d: %s",
+                  errno, strerror(errno));
+        close(sock);
+        socks5_control.socket = -1;
+        return -1;
+    }
+
+    log_print(PLATFORM_LOG_PRIORITY_WARN, "SOCKS5 UDP associating to %s/%u",
+              socks5_addr, socks5_port);
+    return 0;
+}
+
+static int open_socks5_relay(const struct arguments *args, int epoll_fd) {
+    // The reply carries the address of the relay
+    const uint8_t *reply = socks5_control.tcp.socks5_reply;
+    struct sockaddr_storage *relay = &socks5_relay_addr;
+    memcpy(relay, &socks5_sockaddr, sizeof(struct sockaddr_storage));
+    socks5_relay_addrlen = socks5_sockaddr_len;
+    if (reply[3] == 1) {
+        struct sockaddr_in *relay4 = (struct sockaddr_in *) relay;
+        __be32 any = INADDR_ANY;
+        if (memcmp(reply + 4, &any, 4) != 0) {
+            memset(relay, 0, sizeof(struct sockaddr_storage));
+            relay4->sin_family = AF_INET;
+            memcpy(&relay4->sin_addr, reply + 4, 4);
+            socks5_relay_addrlen = sizeof(struct sockaddr_in);
+        }
+        relay4->sin_port = *((__be16 *) (reply + 4 + 4));
+    } else if (reply[3] == 4) {
+        struct sockaddr_in6 *relay6 = (struct sockaddr_in6 *) relay;
+        if (memcmp(reply + 4, &in6addr_any, 16) != 0) {
+            memset(relay, 0, sizeof(struct sockaddr_storage));
+            relay6->sin6_family = AF_INET6;
+            memcpy(&relay6->sin6_addr, reply + 4, 16);
+            socks5_relay_addrlen = sizeof(struct sockaddr_in6);
+        }
+        relay6->sin6_port = *((__be16 *) (reply + 4 + 16));
+    } else {
+        // Domain names are not resolved here, assume the relay runs on the proxy host
+        __be16 port = *((__be16 *) (reply + 4 + 1 + reply[4]));
+        if (relay->ss_family == AF_INET)
+            ((struct sockaddr_in *) relay)->sin_port = port;
+        else
+            ((struct sockaddr_in6 *) relay)->sin6_port = port;
+    }
+
+    ng_free(socks5_control.tcp.socks5_reply, __FILE__, __LINE__);
+    socks5_control.tcp.socks5_reply = NULL;
+
+    log_print(PLATFORM_LOG_PRIORITY_WARN, "SOCKS5 UDP relay port %u",
+              ntohs(relay->ss_family == AF_INET
+                    ? ((struct sockaddr_in *) relay)->sin_port
+                    : ((struct sockaddr_in6 *) relay)->sin6_port));
+
+    // Flows registered while associating get their sockets now
+    for (int i = 0; i < SOCKS5_UDP_SOCKETS; i++)
+        if (socks5_relays[i].flows > 0 &&
+            open_socks5_relay_socket(args, &socks5_relays[i], epoll_fd) < 0)
+            return -1;
+
+    // Send what was queued while associating
+    for (int i = 0; i < socks5_udp_pending_count; i++) {
+        struct socks5_udp_datagram *d = &socks5_udp_pending[i];
+        if (relay_socks5_udp(d->cur, d->data, d->len) < 0)
+            log_print(PLATFORM_LOG_PRIORITY_WARN, "SOCKS5 UDP relay send error %d: %s",
+                      errno, strerror(errno));
+        ng_free(d->data, __FILE__, __LINE__);
+    }
+    socks5_udp_pending_count = 0;
+
+    return 0;
+}
+
+static int open_socks5_relay_socket(const struct arguments *args, struct socks5_udp_socket *r,
+                                    int epoll_fd) {
+    int sock = get_pool_socket(args, SOCK_DGRAM, socks5_relay_addr.ss_family == AF_INET ? 4 : 6);
+    if (sock < 0)
+        return -1;
+
+    // Connected, so only datagrams from the relay are received
+    if (connect(sock, (const struct sockaddr *) &socks5_relay_addr, socks5_relay_addrlen)) {
+        log_print(PLATFORM_LOG_PRIORITY_ERROR, "SOCKS5 UDP relay connect error %d: %s",
+                  errno, strerror(errno));
+        close(sock);
+        return -1;
+    }
+
+    r->socket = sock;
+    memset(&r->ev, 0, sizeof(struct epoll_event));
+    r->ev.events = EPOLLIN | EPOLLERR;
+    r->ev.data.ptr = r;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, sock, &r->ev)) {
+        log_print(PLATFORM_LOG_PRIORITY_ERROR, "epoll add SOCKS5 UDP relay error %d: %s",
+                  errno, strerror(errno));
+        close(sock);
+        r->socket = -1;
+        return -1;
+    }
+
+    log_print(PLATFORM_LOG_PRIORITY_WARN, "SOCKS5 UDP relay socket %d", sock);
+    return 0;
+}
+
+static void close_socks5_relay_socket(struct socks5_udp_socket *r) {
+    // Closing removes the socket from epoll
+    if (r->socket >= 0 && close(r->socket))
+        log_print(PLATFORM_LOG_PRIORITY_ERROR, "SOCKS5 UDP relay close %d error %d: %s",
+                  r->socket, errno, strerror(errno));
+    r->socket = -1;
+}
+
+static void close_socks5_udp(const char *reason) {
+    log_print(PLATFORM_LOG_PRIORITY_WARN, "SOCKS5 UDP association closed: %s", reason);
+
+    // A proxy without UDP support is not asked again for a while
+    if (socks5_relay_addrlen == 0)
+        socks5_udp_backoff = time(NULL) + SOCKS5_UDP_BACKOFF;
+
+    // Relayed flows cannot continue without the association
+    clear_endpoint_flows(&socks5_udp_flows, release_socks5_udp_flow);
+
+    for (int i = 0; i < socks5_udp_pending_count; i++)
+        ng_free(socks5_udp_pending[i].data, __FILE__, __LINE__);
+    socks5_udp_pending_count = 0;
+
+    if (socks5_control.tcp.socks5_reply != NULL) {
+        ng_free(socks5_control.tcp.socks5_reply, __FILE__, __LINE__);
+        socks5_control.tcp.socks5_reply = NULL;
+    }
+
+    // Closing removes the sockets from epoll
+    if (socks5_control.socket >= 0 && close(socks5_control.socket))
+        log_print(PLATFORM_LOG_PRIORITY_ERROR, "SOCKS5 UDP close %d error %d: %s",
+                  socks5_control.socket, errno, strerror(errno));
+    socks5_control.socket = -1;
+
+    for (int i = 0; i < SOCKS5_UDP_SOCKETS; i++) {
+        close_socks5_relay_socket(&socks5_relays[i]);
+        socks5_relays[i].flows = 0;
+    }
+    socks5_relay_addrlen = 0;
+}
+
+int open_socks5_udp(const struct arguments *args, struct ng_session *s, int epoll_fd) {
+    if (!socks5_udp || !*socks5_addr || !socks5_port || socks5_sockaddr_len == 0)
+        return 0;
+
+    // Broadcast and multicast stay on the local network
+    if (is_broadcast_or_multicast(s->udp.version, &s->udp.daddr))
+        return 0;
+
+    // Nothing else leaves outside the proxy, the flow is refused instead
+    if (socks5_udp_backoff > time(NULL)) {
+        log_print(PLATFORM_LOG_PRIORITY_INFO, "SOCKS5 UDP backing off, flow refused");
+        return -1;
+    }
+
+    init_socks5_udp();
+
+    // Replies are demultiplexed by relay socket and remote endpoint,
+    // the association is for any client port, so each relay socket can take one flow per endpoint
+    struct socks5_udp_socket *r = NULL;
+    for (int i = 0; i < SOCKS5_UDP_SOCKETS && r == NULL; i++)
+        if (find_endpoint_flow(&socks5_udp_flows, &socks5_relays[i],
+                               s->udp.version, &s->udp.daddr, s->udp.dest) == NULL)
+            r = &socks5_relays[i];
+    if (r == NULL) {
+        log_print(PLATFORM_LOG_PRIORITY_WARN, "SOCKS5 UDP relay sockets exhausted, flow refused");
+        return -1;
+    }
+
+    if (socks5_control.socket < 0 && open_socks5_control(args, epoll_fd) < 0) {
+        socks5_udp_backoff = time(NULL) + SOCKS5_UDP_BACKOFF;
+        return -1;
+    }
+
+    // Sockets are opened once the relay address is known
+    if (r->socket < 0 && socks5_relay_addrlen > 0 &&
+        open_socks5_relay_socket(args, r, epoll_fd) < 0)
+        return -1;
+
+    s->udp.socks5 = r;
+    add_endpoint_flow(&socks5_udp_flows, r, s);
+    r->flows++;
+
+    return 1;
+}
+
+static ssize_t relay_socks5_udp(const struct udp_session *cur, const uint8_t *data, size_t datalen) {
+    // Reserved, fragment, address type, destination address and port
+    uint8_t header[SOCKS5_UDP_HEADER_MAX];
+    size_t hlen;
+    header[0] = 0;
+    header[1] = 0;
+    header[2] = 0;
+    if (cur->version == 4) {
+        header[3] = 1;
+        memcpy(header + 4, &cur->daddr.ip4, 4);
+        *((__be16 *) (header + 4 + 4)) = cur->dest;
+        hlen = 4 + 4 + 2;
+    } else {
+        header[3] = 4;
+        memcpy(header + 4, &cur->daddr.ip6, 16);
+        *((__be16 *) (header + 4 + 16)) = cur->dest;
+        hlen = 4 + 16 + 2;
+    }
+
+    struct iovec iov[2];
+    iov[0].iov_base = header;
+    iov[0].iov_len = hlen;
+    iov[1].iov_base = (void *) data;
+    iov[1].iov_len = datalen;
+
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(struct msghdr));
+    msg.msg_iov = iov;
+    msg.msg_iovlen = 2;
+
+    ssize_t sent = sendmsg(cur->socks5->socket, &msg, MSG_NOSIGNAL);
+    return (sent < 0 ? -1 : sent - (ssize_t) hlen);
+}
+
+ssize_t send_socks5_udp(const struct udp_session *cur, const uint8_t *data, size_t datalen) {
+    if (cur->socks5->socket >= 0)
+        return relay_socks5_udp(cur, data, datalen);
+
+    // Still associating
+    if (socks5_udp_pending_count < SOCKS5_UDP_PENDING) {
+        struct socks5_udp_datagram *d = &socks5_udp_pending[socks5_udp_pending_count++];
+        d->cur = cur;
+        d->data = ng_malloc(datalen, "socks5 udp pending");
+        memcpy(d->data, data, datalen);
+        d->len = datalen;
+    } else
+        log_print(PLATFORM_LOG_PRIORITY_WARN, "SOCKS5 UDP associating, datagram dropped");
+    return datalen;
+}
+
+int is_socks5_udp_socket(const void *ptr) {
+    return (ptr == &socks5_control ||
+            (ptr >= (const void *) &socks5_relays[0] &&
+             ptr < (const void *) &socks5_relays[SOCKS5_UDP_SOCKETS]));
+}
+
+static void check_socks5_control(const struct arguments *args, const struct epoll_event *ev,
+                                 int epoll_fd) {
+    const char *session = "SOCKS5 UDP";
+
+    if (ev->events & EPOLLERR) {
+        int serr = 0;
+        socklen_t optlen = sizeof(int);
+        if (getsockopt(socks5_control.socket, SOL_SOCKET, SO_ERROR, &serr, &optlen) == 0 && serr)
+            log_print(PLATFORM_LOG_PRIORITY_WARN, "SOCKS5 UDP SO_ERROR %d: %s",
+                      serr, strerror(serr));
+        close_socks5_udp("error");
+        return;
+    }
+
+    if (socks5_control.tcp.socks5 == SOCKS5_NONE) {
+        if (!(ev->events & EPOLLOUT))
+            return;
+
+        if (start_socks5(&socks5_control, session) < 0) {
+            close_socks5_udp("send");
+            return;
+        }
+
+        socks5_control.ev.events = EPOLLIN | EPOLLERR;
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_MOD, socks5_control.socket, &socks5_control.ev))
+            log_print(PLATFORM_LOG_PRIORITY_ERROR, "epoll mod SOCKS5 UDP error %d: %s",
+                      errno, strerror(errno));
+
+    } else if (socks5_control.tcp.socks5 != SOCKS5_CONNECTED) {
+        if (!(ev->events & (EPOLLIN | EPOLLHUP)))
+            return;
+
+        if (recv_socks5(&socks5_control, session) < 0)
+            close_socks5_udp("handshake");
+        else if (socks5_control.tcp.socks5 == SOCKS5_CONNECTED &&
+                 open_socks5_relay(args, epoll_fd) < 0)
+            close_socks5_udp("relay");
+
+    } else if (ev->events & (EPOLLIN | EPOLLHUP)) {
+        // Nothing is expected on the control connection, but its end
+        uint8_t buffer[64];
+        ssize_t bytes = recv(socks5_control.socket, buffer, sizeof(buffer), 0);
+        if (bytes == 0 ||
+            (bytes < 0 && errno != EINTR && errno != EAGAIN && errno != EWOULDBLOCK))
+            close_socks5_udp("control connection");
+    }
+}
+
+static void check_socks5_relay(const struct arguments *args, struct socks5_udp_socket *r) {
+    uint8_t *buffer = ng_malloc(SOCKS5_UDP_MAXMSG, "socks5 udp recv");
+    for (int count = 0; count < SOCKS5_UDP_YIELD && !args->ctx->stopping; count++) {
+        ssize_t bytes = recv(r->socket, buffer, SOCKS5_UDP_MAXMSG, 0);
+        if (bytes < 0) {
+            if (errno != EINTR && errno != EAGAIN && errno != EWOULDBLOCK)
+                log_print(PLATFORM_LOG_PRIORITY_WARN, "SOCKS5 UDP relay recv error %d: %s",
+                          errno, strerror(errno));
+            break;
+        }
+
+        // Fragmented datagrams are not supported
+        if (bytes < 4 || buffer[2] != 0) {
+            log_print(PLATFORM_LOG_PRIORITY_WARN, "SOCKS5 UDP relay invalid datagram %d", bytes);
+            continue;
+        }
+
+        struct ng_session *s = NULL;
+        size_t hlen = 0;
+        if (buffer[3] == 1 && bytes >= 4 + 4 + 2) {
+            hlen = 4 + 4 + 2;
+            s = find_endpoint_flow(&socks5_udp_flows, r,
+                                   4, buffer + 4, *((__be16 *) (buffer + 4 + 4)));
+        } else if (buffer[3] == 4 && bytes >= 4 + 16 + 2) {
+            hlen = 4 + 16 + 2;
+            s = find_endpoint_flow(&socks5_udp_flows, r,
+                                   6, buffer + 4, *((__be16 *) (buffer + 4 + 16)));
+        }
+
+        if (s == NULL || s->udp.state != UDP_ACTIVE) {
+            log_print(PLATFORM_LOG_PRIORITY_DEBUG, "SOCKS5 UDP relay no flow");
+            continue;
+        }
+
+        s->udp.time = time(NULL);
+        forward_udp_data(args, s, buffer + hlen, (size_t) bytes - hlen);
+    }
+    ng_free(buffer, __FILE__, __LINE__);
+}
+
+void check_socks5_udp_socket(const struct arguments *args, const struct epoll_event *ev,
+                             int epoll_fd) {
+    if (ev->data.ptr == &socks5_control)
+        check_socks5_control(args, ev, epoll_fd);
+    else {
+        // A relay socket closed earlier in the same batch is not read
+        struct socks5_udp_socket *r = (struct socks5_udp_socket *) ev->data.ptr;
+        if (r->socket < 0)
+            return;
+
+        if (ev->events & EPOLLERR) {
+            int serr = 0;
+            socklen_t optlen = sizeof(int);
+            if (getsockopt(r->socket, SOL_SOCKET, SO_ERROR, &serr, &optlen) == 0 && serr)
+                log_print(PLATFORM_LOG_PRIORITY_WARN, "SOCKS5 UDP relay SO_ERROR %d: %s",
+                          serr, strerror(serr));
+        }
+        if (ev->events & EPOLLIN)
+            check_socks5_relay(args, r);
+    }
+}
+
+void release_socks5_udp(struct udp_session *cur) {
+    struct socks5_udp_socket *r = cur->socks5;
+    if (r == NULL)
+        return;
+
+    if (remove_endpoint_flow(&socks5_udp_flows, r, cur))
+        r->flows--;
+
+    // The first relay socket stays for the association, the others only for their flows
+    if (r->flows == 0 && r != &socks5_relays[0])
+        close_socks5_relay_socket(r);
+
+    for (int i = 0; i < socks5_udp_pending_count;)
+        if (socks5_udp_pending[i].cur == cur) {
+            ng_free(socks5_udp_pending[i].data, __FILE__, __LINE__);
+            socks5_udp_pending[i] = socks5_udp_pending[--socks5_udp_pending_count];
+        } else
+            i++;
+
+    cur->socks5 = NULL;
+}
+
+static void release_socks5_udp_flow(struct ng_session *s) {
+    s->udp.socks5 = NULL;
+    if (s->udp.state == UDP_ACTIVE)
+        s->udp.state = UDP_FINISHING;
+}
+
+void cleanup_socks5_udp() {
+    // Relay sockets are only open with the control connection
+    if (socks5_control.socket >= 0)
+        close_socks5_udp("cleanup");
+    socks5_udp_backoff = 0;
+}
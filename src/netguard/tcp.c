@@ -23,12 +23,6 @@
 // Definitions
 ///////////////////////////////////////////////////////////////////////////////
 
-#define SOCKS5_NONE 1
-#define SOCKS5_HELLO 2
-#define SOCKS5_AUTH 3
-#define SOCKS5_CONNECT 4
-#define SOCKS5_CONNECTED 5
-
 #define TCP_INIT_TIMEOUT 20 // seconds ~net.inet.tcp.keepinit
 #define TCP_IDLE_TIMEOUT 3600 // seconds ~net.inet.tcp.keepidle
 #define TCP_CLOSE_TIMEOUT 20 // seconds
@@ -36,6 +30,9 @@
 // https://en.wikipedia.org/wiki/Maximum_segment_lifetime
 
 #define SEND_BUF_DEFAULT 163840 // bytes
+#define SEND_BUF_MAX_DEFAULT 4194304 // bytes ~net.ipv4.tcp_wmem
+#define TCP_SCALE_MAX 14 // RFC 7323
+#define TCP_TSO_MAX 65535 // bytes, IP packet
 
 struct segment {
     uint32_t seq;
@@ -46,6 +43,17 @@ struct segment {
     struct segment *next;
 };
 
+struct dns_stream_context {
+    const struct arguments *args;
+    const struct ng_session *s;
+};
+
+// Opt-in: answer the SYN while the upstream connects.
+// The client considers the connection established, so a failing upstream reaches it
+// as a reset of an established connection and not as a failed connect:
+// no ICMP unreachable is sent and Happy Eyeballs will not try another address.
+int tcp_early_synack = 0;
+
 
 static uint32_t get_send_window(const struct tcp_session *cur);
 
@@ -53,13 +61,19 @@ static uint32_t get_receive_buffer(const struct ng_session *cur);
 
 static uint32_t get_receive_window(const struct ng_session *cur);
 
+static uint32_t get_segment_size(const struct arguments *args, const struct tcp_session *cur);
+
+static uint16_t get_path_mss(const struct ng_session *s);
+
+static uint8_t get_receive_scale(const struct ng_session *s);
+
 static void queue_tcp(const struct arguments *args,
                const struct tcphdr *tcphdr,
                const char *session, struct tcp_session *cur,
                const uint8_t *data, uint16_t datalen);
 
 static int open_tcp_socket(const struct arguments *args,
-                    const struct tcp_session *cur, const struct allowed *redirect);
+                    struct tcp_session *cur, const struct allowed *redirect);
 
 static int write_syn_ack(const struct arguments *args, struct tcp_session *cur);
 
@@ -76,9 +90,31 @@ static ssize_t write_tcp(const struct arguments *args, const struct tcp_session
                   const uint8_t *data, size_t datalen,
                   int syn, int ack, int fin, int rst);
 
+static void write_tcp_unreachable(const struct arguments *args,
+                                  const struct tcp_session *cur, int err);
+
+static size_t handle_dns_stream(void *ctx, uint8_t *message, size_t len);
+
+static void flush_dns_stream(const struct arguments *args, struct ng_session *s);
+
 ///////////////////////////////////////////////////////////////////////////////
 
 void clear_tcp_data(struct tcp_session *cur) {
+    clear_tls_hello(cur);
+
+    if (cur->dns != NULL) {
+        free_dns_stream(cur->dns);
+        ng_free(cur->dns, __FILE__, __LINE__);
+        cur->dns = NULL;
+    }
+
+    clear_dns_allowed(cur);
+
+    if (cur->socks5_reply != NULL) {
+        ng_free(cur->socks5_reply, __FILE__, __LINE__);
+        cur->socks5_reply = NULL;
+    }
+
     struct segment *s = cur->forward;
     while (s != NULL) {
         struct segment *p = s;
@@ -90,7 +126,7 @@ void clear_tcp_data(struct tcp_session *cur) {
 
 int get_tcp_timeout(const struct tcp_session *t, int sessions, int maxsessions) {
     int timeout;
-    if (t->state == TCP_LISTEN || t->state == TCP_SYN_RECV)
+    if (t->state == TCP_LISTEN || t->state == TCP_SYN_RECV || t->early)
         timeout = TCP_INIT_TIMEOUT;
     else if (t->state == TCP_ESTABLISHED)
         timeout = TCP_IDLE_TIMEOUT;
@@ -153,8 +189,11 @@ int check_tcp_session(const struct arguments *args, struct ng_session *s,
 
     if ((s->tcp.state == TCP_CLOSING || s->tcp.state == TCP_CLOSE) &&
         (s->tcp.sent || s->tcp.received)) {
+        struct dns_names names;
+        int named = dns_names_get(s->tcp.version, &s->tcp.daddr, &names);
         account_usage(args, s->tcp.version, IPPROTO_TCP,
-                      dest, ntohs(s->tcp.dest), s->tcp.uid, s->tcp.sent, s->tcp.received);
+                      dest, ntohs(s->tcp.dest), s->tcp.uid, s->tcp.sent, s->tcp.received,
+                      named ? names.qname : NULL);
         s->tcp.sent = 0;
         s->tcp.received = 0;
     }
@@ -170,7 +209,7 @@ int monitor_tcp_session(const struct arguments *args, struct ng_session *s, int
     int recheck = 0;
     unsigned int events = EPOLLERR;
 
-    if (s->tcp.state == TCP_LISTEN) {
+    if (s->tcp.state == TCP_LISTEN || s->tcp.early) {
         // Check for connected = writable
         if (s->tcp.socks5 == SOCKS5_NONE)
             events = events | EPOLLOUT;
@@ -178,8 +217,14 @@ int monitor_tcp_session(const struct arguments *args, struct ng_session *s, int
             events = events | EPOLLIN;
     } else if (s->tcp.state == TCP_ESTABLISHED || s->tcp.state == TCP_CLOSE_WAIT) {
 
+        // Forward DNS messages held back by the send window before reading more
+        const uint8_t *held;
+        if (s->tcp.dns != NULL && get_dns_stream_data(s->tcp.dns, &held) > 0)
+            flush_dns_stream(args, s);
+
         // Check for incoming data
-        if (get_send_window(&s->tcp) > 0)
+        if (get_send_window(&s->tcp) > 0 &&
+            (s->tcp.dns == NULL || get_dns_stream_data(s->tcp.dns, &held) == 0))
             events = events | EPOLLIN;
         else {
             recheck = 1;
@@ -234,6 +279,55 @@ static uint32_t get_send_window(const struct tcp_session *cur) {
     return total;
 }
 
+static uint32_t get_segment_size(const struct arguments *args, const struct tcp_session *cur) {
+    // The kernel segments to the client MSS when the tun takes virtio net headers
+    if (args->vnet_hdr)
+        return (uint32_t) (TCP_TSO_MAX - sizeof(struct tcphdr) -
+                           (cur->version == 4 ? sizeof(struct iphdr) : sizeof(struct ip6_hdr)));
+    return cur->mss;
+}
+
+static uint16_t get_path_mss(const struct ng_session *s) {
+    uint16_t mss = get_default_mss(s->tcp.version);
+
+    // The upstream socket is connected to the SOCKS5 proxy if any,
+    // so its MSS accounts for the IP version and options of the proxy hop
+    int maxseg = 0;
+    socklen_t optlen = sizeof(int);
+    if (s->socket >= 0 &&
+        getsockopt(s->socket, IPPROTO_TCP, TCP_MAXSEG, &maxseg, &optlen) == 0 &&
+        maxseg > 0 && maxseg < mss)
+        mss = (uint16_t) maxseg;
+
+    return mss;
+}
+
+static uint8_t get_receive_scale(const struct ng_session *s) {
+    // The send buffer of the upstream socket is auto tuned up to the tcp_wmem maximum
+    static int sendbuf_max = 0;
+    if (sendbuf_max == 0) {
+        sendbuf_max = SEND_BUF_MAX_DEFAULT;
+        FILE *fd = fopen("/proc/sys/net/ipv4/tcp_wmem", "r");
+        if (fd != NULL) {
+            int min, def, max;
+            if (fscanf(fd, "%d %d %d", &min, &def, &max) == 3 && max > 0)
+                sendbuf_max = max;
+            fclose(fd);
+        }
+    }
+
+    int sendbuf = 0;
+    socklen_t optlen = sizeof(int);
+    if (getsockopt(s->socket, SOL_SOCKET, SO_SNDBUF, &sendbuf, &optlen) < 0)
+        log_print(PLATFORM_LOG_PRIORITY_WARN, "getsockopt SO_SNDBUF %d: %s", errno, strerror(errno));
+
+    uint32_t buffer = (uint32_t) (sendbuf > sendbuf_max ? sendbuf : sendbuf_max);
+    uint8_t scale = 0;
+    while (scale < TCP_SCALE_MAX && (((uint32_t) 0xFFFF) << scale) < buffer)
+        scale++;
+    return scale;
+}
+
 static uint32_t get_receive_buffer(const struct ng_session *cur) {
     if (cur->socket < 0)
         return 0;
@@ -325,189 +419,48 @@ void check_tcp_socket(const struct arguments *args,
             log_print(PLATFORM_LOG_PRIORITY_ERROR, "%s SO_ERROR %d: %s",
                         session, serr, strerror(serr));
 
-        write_rst(args, &s->tcp);
+        if ((s->tcp.state == TCP_LISTEN || s->tcp.early) && s->tcp.socks5 == SOCKS5_NONE)
+            check_tcp_fastopen(s, 0);
 
-        // Connection refused
-        if (0)
-            if (err >= 0 && (serr == ECONNREFUSED || serr == EHOSTUNREACH)) {
-                struct icmp icmp;
-                memset(&icmp, 0, sizeof(struct icmp));
-                icmp.icmp_type = ICMP_UNREACH;
-                if (serr == ECONNREFUSED)
-                    icmp.icmp_code = ICMP_UNREACH_PORT;
-                else
-                    icmp.icmp_code = ICMP_UNREACH_HOST;
-                icmp.icmp_cksum = 0;
-                icmp.icmp_cksum = ~calc_checksum(0, (const uint8_t *) &icmp, 4);
-
-                struct icmp_session sicmp;
-                memset(&sicmp, 0, sizeof(struct icmp_session));
-                sicmp.version = s->tcp.version;
-                if (s->tcp.version == 4) {
-                    sicmp.saddr.ip4 = (__be32) s->tcp.saddr.ip4;
-                    sicmp.daddr.ip4 = (__be32) s->tcp.daddr.ip4;
-                } else {
-                    memcpy(&sicmp.saddr.ip6, &s->tcp.saddr.ip6, 16);
-                    memcpy(&sicmp.daddr.ip6, &s->tcp.daddr.ip6, 16);
-                }
+        // An unreachable destination fails the connect with its own error, before the reset;
+        // stacks ignore the error for connections which are established already
+        if (err >= 0 && serr && !s->tcp.early)
+            write_tcp_unreachable(args, &s->tcp, serr);
 
-                write_icmp(args, &sicmp, (uint8_t *) &icmp, 8);
-            }
+        write_rst(args, &s->tcp);
     } else {
         // Assume socket okay
-        if (s->tcp.state == TCP_LISTEN) {
+        if (s->tcp.state == TCP_LISTEN || s->tcp.early) {
             // Check socket connect
             if (s->tcp.socks5 == SOCKS5_NONE) {
                 if (ev->events & EPOLLOUT) {
                     log_print(PLATFORM_LOG_PRIORITY_INFO, "%s connected", session);
+                    check_tcp_fastopen(s, 1);
 
-                    // https://tools.ietf.org/html/rfc1928
-                    // https://tools.ietf.org/html/rfc1929
-                    // https://en.wikipedia.org/wiki/SOCKS#SOCKS5
-                    if (*socks5_addr && socks5_port)
-                        s->tcp.socks5 = SOCKS5_HELLO;
-                    else
-                        s->tcp.socks5 = SOCKS5_CONNECTED;
-                }
-            } else {
-                if (ev->events & EPOLLIN) {
-                    uint8_t buffer[32];
-                    ssize_t bytes = recv(s->socket, buffer, sizeof(buffer), 0);
-                    if (bytes < 0) {
-                        log_print(PLATFORM_LOG_PRIORITY_ERROR, "%s recv SOCKS5 error %d: %s",
-                                    session, errno, strerror(errno));
-                        write_rst(args, &s->tcp);
-                    } else {
-                        char *h = hex(buffer, (const size_t) bytes);
-                        log_print(PLATFORM_LOG_PRIORITY_INFO, "%s recv SOCKS5 %s", session, h);
-                        ng_free(h, __FILE__, __LINE__);
-
-                        if (s->tcp.socks5 == SOCKS5_HELLO &&
-                            bytes == 2 && buffer[0] == 5) {
-                            if (buffer[1] == 0)
-                                s->tcp.socks5 = SOCKS5_CONNECT;
-                            else if (buffer[1] == 2)
-                                s->tcp.socks5 = SOCKS5_AUTH;
-                            else {
-                                s->tcp.socks5 = 0;
-                                log_print(PLATFORM_LOG_PRIORITY_ERROR, "%s SOCKS5 auth %d not supported",
-                                            session, buffer[1]);
-                                write_rst(args, &s->tcp);
-                            }
-
-                        } else if (s->tcp.socks5 == SOCKS5_AUTH &&
-                                   bytes == 2 &&
-                                   (buffer[0] == 1 || buffer[0] == 5)) {
-                            if (buffer[1] == 0) {
-                                s->tcp.socks5 = SOCKS5_CONNECT;
-                                log_print(PLATFORM_LOG_PRIORITY_WARN, "%s SOCKS5 auth OK", session);
-                            } else {
-                                s->tcp.socks5 = 0;
-                                log_print(PLATFORM_LOG_PRIORITY_ERROR, "%s SOCKS5 auth error %d",
-                                            session, buffer[1]);
-                                write_rst(args, &s->tcp);
-                            }
-
-                        } else if (s->tcp.socks5 == SOCKS5_CONNECT &&
-                                   bytes == 6 + (s->tcp.version == 4 ? 4 : 16) &&
-                                   buffer[0] == 5) {
-                            if (buffer[1] == 0) {
-                                s->tcp.socks5 = SOCKS5_CONNECTED;
-                                log_print(PLATFORM_LOG_PRIORITY_WARN, "%s SOCKS5 connected", session);
-                            } else {
-                                s->tcp.socks5 = 0;
-                                log_print(PLATFORM_LOG_PRIORITY_ERROR, "%s SOCKS5 connect error %d",
-                                            session, buffer[1]);
-                                write_rst(args, &s->tcp);
-                                /*
-                                    0x00 = request granted
-                                    0x01 = general failure
-                                    0x02 = connection not allowed by ruleset
-                                    0x03 = network unreachable
-                                    0x04 = host unreachable
-                                    0x05 = connection refused by destination host
-                                    0x06 = TTL expired
-                                    0x07 = command not supported / protocol error
-                                    0x08 = address type not supported
-                                 */
-                            }
-
-                        } else {
+                    if (*socks5_addr && socks5_port) {
+                        if (start_socks5(s, session) < 0) {
                             s->tcp.socks5 = 0;
-                            log_print(PLATFORM_LOG_PRIORITY_ERROR, "%s recv SOCKS5 state %d",
-                                        session, s->tcp.socks5);
                             write_rst(args, &s->tcp);
                         }
-                    }
-                }
-            }
-
-            if (s->tcp.socks5 == SOCKS5_HELLO) {
-                uint8_t buffer[4] = {5, 2, 0, 2};
-                char *h = hex(buffer, sizeof(buffer));
-                log_print(PLATFORM_LOG_PRIORITY_INFO, "%s sending SOCKS5 hello: %s",
-                            session, h);
-                ng_free(h, __FILE__, __LINE__);
-                ssize_t sent = send(s->socket, buffer, sizeof(buffer), MSG_NOSIGNAL);
-                if (sent < 0) {
-                    log_print(PLATFORM_LOG_PRIORITY_ERROR, "%s send SOCKS5 hello error %d: %s",
-                                session, errno, strerror(errno));
-                    write_rst(args, &s->tcp);
+                    } else
+                        s->tcp.socks5 = SOCKS5_CONNECTED;
                 }
-
-            } else if (s->tcp.socks5 == SOCKS5_AUTH) {
-                uint8_t ulen = strlen(socks5_username);
-                uint8_t plen = strlen(socks5_password);
-                uint8_t buffer[512];
-                *(buffer + 0) = 1; // Version
-                *(buffer + 1) = ulen;
-                memcpy(buffer + 2, socks5_username, ulen);
-                *(buffer + 2 + ulen) = plen;
-                memcpy(buffer + 2 + ulen + 1, socks5_password, plen);
-
-                size_t len = 2 + ulen + 1 + plen;
-
-                char *h = hex(buffer, len);
-                log_print(PLATFORM_LOG_PRIORITY_INFO, "%s sending SOCKS5 auth: %s",
-                            session, h);
-                ng_free(h, __FILE__, __LINE__);
-                ssize_t sent = send(s->socket, buffer, len, MSG_NOSIGNAL);
-                if (sent < 0) {
-                    log_print(PLATFORM_LOG_PRIORITY_ERROR,
-                                "%s send SOCKS5 connect error %d: %s",
-                                session, errno, strerror(errno));
+            } else if (s->tcp.socks5 != SOCKS5_CONNECTED && s->tcp.socks5 != 0) {
+                if ((ev->events & EPOLLIN) && recv_socks5(s, session) < 0) {
+                    s->tcp.socks5 = 0;
                     write_rst(args, &s->tcp);
                 }
+            }
 
-            } else if (s->tcp.socks5 == SOCKS5_CONNECT) {
-                uint8_t buffer[22];
-                *(buffer + 0) = 5; // version
-                *(buffer + 1) = 1; // TCP/IP stream connection
-                *(buffer + 2) = 0; // reserved
-                *(buffer + 3) = (uint8_t) (s->tcp.version == 4 ? 1 : 4);
-                if (s->tcp.version == 4) {
-                    memcpy(buffer + 4, &s->tcp.daddr.ip4, 4);
-                    *((__be16 *) (buffer + 4 + 4)) = s->tcp.dest;
-                } else {
-                    memcpy(buffer + 4, &s->tcp.daddr.ip6, 16);
-                    *((__be16 *) (buffer + 4 + 16)) = s->tcp.dest;
-                }
-
-                size_t len = (s->tcp.version == 4 ? 10 : 22);
-
-                char *h = hex(buffer, len);
-                log_print(PLATFORM_LOG_PRIORITY_INFO, "%s sending SOCKS5 connect: %s",
-                            session, h);
-                ng_free(h, __FILE__, __LINE__);
-                ssize_t sent = send(s->socket, buffer, len, MSG_NOSIGNAL);
-                if (sent < 0) {
-                    log_print(PLATFORM_LOG_PRIORITY_ERROR,
-                                "%s send SOCKS5 connect error %d: %s",
-                                session, errno, strerror(errno));
-                    write_rst(args, &s->tcp);
-                }
+            if (s->tcp.socks5 == SOCKS5_CONNECTED && s->tcp.early) {
+                // The client was answered already, forward queued data from now on
+                log_print(PLATFORM_LOG_PRIORITY_INFO, "%s upstream connected", session);
+                s->tcp.early = 0;
+                s->tcp.time = time(NULL);
 
             } else if (s->tcp.socks5 == SOCKS5_CONNECTED) {
+                s->tcp.recv_mss = get_path_mss(s);
+                log_print(PLATFORM_LOG_PRIORITY_INFO, "%s path mss %u", session, s->tcp.recv_mss);
                 s->tcp.remote_seq++; // remote SYN
                 if (write_syn_ack(args, &s->tcp) >= 0) {
                     s->tcp.time = time(NULL);
@@ -607,8 +560,8 @@ void check_tcp_socket(const struct arguments *args,
                 if ((ev->events & EPOLLIN) && send_window > 0) {
                     s->tcp.time = time(NULL);
 
-                    uint32_t buffer_size = (send_window > s->tcp.mss
-                                            ? s->tcp.mss : send_window);
+                    uint32_t segment = get_segment_size(args, &s->tcp);
+                    uint32_t buffer_size = (send_window > segment ? segment : send_window);
                     uint8_t *buffer = ng_malloc(buffer_size, "tcp socket");
                     ssize_t bytes = recv(s->socket, buffer, (size_t) buffer_size, 0);
                     if (bytes < 0) {
@@ -621,6 +574,10 @@ void check_tcp_socket(const struct arguments *args,
                     } else if (bytes == 0) {
                         log_print(PLATFORM_LOG_PRIORITY_WARN, "%s recv eof", session);
 
+                        if (s->tcp.dns != NULL && get_dns_stream_partial(s->tcp.dns) > 0)
+                            log_print(PLATFORM_LOG_PRIORITY_WARN, "%s DNS stream truncated %d",
+                                      session, (int) get_dns_stream_partial(s->tcp.dns));
+
                         if (s->tcp.forward == NULL) {
                             if (write_fin_ack(args, &s->tcp) >= 0) {
                                 log_print(PLATFORM_LOG_PRIORITY_WARN, "%s FIN sent", session);
@@ -649,15 +606,19 @@ void check_tcp_socket(const struct arguments *args,
                         log_print(PLATFORM_LOG_PRIORITY_DEBUG, "%s recv bytes %d", session, bytes);
                         s->tcp.received += bytes;
 
-                        // Process DNS response
-                        int block_dns = 0;
-                        if (ntohs(s->tcp.dest) == 53 && bytes > 2) {
-                            ssize_t dlen = bytes - 2;
-                            block_dns = parse_dns_response(args, s, buffer + 2, (size_t *) &dlen);
-                        }
-
-                        // Forward to tun
-                        if (block_dns == 0 && write_data(args, &s->tcp, buffer, (size_t) bytes) >= 0) {
+                        if (ntohs(s->tcp.dest) == 53) {
+                            // Forward complete DNS responses only, blocked ones rewritten
+                            if (s->tcp.dns == NULL)
+                                s->tcp.dns = ng_calloc(1, sizeof(struct dns_stream), "dns stream");
+                            struct dns_stream_context ctx = {args, s};
+                            if (decode_dns_stream(s->tcp.dns, buffer, (size_t) bytes,
+                                                  handle_dns_stream, &ctx) < 0) {
+                                log_print(PLATFORM_LOG_PRIORITY_ERROR, "%s DNS stream no memory", session);
+                                write_rst(args, &s->tcp);
+                            } else
+                                flush_dns_stream(args, s);
+                        } else if (write_data(args, &s->tcp, buffer, (size_t) bytes) >= 0) {
+                            // Forward to tun
                             s->tcp.local_seq += bytes;
                             s->tcp.unconfirmed++;
                         }
@@ -703,22 +664,21 @@ jboolean handle_tcp(const struct arguments *args,
     // Prepare logging
     char source[INET6_ADDRSTRLEN + 1];
     char dest[INET6_ADDRSTRLEN + 1];
-    void *daddr;
     if (version == 4) {
         inet_ntop(AF_INET, &ip4->saddr, source, sizeof(source));
         inet_ntop(AF_INET, &ip4->daddr, dest, sizeof(dest));
-        daddr = &ip4->daddr;
     } else {
         inet_ntop(AF_INET6, &ip6->ip6_src, source, sizeof(source));
         inet_ntop(AF_INET6, &ip6->ip6_dst, dest, sizeof(dest));
-        daddr = &ip6->ip6_dst;
     }
 
-    // intercept TLS
-    if(cur != NULL && is_sni_found_and_blocked(args, pkt, length, daddr, version, data, cur->tcp.uid)) {
-        // Drop request for SNI domain that should be blocked
+    // Intercept TLS, once per session
+    if (cur != NULL && cur->tcp.tls == TLS_SNI_PENDING && datalen > 0)
+        cur->tcp.tls = inspect_tls_sni(args, &cur->tcp, ntohl(tcphdr->seq), data, datalen);
+
+    // Drop requests for SNI domains that should be blocked
+    if (cur != NULL && cur->tcp.tls == TLS_SNI_BLOCKED && datalen > 0)
         return 1;
-    }
 
     char flags[10];
     int flen = 0;
@@ -758,6 +718,7 @@ jboolean handle_tcp(const struct arguments *args,
             // http://www.iana.org/assignments/tcp-parameters/tcp-parameters.xhtml#tcp-parameters-1
             uint16_t mss = get_default_mss(version);
             uint8_t ws = 0;
+            uint8_t wscale = 0;
             int optlen = tcpoptlen;
             uint8_t *options = (uint8_t *) tcpoptions;
             while (optlen > 0) {
@@ -769,8 +730,10 @@ jboolean handle_tcp(const struct arguments *args,
                 if (kind == 2 && len == 4)
                     mss = ntohs(*((uint16_t *) (options + 2)));
 
-                else if (kind == 3 && len == 3)
+                else if (kind == 3 && len == 3) {
                     ws = *(options + 2);
+                    wscale = 1;
+                }
 
                 if (kind == 1) {
                     optlen--;
@@ -791,10 +754,13 @@ jboolean handle_tcp(const struct arguments *args,
             s->tcp.time = time(NULL);
             s->tcp.uid = uid;
             s->tcp.version = version;
-            s->tcp.mss = mss;
-            s->tcp.recv_scale = ws;
-            s->tcp.send_scale = ws;
-            s->tcp.send_window = ((uint32_t) ntohs(tcphdr->window)) << s->tcp.send_scale;
+            s->tcp.mss = (mss < get_default_mss(version) ? mss : get_default_mss(version));
+            s->tcp.recv_mss = get_default_mss(version);
+            s->tcp.wscale = wscale;
+            s->tcp.recv_scale = 0;
+            s->tcp.recv_window = 0; // sized from the upstream socket once opened
+            s->tcp.send_scale = (ws > TCP_SCALE_MAX ? TCP_SCALE_MAX : ws);
+            s->tcp.send_window = ntohs(tcphdr->window); // not scaled in SYN
             s->tcp.unconfirmed = 0;
             s->tcp.remote_seq = ntohl(tcphdr->seq); // ISN remote
             s->tcp.local_seq = (uint32_t) rand(); // ISN local
@@ -817,13 +783,23 @@ jboolean handle_tcp(const struct arguments *args,
             s->tcp.dest = tcphdr->dest;
             s->tcp.state = TCP_LISTEN;
             s->tcp.socks5 = SOCKS5_NONE;
+            s->tcp.socks5_command = SOCKS5_CMD_CONNECT;
+            s->tcp.socks5_reply = NULL;
+            s->tcp.socks5_received = 0;
+            s->tcp.fastopen = 0;
+            s->tcp.early = 0;
+            s->tcp.tls = get_tls_state(s->tcp.dest);
+            s->tcp.tls_hello = NULL;
+            s->tcp.tls_received = 0;
+            s->tcp.dns = NULL;
+            s->tcp.dns_allowed = NULL;
             s->tcp.forward = NULL;
             s->next = NULL;
 
             if (datalen) {
                 log_print(PLATFORM_LOG_PRIORITY_WARN, "%s SYN data", packet);
                 s->tcp.forward = ng_malloc(sizeof(struct segment), "syn segment");
-                s->tcp.forward->seq = s->tcp.remote_seq;
+                s->tcp.forward->seq = s->tcp.remote_seq + 1; // after SYN
                 s->tcp.forward->len = datalen;
                 s->tcp.forward->sent = 0;
                 s->tcp.forward->psh = tcphdr->psh;
@@ -833,13 +809,23 @@ jboolean handle_tcp(const struct arguments *args,
             }
 
             // Open socket
+            errno = 0;
             s->socket = open_tcp_socket(args, &s->tcp, redirect);
             if (s->socket < 0) {
-                // Remote might retry
+                // Fail fast when there is no route, the remote might retry otherwise
+                int serr = errno;
+                if (serr == ENETUNREACH || serr == EHOSTUNREACH || serr == ECONNREFUSED) {
+                    write_tcp_unreachable(args, &s->tcp, serr);
+                    write_rst(args, &s->tcp);
+                }
+                clear_tcp_data(&s->tcp);
                 ng_free(s, __FILE__, __LINE__);
                 return 0;
             }
 
+            // Our own scale only if the client takes part in window scaling
+            if (s->tcp.wscale)
+                s->tcp.recv_scale = get_receive_scale(s);
             s->tcp.recv_window = get_receive_window(s);
 
             log_print(PLATFORM_LOG_PRIORITY_DEBUG, "TCP socket %d lport %d",
@@ -859,6 +845,15 @@ jboolean handle_tcp(const struct arguments *args,
             if (!allowed) {
                 log_print(PLATFORM_LOG_PRIORITY_WARN, "%s resetting blocked session", packet);
                 write_rst(args, &s->tcp);
+            } else if (tcp_early_synack) {
+                // Let the client send while connecting, data is queued until connected
+                s->tcp.remote_seq++; // remote SYN
+                if (write_syn_ack(args, &s->tcp) >= 0) {
+                    log_print(PLATFORM_LOG_PRIORITY_INFO, "%s early SYN-ACK", packet);
+                    s->tcp.local_seq++; // local SYN
+                    s->tcp.state = TCP_SYN_RECV;
+                    s->tcp.early = 1;
+                }
             }
         } else {
             log_print(PLATFORM_LOG_PRIORITY_WARN, "%s unknown session", packet);
@@ -924,7 +919,30 @@ jboolean handle_tcp(const struct arguments *args,
                     write_rst(args, &cur->tcp);
                     return 0;
                 }
-                queue_tcp(args, tcphdr, session, &cur->tcp, data, datalen);
+
+                // Answer a blocked DNS query locally when it arrives in order in a single segment
+                size_t rlen = 0;
+                if (ntohs(cur->tcp.dest) == 53 && cur->tcp.state == TCP_ESTABLISHED &&
+                    !tcphdr->fin && !tcphdr->rst && cur->tcp.forward == NULL &&
+                    ntohl(tcphdr->seq) == cur->tcp.remote_seq &&
+                    datalen > 2 && ntohs(*((uint16_t *) data)) == datalen - 2) {
+                    uint8_t *response = ng_malloc(datalen, "dns block");
+                    struct dns_verdict verdict;
+                    rlen = block_dns_query(args, cur, data + 2, (size_t) (datalen - 2), response + 2,
+                                           &verdict);
+                    allow_dns_query(&cur->tcp, &verdict);
+                    if (rlen > 0) {
+                        log_print(PLATFORM_LOG_PRIORITY_INFO, "%s DNS answered locally", session);
+                        *((uint16_t *) response) = htons((uint16_t) rlen);
+                        cur->tcp.remote_seq += datalen;
+                        if (write_data(args, &cur->tcp, response, rlen + 2) >= 0)
+                            cur->tcp.local_seq += rlen + 2;
+                    }
+                    ng_free(response, __FILE__, __LINE__);
+                }
+
+                if (rlen == 0)
+                    queue_tcp(args, tcphdr, session, &cur->tcp, data, datalen);
             }
 
             if (tcphdr->rst /* +ACK */) {
@@ -1098,43 +1116,30 @@ static void queue_tcp(const struct arguments *args,
 }
 
 static int open_tcp_socket(const struct arguments *args,
-                    const struct tcp_session *cur, const struct allowed *redirect) {
+                    struct tcp_session *cur, const struct allowed *redirect) {
     int sock;
     int version;
     if (redirect == NULL) {
-        if (*socks5_addr && socks5_port)
-            version = (strstr(socks5_addr, ":") == NULL ? 4 : 6);
-        else
+        if (*socks5_addr && socks5_port) {
+            // Resolved once when configured
+            if (socks5_sockaddr_len == 0) {
+                log_print(PLATFORM_LOG_PRIORITY_ERROR, "SOCKS5 %s unresolved", socks5_addr);
+                return -1;
+            }
+            version = (socks5_sockaddr.ss_family == AF_INET ? 4 : 6);
+        } else
             version = cur->version;
     } else
         version = (strstr(redirect->raddr, ":") == NULL ? 4 : 6);
 
-    // Get TCP socket
-    if ((sock = socket(version == 4 ? PF_INET : PF_INET6, SOCK_STREAM, 0)) < 0) {
-        log_print(PLATFORM_LOG_PRIORITY_ERROR, "socket error %d: %s", errno, strerror(errno));
+    // Get protected, non blocking TCP socket
+    if ((sock = get_pool_socket(args, SOCK_STREAM, version)) < 0) {
         if (errno == EMFILE) {
             report_error(args, errno, "TCP open socket error %d", errno);
         }
         return -1;
     }
 
-    // Protect
-    if (protect_socket(args, sock) < 0)
-        return -1;
-
-    int on = 1;
-    if (setsockopt(sock, SOL_TCP, TCP_NODELAY, &on, sizeof(on)) < 0)
-        log_print(PLATFORM_LOG_PRIORITY_ERROR, "setsockopt TCP_NODELAY error %d: %s",
-                    errno, strerror(errno));
-
-    // Set non blocking
-    int flags = fcntl(sock, F_GETFL, 0);
-    if (flags < 0 || fcntl(sock, F_SETFL, flags | O_NONBLOCK) < 0) {
-        log_print(PLATFORM_LOG_PRIORITY_ERROR, "fcntl socket O_NONBLOCK error %d: %s",
-                    errno, strerror(errno));
-        return -1;
-    }
-
     // Build target address
     struct sockaddr_in addr4;
     struct sockaddr_in6 addr6;
@@ -1143,15 +1148,10 @@ static int open_tcp_socket(const struct arguments *args,
             log_print(PLATFORM_LOG_PRIORITY_WARN, "TCP%d SOCKS5 to %s/%u",
                         version, socks5_addr, socks5_port);
 
-            if (version == 4) {
-                addr4.sin_family = AF_INET;
-                inet_pton(AF_INET, socks5_addr, &addr4.sin_addr);
-                addr4.sin_port = htons(socks5_port);
-            } else {
-                addr6.sin6_family = AF_INET6;
-                inet_pton(AF_INET6, socks5_addr, &addr6.sin6_addr);
-                addr6.sin6_port = htons(socks5_port);
-            }
+            if (version == 4)
+                memcpy(&addr4, &socks5_sockaddr, sizeof(struct sockaddr_in));
+            else
+                memcpy(&addr6, &socks5_sockaddr, sizeof(struct sockaddr_in6));
         } else {
             if (version == 4) {
                 addr4.sin_family = AF_INET;
@@ -1178,15 +1178,37 @@ static int open_tcp_socket(const struct arguments *args,
         }
     }
 
+    const struct sockaddr *addr = (version == 4 ? (const struct sockaddr *) &addr4
+                                                : (const struct sockaddr *) &addr6);
+    socklen_t addrlen = (socklen_t) (version == 4
+                                     ? sizeof(struct sockaddr_in)
+                                     : sizeof(struct sockaddr_in6));
+
+    // Send SYN data directly to the destination with TCP fast open
+    int err = -1;
+    int fastopen = (redirect == NULL && !(*socks5_addr && socks5_port) &&
+                    cur->forward != NULL && cur->forward->seq == cur->remote_seq + 1 &&
+                    can_tcp_fastopen(cur));
+    if (fastopen) {
+        ssize_t sent = send_tcp_fastopen(cur, sock,
+                                         cur->forward->data, cur->forward->len,
+                                         addr, addrlen);
+        if (sent >= 0) {
+            cur->forward->sent += sent;
+            errno = EINPROGRESS;
+        } else if (errno == EOPNOTSUPP)
+            fastopen = 0;
+    }
+
     // Initiate connect
-    int err = connect(sock,
-                      (version == 4 ? (const struct sockaddr *) &addr4
-                                    : (const struct sockaddr *) &addr6),
-                      (socklen_t) (version == 4
-                                   ? sizeof(struct sockaddr_in)
-                                   : sizeof(struct sockaddr_in6)));
+    if (!fastopen)
+        err = connect(sock, addr, addrlen);
     if (err < 0 && errno != EINPROGRESS) {
-        log_print(PLATFORM_LOG_PRIORITY_ERROR, "connect error %d: %s", errno, strerror(errno));
+        int serr = errno;
+        log_print(PLATFORM_LOG_PRIORITY_ERROR, "connect error %d: %s", serr, strerror(serr));
+        if (close(sock))
+            log_print(PLATFORM_LOG_PRIORITY_ERROR, "close error %d: %s", errno, strerror(errno));
+        errno = serr;
         return -1;
     }
 
@@ -1323,7 +1345,10 @@ static ssize_t write_tcp(const struct arguments *args, const struct tcp_session
     tcp->ack = (__u16) ack;
     tcp->fin = (__u16) fin;
     tcp->rst = (__u16) rst;
-    tcp->window = htons(cur->recv_window >> cur->recv_scale);
+    if (syn)
+        tcp->window = htons(cur->recv_window > 0xFFFF ? 0xFFFF : cur->recv_window); // not scaled
+    else
+        tcp->window = htons(cur->recv_window >> cur->recv_scale);
 
     if (!tcp->ack)
         tcp->ack_seq = 0;
@@ -1332,20 +1357,40 @@ static ssize_t write_tcp(const struct arguments *args, const struct tcp_session
     if (syn) {
         *(options) = 2; // MSS
         *(options + 1) = 4; // total option length
-        *((uint16_t *) (options + 2)) = get_default_mss(cur->version);
+        *((uint16_t *) (options + 2)) = htons(cur->recv_mss);
 
-        *(options + 4) = 3; // window scale
-        *(options + 5) = 3; // total option length
-        *(options + 6) = cur->recv_scale;
+        if (cur->wscale) {
+            *(options + 4) = 3; // window scale
+            *(options + 5) = 3; // total option length
+            *(options + 6) = cur->recv_scale;
+        } else
+            memset(options + 4, 1, 3); // No-operation
 
         *(options + 7) = 0; // End, padding
     }
 
-    // Continue checksum
-    csum = calc_checksum(csum, (uint8_t *) tcp, sizeof(struct tcphdr));
-    csum = calc_checksum(csum, options, (size_t) optlen);
-    csum = calc_checksum(csum, data, datalen);
-    tcp->check = ~csum;
+    struct virtio_net_hdr vnet;
+    memset(&vnet, 0, sizeof(struct virtio_net_hdr));
+    if (args->vnet_hdr) {
+        // Leave the checksum over the pseudo header to be completed by the kernel
+        vnet.flags = VIRTIO_NET_HDR_F_NEEDS_CSUM;
+        vnet.csum_start = (uint16_t) ((uint8_t *) tcp - buffer);
+        vnet.csum_offset = (uint16_t) offsetof(struct tcphdr, check);
+        tcp->check = csum;
+
+        if (datalen > cur->mss) {
+            vnet.gso_type = (uint8_t) (cur->version == 4
+                                       ? VIRTIO_NET_HDR_GSO_TCPV4 : VIRTIO_NET_HDR_GSO_TCPV6);
+            vnet.gso_size = cur->mss;
+            vnet.hdr_len = (uint16_t) (vnet.csum_start + sizeof(struct tcphdr) + optlen);
+        }
+    } else {
+        // Continue checksum
+        csum = calc_checksum(csum, (uint8_t *) tcp, sizeof(struct tcphdr));
+        csum = calc_checksum(csum, options, (size_t) optlen);
+        csum = calc_checksum(csum, data, datalen);
+        tcp->check = ~csum;
+    }
 
     inet_ntop(cur->version == 4 ? AF_INET : AF_INET6,
               cur->version == 4 ? (const void *) &cur->saddr.ip4 : (const void *) &cur->saddr.ip6,
@@ -1366,7 +1411,7 @@ static ssize_t write_tcp(const struct arguments *args, const struct tcp_session
                 ntohl(tcp->ack_seq) - cur->remote_start,
                 datalen);
 
-    ssize_t res = write(args->tun, buffer, len);
+    ssize_t res = write_tun(args, buffer, len, &vnet);
 
     // Write pcap record
     if (res >= 0) {
@@ -1390,3 +1435,46 @@ static ssize_t write_tcp(const struct arguments *args, const struct tcp_session
 
     return res;
 }
+
+static void write_tcp_unreachable(const struct arguments *args,
+                                  const struct tcp_session *cur, int err) {
+    // A refused connection is reset only, like a real host would
+    if (err == ECONNREFUSED)
+        return;
+
+    // The client matches the error to its connection by ports and sequence number
+    uint8_t transport[8];
+    uint32_t seq = htonl(cur->remote_seq);
+    memcpy(transport, &cur->source, 2);
+    memcpy(transport + 2, &cur->dest, 2);
+    memcpy(transport + 4, &seq, 4);
+    write_icmp_unreachable(args, cur->version, IPPROTO_TCP, &cur->saddr, &cur->daddr, transport, err);
+}
+
+static size_t handle_dns_stream(void *ctx, uint8_t *message, size_t len) {
+    const struct dns_stream_context *dsc = ctx;
+    parse_dns_response(dsc->args, dsc->s, message, &len);
+    return len;
+}
+
+static void flush_dns_stream(const struct arguments *args, struct ng_session *s) {
+    const uint8_t *data;
+    size_t len;
+    while (s->tcp.state != TCP_CLOSING &&
+           (len = get_dns_stream_data(s->tcp.dns, &data)) > 0) {
+        uint32_t send_window = get_send_window(&s->tcp);
+        uint32_t segment = get_segment_size(args, &s->tcp);
+        if (send_window == 0)
+            break;
+        if (len > segment)
+            len = segment;
+        if (len > send_window)
+            len = send_window;
+
+        if (write_data(args, &s->tcp, data, len) < 0)
+            break;
+        s->tcp.local_seq += len;
+        s->tcp.unconfirmed++;
+        consume_dns_stream(s->tcp.dns, len);
+    }
+}
@@ -0,0 +1,119 @@
+#include "netguard.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// Definitions
+///////////////////////////////////////////////////////////////////////////////
+
+#define TFO_DESTINATIONS 256
+#define TFO_FAILURES 2 // consecutive, before backing off
+#define TFO_BACKOFF 3600 // seconds
+
+#ifndef MSG_FASTOPEN
+#define MSG_FASTOPEN 0x20000000
+#endif
+
+struct tfo_destination {
+    int version;
+    union {
+        __be32 ip4; // network notation
+        struct in6_addr ip6;
+    } daddr;
+    __be16 dest; // network notation
+
+    uint32_t attempts;
+    uint32_t accepted;
+    uint8_t failures;
+    time_t backoff;
+};
+
+int tcp_fastopen = 0;
+
+static int tcp_fastopen_supported = 1;
+
+static struct tfo_destination tfo_destinations[TFO_DESTINATIONS];
+
+static struct tfo_destination *get_tfo_destination(const struct tcp_session *cur, int add);
+
+///////////////////////////////////////////////////////////////////////////////
+
+static struct tfo_destination *get_tfo_destination(const struct tcp_session *cur, int add) {
+    uint32_t h = hash_endpoint(cur->version, &cur->daddr, cur->dest);
+
+    // Direct mapped, a new destination replaces an old one
+    struct tfo_destination *d = &tfo_destinations[h % TFO_DESTINATIONS];
+    if (d->version == cur->version && d->dest == cur->dest &&
+        memcmp(&d->daddr, &cur->daddr, cur->version == 4 ? 4 : 16) == 0)
+        return d;
+
+    if (!add)
+        return NULL;
+
+    memset(d, 0, sizeof(struct tfo_destination));
+    d->version = cur->version;
+    memcpy(&d->daddr, &cur->daddr, cur->version == 4 ? 4 : 16);
+    d->dest = cur->dest;
+    return d;
+}
+
+int can_tcp_fastopen(const struct tcp_session *cur) {
+    if (!tcp_fastopen || !tcp_fastopen_supported)
+        return 0;
+    struct tfo_destination *d = get_tfo_destination(cur, 0);
+    return (d == NULL || d->backoff <= time(NULL));
+}
+
+ssize_t send_tcp_fastopen(struct tcp_session *cur, int sock,
+                          const uint8_t *data, size_t datalen,
+                          const struct sockaddr *addr, socklen_t addrlen) {
+    // Without a cookie the kernel requests one with a plain SYN and returns EINPROGRESS
+    ssize_t sent = sendto(sock, data, datalen, MSG_FASTOPEN | MSG_NOSIGNAL, addr, addrlen);
+    if (sent < 0) {
+        if (errno == EOPNOTSUPP || errno == EPIPE) {
+            log_print(PLATFORM_LOG_PRIORITY_WARN, "TCP fast open not supported error %d: %s",
+                      errno, strerror(errno));
+            tcp_fastopen_supported = 0;
+            errno = EOPNOTSUPP;
+        } else if (errno == EINPROGRESS)
+            log_print(PLATFORM_LOG_PRIORITY_DEBUG, "TCP fast open cookie request");
+        return -1;
+    }
+
+    log_print(PLATFORM_LOG_PRIORITY_DEBUG, "TCP fast open SYN data %d/%d", sent, datalen);
+
+    cur->sent += sent;
+    cur->fastopen = 1;
+    get_tfo_destination(cur, 1)->attempts++;
+    return sent;
+}
+
+void check_tcp_fastopen(const struct ng_session *s, int connected) {
+    if (!s->tcp.fastopen)
+        return;
+
+    // Data carried in the SYN is retransmitted by the kernel when not acknowledged
+    int accepted = 0;
+    if (connected) {
+        struct tcp_info info;
+        socklen_t optlen = sizeof(struct tcp_info);
+        if (getsockopt(s->socket, IPPROTO_TCP, TCP_INFO, &info, &optlen) == 0)
+            accepted = ((info.tcpi_options & TCPI_OPT_SYN_DATA) != 0);
+    }
+
+    struct tfo_destination *d = get_tfo_destination(&s->tcp, 1);
+    if (accepted) {
+        d->accepted++;
+        d->failures = 0;
+    } else if (++d->failures >= TFO_FAILURES) {
+        d->failures = 0;
+        d->backoff = time(NULL) + TFO_BACKOFF;
+    }
+
+    log_print(PLATFORM_LOG_PRIORITY_INFO, "TCP fast open to port %u %s attempts %u accepted %u%s",
+              ntohs(s->tcp.dest), accepted ? "accepted" : "rejected",
+              d->attempts, d->accepted, d->backoff > time(NULL) ? " backing off" : "");
+}
+
+void cleanup_tcp_fastopen() {
+    memset(tfo_destinations, 0, sizeof(tfo_destinations));
+    tcp_fastopen_supported = 1;
+}
@@ -1,35 +1,168 @@
-
 #include "netguard.h"
 #include "tls.h"
+#include "quic.h"
+
+static uint8_t tls_ports[65536 / 8];
+static int tls_ports_count = 0; // all ports when none configured
+
+void set_tls_ports(const jint *ports, int count) {
+    memset(tls_ports, 0, sizeof(tls_ports));
+    tls_ports_count = 0;
+    for (int i = 0; i < count; i++)
+        if (ports[i] > 0 && ports[i] < 65536) {
+            tls_ports[ports[i] / 8] |= (uint8_t) (1 << (ports[i] % 8));
+            tls_ports_count++;
+        }
+}
+
+uint8_t get_tls_state(__be16 port) {
+    uint16_t p = ntohs(port);
+    if (tls_ports_count == 0 || (tls_ports[p / 8] & (1 << (p % 8))))
+        return TLS_SNI_PENDING;
+    return TLS_SNI_NONE;
+}
 
-int is_sni_found_and_blocked(
+void clear_tls_hello(struct tcp_session *cur) {
+    if (cur->tls_hello != NULL) {
+        ng_free(cur->tls_hello, __FILE__, __LINE__);
+        cur->tls_hello = NULL;
+    }
+    cur->tls_received = 0;
+}
+
+static uint8_t check_server_name(
     const struct arguments *args,
-    const uint8_t *pkt,
-    size_t length,
-    void *daddr,
-    uint8_t version,
-    const uint8_t *tls,
-    int uid
+    const char *protocol,
+    int version,
+    const void *daddr,
+    jint uid,
+    const uint8_t *name,
+    int length
 ) {
+    // The blocklist is matched in Java, which needs a terminated string
+    char sn[FQDN_LENGTH];
+    memcpy(sn, name, (size_t) length);
+    sn[length] = 0;
+
     char dest[INET6_ADDRSTRLEN + 1];
     inet_ntop(version == 4 ? AF_INET : AF_INET6, daddr, dest, sizeof(dest));
-    char sn[FQDN_LENGTH];
-    memset(sn, 0, FQDN_LENGTH);
-    *sn = 0;
+    log_print(PLATFORM_LOG_PRIORITY_INFO, "%s server %s (%s) found", protocol, sn, dest);
 
-    int error_code = get_server_name(pkt, length, tls, sn);
+    return (uint8_t) (is_domain_blocked(args, sn, uid) ? TLS_SNI_BLOCKED : TLS_SNI_ALLOWED);
+}
+
+static uint8_t check_tls_sni(
+    const struct arguments *args,
+    const struct tcp_session *cur,
+    const uint8_t *hello,
+    size_t length
+) {
+    const uint8_t *name = NULL;
+    int error_code = find_server_name(hello, length, &name);
 
     // TODO do not report errors back for now see https://app.asana.com/0/488551667048375/1205803419871701/f
 //    if (error_code < 0) {
 //        report_tls_parsing_error(args, error_code);
 //    }
-    if (strlen(sn) == 0) {
+    if (error_code <= 0) {
         log_print(PLATFORM_LOG_PRIORITY_INFO, "TLS server name not found");
-        return 0;
+        return TLS_SNI_NONE;
+    }
+
+    return check_server_name(args, "TLS", cur->version, &cur->daddr, cur->uid, name, error_code);
+}
+
+uint8_t inspect_tls_sni(
+    const struct arguments *args,
+    struct tcp_session *cur,
+    uint32_t seq,
+    const uint8_t *data,
+    size_t datalen
+) {
+    // Only contiguous client data from the start of the stream is reassembled
+    uint32_t offset = seq - (cur->remote_start + 1);
+    if (offset != cur->tls_received)
+        return TLS_SNI_PENDING;
+
+    // A client speaking first with anything but a handshake is not TLS
+    if (offset == 0 && *data != TLS_TYPE_HANDSHAKE_RECORD)
+        return TLS_SNI_NONE;
+
+    // Parse a ClientHello contained in a single segment in place
+    const uint8_t *hello = data;
+    size_t length = datalen;
+    if (cur->tls_received > 0 || datalen < TLS_HEADER_LEN ||
+        datalen < TLS_HEADER_LEN + get_tls_u16(data + 3)) {
+        if (cur->tls_hello == NULL)
+            cur->tls_hello = ng_malloc(TLS_HELLO_MAX, "tls hello");
+
+        size_t copy = datalen;
+        if (cur->tls_received + copy > TLS_HELLO_MAX)
+            copy = TLS_HELLO_MAX - cur->tls_received;
+        memcpy(cur->tls_hello + cur->tls_received, data, copy);
+        cur->tls_received += copy;
+
+        // Wait for the complete first record, up to the cap
+        size_t needed = TLS_HELLO_MAX;
+        if (cur->tls_received >= TLS_HEADER_LEN) {
+            needed = TLS_HEADER_LEN + get_tls_u16(cur->tls_hello + 3);
+            if (needed > TLS_HELLO_MAX)
+                needed = TLS_HELLO_MAX;
+        }
+        if (cur->tls_received < needed) {
+            log_print(PLATFORM_LOG_PRIORITY_DEBUG, "TLS ClientHello %u/%u",
+                      cur->tls_received, needed);
+            return TLS_SNI_PENDING;
+        }
+
+        hello = cur->tls_hello;
+        length = cur->tls_received;
     }
 
-    log_print(PLATFORM_LOG_PRIORITY_INFO, "TLS server %s (%s) found", sn, dest);
+    uint8_t state = check_tls_sni(args, cur, hello, length);
+    clear_tls_hello(cur);
+    return state;
+}
 
-    return is_domain_blocked(args, sn, uid);
+void clear_quic_hello(struct udp_session *cur) {
+    if (cur->quic != NULL) {
+        ng_free(cur->quic, __FILE__, __LINE__);
+        cur->quic = NULL;
+    }
 }
 
+uint8_t inspect_quic_sni(
+    const struct arguments *args,
+    struct udp_session *cur,
+    const uint8_t *data,
+    size_t datalen
+) {
+    if (cur->quic == NULL) {
+        cur->quic = ng_malloc(sizeof(struct quic_hello), "quic hello");
+        memset(cur->quic, 0, sizeof(struct quic_hello));
+    }
+
+    // Client Initials come first, anything else ends the inspection
+    if (add_quic_initial(cur->quic, data, datalen) < 0) {
+        log_print(PLATFORM_LOG_PRIORITY_DEBUG, "QUIC no client Initial");
+        clear_quic_hello(cur);
+        return TLS_SNI_NONE;
+    }
+
+    const uint8_t *name = NULL;
+    int error_code = find_quic_server_name(cur->quic, &name);
+    if (error_code == -1) {
+        log_print(PLATFORM_LOG_PRIORITY_DEBUG, "QUIC ClientHello %zu bytes",
+                  cur->quic->contiguous);
+        return TLS_SNI_PENDING;
+    }
+
+    uint8_t state = TLS_SNI_NONE;
+    if (error_code > 0)
+        state = check_server_name(args, "QUIC", cur->version, &cur->daddr, cur->uid,
+                                  name, error_code);
+    else
+        log_print(PLATFORM_LOG_PRIORITY_INFO, "QUIC server name not found");
+    clear_quic_hello(cur);
+    return state;
+}
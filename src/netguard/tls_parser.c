@@ -1,7 +1,7 @@
 
 #include <stdio.h>
 #include <stdint.h>
-#include <string.h> /* strncpy() */
+#include <string.h>
 #include <sys/socket.h>
 #include <sys/types.h>
 #include <netinet/in.h>
@@ -12,11 +12,25 @@
 #include "tls.h"
 #include "util.h"
 
-static int parse_tls_server_name(const uint8_t *data, const size_t data_len, char *server_name);
-static int parse_extensions(const uint8_t*, size_t, char *);
-static int parse_server_name_extension(const uint8_t*, size_t, char *);
+static int parse_tls_server_name(const uint8_t *data, const size_t data_len, const uint8_t **server_name);
+static int parse_extensions(const uint8_t*, size_t, const uint8_t **);
+static int parse_server_name_extension(const uint8_t*, size_t, const uint8_t **);
+static int is_valid_host_name(const uint8_t *name, size_t len);
+static int is_valid_utf8_name(const uint8_t *name, size_t len);
+
+/* Letters, digits, hyphen, underscore and dot, other bytes above 0x7f must form UTF-8 */
+#define HOST_NAME_ASCII 1
+#define HOST_NAME_UTF8 2
+static const uint8_t host_name_chars[256] = {
+        ['-'] = HOST_NAME_ASCII,
+        ['.'] = HOST_NAME_ASCII,
+        ['_'] = HOST_NAME_ASCII,
+        ['0' ... '9'] = HOST_NAME_ASCII,
+        ['A' ... 'Z'] = HOST_NAME_ASCII,
+        ['a' ... 'z'] = HOST_NAME_ASCII,
+        [0x80 ... 0xff] = HOST_NAME_UTF8
+};
 
-#define TLS_HEADER_LEN 5 // size of the TLS Record Header
 #ifndef MIN
 #define MIN(X, Y) ((X) < (Y) ? (X) : (Y))
 #endif
@@ -28,7 +42,7 @@ static int parse_server_name_extension(const uint8_t*, size_t, char *);
  *
  * @param data the TLS packet
  * @param data_len the TLS packet length
- * @param server_name pointer to the server name static array. This method does not allocate memory for it
+ * @param server_name set to the server name inside data, which is not NUL terminated
  *
  * @returns
  *  >=0 length of the server name found
@@ -37,8 +51,8 @@ static int parse_server_name_extension(const uint8_t*, size_t, char *);
  *  -3  invalid TLS client hello
  *  -4  invalid TLs packet
  */
-static int parse_tls_server_name(const uint8_t *data, const size_t data_len, char *server_name) {
-    *server_name = 0;
+static int parse_tls_server_name(const uint8_t *data, const size_t data_len, const uint8_t **server_name) {
+    *server_name = NULL;
 
     if (data_len < TLS_HEADER_LEN) {
         return -1;
@@ -70,7 +84,7 @@ static int parse_tls_server_name(const uint8_t *data, const size_t data_len, cha
     }
 
     /* TLS record length */
-    size_t len = ntohs(*((uint16_t *) (data + 3))) + TLS_HEADER_LEN;
+    size_t len = get_tls_u16(data + 3) + TLS_HEADER_LEN;
 //    data_len = MIN(len, data_len);
     if (data_len < len) {
         // purposely don't return as we have checks later on
@@ -79,9 +93,9 @@ static int parse_tls_server_name(const uint8_t *data, const size_t data_len, cha
 
     /* handshake */
     size_t pos = TLS_HEADER_LEN;
-//    if (pos + 1 > data_len) {
-//        return -5;
-//    }
+    if (pos + 1 > data_len) {
+        return -5;
+    }
 
     if (data[pos] != 0x1) {
         // not a client hello
@@ -98,17 +112,17 @@ static int parse_tls_server_name(const uint8_t *data, const size_t data_len, cha
     pos += 38;
 
     // Session ID
-//    if (pos + 1 > data_len) return -7;
+    if (pos + 1 > data_len) return -7;
     len = (size_t)data[pos];
     pos += 1 + len;
 
     /* Cipher Suites */
-//    if (pos + 2 > data_len) return -8;
-    len = ntohs(*((uint16_t *) (data + pos)));
+    if (pos + 2 > data_len) return -8;
+    len = get_tls_u16(data + pos);
     pos += 2 + len;
 
     /* Compression Methods */
-//    if (pos + 1 > data_len) return -9;
+    if (pos + 1 > data_len) return -9;
     len = (size_t)data[pos];
     pos += 1 + len;
 
@@ -118,33 +132,34 @@ static int parse_tls_server_name(const uint8_t *data, const size_t data_len, cha
     }
 
     /* Extensions */
-//    if (pos + 2 > data_len) {
-//        return -11;
-//    }
-    len = ntohs(*((uint16_t *) (data + pos)));
+    if (pos + 2 > data_len) {
+        return -11;
+    }
+    len = get_tls_u16(data + pos);
     pos += 2;
 
-//    if (pos + len > data_len) {
-//        return -12;
-//    }
+    /* A ClientHello continued in a next record is parsed as far as available */
+    if (pos + len > data_len) {
+        len = data_len - pos;
+    }
     return parse_extensions(data + pos, len, server_name);
 }
 
-static int parse_extensions(const uint8_t *data, size_t data_len, char *hostname) {
+static int parse_extensions(const uint8_t *data, size_t data_len, const uint8_t **hostname) {
     size_t pos = 0;
     size_t len;
 
     /* Parse each 4 bytes for the extension header */
     while (pos + 4 <= data_len) {
         /* Extension Length */
-        len = ntohs(*((uint16_t *) (data + pos + 2)));
+        len = get_tls_u16(data + pos + 2);
 
         /* Check if it's a server name extension */
         if (data[pos] == 0x00 && data[pos + 1] == 0x00) {
             /* There can be only one extension of each type, so we break
                our state and move p to beinnging of the extension here */
-//            if (pos + 4 + len > data_len)
-//                return -20;
+            if (pos + 4 + len > data_len)
+                len = data_len - pos - 4; /* truncated, parse what is available */
             return parse_server_name_extension(data + pos + 4, len, hostname);
         }
         pos += 4 + len; /* Advance to the next extension header */
@@ -156,33 +171,28 @@ static int parse_extensions(const uint8_t *data, size_t data_len, char *hostname
     return -22;
 }
 
-static int parse_server_name_extension(const uint8_t *data, size_t data_len, char *hostname) {
+static int parse_server_name_extension(const uint8_t *data, size_t data_len, const uint8_t **hostname) {
     size_t pos = 2; /* skip server name list length */
     size_t len;
 
     while (pos + 3 < data_len) {
-        len = ntohs(*((uint16_t *) (data + pos + 1)));
-
-//        if (pos + 3 + len > data_len) {
-//            return -30;
-//        }
+        len = get_tls_u16(data + pos + 1);
 
         switch (data[pos]) { /* name type */
             case 0x00: /* host_name */
-                if (len > FQDN_LENGTH) {
+                if (len >= FQDN_LENGTH) {
                     log_print(PLATFORM_LOG_PRIORITY_WARN, "TLS SNI too long %d", len);
-                    *hostname = 0;
                     return -33;
                 }
-                strncpy(hostname, (const char *)(data + pos + 3), len);
-                (hostname)[len] = '\0';
-                if (is_valid_utf8(hostname)) {
-                    return len;
-                } else {
-                    log_print(PLATFORM_LOG_PRIORITY_WARN, "invalid UTF-8");
-                    *hostname = 0;
+                if (pos + 3 + len > data_len) {
+                    return -30;
+                }
+                if (!is_valid_host_name(data + pos + 3, len)) {
+                    log_print(PLATFORM_LOG_PRIORITY_WARN, "TLS SNI invalid host name");
                     return -34;
                 }
+                *hostname = data + pos + 3;
+                return len;
             default:
                 log_print(PLATFORM_LOG_PRIORITY_DEBUG, "Unknown server name extension name type: %d", data[pos]);
         }
@@ -196,19 +206,70 @@ static int parse_server_name_extension(const uint8_t *data, size_t data_len, cha
     return -32;
 }
 
+static int is_valid_host_name(const uint8_t *name, size_t len) {
+    uint8_t seen = 0;
+    for (size_t i = 0; i < len; i++) {
+        uint8_t c = host_name_chars[name[i]];
+        if (c == 0)
+            return 0;
+        seen |= c;
+    }
+    return (seen & HOST_NAME_UTF8 ? is_valid_utf8_name(name, len) : 1);
+}
+
+static int is_valid_utf8_name(const uint8_t *name, size_t len) {
+    size_t i = 0;
+    while (i < len) {
+        size_t more;
+        if (name[i] < 0x80)
+            more = 0;
+        else if ((name[i] & 0xE0) == 0xC0)
+            more = 1;
+        else if ((name[i] & 0xF0) == 0xE0)
+            more = 2;
+        else if ((name[i] & 0xF8) == 0xF0)
+            more = 3;
+        else
+            return 0;
+
+        if (more > len - i - 1)
+            return 0;
+        for (size_t j = 1; j <= more; j++)
+            if ((name[i + j] & 0xC0) != 0x80)
+                return 0;
+        i += 1 + more;
+    }
+    return 1;
+}
+
+int find_server_name(
+        const uint8_t *data,
+        size_t data_len,
+        const uint8_t **server_name
+) {
+    int error_code = parse_tls_server_name(data, data_len, server_name);
+    if (error_code >= 0) {
+        log_print(PLATFORM_LOG_PRIORITY_DEBUG, "Found server name %.*s", error_code, *server_name);
+    } else {
+        log_print(PLATFORM_LOG_PRIORITY_DEBUG, "TLS parsing error code %d", error_code);
+    }
+
+    return error_code;
+}
+
 int get_server_name(
         const uint8_t *pkt,
         size_t length,
         const uint8_t *tls,
         char *server_name
 ) {
-    size_t data_len = length - (tls - pkt);
-    int error_code = parse_tls_server_name(tls, data_len, server_name);
+    const uint8_t *name = NULL;
+    int error_code = find_server_name(tls, length - (tls - pkt), &name);
+    *server_name = 0;
     if (error_code >= 0) {
-        log_print(PLATFORM_LOG_PRIORITY_DEBUG, "Found server name %s", server_name);
-    } else {
-        log_print(PLATFORM_LOG_PRIORITY_DEBUG, "TLS parsing error code %d", error_code);
+        memcpy(server_name, name, (size_t) error_code);
+        server_name[error_code] = 0;
     }
 
     return error_code;
-}
\ No newline at end of file
+}
@@ -30,12 +30,87 @@
 #define UDP_TIMEOUT_ANY 300 // seconds
 #define UDP_KEEP_TIMEOUT 60 // seconds
 
+#define UDP_YIELD 10 // batches
+#define UDP_RECV_BATCH 8 // datagrams per recvmmsg
+#define UDP_SEND_BATCH 32 // datagrams per sendmmsg
+#define UDP_FLUSH_MAX 32 // sessions with queued datagrams
+
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103
+#endif
+#ifndef UDP_GRO
+#define UDP_GRO 104
+#endif
+#define UDP_GSO_CMSG CMSG_SPACE(sizeof(uint16_t))
+#define UDP_GRO_CMSG CMSG_SPACE(sizeof(int))
+
+struct udp_datagram {
+    size_t len;
+    struct udp_datagram *next;
+    uint8_t data[]; // allocated with the node
+};
+
+int udp_gso = 0;
+
+static int udp_gso_supported = -1; // unknown
+static int udp_gro_supported = 1;
+
+static uint8_t *udp_buffers[UDP_RECV_BATCH];
+static struct ng_session *udp_flush[UDP_FLUSH_MAX];
+static int udp_flush_count = 0;
 
 static int open_udp_socket(const struct arguments *args,
                     const struct udp_session *cur, const struct allowed *redirect);
 
+static int open_udp_session_socket(const struct arguments *args, struct ng_session *s,
+                                   const struct allowed *redirect, const int epoll_fd);
+
+static int connect_udp_socket(struct ng_session *s, const struct allowed *redirect);
+
+static void queue_udp(const struct arguments *args, struct ng_session *s,
+                      const uint8_t *data, size_t datalen);
+
+static void flush_udp_session(const struct arguments *args, struct ng_session *s);
+
+static void write_udp_unreachable(const struct arguments *args, const struct udp_session *cur, int err);
+
+static void enable_udp_offload(struct ng_session *s);
+
 ///////////////////////////////////////////////////////////////////////////////
 
+void clear_udp_data(struct udp_session *cur) {
+    clear_dns_query(cur);
+    release_dns_pool(cur);
+    release_udp_mux(cur);
+    release_socks5_udp(cur);
+    clear_quic_hello(cur);
+
+    struct udp_datagram *d = cur->queue;
+    while (d != NULL) {
+        struct udp_datagram *p = d;
+        d = d->next;
+        ng_free(p, __FILE__, __LINE__);
+    }
+    cur->queue = NULL;
+    cur->queue_tail = NULL;
+    cur->queued = 0;
+
+    for (int i = 0; i < udp_flush_count; i++)
+        if (&udp_flush[i]->udp == cur) {
+            udp_flush[i] = udp_flush[--udp_flush_count];
+            break;
+        }
+}
+
+void cleanup_udp_buffers() {
+    for (int i = 0; i < UDP_RECV_BATCH; i++)
+        if (udp_buffers[i] != NULL) {
+            ng_free(udp_buffers[i], __FILE__, __LINE__);
+            udp_buffers[i] = NULL;
+        }
+    udp_flush_count = 0;
+}
+
 int get_udp_timeout(const struct udp_session *u, int sessions, int maxsessions) {
     int timeout = (ntohs(u->dest) == 53 ? UDP_TIMEOUT_53 : UDP_TIMEOUT_ANY);
 
@@ -73,18 +148,24 @@ int check_udp_session(const struct arguments *args, struct ng_session *s,
         log_print(PLATFORM_LOG_PRIORITY_INFO, "UDP close from %s/%u to %s/%u socket %d",
                     source, ntohs(s->udp.source), dest, ntohs(s->udp.dest), s->socket);
 
-        if (close(s->socket))
+        if (s->socket >= 0 && close(s->socket))
             log_print(PLATFORM_LOG_PRIORITY_ERROR, "UDP close %d error %d: %s",
                         s->socket, errno, strerror(errno));
         s->socket = -1;
 
         s->udp.time = time(NULL);
         s->udp.state = UDP_CLOSED;
+
+        // Waiting queries will be retried
+        clear_udp_data(&s->udp);
     }
 
     if (s->udp.state == UDP_CLOSED && (s->udp.sent || s->udp.received)) {
+        struct dns_names names;
+        int named = dns_names_get(s->udp.version, &s->udp.daddr, &names);
         account_usage(args, s->udp.version, IPPROTO_UDP,
-                      dest, ntohs(s->udp.dest), s->udp.uid, s->udp.sent, s->udp.received);
+                      dest, ntohs(s->udp.dest), s->udp.uid, s->udp.sent, s->udp.received,
+                      named ? names.qname : NULL);
         s->udp.sent = 0;
         s->udp.received = 0;
     }
@@ -113,56 +194,110 @@ void check_udp_socket(const struct arguments *args, const struct epoll_event *ev
         else if (serr)
             log_print(PLATFORM_LOG_PRIORITY_ERROR, "UDP SO_ERROR %d: %s", serr, strerror(serr));
 
+        if (err >= 0 && serr)
+            write_udp_unreachable(args, &s->udp, serr);
         s->udp.state = UDP_FINISHING;
     } else {
         // Check socket read
         if (ev->events & EPOLLIN) {
             s->udp.time = time(NULL);
 
-            uint8_t *buffer = ng_malloc(s->udp.mss, "udp recv");
-            ssize_t bytes = recv(s->socket, buffer, s->udp.mss, 0);
-            if (bytes < 0) {
-                // Socket error
-                log_print(PLATFORM_LOG_PRIORITY_WARN, "UDP recv error %d: %s",
-                            errno, strerror(errno));
-
-                if (errno != EINTR && errno != EAGAIN)
-                    s->udp.state = UDP_FINISHING;
-            } else if (bytes == 0) {
-                log_print(PLATFORM_LOG_PRIORITY_WARN, "UDP recv eof");
-                s->udp.state = UDP_FINISHING;
+            // Pooled receive buffers
+            struct mmsghdr msgs[UDP_RECV_BATCH];
+            struct iovec iov[UDP_RECV_BATCH];
+            uint8_t control[UDP_RECV_BATCH][UDP_GRO_CMSG];
+            for (int i = 0; i < UDP_RECV_BATCH; i++) {
+                if (udp_buffers[i] == NULL)
+                    udp_buffers[i] = ng_malloc(UDP4_MAXMSG, "udp recv");
+                iov[i].iov_base = udp_buffers[i];
+                iov[i].iov_len = s->udp.mss;
+            }
 
-            } else {
-                // Socket read data
-                char dest[INET6_ADDRSTRLEN + 1];
-                if (s->udp.version == 4)
-                    inet_ntop(AF_INET, &s->udp.daddr.ip4, dest, sizeof(dest));
-                else
-                    inet_ntop(AF_INET6, &s->udp.daddr.ip6, dest, sizeof(dest));
-                log_print(PLATFORM_LOG_PRIORITY_INFO, "UDP recv bytes %d from %s/%u for tun",
-                            bytes, dest, ntohs(s->udp.dest));
-
-                s->udp.received += bytes;
-
-                // Process DNS response
-                int block_dns = 0;
-                if (ntohs(s->udp.dest) == 53)
-                    block_dns = parse_dns_response(args, s, buffer, (size_t *) &bytes);
-
-                // Forward to tun
-                if (block_dns == 0 && write_udp(args, &s->udp, buffer, (size_t) bytes) < 0)
-                    s->udp.state = UDP_FINISHING;
-                else {
-                    // Prevent too many open files
-                    if (ntohs(s->udp.dest) == 53)
+            int count = 0;
+            while (count < UDP_YIELD && s->udp.state == UDP_ACTIVE && !args->ctx->stopping) {
+                count++;
+
+                memset(msgs, 0, sizeof(msgs));
+                for (int i = 0; i < UDP_RECV_BATCH; i++) {
+                    msgs[i].msg_hdr.msg_iov = &iov[i];
+                    msgs[i].msg_hdr.msg_iovlen = 1;
+                    if (s->udp.gro) {
+                        msgs[i].msg_hdr.msg_control = control[i];
+                        msgs[i].msg_hdr.msg_controllen = UDP_GRO_CMSG;
+                    }
+                }
+
+                int n = recvmmsg(s->socket, msgs, UDP_RECV_BATCH, MSG_DONTWAIT, NULL);
+                if (n < 0) {
+                    int rerr = errno;
+                    if (rerr != EINTR && rerr != EAGAIN && rerr != EWOULDBLOCK) {
+                        // Socket error
+                        log_print(PLATFORM_LOG_PRIORITY_WARN, "UDP recvmmsg error %d: %s",
+                                    rerr, strerror(rerr));
+                        write_udp_unreachable(args, &s->udp, rerr);
                         s->udp.state = UDP_FINISHING;
+                    }
+                    break;
+                }
+
+                for (int i = 0; i < n && s->udp.state == UDP_ACTIVE; i++) {
+                    // Split coalesced datagrams at the tun boundary
+                    size_t segment = msgs[i].msg_len;
+                    if (s->udp.gro) {
+                        struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msgs[i].msg_hdr);
+                        for (; cmsg != NULL; cmsg = CMSG_NXTHDR(&msgs[i].msg_hdr, cmsg))
+                            if (cmsg->cmsg_level == SOL_UDP && cmsg->cmsg_type == UDP_GRO) {
+                                int gso_size = *((int *) CMSG_DATA(cmsg));
+                                if (gso_size > 0)
+                                    segment = (size_t) gso_size;
+                            }
+                    }
+
+                    for (size_t off = 0;
+                         off < msgs[i].msg_len && s->udp.state == UDP_ACTIVE; off += segment) {
+                        size_t len = msgs[i].msg_len - off;
+                        forward_udp_data(args, s, udp_buffers[i] + off, len < segment ? len : segment);
+                    }
                 }
+
+                if (n < UDP_RECV_BATCH)
+                    break;
             }
-            ng_free(buffer, __FILE__, __LINE__);
         }
     }
 }
 
+void forward_udp_data(const struct arguments *args, struct ng_session *s,
+                      uint8_t *buffer, size_t bytes) {
+    char dest[INET6_ADDRSTRLEN + 1];
+    if (s->udp.version == 4)
+        inet_ntop(AF_INET, &s->udp.daddr.ip4, dest, sizeof(dest));
+    else
+        inet_ntop(AF_INET6, &s->udp.daddr.ip6, dest, sizeof(dest));
+    log_print(PLATFORM_LOG_PRIORITY_INFO, "UDP recv bytes %d from %s/%u for tun",
+                bytes, dest, ntohs(s->udp.dest));
+
+    s->udp.received += bytes;
+
+    // Process DNS response
+    int block_dns = 0;
+    if (ntohs(s->udp.dest) == 53)
+        block_dns = parse_dns_response(args, s, buffer, &bytes);
+
+    // Forward to tun
+    if (block_dns == 0 && write_udp(args, &s->udp, buffer, bytes) < 0)
+        s->udp.state = UDP_FINISHING;
+    else {
+        // Answer coalesced queries
+        if (block_dns == 0 && ntohs(s->udp.dest) == 53)
+            answer_dns_waiters(args, &s->udp, buffer, bytes);
+
+        // Prevent too many open files
+        if (ntohs(s->udp.dest) == 53)
+            s->udp.state = UDP_FINISHING;
+    }
+}
+
 int has_udp_session(const struct arguments *args, const uint8_t *pkt, const uint8_t *payload) {
     // Get headers
     const uint8_t version = (*pkt) >> 4;
@@ -230,6 +365,17 @@ void block_udp(const struct arguments *args,
     s->udp.source = udphdr->source;
     s->udp.dest = udphdr->dest;
     s->udp.state = UDP_BLOCKED;
+    s->udp.query_ms = 0;
+    s->udp.dns = NULL;
+    s->udp.mux = NULL;
+    s->udp.socks5 = NULL;
+    s->udp.connected = 0;
+    s->udp.gro = 0;
+    s->udp.tls = TLS_SNI_NONE;
+    s->udp.quic = NULL;
+    s->udp.queue = NULL;
+    s->udp.queue_tail = NULL;
+    s->udp.queued = 0;
     s->socket = -1;
 
     s->next = args->ctx->ng_session;
@@ -277,6 +423,66 @@ jboolean handle_udp(const struct arguments *args,
         return 0;
     }
 
+    // Existing DNS sessions keep the resolver of their first query
+    struct dns_upstream upstream;
+    int tracked = (cur != NULL && get_tracked_dns_upstream(&cur->udp, &upstream));
+    if (!tracked && ntohs(udphdr->dest) == 53)
+        get_dns_upstream(version, version == 4 ? (const void *) &ip4->daddr : &ip6->ip6_dst,
+                         udphdr->dest, redirect, &upstream);
+
+    // Answer blocked and cached DNS queries locally, without opening an upstream socket
+    struct dns_verdict verdict;
+    verdict.allowed = 0;
+    if (ntohs(udphdr->dest) == 53 && datalen > 0) {
+        struct ng_session dns;
+        const struct ng_session *q = cur;
+        if (q == NULL) {
+            memset(&dns, 0, sizeof(struct ng_session));
+            dns.protocol = IPPROTO_UDP;
+            dns.udp.uid = uid;
+            dns.udp.version = version;
+            if (version == 4) {
+                dns.udp.saddr.ip4 = (__be32) ip4->saddr;
+                dns.udp.daddr.ip4 = (__be32) ip4->daddr;
+            } else {
+                memcpy(&dns.udp.saddr.ip6, &ip6->ip6_src, 16);
+                memcpy(&dns.udp.daddr.ip6, &ip6->ip6_dst, 16);
+            }
+            dns.udp.source = udphdr->source;
+            dns.udp.dest = udphdr->dest;
+            dns.udp.state = UDP_ACTIVE;
+            dns.socket = -1;
+            q = &dns;
+        }
+
+        // The answer echoes the header and question only, so never exceeds the query
+        uint8_t *response = ng_malloc(datalen, "dns block");
+        size_t rlen = block_dns_query(args, q, data, datalen, response, &verdict);
+        if (rlen > 0) {
+            log_print(PLATFORM_LOG_PRIORITY_INFO, "UDP DNS answered locally from %s/%u to %s/%u",
+                        source, ntohs(udphdr->source), dest, ntohs(udphdr->dest));
+            write_udp(args, &q->udp, response, rlen);
+        }
+        ng_free(response, __FILE__, __LINE__);
+        if (rlen > 0)
+            return 1;
+
+        uint8_t *cached = NULL;
+        rlen = (cur == NULL || tracked
+                ? get_cached_dns_response(args, &upstream, data, datalen, &cached) : 0);
+        if (rlen > 0) {
+            log_print(PLATFORM_LOG_PRIORITY_INFO, "UDP DNS answered from cache from %s/%u to %s/%u",
+                        source, ntohs(udphdr->source), dest, ntohs(udphdr->dest));
+            write_udp(args, &q->udp, cached, rlen);
+            ng_free(cached, __FILE__, __LINE__);
+            return 1;
+        }
+
+        // Share an identical outstanding upstream query
+        if (cur == NULL && coalesce_dns_query(args, &q->udp, &upstream, data, datalen))
+            return 1;
+    }
+
     // Create new session if needed
     if (cur == NULL) {
         log_print(PLATFORM_LOG_PRIORITY_INFO, "UDP new session from %s/%u to %s/%u",
@@ -311,28 +517,68 @@ jboolean handle_udp(const struct arguments *args,
         s->udp.source = udphdr->source;
         s->udp.dest = udphdr->dest;
         s->udp.state = UDP_ACTIVE;
+        s->udp.query_ms = 0;
+        s->udp.dns = NULL;
+        s->udp.mux = NULL;
+        s->udp.socks5 = NULL;
+        s->udp.connected = 0;
+        s->udp.gro = 0;
+        s->udp.tls = TLS_SNI_NONE;
+        s->udp.quic = NULL;
+        s->udp.queue = NULL;
+        s->udp.queue_tail = NULL;
+        s->udp.queued = 0;
         s->next = NULL;
 
-        // Open UDP socket
-        s->socket = open_udp_socket(args, &s->udp, redirect);
-        if (s->socket < 0) {
+        // Block QUIC by server name on the first client Initial, before opening a socket
+        if (datalen >= QUIC_INITIAL_MIN && get_tls_state(s->udp.dest) == TLS_SNI_PENDING)
+            s->udp.tls = inspect_quic_sni(args, &s->udp, data, datalen);
+        if (s->udp.tls == TLS_SNI_BLOCKED) {
+            log_print(PLATFORM_LOG_PRIORITY_INFO, "UDP QUIC blocked from %s/%u to %s/%u",
+                        source, ntohs(udphdr->source), dest, ntohs(udphdr->dest));
+            s->udp.state = UDP_BLOCKED;
+            s->socket = -1;
+            s->next = args->ctx->ng_session;
+            args->ctx->ng_session = s;
+            return 1;
+        }
+
+        // With the SOCKS5 relay enabled, a flow it cannot take is refused rather than sent direct
+        s->socket = -1;
+        int relayed = (redirect == NULL ? open_socks5_udp(args, s, epoll_fd) : 0);
+        if (relayed < 0) {
+            log_print(PLATFORM_LOG_PRIORITY_WARN, "UDP SOCKS5 relay unavailable from %s/%u to %s/%u",
+                        source, ntohs(udphdr->source), dest, ntohs(udphdr->dest));
+            write_udp_unreachable(args, &s->udp, ENETUNREACH);
+            clear_quic_hello(&s->udp);
             ng_free(s, __FILE__, __LINE__);
             return 0;
         }
 
-        log_print(PLATFORM_LOG_PRIORITY_DEBUG, "UDP socket %d", s->socket);
-
-        // Monitor events
-        memset(&s->ev, 0, sizeof(struct epoll_event));
-        s->ev.events = EPOLLIN | EPOLLERR;
-        s->ev.data.ptr = s;
-        if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, s->socket, &s->ev))
-            log_print(PLATFORM_LOG_PRIORITY_ERROR, "epoll add udp error %d: %s", errno, strerror(errno));
+        // DNS queries and, optionally, other flows are sent through shared sockets
+        if (!relayed &&
+            ntohs(s->udp.dest) != 53 &&
+            !(redirect == NULL && open_udp_mux(args, s, epoll_fd)) &&
+            open_udp_session_socket(args, s, redirect, epoll_fd) < 0) {
+            clear_quic_hello(&s->udp);
+            ng_free(s, __FILE__, __LINE__);
+            return 0;
+        }
 
         s->next = args->ctx->ng_session;
         args->ctx->ng_session = s;
 
         cur = s;
+
+    } else if (cur->udp.tls == TLS_SNI_PENDING) {
+        // The rest of a ClientHello spanning datagrams, the upstream never gets all of it
+        cur->udp.tls = inspect_quic_sni(args, &cur->udp, data, datalen);
+        if (cur->udp.tls == TLS_SNI_BLOCKED) {
+            log_print(PLATFORM_LOG_PRIORITY_INFO, "UDP QUIC blocked from %s/%u to %s/%u",
+                        source, ntohs(udphdr->source), dest, ntohs(udphdr->dest));
+            cur->udp.state = UDP_FINISHING;
+            return 1;
+        }
     }
 
     // Check for DHCP (tethering)
@@ -346,6 +592,64 @@ jboolean handle_udp(const struct arguments *args,
 
     cur->udp.time = time(NULL);
 
+    if (cur->udp.socks5 != NULL) {
+        if (send_socks5_udp(&cur->udp, data, datalen) != datalen) {
+            log_print(PLATFORM_LOG_PRIORITY_ERROR, "UDP SOCKS5 relay send error %d: %s",
+                        errno, strerror(errno));
+            if (errno != EINTR && errno != EAGAIN) {
+                cur->udp.state = UDP_FINISHING;
+                return 0;
+            }
+        } else {
+            cur->udp.sent += datalen;
+            if (ntohs(cur->udp.dest) == 53) {
+                cur->udp.query_ms = get_ms();
+                track_dns_query(&cur->udp, data, datalen, &upstream, &verdict);
+            }
+        }
+        return 1;
+    }
+
+    if (cur->socket < 0 && ntohs(cur->udp.dest) == 53) {
+        track_dns_query(&cur->udp, data, datalen, &upstream, &verdict);
+        if (send_dns_pool(args, cur, data, datalen, &upstream, epoll_fd)) {
+            cur->udp.sent += datalen;
+            cur->udp.query_ms = get_ms();
+            return 1;
+        }
+
+        // Fall back to a socket of its own
+        if (open_udp_session_socket(args, cur, redirect, epoll_fd) < 0) {
+            cur->udp.state = UDP_FINISHING;
+            return 0;
+        }
+    }
+
+    if (cur->udp.mux != NULL) {
+        if (send_udp_mux(&cur->udp, data, datalen) != datalen) {
+            int serr = errno;
+            log_print(PLATFORM_LOG_PRIORITY_ERROR, "UDP mux sendto error %d: %s",
+                        serr, strerror(serr));
+            if (serr != EINTR && serr != EAGAIN) {
+                write_udp_unreachable(args, &cur->udp, serr);
+                cur->udp.state = UDP_FINISHING;
+                return 0;
+            }
+        } else
+            cur->udp.sent += datalen;
+        return 1;
+    }
+
+    // Connected sockets are flushed with sendmmsg after the tun batch
+    if (cur->udp.connected) {
+        queue_udp(args, cur, data, datalen);
+        if (ntohs(cur->udp.dest) == 53) {
+            cur->udp.query_ms = get_ms();
+            track_dns_query(&cur->udp, data, datalen, &upstream, &verdict);
+        }
+        return 1;
+    }
+
     int rversion;
     struct sockaddr_in addr4;
     struct sockaddr_in6 addr6;
@@ -380,17 +684,247 @@ jboolean handle_udp(const struct arguments *args,
                (rversion == 4 ? (const struct sockaddr *) &addr4
                               : (const struct sockaddr *) &addr6),
                (socklen_t) (rversion == 4 ? sizeof(addr4) : sizeof(addr6))) != datalen) {
-        log_print(PLATFORM_LOG_PRIORITY_ERROR, "UDP sendto error %d: %s", errno, strerror(errno));
-        if (errno != EINTR && errno != EAGAIN) {
+        int serr = errno;
+        log_print(PLATFORM_LOG_PRIORITY_ERROR, "UDP sendto error %d: %s", serr, strerror(serr));
+        if (serr != EINTR && serr != EAGAIN) {
+            write_udp_unreachable(args, &cur->udp, serr);
             cur->udp.state = UDP_FINISHING;
             return 0;
         }
-    } else
+    } else {
         cur->udp.sent += datalen;
+        if (ntohs(cur->udp.dest) == 53) {
+            cur->udp.query_ms = get_ms();
+            track_dns_query(&cur->udp, data, datalen, &upstream, &verdict);
+        }
+    }
 
     return 1;
 }
 
+static int open_udp_session_socket(const struct arguments *args, struct ng_session *s,
+                                   const struct allowed *redirect, const int epoll_fd) {
+    // Open UDP socket
+    s->socket = open_udp_socket(args, &s->udp, redirect);
+    if (s->socket < 0)
+        return -1;
+
+    log_print(PLATFORM_LOG_PRIORITY_DEBUG, "UDP socket %d", s->socket);
+
+    s->udp.connected = (connect_udp_socket(s, redirect) == 0);
+    enable_udp_offload(s);
+
+    // Monitor events
+    memset(&s->ev, 0, sizeof(struct epoll_event));
+    s->ev.events = EPOLLIN | EPOLLERR;
+    s->ev.data.ptr = s;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, s->socket, &s->ev))
+        log_print(PLATFORM_LOG_PRIORITY_ERROR, "epoll add udp error %d: %s", errno, strerror(errno));
+
+    return s->socket;
+}
+
+static int connect_udp_socket(struct ng_session *s, const struct allowed *redirect) {
+    // Broadcast and multicast replies come from other addresses
+    if (redirect == NULL && is_broadcast_or_multicast(s->udp.version, &s->udp.daddr))
+        return -1;
+
+    int rversion;
+    struct sockaddr_in addr4;
+    struct sockaddr_in6 addr6;
+    memset(&addr4, 0, sizeof(struct sockaddr_in));
+    memset(&addr6, 0, sizeof(struct sockaddr_in6));
+    if (redirect == NULL) {
+        rversion = s->udp.version;
+        if (rversion == 4) {
+            addr4.sin_family = AF_INET;
+            addr4.sin_addr.s_addr = (__be32) s->udp.daddr.ip4;
+            addr4.sin_port = s->udp.dest;
+        } else {
+            addr6.sin6_family = AF_INET6;
+            memcpy(&addr6.sin6_addr, &s->udp.daddr.ip6, 16);
+            addr6.sin6_port = s->udp.dest;
+        }
+    } else {
+        rversion = (strstr(redirect->raddr, ":") == NULL ? 4 : 6);
+        if (rversion == 4) {
+            addr4.sin_family = AF_INET;
+            inet_pton(AF_INET, redirect->raddr, &addr4.sin_addr);
+            addr4.sin_port = htons(redirect->rport);
+        } else {
+            addr6.sin6_family = AF_INET6;
+            inet_pton(AF_INET6, redirect->raddr, &addr6.sin6_addr);
+            addr6.sin6_port = htons(redirect->rport);
+        }
+    }
+
+    if (connect(s->socket,
+                (rversion == 4 ? (const struct sockaddr *) &addr4
+                               : (const struct sockaddr *) &addr6),
+                (socklen_t) (rversion == 4 ? sizeof(addr4) : sizeof(addr6)))) {
+        log_print(PLATFORM_LOG_PRIORITY_WARN, "UDP connect error %d: %s", errno, strerror(errno));
+        return -1;
+    }
+
+    return 0;
+}
+
+static void queue_udp(const struct arguments *args, struct ng_session *s,
+                      const uint8_t *data, size_t datalen) {
+    struct udp_datagram *d = ng_malloc(sizeof(struct udp_datagram) + datalen, "udp datagram");
+    memcpy(d->data, data, datalen);
+    d->len = datalen;
+    d->next = NULL;
+
+    if (s->udp.queue == NULL)
+        s->udp.queue = d;
+    else
+        s->udp.queue_tail->next = d;
+    s->udp.queue_tail = d;
+    int count = ++s->udp.queued;
+
+    if (count == 1) {
+        if (udp_flush_count == UDP_FLUSH_MAX)
+            flush_udp_session(args, udp_flush[--udp_flush_count]);
+        udp_flush[udp_flush_count++] = s;
+    } else if (count >= UDP_SEND_BATCH) {
+        for (int i = 0; i < udp_flush_count; i++)
+            if (udp_flush[i] == s) {
+                udp_flush[i] = udp_flush[--udp_flush_count];
+                break;
+            }
+        flush_udp_session(args, s);
+    }
+}
+
+static void flush_udp_session(const struct arguments *args, struct ng_session *s) {
+    struct mmsghdr msgs[UDP_SEND_BATCH];
+    struct iovec iov[UDP_SEND_BATCH];
+    int segments[UDP_SEND_BATCH];
+    uint8_t control[UDP_SEND_BATCH][UDP_GSO_CMSG];
+    int gso = (udp_gso && udp_gso_supported > 0 && s->udp.connected);
+
+    while (s->udp.queue != NULL) {
+        // Datagrams of equal size (the last one may be shorter) are sent as one GSO message
+        int n = 0;
+        int m = 0;
+        size_t total = 0;
+        memset(msgs, 0, sizeof(msgs));
+        for (struct udp_datagram *d = s->udp.queue; d != NULL && n < UDP_SEND_BATCH; d = d->next) {
+            iov[n].iov_base = d->data;
+            iov[n].iov_len = d->len;
+
+            struct msghdr *prev = (m > 0 ? &msgs[m - 1].msg_hdr : NULL);
+            if (gso && prev != NULL &&
+                d->len <= prev->msg_iov[0].iov_len &&
+                prev->msg_iov[prev->msg_iovlen - 1].iov_len == prev->msg_iov[0].iov_len &&
+                total + d->len <= s->udp.mss) {
+                prev->msg_iovlen++;
+                segments[m - 1]++;
+                total += d->len;
+            } else {
+                msgs[m].msg_hdr.msg_iov = &iov[n];
+                msgs[m].msg_hdr.msg_iovlen = 1;
+                segments[m] = 1;
+                total = d->len;
+                m++;
+            }
+            n++;
+        }
+
+        for (int i = 0; i < m; i++)
+            if (segments[i] > 1) {
+                msgs[i].msg_hdr.msg_control = control[i];
+                msgs[i].msg_hdr.msg_controllen = UDP_GSO_CMSG;
+                struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msgs[i].msg_hdr);
+                cmsg->cmsg_level = SOL_UDP;
+                cmsg->cmsg_type = UDP_SEGMENT;
+                cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+                *((uint16_t *) CMSG_DATA(cmsg)) = (uint16_t) msgs[i].msg_hdr.msg_iov[0].iov_len;
+            }
+
+        int sent = (s->udp.state == UDP_ACTIVE
+                    ? sendmmsg(s->socket, msgs, (unsigned int) m, MSG_DONTWAIT | MSG_NOSIGNAL)
+                    : 0);
+        if (sent < 0) {
+            int serr = errno;
+            log_print(PLATFORM_LOG_PRIORITY_ERROR, "UDP sendmmsg error %d: %s",
+                        serr, strerror(serr));
+            if (gso && m < n && (serr == EIO || serr == EINVAL || serr == ENOPROTOOPT)) {
+                // Segmentation offload not available on this path, resend one by one
+                log_print(PLATFORM_LOG_PRIORITY_WARN, "UDP GSO disabled");
+                udp_gso_supported = 0;
+                gso = 0;
+                continue;
+            } else if (serr != EINTR && serr != EAGAIN && serr != EWOULDBLOCK) {
+                write_udp_unreachable(args, &s->udp, serr);
+                s->udp.state = UDP_FINISHING;
+            }
+            sent = 0;
+        }
+
+        // The rest of a partially sent batch is retried, the error is reported then;
+        // datagrams which could not be sent at all are dropped, like with sendto
+        int dsent = 0;
+        for (int i = 0; i < sent; i++)
+            dsent += segments[i];
+        int done = (sent > 0 && sent < m ? dsent : n);
+        for (int i = 0; i < done; i++) {
+            struct udp_datagram *d = s->udp.queue;
+            if (i < dsent)
+                s->udp.sent += d->len;
+            s->udp.queue = d->next;
+            s->udp.queued--;
+            ng_free(d, __FILE__, __LINE__);
+        }
+        if (s->udp.queue == NULL)
+            s->udp.queue_tail = NULL;
+
+        log_print(PLATFORM_LOG_PRIORITY_DEBUG, "UDP sendmmsg socket %d sent %d/%d messages %d",
+                    s->socket, dsent, n, m);
+    }
+}
+
+static void write_udp_unreachable(const struct arguments *args, const struct udp_session *cur, int err) {
+    // The client matches the error to its socket by ports
+    uint8_t transport[8];
+    memset(transport, 0, sizeof(transport));
+    memcpy(transport, &cur->source, 2);
+    memcpy(transport + 2, &cur->dest, 2);
+    transport[5] = 8; // length
+    write_icmp_unreachable(args, cur->version, IPPROTO_UDP, &cur->saddr, &cur->daddr, transport, err);
+}
+
+static void enable_udp_offload(struct ng_session *s) {
+    if (!udp_gso || !s->udp.connected)
+        return;
+
+    // Segmentation offload needs Linux 4.18
+    if (udp_gso_supported < 0) {
+        int size = 0;
+        socklen_t optlen = sizeof(int);
+        udp_gso_supported = (getsockopt(s->socket, SOL_UDP, UDP_SEGMENT, &size, &optlen) == 0);
+        log_print(PLATFORM_LOG_PRIORITY_WARN, "UDP GSO supported %d", udp_gso_supported);
+    }
+
+    // Receive offload needs Linux 5.0
+    if (udp_gro_supported) {
+        int on = 1;
+        if (setsockopt(s->socket, SOL_UDP, UDP_GRO, &on, sizeof(on)) == 0)
+            s->udp.gro = 1;
+        else {
+            log_print(PLATFORM_LOG_PRIORITY_WARN, "UDP setsockopt UDP_GRO error %d: %s",
+                        errno, strerror(errno));
+            udp_gro_supported = 0;
+        }
+    }
+}
+
+void flush_udp(const struct arguments *args) {
+    while (udp_flush_count > 0)
+        flush_udp_session(args, udp_flush[--udp_flush_count]);
+}
+
 static int open_udp_socket(const struct arguments *args,
                     const struct udp_session *cur, const struct allowed *redirect) {
     int sock;
@@ -400,52 +934,41 @@ static int open_udp_socket(const struct arguments *args,
     else
         version = (strstr(redirect->raddr, ":") == NULL ? 4 : 6);
 
-    // Get UDP socket
-    sock = socket(version == 4 ? PF_INET : PF_INET6, SOCK_DGRAM, IPPROTO_UDP);
-    if (sock < 0) {
-        log_print(PLATFORM_LOG_PRIORITY_ERROR, "UDP socket error %d: %s", errno, strerror(errno));
-        return -1;
-    }
-
-    // Protect socket
-    if (protect_socket(args, sock) < 0)
+    // Get protected, non blocking UDP socket
+    sock = get_pool_socket(args, SOCK_DGRAM, version);
+    if (sock < 0)
         return -1;
 
     // Check for broadcast/multicast
-    if (cur->version == 4) {
-        uint32_t broadcast4 = INADDR_BROADCAST;
-        if (memcmp(&cur->daddr.ip4, &broadcast4, sizeof(broadcast4)) == 0) {
-            log_print(PLATFORM_LOG_PRIORITY_WARN, "UDP4 broadcast");
-            int on = 1;
-            if (setsockopt(sock, SOL_SOCKET, SO_BROADCAST, &on, sizeof(on)))
-                log_print(PLATFORM_LOG_PRIORITY_ERROR, "UDP setsockopt SO_BROADCAST error %d: %s",
-                            errno, strerror(errno));
-        }
-    } else {
+    if (cur->version == 4 && is_broadcast_or_multicast(4, &cur->daddr)) {
+        log_print(PLATFORM_LOG_PRIORITY_WARN, "UDP4 broadcast");
+        int on = 1;
+        if (setsockopt(sock, SOL_SOCKET, SO_BROADCAST, &on, sizeof(on)))
+            log_print(PLATFORM_LOG_PRIORITY_ERROR, "UDP setsockopt SO_BROADCAST error %d: %s",
+                        errno, strerror(errno));
+    } else if (cur->version == 6 && is_broadcast_or_multicast(6, &cur->daddr)) {
         // http://man7.org/linux/man-pages/man7/ipv6.7.html
-        if (*((uint8_t *) &cur->daddr.ip6) == 0xFF) {
-            log_print(PLATFORM_LOG_PRIORITY_WARN, "UDP6 broadcast");
-
-            int loop = 1; // true
-            if (setsockopt(sock, IPPROTO_IPV6, IPV6_MULTICAST_LOOP, &loop, sizeof(loop)))
-                log_print(PLATFORM_LOG_PRIORITY_ERROR,
-                            "UDP setsockopt IPV6_MULTICAST_LOOP error %d: %s",
-                            errno, strerror(errno));
-
-            int ttl = -1; // route default
-            if (setsockopt(sock, IPPROTO_IPV6, IPV6_MULTICAST_HOPS, &ttl, sizeof(ttl)))
-                log_print(PLATFORM_LOG_PRIORITY_ERROR,
-                            "UDP setsockopt IPV6_MULTICAST_HOPS error %d: %s",
-                            errno, strerror(errno));
-
-            struct ipv6_mreq mreq6;
-            memcpy(&mreq6.ipv6mr_multiaddr, &cur->daddr.ip6, sizeof(struct in6_addr));
-            mreq6.ipv6mr_interface = INADDR_ANY;
-            if (setsockopt(sock, IPPROTO_IPV6, IPV6_ADD_MEMBERSHIP, &mreq6, sizeof(mreq6)))
-                log_print(PLATFORM_LOG_PRIORITY_ERROR,
-                            "UDP setsockopt IPV6_ADD_MEMBERSHIP error %d: %s",
-                            errno, strerror(errno));
-        }
+        log_print(PLATFORM_LOG_PRIORITY_WARN, "UDP6 broadcast");
+
+        int loop = 1; // true
+        if (setsockopt(sock, IPPROTO_IPV6, IPV6_MULTICAST_LOOP, &loop, sizeof(loop)))
+            log_print(PLATFORM_LOG_PRIORITY_ERROR,
+                        "UDP setsockopt IPV6_MULTICAST_LOOP error %d: %s",
+                        errno, strerror(errno));
+
+        int ttl = -1; // route default
+        if (setsockopt(sock, IPPROTO_IPV6, IPV6_MULTICAST_HOPS, &ttl, sizeof(ttl)))
+            log_print(PLATFORM_LOG_PRIORITY_ERROR,
+                        "UDP setsockopt IPV6_MULTICAST_HOPS error %d: %s",
+                        errno, strerror(errno));
+
+        struct ipv6_mreq mreq6;
+        memcpy(&mreq6.ipv6mr_multiaddr, &cur->daddr.ip6, sizeof(struct in6_addr));
+        mreq6.ipv6mr_interface = INADDR_ANY;
+        if (setsockopt(sock, IPPROTO_IPV6, IPV6_ADD_MEMBERSHIP, &mreq6, sizeof(mreq6)))
+            log_print(PLATFORM_LOG_PRIORITY_ERROR,
+                        "UDP setsockopt IPV6_ADD_MEMBERSHIP error %d: %s",
+                        errno, strerror(errno));
     }
 
     return sock;
@@ -545,7 +1068,7 @@ ssize_t write_udp(const struct arguments *args, const struct udp_session *cur,
                 "UDP sending to tun %d from %s/%u to %s/%u data %u",
                 args->tun, dest, ntohs(cur->dest), source, ntohs(cur->source), len);
 
-    ssize_t res = write(args->tun, buffer, len);
+    ssize_t res = write_tun(args, buffer, len, NULL);
 
     // Write PCAP record
     if (res >= 0) {
@@ -0,0 +1,219 @@
+#include "netguard.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// Definitions
+///////////////////////////////////////////////////////////////////////////////
+
+#define UDP_MUX_SOCKETS 2 // per address family
+#define UDP_MUX_YIELD 10 // datagrams
+#define UDP_MUX_MAXMSG (IPV6_MAXPACKET - 40 - 8) // bytes
+
+struct udp_mux_socket {
+    int socket;
+    int version;
+    int flows;
+    struct epoll_event ev;
+};
+
+int udp_mux = 0;
+
+static struct udp_mux_socket udp_mux_sockets[2 * UDP_MUX_SOCKETS];
+static struct endpoint_flows udp_mux_flows;
+static int udp_mux_initialized = 0;
+
+static void init_udp_mux();
+
+static int open_udp_mux_socket(const struct arguments *args, struct udp_mux_socket *ms,
+                               int epoll_fd);
+
+static void release_udp_mux_flow(struct ng_session *s);
+
+///////////////////////////////////////////////////////////////////////////////
+
+static void init_udp_mux() {
+    if (udp_mux_initialized)
+        return;
+    for (int i = 0; i < 2 * UDP_MUX_SOCKETS; i++) {
+        udp_mux_sockets[i].socket = -1;
+        udp_mux_sockets[i].version = (i < UDP_MUX_SOCKETS ? 4 : 6);
+        udp_mux_sockets[i].flows = 0;
+    }
+    memset(&udp_mux_flows, 0, sizeof(udp_mux_flows));
+    udp_mux_initialized = 1;
+}
+
+static int open_udp_mux_socket(const struct arguments *args, struct udp_mux_socket *ms,
+                               int epoll_fd) {
+    int sock = socket(ms->version == 4 ? PF_INET : PF_INET6, SOCK_DGRAM, IPPROTO_UDP);
+    if (sock < 0) {
+        log_print(PLATFORM_LOG_PRIORITY_ERROR, "UDP mux socket error %d: %s",
+                  errno, strerror(errno));
+        return -1;
+    }
+
+    if (protect_socket(args, sock) < 0) {
+        close(sock);
+        return -1;
+    }
+
+    int flags = fcntl(sock, F_GETFL, 0);
+    if (flags < 0 || fcntl(sock, F_SETFL, flags | O_NONBLOCK) < 0)
+        log_print(PLATFORM_LOG_PRIORITY_ERROR, "UDP mux fcntl O_NONBLOCK error %d: %s",
+                  errno, strerror(errno));
+
+    ms->socket = sock;
+    memset(&ms->ev, 0, sizeof(struct epoll_event));
+    ms->ev.events = EPOLLIN | EPOLLERR;
+    ms->ev.data.ptr = ms;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, sock, &ms->ev))
+        log_print(PLATFORM_LOG_PRIORITY_ERROR, "epoll add udp mux error %d: %s",
+                  errno, strerror(errno));
+
+    log_print(PLATFORM_LOG_PRIORITY_WARN, "UDP%d mux socket %d", ms->version, sock);
+    return sock;
+}
+
+int open_udp_mux(const struct arguments *args, struct ng_session *s, int epoll_fd) {
+    if (!udp_mux)
+        return 0;
+
+    // Broadcast and multicast need socket options of their own
+    if (is_broadcast_or_multicast(s->udp.version, &s->udp.daddr))
+        return 0;
+
+    init_udp_mux();
+
+    // Use the first shared socket without a flow to the same remote endpoint
+    int first = (s->udp.version == 4 ? 0 : UDP_MUX_SOCKETS);
+    for (int i = first; i < first + UDP_MUX_SOCKETS; i++) {
+        struct udp_mux_socket *ms = &udp_mux_sockets[i];
+        if (ms->socket < 0 && open_udp_mux_socket(args, ms, epoll_fd) < 0)
+            return 0;
+        if (find_endpoint_flow(&udp_mux_flows, ms,
+                               s->udp.version, &s->udp.daddr, s->udp.dest) != NULL)
+            continue;
+
+        s->udp.mux = ms;
+        add_endpoint_flow(&udp_mux_flows, ms, s);
+        ms->flows++;
+
+        log_print(PLATFORM_LOG_PRIORITY_DEBUG, "UDP mux socket %d flows %d",
+                  ms->socket, ms->flows);
+        return 1;
+    }
+
+    log_print(PLATFORM_LOG_PRIORITY_INFO, "UDP mux collision, using dedicated socket");
+    return 0;
+}
+
+ssize_t send_udp_mux(const struct udp_session *cur, const uint8_t *data, size_t datalen) {
+    if (cur->version == 4) {
+        struct sockaddr_in addr4;
+        memset(&addr4, 0, sizeof(struct sockaddr_in));
+        addr4.sin_family = AF_INET;
+        addr4.sin_addr.s_addr = (__be32) cur->daddr.ip4;
+        addr4.sin_port = cur->dest;
+        return sendto(cur->mux->socket, data, datalen, MSG_NOSIGNAL,
+                      (const struct sockaddr *) &addr4, sizeof(struct sockaddr_in));
+    } else {
+        struct sockaddr_in6 addr6;
+        memset(&addr6, 0, sizeof(struct sockaddr_in6));
+        addr6.sin6_family = AF_INET6;
+        memcpy(&addr6.sin6_addr, &cur->daddr.ip6, 16);
+        addr6.sin6_port = cur->dest;
+        return sendto(cur->mux->socket, data, datalen, MSG_NOSIGNAL,
+                      (const struct sockaddr *) &addr6, sizeof(struct sockaddr_in6));
+    }
+}
+
+int is_udp_mux_socket(const void *ptr) {
+    return (ptr >= (const void *) &udp_mux_sockets[0] &&
+            ptr < (const void *) &udp_mux_sockets[2 * UDP_MUX_SOCKETS]);
+}
+
+void check_udp_mux_socket(const struct arguments *args, const struct epoll_event *ev) {
+    struct udp_mux_socket *ms = (struct udp_mux_socket *) ev->data.ptr;
+
+    if (ev->events & EPOLLERR) {
+        int serr = 0;
+        socklen_t optlen = sizeof(int);
+        if (getsockopt(ms->socket, SOL_SOCKET, SO_ERROR, &serr, &optlen) == 0 && serr)
+            log_print(PLATFORM_LOG_PRIORITY_WARN, "UDP mux SO_ERROR %d: %s",
+                      serr, strerror(serr));
+    }
+
+    if (!(ev->events & EPOLLIN))
+        return;
+
+    uint8_t *buffer = ng_malloc(UDP_MUX_MAXMSG, "udp mux recv");
+    for (int count = 0; count < UDP_MUX_YIELD && !args->ctx->stopping; count++) {
+        struct sockaddr_storage from;
+        struct iovec iov;
+        struct msghdr msg;
+        iov.iov_base = buffer;
+        iov.iov_len = UDP_MUX_MAXMSG;
+        memset(&msg, 0, sizeof(struct msghdr));
+        msg.msg_name = &from;
+        msg.msg_namelen = sizeof(from);
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+
+        ssize_t bytes = recvmsg(ms->socket, &msg, 0);
+        if (bytes < 0) {
+            if (errno != EINTR && errno != EAGAIN && errno != EWOULDBLOCK)
+                log_print(PLATFORM_LOG_PRIORITY_WARN, "UDP mux recvmsg error %d: %s",
+                          errno, strerror(errno));
+            break;
+        }
+
+        // Demultiplex by remote address and port
+        struct ng_session *s;
+        if (from.ss_family == AF_INET) {
+            struct sockaddr_in *from4 = (struct sockaddr_in *) &from;
+            s = find_endpoint_flow(&udp_mux_flows, ms, 4, &from4->sin_addr, from4->sin_port);
+        } else if (from.ss_family == AF_INET6) {
+            struct sockaddr_in6 *from6 = (struct sockaddr_in6 *) &from;
+            s = find_endpoint_flow(&udp_mux_flows, ms, 6, &from6->sin6_addr, from6->sin6_port);
+        } else
+            s = NULL;
+
+        if (s == NULL || s->udp.state != UDP_ACTIVE) {
+            log_print(PLATFORM_LOG_PRIORITY_DEBUG, "UDP mux socket %d no flow", ms->socket);
+            continue;
+        }
+
+        s->udp.time = time(NULL);
+        forward_udp_data(args, s, buffer, (size_t) bytes);
+    }
+    ng_free(buffer, __FILE__, __LINE__);
+}
+
+void release_udp_mux(struct udp_session *cur) {
+    struct udp_mux_socket *ms = cur->mux;
+    if (ms == NULL)
+        return;
+
+    if (remove_endpoint_flow(&udp_mux_flows, ms, cur))
+        ms->flows--;
+
+    cur->mux = NULL;
+}
+
+static void release_udp_mux_flow(struct ng_session *s) {
+    s->udp.mux = NULL;
+}
+
+void cleanup_udp_mux() {
+    if (!udp_mux_initialized)
+        return;
+
+    clear_endpoint_flows(&udp_mux_flows, release_udp_mux_flow);
+
+    for (int i = 0; i < 2 * UDP_MUX_SOCKETS; i++) {
+        if (udp_mux_sockets[i].socket >= 0 && close(udp_mux_sockets[i].socket))
+            log_print(PLATFORM_LOG_PRIORITY_ERROR, "UDP mux close %d error %d: %s",
+                      udp_mux_sockets[i].socket, errno, strerror(errno));
+        udp_mux_sockets[i].socket = -1;
+        udp_mux_sockets[i].flows = 0;
+    }
+}
@@ -148,58 +148,86 @@ long long get_ms() {
     return ts.tv_sec * 1000LL + ts.tv_nsec / 1e6;
 }
 
-static int is10x(int a) {
-    int bit1 = (a >> 7) & 1;
-    int bit2 = (a >> 6) & 1;
-    return (bit1 == 1) && (bit2 == 0);
-}
-
-int is_valid_utf8(const char *str) {
-    int str_len = strlen(str);
-    for (int i = 0; i < str_len; i++) {
-        // 0xxxxxxx
-        int bit1 = (str[i] >> 7) & 1;
-        if (bit1 == 0) continue;
-        // 110xxxxx 10xxxxxx
-        int bit2 = (str[i] >> 6) & 1;
-        if (bit2 == 0) return 0;
-        // 11
-        int bit3 = (str[i] >> 5) & 1;
-        if (bit3 == 0) {
-            // 110xxxxx 10xxxxxx
-            if ((++ i) < str_len) {
-                if (is10x(str[i])) {
-                    continue;
-                }
-                return 0;
-            } else {
-                return 0;
-            }
-        }
-        int bit4 = (str[i] >> 4) & 1;
-        if (bit4 == 0) {
-            // 1110xxxx 10xxxxxx 10xxxxxx
-            if (i + 2 < str_len) {
-                if (is10x(str[i + 1]) && is10x(str[i + 2])) {
-                    i += 2;
-                    continue;
-                }
-                return 0;
-            } else {
-                return 0;
-            }
-        }
-        int bit5 = (str[i] >> 3) & 1;
-        if (bit5 == 1) return false;
-        if (i + 3 < str_len) {
-            if (is10x(str[i + 1]) && is10x(str[i + 2]) && is10x(str[i + 3])) {
-                i += 3;
-                continue;
-            }
-            return 0;
-        } else {
-            return 0;
-        }
-    } // for
+uint32_t hash_fnv1a(uint32_t h, const void *data, size_t len) {
+    const uint8_t *d = (const uint8_t *) data;
+    for (size_t i = 0; i < len; i++) {
+        h ^= d[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+uint32_t hash_fnv1a_lower(uint32_t h, const char *str) {
+    for (const char *c = str; *c; c++) {
+        h ^= (uint8_t) tolower(*c);
+        h *= 16777619u;
+    }
+    return h;
+}
+
+uint32_t hash_endpoint(int version, const void *addr, uint16_t port) {
+    uint32_t h = hash_fnv1a(HASH_FNV1A_BASIS, addr, version == 4 ? 4 : 16);
+    return hash_fnv1a(h, &port, sizeof(port));
+}
+
+int is_broadcast_or_multicast(int version, const void *addr) {
+    if (version == 4) {
+        uint32_t broadcast4 = INADDR_BROADCAST;
+        return (memcmp(addr, &broadcast4, sizeof(broadcast4)) == 0);
+    } else
+        return (*((const uint8_t *) addr) == 0xFF);
+}
+
+static uint32_t endpoint_flow_bucket(const void *owner, int version, const void *addr, uint16_t port) {
+    uint32_t h = hash_endpoint(version, addr, port);
+    return hash_fnv1a(h, &owner, sizeof(owner)) % ENDPOINT_FLOW_BUCKETS;
+}
+
+struct ng_session *find_endpoint_flow(const struct endpoint_flows *flows, const void *owner,
+                                      int version, const void *addr, uint16_t port) {
+    struct endpoint_flow *f = flows->buckets[endpoint_flow_bucket(owner, version, addr, port)];
+    while (f != NULL &&
+           !(f->owner == owner &&
+             f->session->udp.version == version &&
+             f->session->udp.dest == port &&
+             memcmp(&f->session->udp.daddr, addr, version == 4 ? 4 : 16) == 0))
+        f = f->next;
+    return (f == NULL ? NULL : f->session);
+}
+
+void add_endpoint_flow(struct endpoint_flows *flows, const void *owner, struct ng_session *s) {
+    uint32_t b = endpoint_flow_bucket(owner, s->udp.version, &s->udp.daddr, s->udp.dest);
+    struct endpoint_flow *f = ng_malloc(sizeof(struct endpoint_flow), "endpoint flow");
+    f->owner = owner;
+    f->session = s;
+    f->next = flows->buckets[b];
+    flows->buckets[b] = f;
+}
+
+int remove_endpoint_flow(struct endpoint_flows *flows, const void *owner,
+                         const struct udp_session *cur) {
+    uint32_t b = endpoint_flow_bucket(owner, cur->version, &cur->daddr, cur->dest);
+    struct endpoint_flow **p = &flows->buckets[b];
+    while (*p != NULL && &(*p)->session->udp != cur)
+        p = &(*p)->next;
+    if (*p == NULL)
+        return 0;
+
+    struct endpoint_flow *f = *p;
+    *p = f->next;
+    ng_free(f, __FILE__, __LINE__);
     return 1;
-}
\ No newline at end of file
+}
+
+void clear_endpoint_flows(struct endpoint_flows *flows, void (*release)(struct ng_session *s)) {
+    for (int i = 0; i < ENDPOINT_FLOW_BUCKETS; i++) {
+        struct endpoint_flow *f = flows->buckets[i];
+        while (f != NULL) {
+            struct endpoint_flow *p = f;
+            f = f->next;
+            release(p->session);
+            ng_free(p, __FILE__, __LINE__);
+        }
+        flows->buckets[i] = NULL;
+    }
+}
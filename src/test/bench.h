@@ -0,0 +1,31 @@
+// Timing and reporting shared by the parser benchmarks
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <time.h>
+
+#define DURATION 500000 // microseconds per run
+#ifndef BATCH
+#define BATCH 1000 // iterations between clock reads
+#endif
+
+static volatile int sink; // keeps results from being optimized away
+
+static long long now_us() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+static void report(const char *name, const char *how, size_t bytes, const char *unit,
+                   long long count, long long elapsed) {
+    printf("%-18s %-5s %5zu bytes %9.1f ns/%-7s %6.0f MB/s\n",
+           name, how, bytes,
+           elapsed * 1000.0 / count, unit,
+           (double) count * bytes / elapsed);
+}
+
+#endif // BENCH_H
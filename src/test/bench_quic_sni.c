@@ -0,0 +1,45 @@
+// Benchmark server name extraction from QUIC client Initials
+// Each flow derives its initial keys, removes packet protection and parses the ClientHello
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../netguard/include/quic.h"
+#include "quic_corpus.h"
+
+#define BATCH 100 // flows between clock reads
+#include "bench.h"
+
+static int run_flow(struct quic_hello *hello, const struct quic_corpus_flow *f) {
+    const uint8_t *name;
+    memset(hello, 0, sizeof(struct quic_hello));
+    for (int d = 0; d < f->count; d++)
+        add_quic_initial(hello, f->datagrams[d].data, f->datagrams[d].len);
+    return find_quic_server_name(hello, &name);
+}
+
+int main() {
+    struct quic_hello *hello = malloc(sizeof(struct quic_hello));
+    printf("QUIC Initial server name extraction, %d ms per run\n", DURATION / 1000);
+    for (int i = 0; i < sizeof(quic_corpus) / sizeof(quic_corpus[0]); i++) {
+        const struct quic_corpus_flow *f = &quic_corpus[i];
+        if (run_flow(hello, f) != strlen(f->server_name)) {
+            printf("%s no server name\n", f->name);
+            return 1;
+        }
+
+        size_t bytes = 0;
+        for (int d = 0; d < f->count; d++)
+            bytes += f->datagrams[d].len;
+
+        long long flows = 0;
+        long long start = now_us();
+        while (now_us() - start < DURATION)
+            for (int b = 0; b < BATCH; b++, flows++)
+                sink += run_flow(hello, f);
+        report(f->name, "flow", bytes, "flow", flows, now_us() - start);
+    }
+    free(hello);
+    return 0;
+}
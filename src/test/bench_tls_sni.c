@@ -0,0 +1,238 @@
+// Benchmark server name extraction from real ClientHellos
+// Compares the zero-copy view and the copying get_server_name with the previous extractor,
+// kept below as the baseline, per corpus sample
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <arpa/inet.h>
+#include "../netguard/include/tls.h"
+#include "tls_corpus.h"
+#include "bench.h"
+
+// The previous extractor, without its logging: unaligned 16-bit reads,
+// strncpy into the name buffer and a bit by bit UTF-8 check of the copy
+
+static int old_is10x(int a) {
+    int bit1 = (a >> 7) & 1;
+    int bit2 = (a >> 6) & 1;
+    return (bit1 == 1) && (bit2 == 0);
+}
+
+static int old_is_valid_utf8(const char *str) {
+    int str_len = strlen(str);
+    for (int i = 0; i < str_len; i++) {
+        // 0xxxxxxx
+        int bit1 = (str[i] >> 7) & 1;
+        if (bit1 == 0) continue;
+        // 110xxxxx 10xxxxxx
+        int bit2 = (str[i] >> 6) & 1;
+        if (bit2 == 0) return 0;
+        // 11
+        int bit3 = (str[i] >> 5) & 1;
+        if (bit3 == 0) {
+            // 110xxxxx 10xxxxxx
+            if ((++ i) < str_len) {
+                if (old_is10x(str[i])) {
+                    continue;
+                }
+                return 0;
+            } else {
+                return 0;
+            }
+        }
+        int bit4 = (str[i] >> 4) & 1;
+        if (bit4 == 0) {
+            // 1110xxxx 10xxxxxx 10xxxxxx
+            if (i + 2 < str_len) {
+                if (old_is10x(str[i + 1]) && old_is10x(str[i + 2])) {
+                    i += 2;
+                    continue;
+                }
+                return 0;
+            } else {
+                return 0;
+            }
+        }
+        int bit5 = (str[i] >> 3) & 1;
+        if (bit5 == 1) return 0;
+        if (i + 3 < str_len) {
+            if (old_is10x(str[i + 1]) && old_is10x(str[i + 2]) && old_is10x(str[i + 3])) {
+                i += 3;
+                continue;
+            }
+            return 0;
+        } else {
+            return 0;
+        }
+    } // for
+    return 1;
+}
+
+static int old_parse_server_name_extension(const uint8_t *data, size_t data_len, char *hostname) {
+    size_t pos = 2; /* skip server name list length */
+    size_t len;
+
+    while (pos + 3 < data_len) {
+        len = ntohs(*((uint16_t *) (data + pos + 1)));
+
+        switch (data[pos]) { /* name type */
+            case 0x00: /* host_name */
+                if (len >= FQDN_LENGTH) {
+                    *hostname = 0;
+                    return -33;
+                }
+                if (pos + 3 + len > data_len) {
+                    return -30;
+                }
+                strncpy(hostname, (const char *)(data + pos + 3), len);
+                (hostname)[len] = '\0';
+                if (old_is_valid_utf8(hostname)) {
+                    return len;
+                } else {
+                    *hostname = 0;
+                    return -34;
+                }
+            default:
+                break;
+        }
+        pos += 3 + len;
+    }
+    /* Check we ended where we expected to */
+    if (pos != data_len) {
+        return -31;
+    }
+
+    return -32;
+}
+
+static int old_parse_extensions(const uint8_t *data, size_t data_len, char *hostname) {
+    size_t pos = 0;
+    size_t len;
+
+    /* Parse each 4 bytes for the extension header */
+    while (pos + 4 <= data_len) {
+        /* Extension Length */
+        len = ntohs(*((uint16_t *) (data + pos + 2)));
+
+        /* Check if it's a server name extension */
+        if (data[pos] == 0x00 && data[pos + 1] == 0x00) {
+            if (pos + 4 + len > data_len)
+                len = data_len - pos - 4; /* truncated, parse what is available */
+            return old_parse_server_name_extension(data + pos + 4, len, hostname);
+        }
+        pos += 4 + len; /* Advance to the next extension header */
+    }
+    /* Check we ended where we expected to */
+    if (pos != data_len)
+        return -21;
+
+    return -22;
+}
+
+static int old_parse_tls_server_name(const uint8_t *data, const size_t data_len, char *server_name) {
+    *server_name = 0;
+
+    if (data_len < TLS_HEADER_LEN)
+        return -1;
+    if ((data[0] & 0x80) && (data[2] == 1))
+        return -2;
+    if (data[0] != 0x16)
+        return -3;
+
+    uint8_t tls_version_major = data[1];
+    uint8_t tls_version_minor = data[2];
+    if (tls_version_major < 3)
+        return -4;
+
+    /* handshake */
+    size_t pos = TLS_HEADER_LEN;
+    size_t len;
+    if (pos + 1 > data_len)
+        return -5;
+    if (data[pos] != 0x1)
+        return -6;
+    pos += 38;
+
+    // Session ID
+    if (pos + 1 > data_len) return -7;
+    len = (size_t)data[pos];
+    pos += 1 + len;
+
+    /* Cipher Suites */
+    if (pos + 2 > data_len) return -8;
+    len = ntohs(*((uint16_t *) (data + pos)));
+    pos += 2 + len;
+
+    /* Compression Methods */
+    if (pos + 1 > data_len) return -9;
+    len = (size_t)data[pos];
+    pos += 1 + len;
+
+    if (pos == data_len && tls_version_major == 3 && tls_version_minor == 0)
+        return -10;
+
+    /* Extensions */
+    if (pos + 2 > data_len)
+        return -11;
+    len = ntohs(*((uint16_t *) (data + pos)));
+    pos += 2;
+
+    if (pos + len > data_len)
+        len = data_len - pos;
+    return old_parse_extensions(data + pos, len, server_name);
+}
+
+static void run_view(const struct tls_corpus_hello *h) {
+    long long parses = 0;
+    long long start = now_us();
+    while (now_us() - start < DURATION)
+        for (int i = 0; i < BATCH; i++, parses++) {
+            const uint8_t *name;
+            sink += find_server_name(h->data, h->len, &name);
+        }
+    report(h->name, "view", h->len, "hello", parses, now_us() - start);
+}
+
+static void run_copy(const struct tls_corpus_hello *h) {
+    char sn[FQDN_LENGTH];
+    long long parses = 0;
+    long long start = now_us();
+    while (now_us() - start < DURATION)
+        for (int i = 0; i < BATCH; i++, parses++) {
+            // As the session path did, clearing the name buffer first
+            memset(sn, 0, FQDN_LENGTH);
+            sink += get_server_name(h->data, h->len, h->data, sn);
+        }
+    report(h->name, "copy", h->len, "hello", parses, now_us() - start);
+}
+
+static void run_old(const struct tls_corpus_hello *h) {
+    char sn[FQDN_LENGTH];
+    long long parses = 0;
+    long long start = now_us();
+    while (now_us() - start < DURATION)
+        for (int i = 0; i < BATCH; i++, parses++) {
+            memset(sn, 0, FQDN_LENGTH);
+            sink += old_parse_tls_server_name(h->data, h->len, sn);
+        }
+    report(h->name, "old", h->len, "hello", parses, now_us() - start);
+}
+
+int main() {
+    printf("ClientHello server name extraction, %d ms per run\n", DURATION / 1000);
+    for (int i = 0; i < sizeof(tls_corpus) / sizeof(tls_corpus[0]); i++) {
+        const uint8_t *name;
+        char sn[FQDN_LENGTH];
+        if (find_server_name(tls_corpus[i].data, tls_corpus[i].len, &name) < 0 ||
+            old_parse_tls_server_name(tls_corpus[i].data, tls_corpus[i].len, sn) < 0) {
+            printf("%s no server name\n", tls_corpus[i].name);
+            return 1;
+        }
+        run_view(&tls_corpus[i]);
+        run_copy(&tls_corpus[i]);
+        run_old(&tls_corpus[i]);
+    }
+    return 0;
+}
@@ -0,0 +1,226 @@
+// Benchmark tun throughput at different MTUs
+// Reads packets the host stack routes into a tun device, and writes packets into it,
+// one packet per syscall like check_tun and write_udp do. Needs CAP_NET_ADMIN.
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <net/if.h>
+#include <netinet/in.h>
+#include <netinet/ip.h>
+#include <netinet/udp.h>
+#include <arpa/inet.h>
+#include <linux/if_tun.h>
+
+#define DURATION 1000000 // microseconds per run
+#define TUN_ADDR "10.99.0.1"
+#define PEER_ADDR "10.99.0.2"
+#define PORT 5001
+
+struct drain {
+    int fd;
+    size_t size;
+    volatile int stop;
+    long long packets;
+    long long bytes;
+};
+
+static long long now_us() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+static uint16_t checksum(uint32_t sum, const uint8_t *buffer, size_t length) {
+    const uint16_t *buf = (const uint16_t *) buffer;
+    while (length > 1) {
+        sum += *buf++;
+        length -= 2;
+    }
+    if (length > 0)
+        sum += *((const uint8_t *) buf);
+    while (sum >> 16)
+        sum = (sum & 0xFFFF) + (sum >> 16);
+    return (uint16_t) sum;
+}
+
+static int open_tun(const char *name, int mtu) {
+    int fd = open("/dev/net/tun", O_RDWR);
+    if (fd < 0)
+        return -1;
+
+    struct ifreq ifr;
+    memset(&ifr, 0, sizeof(ifr));
+    ifr.ifr_flags = IFF_TUN | IFF_NO_PI;
+    strncpy(ifr.ifr_name, name, IFNAMSIZ - 1);
+    if (ioctl(fd, TUNSETIFF, &ifr)) {
+        close(fd);
+        return -1;
+    }
+
+    int sock = socket(AF_INET, SOCK_DGRAM, 0);
+    struct sockaddr_in *addr = (struct sockaddr_in *) &ifr.ifr_addr;
+    int ok = 1;
+
+    ifr.ifr_mtu = mtu;
+    ok = ok && ioctl(sock, SIOCSIFMTU, &ifr) == 0;
+
+    memset(&ifr.ifr_addr, 0, sizeof(ifr.ifr_addr));
+    addr->sin_family = AF_INET;
+    inet_pton(AF_INET, TUN_ADDR, &addr->sin_addr);
+    ok = ok && ioctl(sock, SIOCSIFADDR, &ifr) == 0;
+
+    inet_pton(AF_INET, "255.255.255.0", &addr->sin_addr);
+    ok = ok && ioctl(sock, SIOCSIFNETMASK, &ifr) == 0;
+
+    ok = ok && ioctl(sock, SIOCGIFFLAGS, &ifr) == 0;
+    ifr.ifr_flags |= IFF_UP | IFF_RUNNING;
+    ok = ok && ioctl(sock, SIOCSIFFLAGS, &ifr) == 0;
+
+    close(sock);
+    if (!ok) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static void *drain(void *arg) {
+    struct drain *d = (struct drain *) arg;
+    uint8_t *buffer = malloc(d->size);
+    while (!d->stop) {
+        ssize_t len = read(d->fd, buffer, d->size);
+        if (len <= 0)
+            continue;
+        d->packets++;
+        d->bytes += len;
+    }
+    free(buffer);
+    return NULL;
+}
+
+static void report(const char *name, int mtu, long long packets, long long bytes, long long elapsed) {
+    printf("%-6s mtu %5d packets %8lld %8.0f kpps %8.1f MB/s\n",
+           name, mtu, packets, packets * 1000.0 / elapsed, (double) bytes / elapsed);
+}
+
+// Host stack -> tun, the path of check_tun
+static void run_read(int fd, int mtu) {
+    struct drain d = {fd, 65536, 0, 0, 0};
+    pthread_t thread;
+    pthread_create(&thread, NULL, drain, &d);
+
+    int sock = socket(AF_INET, SOCK_DGRAM, 0);
+    int pmtu = IP_PMTUDISC_DO;
+    setsockopt(sock, IPPROTO_IP, IP_MTU_DISCOVER, &pmtu, sizeof(pmtu));
+    struct sockaddr_in peer;
+    memset(&peer, 0, sizeof(peer));
+    peer.sin_family = AF_INET;
+    peer.sin_port = htons(PORT);
+    inet_pton(AF_INET, PEER_ADDR, &peer.sin_addr);
+
+    size_t size = (size_t) mtu - sizeof(struct iphdr) - sizeof(struct udphdr);
+    uint8_t *data = calloc(1, size);
+    long long start = now_us();
+    while (now_us() - start < DURATION)
+        if (sendto(sock, data, size, 0, (struct sockaddr *) &peer, sizeof(peer)) < 0 &&
+            errno != ENOBUFS && errno != EAGAIN) {
+            printf("read   mtu %5d sendto error %d: %s\n", mtu, errno, strerror(errno));
+            break;
+        }
+    long long elapsed = now_us() - start;
+
+    usleep(100 * 1000);
+    d.stop = 1;
+    sendto(sock, data, 1, 0, (struct sockaddr *) &peer, sizeof(peer)); // wake up
+    pthread_join(thread, NULL);
+    close(sock);
+    free(data);
+
+    report("read", mtu, d.packets, d.bytes, elapsed);
+}
+
+// tun -> host stack, the path of write_udp/write_tcp
+static void run_write(int fd, int mtu) {
+    int sock = socket(AF_INET, SOCK_DGRAM, 0);
+    int rcvbuf = 8 * 1024 * 1024;
+    setsockopt(sock, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+    struct timeval tv = {0, 100 * 1000};
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    struct sockaddr_in local;
+    memset(&local, 0, sizeof(local));
+    local.sin_family = AF_INET;
+    local.sin_port = htons(PORT);
+    inet_pton(AF_INET, TUN_ADDR, &local.sin_addr);
+    if (bind(sock, (struct sockaddr *) &local, sizeof(local))) {
+        printf("write  mtu %5d bind error %d: %s\n", mtu, errno, strerror(errno));
+        close(sock);
+        return;
+    }
+
+    struct drain d = {sock, 65536, 0, 0, 0};
+    pthread_t thread;
+    pthread_create(&thread, NULL, drain, &d);
+
+    // Build one IPv4/UDP packet of MTU size, as write_udp does
+    uint8_t *packet = calloc(1, (size_t) mtu);
+    struct iphdr *ip4 = (struct iphdr *) packet;
+    struct udphdr *udp = (struct udphdr *) (packet + sizeof(struct iphdr));
+    size_t datalen = (size_t) mtu - sizeof(struct iphdr) - sizeof(struct udphdr);
+    ip4->version = 4;
+    ip4->ihl = sizeof(struct iphdr) >> 2;
+    ip4->tot_len = htons((uint16_t) mtu);
+    ip4->ttl = IPDEFTTL;
+    ip4->protocol = IPPROTO_UDP;
+    inet_pton(AF_INET, PEER_ADDR, &ip4->saddr);
+    inet_pton(AF_INET, TUN_ADDR, &ip4->daddr);
+    ip4->check = ~checksum(0, (uint8_t *) ip4, sizeof(struct iphdr));
+    udp->source = htons(PORT);
+    udp->dest = htons(PORT);
+    udp->len = htons((uint16_t) (sizeof(struct udphdr) + datalen));
+    udp->check = 0; // optional for IPv4
+
+    long long written = 0;
+    long long start = now_us();
+    while (now_us() - start < DURATION)
+        if (write(fd, packet, (size_t) mtu) == mtu)
+            written++;
+    long long elapsed = now_us() - start;
+
+    usleep(100 * 1000);
+    d.stop = 1;
+    pthread_join(thread, NULL);
+    close(sock);
+    free(packet);
+
+    report("write", mtu, written, written * mtu, elapsed);
+    if (d.packets < written)
+        printf("       mtu %5d delivered %lld of %lld\n", mtu, d.packets, written);
+}
+
+int main() {
+    const int mtus[] = {1500, 9000, 65535};
+    printf("IPv4/UDP through a tun device, one packet per syscall, %d ms per run\n",
+           DURATION / 1000);
+    for (int i = 0; i < sizeof(mtus) / sizeof(mtus[0]); i++) {
+        int fd = open_tun("ngbench0", mtus[i]);
+        if (fd < 0) {
+            printf("mtu %d tun error %d: %s\n", mtus[i], errno, strerror(errno));
+            return 1;
+        }
+        run_read(fd, mtus[i]);
+        run_write(fd, mtus[i]);
+        close(fd);
+    }
+    return 0;
+}
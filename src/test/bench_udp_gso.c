@@ -0,0 +1,212 @@
+// Benchmark UDP segmentation/receive offload against a local UDP echo server
+// Compares one syscall per datagram with UDP_SEGMENT sends and UDP_GRO receives
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <netinet/udp.h>
+#include <arpa/inet.h>
+
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103
+#endif
+#ifndef UDP_GRO
+#define UDP_GRO 104
+#endif
+
+#define DATAGRAM 1200 // bytes, typical QUIC
+#define BATCH 32 // datagrams per GSO send
+#define DATAGRAMS (BATCH * 8192)
+
+struct echo {
+    int socket;
+    int gro;
+    volatile int stop;
+};
+
+static long long now_us() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+static int get_gso_size(struct msghdr *msg) {
+    for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(msg); cmsg != NULL; cmsg = CMSG_NXTHDR(msg, cmsg))
+        if (cmsg->cmsg_level == SOL_UDP && cmsg->cmsg_type == UDP_GRO)
+            return *((int *) CMSG_DATA(cmsg));
+    return 0;
+}
+
+static ssize_t send_segmented(int sock, const struct sockaddr *to, socklen_t tolen,
+                              uint8_t *data, size_t len, uint16_t segment) {
+    uint8_t control[CMSG_SPACE(sizeof(uint16_t))];
+    struct iovec iov = {data, len};
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_name = (void *) to;
+    msg.msg_namelen = tolen;
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    if (segment > 0 && segment < len) {
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_UDP;
+        cmsg->cmsg_type = UDP_SEGMENT;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+        *((uint16_t *) CMSG_DATA(cmsg)) = segment;
+    }
+    return sendmsg(sock, &msg, 0);
+}
+
+// Echo every datagram back, keeping the segmentation of coalesced reads
+static void *echo_server(void *arg) {
+    struct echo *e = (struct echo *) arg;
+    uint8_t *buffer = malloc(65536);
+    uint8_t control[CMSG_SPACE(sizeof(int))];
+    while (!e->stop) {
+        struct sockaddr_in from;
+        struct iovec iov = {buffer, 65536};
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_name = &from;
+        msg.msg_namelen = sizeof(from);
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        ssize_t len = recvmsg(e->socket, &msg, 0);
+        if (len <= 0)
+            continue;
+        int gso_size = (e->gro ? get_gso_size(&msg) : 0);
+        send_segmented(e->socket, (struct sockaddr *) &from, sizeof(from),
+                       buffer, (size_t) len, (uint16_t) gso_size);
+    }
+    free(buffer);
+    return NULL;
+}
+
+static int open_socket(int gro) {
+    int sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    bind(sock, (struct sockaddr *) &addr, sizeof(addr));
+
+    int size = 8 * 1024 * 1024;
+    setsockopt(sock, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+    setsockopt(sock, SOL_SOCKET, SO_SNDBUF, &size, sizeof(size));
+
+    struct timeval tv = {0, 200 * 1000};
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+    if (gro) {
+        int on = 1;
+        if (setsockopt(sock, SOL_UDP, UDP_GRO, &on, sizeof(on))) {
+            close(sock);
+            return -1;
+        }
+    }
+    return sock;
+}
+
+static int run(const char *name, int offload) {
+    struct echo e;
+    e.socket = open_socket(offload);
+    e.gro = offload;
+    e.stop = 0;
+    int sock = open_socket(offload);
+    if (e.socket < 0 || sock < 0) {
+        printf("%-8s not supported\n", name);
+        return -1;
+    }
+
+    struct sockaddr_in server;
+    socklen_t slen = sizeof(server);
+    getsockname(e.socket, (struct sockaddr *) &server, &slen);
+    if (connect(sock, (struct sockaddr *) &server, sizeof(server))) {
+        perror("connect");
+        return -1;
+    }
+
+    pthread_t thread;
+    pthread_create(&thread, NULL, echo_server, &e);
+
+    uint8_t *out = malloc(BATCH * DATAGRAM);
+    uint8_t *in = malloc(65536);
+    memset(out, 0x5a, BATCH * DATAGRAM);
+
+    long long syscalls = 0;
+    long long received = 0;
+    long long start = now_us();
+    for (int b = 0; b < DATAGRAMS / BATCH; b++) {
+        // Send a burst
+        if (offload) {
+            if (send_segmented(sock, NULL, 0, out, BATCH * DATAGRAM, DATAGRAM) < 0) {
+                printf("%-8s UDP_SEGMENT error %d: %s\n", name, errno, strerror(errno));
+                return -1;
+            }
+            syscalls++;
+        } else
+            for (int i = 0; i < BATCH; i++) {
+                send(sock, out + i * DATAGRAM, DATAGRAM, 0);
+                syscalls++;
+            }
+
+        // Wait for the echoes
+        int pending = BATCH;
+        while (pending > 0) {
+            uint8_t control[CMSG_SPACE(sizeof(int))];
+            struct iovec iov = {in, 65536};
+            struct msghdr msg;
+            memset(&msg, 0, sizeof(msg));
+            msg.msg_iov = &iov;
+            msg.msg_iovlen = 1;
+            msg.msg_control = control;
+            msg.msg_controllen = sizeof(control);
+            ssize_t len = recvmsg(sock, &msg, 0);
+            syscalls++;
+            if (len <= 0)
+                break; // lost
+            int gso_size = (offload ? get_gso_size(&msg) : 0);
+            int count = (gso_size > 0 ? (int) ((len + gso_size - 1) / gso_size) : 1);
+            pending -= count;
+            received += count;
+        }
+    }
+    long long elapsed = now_us() - start;
+
+    e.stop = 1;
+    send(sock, out, 1, 0); // wake up
+    pthread_join(thread, NULL);
+    close(sock);
+    close(e.socket);
+    free(out);
+    free(in);
+
+    long long packets = (long long) DATAGRAMS + received;
+    printf("%-8s datagrams %d echoed %lld syscalls %lld packets/syscall %.2f "
+           "%.0f kpps %.1f MB/s\n",
+           name, DATAGRAMS, received, syscalls,
+           (double) packets / syscalls,
+           packets * 1000.0 / elapsed,
+           2.0 * received * DATAGRAM / elapsed);
+    return 0;
+}
+
+int main() {
+    printf("UDP echo over loopback, %d byte datagrams, bursts of %d\n", DATAGRAM, BATCH);
+    run("plain", 0);
+    run("gso/gro", 1);
+    return 0;
+}
@@ -0,0 +1,144 @@
+// DNS responses for test_dns and bench_dns_parse
+// Encoded as resolvers do, with compressed names and an EDNS OPT record where noted.
+
+#ifndef DNS_CORPUS_H
+#define DNS_CORPUS_H
+
+static const unsigned char dns_a[] = {
+        0x1a, 0x2b, 0x81, 0x80, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01,
+        0x0a, 0x64, 0x75, 0x63, 0x6b, 0x64, 0x75, 0x63, 0x6b, 0x67, 0x6f, 0x03,
+        0x63, 0x6f, 0x6d, 0x00, 0x00, 0x01, 0x00, 0x01, 0xc0, 0x0c, 0x00, 0x01,
+        0x00, 0x01, 0x00, 0x00, 0x01, 0x2c, 0x00, 0x04, 0x34, 0x8e, 0x7c, 0xd7,
+        0x00, 0x00, 0x29, 0x04, 0xd0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
+};
+
+static const unsigned char dns_cname_chain[] = {
+        0x01, 0x02, 0x81, 0x80, 0x00, 0x01, 0x00, 0x04, 0x00, 0x00, 0x00, 0x01,
+        0x03, 0x77, 0x77, 0x77, 0x07, 0x45, 0x78, 0x61, 0x6d, 0x70, 0x6c, 0x65,
+        0x03, 0x63, 0x6f, 0x6d, 0x00, 0x00, 0x1c, 0x00, 0x01, 0xc0, 0x0c, 0x00,
+        0x05, 0x00, 0x01, 0x00, 0x00, 0x0e, 0x10, 0x00, 0x21, 0x03, 0x77, 0x77,
+        0x77, 0x07, 0x65, 0x78, 0x61, 0x6d, 0x70, 0x6c, 0x65, 0x03, 0x63, 0x6f,
+        0x6d, 0x03, 0x63, 0x64, 0x6e, 0x07, 0x65, 0x78, 0x61, 0x6d, 0x70, 0x6c,
+        0x65, 0x03, 0x6e, 0x65, 0x74, 0x00, 0xc0, 0x2d, 0x00, 0x05, 0x00, 0x01,
+        0x00, 0x00, 0x00, 0x3c, 0x00, 0x09, 0x06, 0x65, 0x64, 0x67, 0x65, 0x2d,
+        0x37, 0xc0, 0x3d, 0xc0, 0x5a, 0x00, 0x1c, 0x00, 0x01, 0x00, 0x00, 0x00,
+        0x14, 0x00, 0x10, 0x26, 0x06, 0x47, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x68, 0x10, 0x85, 0xe5, 0xc0, 0x5a, 0x00, 0x1c, 0x00,
+        0x01, 0x00, 0x00, 0x00, 0x14, 0x00, 0x10, 0x26, 0x06, 0x47, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x68, 0x10, 0x84, 0xe5, 0x00,
+        0x00, 0x29, 0x04, 0xd0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
+};
+
+static const unsigned char dns_https[] = {
+        0x77, 0x77, 0x81, 0x80, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00,
+        0x06, 0x63, 0x72, 0x79, 0x70, 0x74, 0x6f, 0x0a, 0x63, 0x6c, 0x6f, 0x75,
+        0x64, 0x66, 0x6c, 0x61, 0x72, 0x65, 0x03, 0x63, 0x6f, 0x6d, 0x00, 0x00,
+        0x41, 0x00, 0x01, 0xc0, 0x0c, 0x00, 0x41, 0x00, 0x01, 0x00, 0x00, 0x01,
+        0x2c, 0x00, 0x19, 0x00, 0x01, 0x00, 0x00, 0x01, 0x00, 0x06, 0x02, 0x68,
+        0x33, 0x02, 0x68, 0x32, 0x00, 0x04, 0x00, 0x08, 0xa2, 0x9f, 0x87, 0x4f,
+        0xa2, 0x9f, 0x88, 0x4f
+};
+
+static const unsigned char dns_nxdomain[] = {
+        0x42, 0x42, 0x81, 0x83, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00,
+        0x0b, 0x6e, 0x6f, 0x6e, 0x65, 0x78, 0x69, 0x73, 0x74, 0x65, 0x6e, 0x74,
+        0x0a, 0x64, 0x75, 0x63, 0x6b, 0x64, 0x75, 0x63, 0x6b, 0x67, 0x6f, 0x03,
+        0x63, 0x6f, 0x6d, 0x00, 0x00, 0x01, 0x00, 0x01, 0xc0, 0x18, 0x00, 0x06,
+        0x00, 0x01, 0x00, 0x00, 0x0e, 0x10, 0x00, 0x35, 0x04, 0x64, 0x6e, 0x73,
+        0x31, 0x03, 0x70, 0x30, 0x35, 0x05, 0x6e, 0x73, 0x6f, 0x6e, 0x65, 0x03,
+        0x6e, 0x65, 0x74, 0x00, 0x0a, 0x68, 0x6f, 0x73, 0x74, 0x6d, 0x61, 0x73,
+        0x74, 0x65, 0x72, 0xc0, 0x41, 0x62, 0x59, 0x00, 0x80, 0x00, 0x00, 0xa8,
+        0xc0, 0x00, 0x00, 0x1c, 0x20, 0x00, 0x12, 0x75, 0x00, 0x00, 0x00, 0x0e,
+        0x10
+};
+
+static const unsigned char dns_two_questions[] = {
+        0x51, 0x51, 0x81, 0x80, 0x00, 0x02, 0x00, 0x02, 0x00, 0x00, 0x00, 0x00,
+        0x03, 0x6f, 0x6e, 0x65, 0x07, 0x65, 0x78, 0x61, 0x6d, 0x70, 0x6c, 0x65,
+        0x03, 0x6f, 0x72, 0x67, 0x00, 0x00, 0x01, 0x00, 0x01, 0x03, 0x74, 0x77,
+        0x6f, 0xc0, 0x10, 0x00, 0x1c, 0x00, 0x01, 0xc0, 0x0c, 0x00, 0x01, 0x00,
+        0x01, 0x00, 0x00, 0x00, 0x78, 0x00, 0x04, 0xc0, 0x00, 0x02, 0x01, 0xc0,
+        0x21, 0x00, 0x1c, 0x00, 0x01, 0x00, 0x00, 0x00, 0x78, 0x00, 0x10, 0x20,
+        0x01, 0x0d, 0xb8, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x02
+};
+
+static const unsigned char dns_many_a[] = {
+        0x99, 0x99, 0x81, 0x80, 0x00, 0x01, 0x00, 0x28, 0x00, 0x00, 0x00, 0x01,
+        0x04, 0x70, 0x6f, 0x6f, 0x6c, 0x03, 0x6e, 0x74, 0x70, 0x07, 0x65, 0x78,
+        0x61, 0x6d, 0x70, 0x6c, 0x65, 0x00, 0x00, 0x01, 0x00, 0x01, 0xc0, 0x0c,
+        0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00, 0x96, 0x00, 0x04, 0xc6, 0x33,
+        0x64, 0x01, 0xc0, 0x0c, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00, 0x96,
+        0x00, 0x04, 0xc6, 0x33, 0x64, 0x02, 0xc0, 0x0c, 0x00, 0x01, 0x00, 0x01,
+        0x00, 0x00, 0x00, 0x96, 0x00, 0x04, 0xc6, 0x33, 0x64, 0x03, 0xc0, 0x0c,
+        0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00, 0x96, 0x00, 0x04, 0xc6, 0x33,
+        0x64, 0x04, 0xc0, 0x0c, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00, 0x96,
+        0x00, 0x04, 0xc6, 0x33, 0x64, 0x05, 0xc0, 0x0c, 0x00, 0x01, 0x00, 0x01,
+        0x00, 0x00, 0x00, 0x96, 0x00, 0x04, 0xc6, 0x33, 0x64, 0x06, 0xc0, 0x0c,
+        0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00, 0x96, 0x00, 0x04, 0xc6, 0x33,
+        0x64, 0x07, 0xc0, 0x0c, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00, 0x96,
+        0x00, 0x04, 0xc6, 0x33, 0x64, 0x08, 0xc0, 0x0c, 0x00, 0x01, 0x00, 0x01,
+        0x00, 0x00, 0x00, 0x96, 0x00, 0x04, 0xc6, 0x33, 0x64, 0x09, 0xc0, 0x0c,
+        0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00, 0x96, 0x00, 0x04, 0xc6, 0x33,
+        0x64, 0x0a, 0xc0, 0x0c, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00, 0x96,
+        0x00, 0x04, 0xc6, 0x33, 0x64, 0x0b, 0xc0, 0x0c, 0x00, 0x01, 0x00, 0x01,
+        0x00, 0x00, 0x00, 0x96, 0x00, 0x04, 0xc6, 0x33, 0x64, 0x0c, 0xc0, 0x0c,
+        0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00, 0x96, 0x00, 0x04, 0xc6, 0x33,
+        0x64, 0x0d, 0xc0, 0x0c, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00, 0x96,
+        0x00, 0x04, 0xc6, 0x33, 0x64, 0x0e, 0xc0, 0x0c, 0x00, 0x01, 0x00, 0x01,
+        0x00, 0x00, 0x00, 0x96, 0x00, 0x04, 0xc6, 0x33, 0x64, 0x0f, 0xc0, 0x0c,
+        0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00, 0x96, 0x00, 0x04, 0xc6, 0x33,
+        0x64, 0x10, 0xc0, 0x0c, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00, 0x96,
+        0x00, 0x04, 0xc6, 0x33, 0x64, 0x11, 0xc0, 0x0c, 0x00, 0x01, 0x00, 0x01,
+        0x00, 0x00, 0x00, 0x96, 0x00, 0x04, 0xc6, 0x33, 0x64, 0x12, 0xc0, 0x0c,
+        0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00, 0x96, 0x00, 0x04, 0xc6, 0x33,
+        0x64, 0x13, 0xc0, 0x0c, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00, 0x96,
+        0x00, 0x04, 0xc6, 0x33, 0x64, 0x14, 0xc0, 0x0c, 0x00, 0x01, 0x00, 0x01,
+        0x00, 0x00, 0x00, 0x96, 0x00, 0x04, 0xc6, 0x33, 0x64, 0x15, 0xc0, 0x0c,
+        0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00, 0x96, 0x00, 0x04, 0xc6, 0x33,
+        0x64, 0x16, 0xc0, 0x0c, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00, 0x96,
+        0x00, 0x04, 0xc6, 0x33, 0x64, 0x17, 0xc0, 0x0c, 0x00, 0x01, 0x00, 0x01,
+        0x00, 0x00, 0x00, 0x96, 0x00, 0x04, 0xc6, 0x33, 0x64, 0x18, 0xc0, 0x0c,
+        0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00, 0x96, 0x00, 0x04, 0xc6, 0x33,
+        0x64, 0x19, 0xc0, 0x0c, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00, 0x96,
+        0x00, 0x04, 0xc6, 0x33, 0x64, 0x1a, 0xc0, 0x0c, 0x00, 0x01, 0x00, 0x01,
+        0x00, 0x00, 0x00, 0x96, 0x00, 0x04, 0xc6, 0x33, 0x64, 0x1b, 0xc0, 0x0c,
+        0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00, 0x96, 0x00, 0x04, 0xc6, 0x33,
+        0x64, 0x1c, 0xc0, 0x0c, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00, 0x96,
+        0x00, 0x04, 0xc6, 0x33, 0x64, 0x1d, 0xc0, 0x0c, 0x00, 0x01, 0x00, 0x01,
+        0x00, 0x00, 0x00, 0x96, 0x00, 0x04, 0xc6, 0x33, 0x64, 0x1e, 0xc0, 0x0c,
+        0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00, 0x96, 0x00, 0x04, 0xc6, 0x33,
+        0x64, 0x1f, 0xc0, 0x0c, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00, 0x96,
+        0x00, 0x04, 0xc6, 0x33, 0x64, 0x20, 0xc0, 0x0c, 0x00, 0x01, 0x00, 0x01,
+        0x00, 0x00, 0x00, 0x96, 0x00, 0x04, 0xc6, 0x33, 0x64, 0x21, 0xc0, 0x0c,
+        0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00, 0x96, 0x00, 0x04, 0xc6, 0x33,
+        0x64, 0x22, 0xc0, 0x0c, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00, 0x96,
+        0x00, 0x04, 0xc6, 0x33, 0x64, 0x23, 0xc0, 0x0c, 0x00, 0x01, 0x00, 0x01,
+        0x00, 0x00, 0x00, 0x96, 0x00, 0x04, 0xc6, 0x33, 0x64, 0x24, 0xc0, 0x0c,
+        0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00, 0x96, 0x00, 0x04, 0xc6, 0x33,
+        0x64, 0x25, 0xc0, 0x0c, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00, 0x96,
+        0x00, 0x04, 0xc6, 0x33, 0x64, 0x26, 0xc0, 0x0c, 0x00, 0x01, 0x00, 0x01,
+        0x00, 0x00, 0x00, 0x96, 0x00, 0x04, 0xc6, 0x33, 0x64, 0x27, 0xc0, 0x0c,
+        0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00, 0x96, 0x00, 0x04, 0xc6, 0x33,
+        0x64, 0x28, 0x00, 0x00, 0x29, 0x04, 0xd0, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00
+};
+
+struct dns_corpus_message {
+    const char *name;
+    const char *qname;
+    const unsigned char *data;
+    size_t len;
+    int count[4];
+};
+
+static const struct dns_corpus_message dns_corpus[] = {
+        {"dns_a", "duckduckgo.com", dns_a, sizeof(dns_a), {1, 1, 0, 1}},
+        {"dns_cname_chain", "www.Example.com", dns_cname_chain, sizeof(dns_cname_chain), {1, 4, 0, 1}},
+        {"dns_https", "crypto.cloudflare.com", dns_https, sizeof(dns_https), {1, 1, 0, 0}},
+        {"dns_nxdomain", "nonexistent.duckduckgo.com", dns_nxdomain, sizeof(dns_nxdomain), {1, 0, 1, 0}},
+        {"dns_two_questions", "one.example.org", dns_two_questions, sizeof(dns_two_questions), {2, 2, 0, 0}},
+        {"dns_many_a", "pool.ntp.example", dns_many_a, sizeof(dns_many_a), {1, 40, 0, 1}},
+};
+
+#endif // DNS_CORPUS_H
@@ -0,0 +1,542 @@
+// QUIC client Initial datagrams for test_tls and bench_quic_sni
+// Built from the ClientHellos in tls_corpus.h with the initial keys of RFC 9001
+// and RFC 9369, using the destination connection ID of RFC 9001 appendix A.
+
+#ifndef QUIC_CORPUS_H
+#define QUIC_CORPUS_H
+
+static const unsigned char quic_v1_single_0[] = {
+        0xcb, 0x00, 0x00, 0x00, 0x01, 0x08, 0x83, 0x94, 0xc8, 0xf0, 0x3e, 0x51,
+        0x57, 0x08, 0x00, 0x00, 0x44, 0x9e, 0x76, 0x00, 0x0d, 0x78, 0x46, 0xb4,
+        0x53, 0xda, 0x9b, 0x7c, 0xa2, 0xdb, 0xc0, 0xa5, 0x63, 0x4d, 0xc0, 0x46,
+        0xf8, 0x59, 0x7f, 0x26, 0x9b, 0x4c, 0x47, 0x50, 0x1a, 0xf4, 0x39, 0x2b,
+        0xee, 0x62, 0xb9, 0xd3, 0xb8, 0xbd, 0x49, 0x57, 0xe4, 0x8c, 0xfe, 0x67,
+        0x0e, 0x16, 0x09, 0xd9, 0x07, 0xa2, 0x44, 0x42, 0xb7, 0x38, 0xbd, 0xdd,
+        0x44, 0xe5, 0xa1, 0x0b, 0x9e, 0x2a, 0x0e, 0xee, 0xcd, 0x55, 0x6a, 0x1b,
+        0x97, 0x90, 0x33, 0x58, 0x6a, 0x78, 0x3f, 0xa6, 0x38, 0xb8, 0xe9, 0x20,
+        0x67, 0x7c, 0xfe, 0x2f, 0xbc, 0x52, 0xaf, 0xa7, 0x33, 0x2e, 0xb1, 0x3c,
+        0xb8, 0x90, 0x4e, 0xd7, 0xf0, 0x88, 0x88, 0x6c, 0xac, 0xc2, 0xa6, 0x22,
+        0x0d, 0x3a, 0x4f, 0xd8, 0x76, 0x22, 0xa3, 0x9c, 0x63, 0x10, 0x35, 0x23,
+        0x33, 0xf0, 0x6a, 0xed, 0x25, 0xc0, 0x49, 0x9f, 0x4b, 0xc3, 0x98, 0x4a,
+        0xd6, 0x08, 0x86, 0x50, 0x11, 0x6b, 0x94, 0x73, 0x8e, 0x88, 0x10, 0xff,
+        0x18, 0x78, 0x72, 0x30, 0x5a, 0x44, 0x52, 0xaf, 0xc4, 0xa9, 0x4a, 0x15,
+        0xcd, 0xd0, 0x7f, 0xf9, 0x42, 0x65, 0x12, 0xe4, 0x43, 0x37, 0x0c, 0x91,
+        0x9b, 0x13, 0x54, 0xc0, 0x6b, 0x36, 0x4f, 0x68, 0x5b, 0xc4, 0xce, 0xcf,
+        0x75, 0x0b, 0x1f, 0x06, 0x2f, 0x5a, 0x7b, 0x9d, 0xc0, 0x1d, 0xac, 0x96,
+        0x57, 0x89, 0x77, 0x0b, 0x3d, 0x4a, 0x6e, 0xf0, 0x12, 0xb1, 0x0d, 0xe1,
+        0x74, 0x47, 0x5b, 0xdc, 0x0a, 0x05, 0x56, 0xa8, 0x04, 0x24, 0x0a, 0x53,
+        0xfe, 0x13, 0xb7, 0x57, 0x98, 0x4f, 0xf2, 0x43, 0x69, 0xcd, 0xf8, 0xe1,
+        0x59, 0x3d, 0x9b, 0x86, 0xa9, 0xb5, 0x17, 0x43, 0x9e, 0xb3, 0x86, 0x0a,
+        0xed, 0xc8, 0x31, 0x19, 0x28, 0x26, 0x58, 0xf2, 0x52, 0xab, 0xf2, 0xaa,
+        0xb2, 0x69, 0x5c, 0x2f, 0xa9, 0x75, 0x29, 0xa8, 0xb8, 0xe3, 0xf2, 0x0e,
+        0xf3, 0xa9, 0x7a, 0x96, 0x1a, 0x05, 0xb0, 0x36, 0x12, 0xc0, 0x59, 0x1b,
+        0xcf, 0xd4, 0x34, 0x88, 0x16, 0xf3, 0xa8, 0x7c, 0x48, 0xb0, 0x0c, 0x07,
+        0x45, 0x42, 0x23, 0x6a, 0xf6, 0x69, 0x7f, 0x80, 0x4d, 0x0f, 0x49, 0xcc,
+        0x0c, 0x88, 0xaf, 0xbd, 0x83, 0x08, 0x27, 0x9b, 0x50, 0x21, 0xa1, 0x3a,
+        0xdd, 0xd6, 0x09, 0x84, 0x31, 0x41, 0x3d, 0xca, 0x76, 0xe4, 0x65, 0x60,
+        0xb5, 0x2a, 0x54, 0x4c, 0x09, 0x0f, 0xaa, 0xf6, 0x9b, 0x7a, 0xfb, 0xbb,
+        0x59, 0xc6, 0x4a, 0xe4, 0xb8, 0xd0, 0x09, 0x7b, 0x1e, 0x14, 0x25, 0x8d,
+        0x0c, 0x46, 0x05, 0x26, 0xfc, 0x25, 0x76, 0x13, 0x67, 0xa8, 0x78, 0x38,
+        0xc2, 0xc9, 0x78, 0xe4, 0x5a, 0x4f, 0x7b, 0xa0, 0x1f, 0x7d, 0x22, 0x05,
+        0x44, 0x07, 0x11, 0x6b, 0x3c, 0x15, 0xe9, 0xd2, 0xee, 0x51, 0xbd, 0x3c,
+        0xe3, 0x05, 0xc6, 0x9e, 0xbb, 0x9d, 0xf2, 0xb6, 0x5d, 0x73, 0x13, 0x58,
+        0xe3, 0xc4, 0x24, 0x46, 0x2f, 0xa4, 0x31, 0x43, 0x98, 0x88, 0xba, 0x4f,
+        0x17, 0xe8, 0xe4, 0x63, 0x5d, 0xa8, 0xc7, 0x80, 0x9c, 0xef, 0xa7, 0xcc,
+        0xb0, 0x5a, 0x7c, 0x22, 0xa1, 0xdf, 0xfa, 0x46, 0x90, 0x3a, 0x95, 0x5f,
+        0x4b, 0x06, 0xdd, 0xd9, 0xed, 0x36, 0x7c, 0x01, 0x7a, 0x3f, 0xcd, 0xaf,
+        0x51, 0xeb, 0x44, 0x82, 0xcf, 0xff, 0xfa, 0xbc, 0xff, 0xab, 0x26, 0x60,
+        0x48, 0x71, 0xe6, 0x45, 0x08, 0xd2, 0xce, 0x2b, 0x89, 0xe6, 0x1a, 0x98,
+        0x2e, 0xfd, 0xcf, 0xad, 0x27, 0xfe, 0xa6, 0x5e, 0x93, 0xe6, 0x93, 0x62,
+        0x0b, 0xcc, 0x92, 0xd7, 0xe8, 0x62, 0xd6, 0xdd, 0x8a, 0x79, 0xa9, 0x93,
+        0x48, 0x90, 0x56, 0xae, 0xff, 0x4a, 0xbe, 0x9f, 0xf7, 0xef, 0x19, 0x90,
+        0x1d, 0x11, 0xf4, 0x2d, 0x0e, 0x8f, 0xc1, 0xe9, 0x3a, 0xac, 0x3d, 0x7e,
+        0x19, 0x7f, 0x42, 0xd7, 0x85, 0xaa, 0x00, 0xf9, 0x03, 0x48, 0xc4, 0xa4,
+        0xaa, 0x1f, 0x31, 0x03, 0x51, 0xcd, 0xa3, 0xd0, 0x64, 0xab, 0xd9, 0xef,
+        0x56, 0x10, 0x01, 0xf3, 0x70, 0x71, 0xa8, 0x4a, 0x70, 0xbf, 0x41, 0x6f,
+        0xfc, 0xe1, 0xb0, 0x6c, 0x4f, 0xae, 0x8a, 0x14, 0x11, 0x91, 0x76, 0x09,
+        0x34, 0x60, 0xbe, 0x22, 0x23, 0xdb, 0x2b, 0xdc, 0x97, 0x1c, 0xc9, 0xe4,
+        0x6b, 0x5f, 0x58, 0x66, 0xab, 0xf8, 0x63, 0x1b, 0x9d, 0x1e, 0x09, 0xef,
+        0x39, 0xb2, 0x78, 0xca, 0x43, 0x61, 0x91, 0xc3, 0xb7, 0x08, 0x29, 0x0b,
+        0xfd, 0x45, 0x9f, 0x7f, 0x32, 0x67, 0xa7, 0x2b, 0xee, 0x7a, 0xe3, 0xe4,
+        0x78, 0xb0, 0x87, 0xb7, 0x3e, 0xde, 0x75, 0xf6, 0x84, 0x4d, 0xa2, 0xab,
+        0xbf, 0xe4, 0x6c, 0xed, 0x45, 0xa6, 0x55, 0x21, 0xa8, 0x95, 0x49, 0x6e,
+        0xa1, 0x6d, 0xa2, 0xb8, 0x5c, 0xc7, 0xdb, 0x73, 0x8a, 0x0d, 0x50, 0x08,
+        0x96, 0xa0, 0x70, 0xa3, 0xbe, 0x60, 0x83, 0x3c, 0x3f, 0xc7, 0x5b, 0x4b,
+        0xf2, 0x64, 0x1d, 0xf9, 0x11, 0x3d, 0x3d, 0x6c, 0xca, 0x42, 0xd5, 0xe8,
+        0xc9, 0x42, 0x03, 0x30, 0x17, 0x67, 0xab, 0x43, 0x3c, 0x28, 0x82, 0x7a,
+        0x52, 0xf1, 0xa8, 0xe8, 0x9e, 0xa6, 0xa6, 0x22, 0x80, 0xc2, 0xb8, 0x48,
+        0x72, 0xc9, 0x24, 0x27, 0x17, 0x7e, 0x05, 0xa9, 0xe9, 0x68, 0xba, 0x0b,
+        0xaa, 0x7c, 0x07, 0x97, 0xc9, 0xf1, 0xea, 0x63, 0xaf, 0xd6, 0x05, 0xfd,
+        0xba, 0x47, 0x34, 0xe9, 0x92, 0x97, 0x84, 0x28, 0x4f, 0x23, 0xa1, 0x86,
+        0x84, 0x66, 0x25, 0x34, 0x08, 0xe9, 0x80, 0x82, 0x78, 0x30, 0xb1, 0xf5,
+        0xca, 0xbb, 0x51, 0x39, 0x75, 0x59, 0x6e, 0x2e, 0x4b, 0x2b, 0x4a, 0xa3,
+        0x4d, 0x14, 0xf6, 0xbb, 0x69, 0x56, 0x74, 0x21, 0x9e, 0x80, 0x56, 0x58,
+        0xf3, 0x36, 0x2f, 0x2e, 0xca, 0x47, 0x5d, 0x08, 0xb8, 0x4b, 0xaf, 0x96,
+        0x62, 0xab, 0x91, 0x36, 0x1c, 0x44, 0xb3, 0x5b, 0x07, 0x24, 0xfb, 0xd0,
+        0x7d, 0xcf, 0xc1, 0xff, 0x68, 0x36, 0x9b, 0xa9, 0xfc, 0x60, 0xd3, 0x34,
+        0x8b, 0xfb, 0x5f, 0x29, 0x78, 0x87, 0x4c, 0xb9, 0x25, 0xe3, 0xb5, 0x1c,
+        0x36, 0xe0, 0xb2, 0xae, 0x85, 0xf9, 0x85, 0xd2, 0x23, 0x04, 0xee, 0x49,
+        0x5f, 0x72, 0xc0, 0x76, 0xa3, 0xdb, 0xb6, 0xb3, 0xbd, 0x5f, 0xaa, 0x2a,
+        0x41, 0x26, 0x8f, 0x61, 0xb9, 0x6e, 0xca, 0x9d, 0x1f, 0x28, 0x3f, 0x56,
+        0x6f, 0x4a, 0xfb, 0x6e, 0x36, 0xfc, 0x07, 0x0c, 0x7b, 0xa5, 0xe8, 0xa7,
+        0x2a, 0x2c, 0xeb, 0xec, 0xaa, 0xb6, 0x13, 0xe0, 0x30, 0x1f, 0xca, 0xa9,
+        0xce, 0xc2, 0xce, 0x20, 0x33, 0xfa, 0x2d, 0x17, 0x01, 0x37, 0xfd, 0x56,
+        0xa2, 0x7f, 0xeb, 0xc1, 0xa0, 0x03, 0x19, 0x97, 0xe1, 0xce, 0x20, 0x6b,
+        0xca, 0xf6, 0x06, 0xb4, 0x42, 0xc1, 0x66, 0xe2, 0x6f, 0xc8, 0x1f, 0x78,
+        0xed, 0xf7, 0x43, 0xda, 0xe6, 0x7b, 0x91, 0xa0, 0x2f, 0x4e, 0x1f, 0xc6,
+        0xaa, 0x42, 0x19, 0xe4, 0x7d, 0xc9, 0x19, 0x74, 0x3d, 0xe4, 0xf2, 0xb7,
+        0x39, 0x98, 0x60, 0x29, 0x87, 0x12, 0xfc, 0xf8, 0x2f, 0x79, 0x8c, 0x5b,
+        0x8f, 0xc3, 0x25, 0x53, 0xac, 0x66, 0x39, 0x83, 0x6f, 0xae, 0x63, 0xe6,
+        0x4b, 0x04, 0xfe, 0x34, 0x46, 0xeb, 0x09, 0xc3, 0x76, 0xe8, 0x16, 0x7a,
+        0x31, 0xcb, 0x2d, 0xb6, 0x2e, 0xba, 0x9c, 0x0d, 0x53, 0x1d, 0x39, 0x58,
+        0x8f, 0xad, 0xe1, 0xf7, 0xa2, 0x99, 0x8a, 0x08, 0xe3, 0x23, 0xf0, 0xd6,
+        0x83, 0x87, 0x1d, 0x43, 0x88, 0x2a, 0xba, 0x2f, 0xcc, 0xa4, 0xed, 0x81,
+        0x31, 0x9b, 0xb1, 0xb3, 0xef, 0x92, 0x47, 0xdd, 0x04, 0x87, 0x56, 0x01,
+        0xb9, 0x6b, 0xec, 0x45, 0xb7, 0xaf, 0x2c, 0x9b, 0x74, 0x96, 0x9e, 0xc3,
+        0x0d, 0xfd, 0x53, 0x05, 0xff, 0xff, 0x2a, 0xd6, 0x90, 0xc3, 0x2d, 0x3f,
+        0x6f, 0x3b, 0xf2, 0x03, 0x16, 0x9b, 0x0a, 0xcb, 0xa5, 0xce, 0xd7, 0x6c,
+        0x1f, 0xdc, 0x06, 0x70, 0xf4, 0x39, 0x0c, 0x22, 0xff, 0x75, 0x96, 0x81,
+        0x04, 0xfd, 0x4a, 0xb5, 0xaa, 0x7a, 0x3f, 0xa0, 0xea, 0xcb, 0xe3, 0xb7,
+        0xfb, 0xd2, 0x4f, 0x43, 0x06, 0x3b, 0x33, 0x08, 0x05, 0x04, 0xb8, 0x05,
+        0x0b, 0x86, 0x80, 0x65, 0x5c, 0xa4, 0xd9, 0x91, 0xbb, 0xc8, 0x8c, 0xbb,
+        0xfd, 0x5c, 0x32, 0x3f, 0x9a, 0x50, 0xe8, 0x15, 0x57, 0x95, 0xe3, 0x17,
+        0x68, 0x99, 0xe5, 0x61, 0x61, 0x8f, 0xcf, 0x38, 0xe2, 0xfe, 0x3b, 0x05,
+        0x3c, 0xa5, 0xfe, 0xb9, 0x7f, 0x0a, 0xa5, 0x46, 0x1d, 0x42, 0xa6, 0x22,
+        0x74, 0x67, 0xb9, 0x67, 0xd3, 0x0c, 0x2e, 0x89, 0x72, 0x63, 0x82, 0xed,
+        0x75, 0xf0, 0xa3, 0x81, 0xc2, 0x1f, 0x68, 0x5e, 0x6f, 0x7a, 0xf1, 0xe9,
+        0x45, 0x9c, 0x07, 0x0e, 0xbc, 0xa2, 0xc0, 0x4d, 0xd1, 0xbe, 0x88, 0x33,
+        0xeb, 0x43, 0xde, 0x92, 0x09, 0xeb, 0x75, 0xe8, 0x99, 0x06, 0x6e, 0xf5
+};
+
+static const unsigned char quic_v2_reordered_0[] = {
+        0xd3, 0x6b, 0x33, 0x43, 0xcf, 0x08, 0x83, 0x94, 0xc8, 0xf0, 0x3e, 0x51,
+        0x57, 0x08, 0x04, 0xc2, 0xb1, 0xa1, 0xf3, 0x00, 0x44, 0x9a, 0x98, 0x52,
+        0x37, 0x56, 0xd4, 0xac, 0x16, 0x2f, 0x51, 0x5f, 0x24, 0x32, 0xbb, 0xd3,
+        0xc0, 0xf6, 0xaf, 0x1c, 0x12, 0x66, 0xf6, 0x99, 0x22, 0xb8, 0xf8, 0x88,
+        0xe3, 0x52, 0x7c, 0x58, 0x45, 0x7a, 0xa7, 0x84, 0x38, 0xa6, 0x61, 0x3d,
+        0x76, 0xea, 0x2a, 0x91, 0xe4, 0x0b, 0x98, 0x8d, 0x3c, 0x33, 0x7c, 0x6d,
+        0x1a, 0x9d, 0xa9, 0x08, 0x2b, 0x9c, 0xd3, 0x9f, 0x13, 0xdb, 0x65, 0xa4,
+        0x47, 0xae, 0x70, 0xa4, 0x5e, 0x53, 0x99, 0xc0, 0xc8, 0x0c, 0x26, 0xb0,
+        0xfa, 0xdb, 0x80, 0x4c, 0xb6, 0x9f, 0xce, 0x26, 0xf3, 0x77, 0x88, 0x23,
+        0xf5, 0x62, 0x33, 0xe7, 0xca, 0xee, 0x96, 0x73, 0x38, 0x03, 0x59, 0xf2,
+        0xd0, 0xce, 0x40, 0x28, 0xe5, 0xb2, 0x89, 0x4b, 0xf2, 0x5a, 0x04, 0x06,
+        0xf5, 0x25, 0x78, 0xaf, 0x22, 0x15, 0x47, 0x74, 0xff, 0x8f, 0xb8, 0x78,
+        0x8b, 0xcf, 0x53, 0x11, 0x9e, 0xad, 0x57, 0x0d, 0x51, 0xa6, 0x2f, 0x6e,
+        0x7a, 0x3e, 0xb8, 0xc6, 0x48, 0x60, 0x17, 0xce, 0xd5, 0xe4, 0x3b, 0x3d,
+        0xd7, 0x31, 0x81, 0xd9, 0x80, 0xf1, 0xf1, 0x39, 0xa1, 0x2d, 0x3d, 0x33,
+        0x7f, 0x80, 0x5d, 0xdb, 0xb7, 0x25, 0xc1, 0x85, 0x55, 0x78, 0xee, 0x64,
+        0xe1, 0x7b, 0xfe, 0x6e, 0x5f, 0x4a, 0xad, 0x16, 0x9e, 0xe9, 0x81, 0xaf,
+        0x62, 0x19, 0x50, 0xeb, 0x2e, 0x52, 0x91, 0x4e, 0xac, 0x02, 0x9d, 0x93,
+        0x96, 0x34, 0x4f, 0xda, 0xe0, 0x12, 0xc5, 0xa2, 0x59, 0xef, 0xb1, 0x13,
+        0x65, 0xb6, 0x75, 0xd8, 0x86, 0x12, 0x2b, 0x6b, 0x20, 0x1b, 0xf2, 0xd6,
+        0x37, 0x32, 0x54, 0x89, 0x58, 0x33, 0x68, 0x7d, 0xe7, 0x7f, 0x6f, 0x95,
+        0x1f, 0x71, 0x4f, 0xd5, 0xf3, 0xb7, 0xef, 0xb0, 0x7c, 0x38, 0xff, 0xb3,
+        0xa1, 0x23, 0xab, 0x4b, 0x87, 0x60, 0xf8, 0xaf, 0x89, 0xb9, 0xf0, 0x21,
+        0x17, 0xf1, 0xd8, 0x11, 0xb8, 0x88, 0x42, 0x9f, 0x12, 0x44, 0x4a, 0x20,
+        0x25, 0xf9, 0xc3, 0xd7, 0x2b, 0xb7, 0x39, 0x5d, 0xa1, 0xa9, 0xdc, 0xe3,
+        0x15, 0x87, 0xc6, 0xd1, 0x3c, 0x24, 0x13, 0x63, 0x32, 0x9b, 0x81, 0x17,
+        0x97, 0x35, 0x5e, 0xbd, 0xe8, 0xca, 0x36, 0x57, 0x5b, 0xa0, 0x2a, 0x7f,
+        0x13, 0x35, 0x1c, 0x80, 0x4f, 0x92, 0xcf, 0x85, 0xd4, 0xf4, 0xb5, 0x5e,
+        0xdc, 0xd5, 0xe2, 0x28, 0x08, 0xe1, 0xb4, 0xe7, 0x51, 0xb8, 0x6e, 0xec,
+        0x41, 0xe4, 0xe7, 0x03, 0xf2, 0x01, 0x0b, 0xae, 0x35, 0x32, 0x6e, 0x35,
+        0x87, 0xeb, 0xfb, 0x2f, 0x44, 0x4a, 0xb6, 0x0c, 0xb3, 0x0c, 0x4f, 0xef,
+        0x18, 0xb4, 0x6d, 0x76, 0x0f, 0x2a, 0x38, 0xae, 0xff, 0x07, 0x09, 0xa5,
+        0xd3, 0x7d, 0x73, 0xe3, 0x60, 0x80, 0xf0, 0x6b, 0x6a, 0x56, 0x0a, 0x23,
+        0x34, 0x38, 0xef, 0x8c, 0xc8, 0x58, 0xe3, 0x82, 0x63, 0xe1, 0x55, 0x32,
+        0x36, 0xeb, 0xbb, 0x5a, 0x51, 0x4a, 0xdb, 0x3e, 0xc2, 0x6d, 0x6c, 0x5e,
+        0xf7, 0x71, 0x82, 0xe3, 0xb3, 0x3a, 0xb1, 0x21, 0x5b, 0xe7, 0xe2, 0x8f,
+        0xa5, 0x4e, 0x14, 0x21, 0xfa, 0x8c, 0x26, 0x46, 0x4e, 0x04, 0x98, 0xc0,
+        0xd7, 0x64, 0x76, 0x6f, 0x5b, 0x87, 0x7f, 0x5c, 0xe6, 0xb4, 0x41, 0xca,
+        0x1c, 0xbc, 0x24, 0x04, 0xe6, 0xe1, 0xd7, 0xc7, 0x1f, 0xa9, 0x0f, 0x9c,
+        0x44, 0xee, 0x5d, 0xa8, 0x93, 0xed, 0x4d, 0xf5, 0x01, 0x92, 0x78, 0xe1,
+        0xd0, 0xec, 0xb9, 0x5c, 0x47, 0x73, 0x2d, 0xda, 0x05, 0x05, 0x70, 0xdb,
+        0x60, 0x96, 0x1d, 0x3c, 0xb8, 0x2f, 0x86, 0x81, 0x8f, 0x84, 0x61, 0x3b,
+        0xce, 0x19, 0x6e, 0xc3, 0x51, 0x31, 0x1f, 0x49, 0x2a, 0x64, 0x88, 0x9c,
+        0x79, 0xc8, 0xcb, 0x2b, 0x95, 0x4f, 0xd1, 0x82, 0x37, 0x12, 0xbe, 0xb8,
+        0x0f, 0x84, 0xb5, 0x71, 0xef, 0xfa, 0xf2, 0xcf, 0x12, 0x3a, 0x74, 0x71,
+        0x20, 0xc5, 0x41, 0xa8, 0xd1, 0xc4, 0x18, 0x07, 0x5c, 0x86, 0xe1, 0xf1,
+        0xef, 0x4f, 0x9f, 0x09, 0x7e, 0x29, 0x0a, 0x96, 0x68, 0x38, 0x98, 0xda,
+        0xd4, 0x33, 0x51, 0xa4, 0x29, 0x72, 0x2e, 0x68, 0x87, 0x0e, 0x23, 0xae,
+        0x58, 0xa3, 0xd0, 0xb1, 0x03, 0x5d, 0xc2, 0x76, 0x91, 0x5a, 0x97, 0x83,
+        0x6b, 0xde, 0x82, 0x54, 0xbc, 0xfa, 0x23, 0xe4, 0xff, 0xfd, 0x67, 0x97,
+        0xf7, 0xe5, 0x7f, 0xe3, 0xca, 0x5d, 0xe0, 0x62, 0xe7, 0x73, 0x5f, 0x4a,
+        0xc8, 0xf5, 0xba, 0x54, 0x0b, 0x37, 0x8a, 0x57, 0xaa, 0x6c, 0xe0, 0x9a,
+        0x22, 0x9f, 0x4f, 0x6c, 0xbb, 0x37, 0x61, 0xef, 0x64, 0x08, 0x30, 0x98,
+        0x20, 0x6d, 0x56, 0x9c, 0xb8, 0x2b, 0x61, 0xaa, 0xab, 0x4f, 0x30, 0xd3,
+        0xf7, 0x03, 0x47, 0x5b, 0x3b, 0x64, 0x64, 0x2e, 0xd9, 0x4f, 0x33, 0x15,
+        0x9c, 0x4c, 0xbd, 0x98, 0xdf, 0xa8, 0xc0, 0x7e, 0x9e, 0x60, 0xe0, 0x5b,
+        0x45, 0x1a, 0xbc, 0x94, 0x65, 0xce, 0xa6, 0x78, 0xa9, 0xae, 0x63, 0xe3,
+        0x3c, 0x31, 0x57, 0x45, 0xca, 0xfc, 0xf8, 0x61, 0xdd, 0x59, 0x63, 0xab,
+        0xba, 0xb0, 0xc1, 0x9a, 0x14, 0x13, 0x56, 0xc9, 0xee, 0x11, 0x72, 0x11,
+        0xe5, 0xd3, 0xea, 0xc4, 0x0d, 0xbf, 0xe6, 0x15, 0x50, 0xb4, 0xe7, 0x65,
+        0xb1, 0x24, 0x3a, 0xca, 0xce, 0x33, 0x8d, 0xf1, 0x3b, 0x9d, 0x1a, 0x95,
+        0x5a, 0x09, 0x98, 0x81, 0x9d, 0x19, 0x5a, 0x86, 0xe7, 0xb7, 0x49, 0x36,
+        0x7e, 0x88, 0xa0, 0xfc, 0x81, 0x1a, 0x3d, 0x8d, 0x9b, 0x7b, 0xa7, 0x88,
+        0xeb, 0xea, 0x71, 0x88, 0xb7, 0x19, 0x52, 0x08, 0xd5, 0x2a, 0x31, 0x66,
+        0x35, 0x10, 0xd7, 0x86, 0x51, 0xea, 0xa9, 0xd8, 0xbb, 0x74, 0xce, 0x4a,
+        0x4e, 0xe1, 0xa0, 0x8a, 0x51, 0xd0, 0x99, 0x64, 0x9b, 0xe5, 0xf8, 0x5f,
+        0xd2, 0xd1, 0x8b, 0xe5, 0x93, 0x8f, 0x4c, 0x22, 0x1d, 0x56, 0x57, 0xba,
+        0x32, 0x82, 0xf4, 0xa5, 0x7a, 0x16, 0xba, 0x89, 0xbc, 0x34, 0x74, 0x55,
+        0x2a, 0x2f, 0x51, 0xc6, 0xc3, 0x6e, 0x29, 0x44, 0xde, 0x4d, 0x76, 0x1a,
+        0x0f, 0x3e, 0x59, 0xf6, 0x1c, 0xf3, 0x0e, 0xa2, 0x40, 0xf3, 0x2b, 0xf7,
+        0xef, 0xa2, 0x24, 0xb2, 0xac, 0x81, 0x01, 0x46, 0x8b, 0x51, 0x3c, 0x6d,
+        0xb9, 0x08, 0x6c, 0x1f, 0x70, 0x56, 0x83, 0x45, 0x5f, 0x29, 0x41, 0x66,
+        0x3e, 0x5f, 0xe2, 0xea, 0x91, 0xd4, 0xbf, 0xf9, 0x93, 0x6a, 0xe2, 0x04,
+        0xd0, 0x54, 0x66, 0xc7, 0x91, 0x2d, 0x76, 0x92, 0x3b, 0x98, 0xda, 0x69,
+        0xa4, 0x6c, 0xfc, 0x0e, 0x86, 0x02, 0xf6, 0xfb, 0x4e, 0xfa, 0x0b, 0x0c,
+        0x4e, 0xd3, 0x32, 0x2d, 0x09, 0xb6, 0x6f, 0x15, 0x84, 0xfe, 0x1a, 0xdb,
+        0x3f, 0x68, 0xe2, 0x6f, 0xea, 0x18, 0xa5, 0x4b, 0xde, 0xdc, 0x37, 0x62,
+        0x6a, 0xb5, 0x50, 0x97, 0x13, 0x30, 0x4f, 0xa3, 0xb3, 0x6a, 0xf2, 0x77,
+        0xc7, 0xbe, 0x49, 0xd0, 0x44, 0xa2, 0x78, 0x73, 0x45, 0x2c, 0x92, 0x96,
+        0xab, 0x89, 0x0d, 0xe2, 0x55, 0x03, 0xcb, 0xae, 0xac, 0x65, 0x01, 0x4f,
+        0x10, 0xc8, 0xda, 0x4d, 0xf5, 0xe2, 0x51, 0xdc, 0xb7, 0x14, 0x48, 0xd1,
+        0xb1, 0xa0, 0xf9, 0x1a, 0x94, 0x16, 0x97, 0x55, 0x1e, 0xf4, 0x7d, 0x6d,
+        0xfe, 0x8c, 0xb6, 0xe9, 0x11, 0x77, 0xc5, 0x21, 0x7a, 0xb1, 0x5d, 0xbd,
+        0xd3, 0x3b, 0xb7, 0x58, 0xc5, 0x87, 0x6d, 0x1f, 0x56, 0xb3, 0xfc, 0x26,
+        0x9e, 0x8a, 0xea, 0xb7, 0x4c, 0x43, 0x77, 0x75, 0x6b, 0x15, 0x3b, 0xff,
+        0x4a, 0x51, 0xce, 0xaf, 0x54, 0x5f, 0x3f, 0xfe, 0x16, 0xc0, 0x1e, 0x9a,
+        0x2b, 0x0b, 0x12, 0xe4, 0xfc, 0xc6, 0x48, 0x7b, 0x46, 0xf3, 0xfe, 0xb4,
+        0xdf, 0x80, 0x60, 0x74, 0xb4, 0x24, 0xdf, 0xa1, 0x7e, 0xd3, 0x0e, 0x9b,
+        0xb4, 0x6d, 0xe3, 0x96, 0xd0, 0x75, 0x88, 0xca, 0x83, 0x7e, 0x9f, 0xef,
+        0x50, 0x1e, 0x46, 0x4f, 0xc4, 0xe6, 0x55, 0x8b, 0x61, 0x0c, 0xf1, 0xe5,
+        0xcf, 0xa9, 0xf7, 0xdd, 0x2b, 0x16, 0xef, 0x7a, 0x2f, 0xfe, 0xdc, 0xe3,
+        0xa4, 0x87, 0xcc, 0x95, 0x1d, 0x1f, 0x18, 0xff, 0x74, 0x2f, 0xa6, 0xbe,
+        0x83, 0x02, 0x24, 0xbd, 0xdb, 0x49, 0x11, 0xc4, 0x6f, 0xe5, 0x40, 0x86,
+        0x98, 0x06, 0xd7, 0x60, 0x7a, 0x41, 0x41, 0xd8, 0x94, 0x29, 0x5e, 0x25,
+        0x5d, 0x4b, 0x79, 0x67, 0x4e, 0x28, 0x75, 0x8a, 0x8b, 0x61, 0xe2, 0x27,
+        0x79, 0x0a, 0x24, 0x04, 0x41, 0xca, 0x7a, 0x09, 0xc9, 0xe6, 0xa9, 0x49,
+        0x51, 0x00, 0x02, 0x9e, 0x93, 0xd4, 0xde, 0x4f, 0x5e, 0xea, 0xb8, 0xc7,
+        0x2c, 0x10, 0x37, 0xdf, 0xa4, 0x6a, 0x60, 0x11, 0x0b, 0x6d, 0x05, 0x28,
+        0xd6, 0x75, 0x4c, 0x18, 0x20, 0xe8, 0x28, 0x9e, 0xd2, 0x5b, 0xb2, 0x81,
+        0xb0, 0x12, 0x35, 0x3b, 0xf2, 0x9a, 0xf2, 0x48, 0x00, 0x65, 0x7b, 0x2b
+};
+
+static const unsigned char quic_v1_split_0[] = {
+        0xcb, 0x00, 0x00, 0x00, 0x01, 0x08, 0x83, 0x94, 0xc8, 0xf0, 0x3e, 0x51,
+        0x57, 0x08, 0x04, 0xc2, 0xb1, 0xa1, 0xf3, 0x00, 0x44, 0x9a, 0xe6, 0xb7,
+        0x09, 0xd2, 0x6c, 0x7e, 0xe7, 0xfe, 0x7f, 0xed, 0x4d, 0x7a, 0x38, 0x23,
+        0xbf, 0xec, 0x5f, 0xee, 0x51, 0xf9, 0x62, 0x41, 0xc1, 0xfb, 0x36, 0x4d,
+        0xbf, 0x0c, 0xad, 0xae, 0x57, 0xcd, 0x58, 0xbc, 0x03, 0xde, 0x68, 0xad,
+        0x5f, 0x3b, 0xaa, 0x5e, 0x98, 0xd3, 0xf8, 0xa3, 0xe7, 0xdc, 0x5c, 0xbd,
+        0xaf, 0x3b, 0xb8, 0xcf, 0x2d, 0xd9, 0xa7, 0x86, 0x69, 0xe0, 0xbb, 0xf6,
+        0xa5, 0x35, 0xe4, 0x44, 0xbd, 0xc3, 0x39, 0xa9, 0x81, 0x4d, 0xca, 0x23,
+        0x48, 0xee, 0x98, 0x17, 0x44, 0x0f, 0xfa, 0x81, 0xbd, 0x57, 0x3c, 0xfe,
+        0x37, 0xca, 0xec, 0x1c, 0x76, 0x80, 0xeb, 0xb0, 0x24, 0x3b, 0x50, 0x42,
+        0x5e, 0x01, 0xbd, 0x84, 0x2c, 0xe2, 0x88, 0xa3, 0xc0, 0xa4, 0xe1, 0x95,
+        0xbc, 0xfc, 0x94, 0x94, 0xba, 0x82, 0xc8, 0x75, 0x43, 0x30, 0x43, 0x78,
+        0xfa, 0xea, 0xbd, 0xc3, 0xba, 0xc7, 0x3b, 0xde, 0x6a, 0x68, 0x50, 0x9b,
+        0x7c, 0x8c, 0x1a, 0x45, 0xe8, 0xee, 0x1c, 0xd2, 0xc3, 0x37, 0x4d, 0xa5,
+        0x5d, 0x45, 0x15, 0x63, 0x09, 0x9e, 0xeb, 0x5f, 0x8e, 0xae, 0xb4, 0x34,
+        0x31, 0x58, 0x4e, 0x96, 0x56, 0x53, 0x5e, 0xbe, 0xa4, 0xac, 0xdd, 0x5d,
+        0x15, 0x2f, 0xa3, 0x71, 0xcd, 0x32, 0xef, 0x22, 0x2a, 0xa2, 0xa6, 0xcc,
+        0xc5, 0x06, 0x29, 0x85, 0xd3, 0x68, 0x6b, 0x82, 0xf0, 0x8a, 0x11, 0x84,
+        0x93, 0xc5, 0x60, 0xcd, 0xc5, 0x59, 0xf3, 0x3d, 0x75, 0x61, 0xd1, 0x97,
+        0x68, 0x6f, 0x95, 0x44, 0x4b, 0xf2, 0x61, 0x46, 0x09, 0xff, 0x0c, 0xa0,
+        0x06, 0x7a, 0xb0, 0x76, 0x55, 0x7b, 0x3d, 0x26, 0x86, 0x07, 0x83, 0x33,
+        0x67, 0xb1, 0x2d, 0xc2, 0xb2, 0xed, 0x25, 0xb9, 0x5a, 0xce, 0xca, 0x5a,
+        0x95, 0x49, 0x04, 0x44, 0xfc, 0xbd, 0x82, 0xf5, 0x4f, 0xa9, 0x00, 0xeb,
+        0xd9, 0xfe, 0x58, 0x7f, 0x2d, 0x17, 0x66, 0xa1, 0xe4, 0x08, 0x47, 0x47,
+        0x1f, 0x88, 0x91, 0xc4, 0x94, 0x60, 0xb1, 0x42, 0x4f, 0xfe, 0xf0, 0x83,
+        0x0f, 0xbc, 0x0a, 0x41, 0x5c, 0xf2, 0x86, 0xa5, 0x6a, 0xfd, 0xb5, 0x25,
+        0xc6, 0x19, 0xf9, 0x2a, 0x04, 0xd9, 0x59, 0x24, 0xb5, 0x9b, 0x8f, 0x01,
+        0xaa, 0xd2, 0x08, 0x91, 0x3c, 0xf7, 0x10, 0xe7, 0xf7, 0xf0, 0xfb, 0x92,
+        0xe6, 0x22, 0x0f, 0xd8, 0xca, 0x05, 0xf6, 0xcd, 0xf8, 0xf2, 0x5b, 0x89,
+        0x5b, 0x5e, 0xae, 0xc7, 0x61, 0x53, 0xd9, 0x36, 0xf0, 0xee, 0x06, 0x7d,
+        0x14, 0x45, 0xd7, 0x6f, 0xae, 0x06, 0x9e, 0x91, 0x48, 0x68, 0x4a, 0x3b,
+        0xdc, 0x84, 0xc9, 0xf0, 0xc4, 0xda, 0x82, 0x27, 0xbe, 0xaf, 0x27, 0xec,
+        0xda, 0x92, 0xa8, 0xb8, 0xd3, 0xec, 0x12, 0xc3, 0x34, 0x21, 0x94, 0x86,
+        0x4d, 0x9c, 0xfe, 0x42, 0x17, 0x60, 0xe0, 0xed, 0xe6, 0x34, 0x4c, 0xf1,
+        0x0b, 0xfb, 0x69, 0x71, 0x6c, 0x96, 0x53, 0xaa, 0x02, 0x8e, 0xa1, 0x6d,
+        0xfc, 0xd3, 0x91, 0x74, 0xa4, 0x7d, 0x39, 0xeb, 0x4c, 0xf1, 0x45, 0x22,
+        0xaa, 0xa9, 0xf9, 0x37, 0x86, 0xe2, 0x68, 0xdc, 0xff, 0x13, 0xf7, 0x80,
+        0x53, 0x0d, 0x9b, 0x55, 0x95, 0x54, 0x02, 0xdb, 0x1d, 0x9f, 0xf9, 0x82,
+        0x42, 0x98, 0x0a, 0x51, 0x70, 0xf5, 0xb7, 0xb5, 0x2b, 0x19, 0x9e, 0xf6,
+        0x02, 0xb6, 0x9b, 0xd0, 0x77, 0x9c, 0xc1, 0x00, 0x48, 0x9a, 0xe9, 0x29,
+        0x90, 0x04, 0x5b, 0xae, 0xa0, 0xc6, 0xaa, 0x17, 0xd0, 0x24, 0x9a, 0x28,
+        0x32, 0x52, 0x66, 0x99, 0x39, 0x0a, 0xb3, 0xf3, 0xaf, 0x42, 0x43, 0xbe,
+        0x8e, 0x03, 0x55, 0x7e, 0x3c, 0x67, 0x44, 0x3a, 0x8f, 0xfd, 0x2f, 0x3b,
+        0xfb, 0xe9, 0x6b, 0xd1, 0xa8, 0xc2, 0x76, 0xc2, 0xe8, 0x5b, 0x96, 0x38,
+        0xb5, 0x6d, 0x4b, 0xe2, 0x19, 0x04, 0x46, 0x0a, 0x19, 0xff, 0x06, 0x96,
+        0xcf, 0x88, 0x74, 0xfb, 0x3f, 0x3a, 0x08, 0xdf, 0x8a, 0x3a, 0x5a, 0xfc,
+        0x26, 0xa5, 0x0c, 0x0c, 0x98, 0x32, 0x59, 0x1b, 0x0f, 0xe2, 0x09, 0xbe,
+        0x62, 0x89, 0xb3, 0x0d, 0xac, 0x81, 0xce, 0xcb, 0x34, 0x18, 0x2c, 0xf3,
+        0xae, 0xff, 0x93, 0xe6, 0x91, 0x83, 0x88, 0xbe, 0xb0, 0x95, 0xe4, 0xf5,
+        0xa4, 0xda, 0x84, 0x7e, 0x91, 0x17, 0x58, 0xb6, 0x9b, 0xcb, 0xad, 0x97,
+        0x78, 0xd6, 0xa3, 0x08, 0x27, 0xd7, 0xe4, 0xb9, 0x17, 0xf5, 0xb7, 0xc4,
+        0x0c, 0x2b, 0xe0, 0xf9, 0x81, 0x78, 0x76, 0x3f, 0x6a, 0xa0, 0xf8, 0xdb,
+        0x6a, 0x9d, 0x6d, 0xf1, 0x3c, 0xa6, 0x2d, 0x45, 0x71, 0xbb, 0xe3, 0xa7,
+        0xc7, 0x51, 0xe6, 0xb1, 0x93, 0xbf, 0x44, 0xfc, 0xb6, 0xc1, 0xe7, 0xd7,
+        0xf7, 0x48, 0x02, 0x3c, 0xd8, 0x1b, 0xcb, 0xfa, 0x48, 0x46, 0xd4, 0xce,
+        0x85, 0x93, 0x6d, 0x04, 0x60, 0x4a, 0xbc, 0xd0, 0x4e, 0xea, 0xb2, 0xf0,
+        0x4d, 0x93, 0x3b, 0xf0, 0x3a, 0xe3, 0x3a, 0xf0, 0x14, 0x7e, 0x0b, 0x32,
+        0x0d, 0xb0, 0xc7, 0x37, 0x69, 0x3c, 0x33, 0x43, 0xa7, 0xa0, 0x3e, 0x54,
+        0x0a, 0x60, 0x6e, 0x1b, 0xd0, 0x93, 0x2d, 0x4e, 0xeb, 0xc7, 0x18, 0x81,
+        0xe9, 0xa2, 0xc7, 0x6e, 0xbc, 0x89, 0xaf, 0xdf, 0xb6, 0x15, 0x41, 0x1f,
+        0x69, 0xdd, 0x30, 0x68, 0x10, 0x6d, 0xcc, 0x47, 0xe1, 0xbf, 0x48, 0xff,
+        0xbe, 0xd2, 0xff, 0xb4, 0x8a, 0xcf, 0x09, 0x83, 0x34, 0x96, 0x37, 0xce,
+        0xa7, 0x4b, 0x9c, 0xd4, 0x85, 0xe4, 0x28, 0xbe, 0x64, 0x60, 0x26, 0xa7,
+        0x38, 0x35, 0xee, 0xa7, 0xfa, 0x8c, 0xf2, 0x42, 0x9c, 0xb2, 0x34, 0x4b,
+        0x8d, 0xe3, 0xc3, 0x91, 0xd4, 0xce, 0xfc, 0x6f, 0x2a, 0x30, 0xc8, 0x59,
+        0xf8, 0xfc, 0x21, 0xd0, 0x8a, 0x22, 0xc5, 0xc9, 0x53, 0xe1, 0xa8, 0x68,
+        0xcb, 0xef, 0xa1, 0x91, 0x38, 0x45, 0x7f, 0xe7, 0x80, 0xa4, 0xff, 0x40,
+        0x0d, 0xfb, 0x26, 0x34, 0xb0, 0x35, 0x3e, 0xb7, 0xf4, 0x55, 0xd7, 0xf5,
+        0x94, 0x17, 0x68, 0x47, 0x65, 0x09, 0xd3, 0x2d, 0x5e, 0x8e, 0xb8, 0x88,
+        0xb6, 0x4a, 0x21, 0x83, 0x3a, 0x8b, 0x19, 0xc5, 0x19, 0xfb, 0x00, 0x36,
+        0xfd, 0xc6, 0x0c, 0xfd, 0x0c, 0xd2, 0x7b, 0xa5, 0x25, 0xa4, 0x1c, 0xd2,
+        0x28, 0xab, 0x25, 0xab, 0x8a, 0x24, 0x28, 0xd7, 0xd4, 0xb6, 0x89, 0xe9,
+        0x1d, 0xcb, 0x16, 0x6e, 0x57, 0x41, 0xff, 0x40, 0x95, 0x1d, 0x72, 0xc1,
+        0x06, 0xf0, 0x49, 0x09, 0x1e, 0x8a, 0x1b, 0x83, 0x4d, 0xc4, 0xc8, 0xc9,
+        0xf1, 0x4f, 0xad, 0x3d, 0xac, 0xb5, 0x3f, 0x92, 0x7e, 0x6c, 0xa5, 0xb6,
+        0x24, 0x5e, 0x5a, 0x6d, 0x71, 0x1d, 0x6c, 0xd9, 0xba, 0x57, 0xcf, 0x6b,
+        0x40, 0x20, 0xf0, 0xa5, 0x88, 0x89, 0x55, 0xc2, 0xf1, 0xa3, 0x58, 0x08,
+        0x01, 0x0f, 0x91, 0x55, 0xd8, 0xe9, 0xcc, 0xe2, 0xdf, 0xec, 0x3a, 0x2c,
+        0x77, 0x35, 0xf6, 0x4c, 0xf2, 0xfa, 0x0a, 0xc9, 0x34, 0xd1, 0xa3, 0xe0,
+        0xdd, 0x35, 0x6d, 0xa2, 0xce, 0xa6, 0xe0, 0x7e, 0x9c, 0x0d, 0xd7, 0x76,
+        0x03, 0x10, 0xaa, 0x76, 0x8e, 0xc9, 0xc4, 0xdf, 0xba, 0xeb, 0x58, 0x53,
+        0x49, 0xd0, 0xe8, 0xca, 0xe6, 0x50, 0x76, 0xb6, 0x7c, 0xb4, 0xd5, 0x5e,
+        0x51, 0x71, 0x0f, 0x11, 0xed, 0x52, 0xa7, 0x12, 0xbe, 0xc9, 0x74, 0x3d,
+        0x1a, 0x82, 0x4e, 0xc3, 0xfe, 0x11, 0x90, 0x76, 0x2b, 0x9d, 0xbb, 0xc4,
+        0xb8, 0xf5, 0x0e, 0xcd, 0x10, 0xcc, 0x74, 0x0b, 0x6b, 0xcc, 0x5f, 0x61,
+        0x46, 0x06, 0xd0, 0x49, 0x36, 0x5e, 0xb6, 0xf4, 0x13, 0x40, 0xc3, 0x2c,
+        0xe1, 0x9b, 0x64, 0x0a, 0x25, 0xdd, 0xe4, 0x50, 0xcd, 0x3b, 0xee, 0x89,
+        0x1d, 0xa2, 0xeb, 0xc4, 0xe2, 0xd3, 0x60, 0x77, 0x0b, 0x28, 0x82, 0x58,
+        0x67, 0x00, 0x85, 0xd5, 0x64, 0x79, 0x83, 0x8e, 0x8d, 0x4c, 0x57, 0x4c,
+        0x8e, 0xe9, 0x37, 0x73, 0xf2, 0xd2, 0x06, 0x19, 0x5c, 0xa3, 0x3a, 0x87,
+        0xfe, 0xe7, 0xb9, 0xf6, 0xf4, 0x65, 0xe9, 0xfe, 0x0f, 0xd5, 0xc4, 0x96,
+        0xc7, 0x5c, 0x1c, 0xda, 0xda, 0x86, 0x74, 0xa0, 0xc1, 0xaf, 0xe8, 0xdc,
+        0x05, 0x9b, 0xeb, 0x7a, 0xf7, 0x21, 0x30, 0x81, 0x11, 0xc7, 0x73, 0x9a,
+        0x63, 0xeb, 0xc8, 0x7f, 0x60, 0xb9, 0x11, 0xff, 0x11, 0xf0, 0x04, 0x1e,
+        0xd6, 0xd4, 0x8e, 0xac, 0x76, 0xa0, 0xcc, 0xa1, 0xfa, 0x23, 0x87, 0x60,
+        0x8e, 0xdb, 0x5a, 0x25, 0x34, 0xe6, 0x9b, 0xc2, 0x8b, 0xc7, 0xc7, 0x6b,
+        0x33, 0x2b, 0x54, 0x82, 0xb5, 0xfd, 0x11, 0xf4, 0xc2, 0x4b, 0xe2, 0xe7,
+        0xe0, 0xff, 0xe0, 0x6a, 0xd4, 0x57, 0xe5, 0x48, 0x5c, 0xb7, 0xa5, 0x1a,
+        0xd6, 0xed, 0xce, 0xf2, 0x07, 0x8a, 0x45, 0x25, 0xcf, 0xc7, 0x75, 0x29,
+        0x26, 0x1b, 0xc8, 0x78, 0xb6, 0xfe, 0xd2, 0xd1, 0xac, 0x33, 0xd2, 0x8f
+};
+
+static const unsigned char quic_v1_split_1[] = {
+        0xc8, 0x00, 0x00, 0x00, 0x01, 0x08, 0x83, 0x94, 0xc8, 0xf0, 0x3e, 0x51,
+        0x57, 0x08, 0x04, 0xc2, 0xb1, 0xa1, 0xf3, 0x00, 0x44, 0x9a, 0xe7, 0xd8,
+        0x34, 0x9b, 0x46, 0xb4, 0x55, 0x96, 0x9b, 0x7c, 0xa5, 0xe7, 0xc0, 0xa5,
+        0x11, 0x92, 0xeb, 0xb4, 0x24, 0x5e, 0xa2, 0x31, 0x5f, 0xd3, 0xe2, 0x49,
+        0x95, 0x9c, 0x35, 0xb9, 0x75, 0x64, 0x37, 0xef, 0x13, 0xf1, 0x9f, 0x8b,
+        0x6a, 0xc0, 0xc9, 0x3f, 0xa8, 0xa7, 0x2e, 0x57, 0x07, 0x37, 0xed, 0xe4,
+        0x29, 0xd2, 0x30, 0x55, 0xa7, 0xbc, 0x66, 0x48, 0xbc, 0x52, 0xe3, 0x4c,
+        0xeb, 0x40, 0x4f, 0x35, 0xae, 0xe1, 0x0d, 0xc1, 0xf0, 0x2f, 0xbc, 0x3c,
+        0xf8, 0xde, 0x4f, 0x24, 0x1b, 0x7c, 0xfe, 0x2f, 0xbc, 0x52, 0xaf, 0xa7,
+        0x33, 0x2e, 0xb1, 0x3c, 0xb8, 0x90, 0x4e, 0xd7, 0xf0, 0x88, 0x88, 0x6c,
+        0xac, 0xc2, 0xa6, 0x22, 0x0d, 0x3a, 0x4f, 0xd8, 0x76, 0x22, 0xa3, 0x9c,
+        0x63, 0x10, 0x35, 0x23, 0x33, 0xf0, 0x6a, 0xed, 0x25, 0xc7, 0x95, 0x9f,
+        0x4b, 0xc3, 0x96, 0x4a, 0xdc, 0x08, 0x86, 0x46, 0x1c, 0x73, 0x87, 0x6a,
+        0x85, 0x8b, 0x1a, 0xfa, 0x18, 0x39, 0x38, 0x26, 0x56, 0x42, 0x36, 0xd1,
+        0xa7, 0xc6, 0x2e, 0x7a, 0xe2, 0xb1, 0x10, 0x9e, 0x42, 0x78, 0x12, 0xf4,
+        0x40, 0x2a, 0x0d, 0x84, 0x9b, 0x07, 0x54, 0xcf, 0x6b, 0x3a, 0x4e, 0x75,
+        0x5a, 0xd2, 0xcf, 0xd3, 0x74, 0x11, 0x1e, 0x1a, 0x2e, 0x79, 0x7a, 0x9c,
+        0xc1, 0x09, 0xad, 0x95, 0x56, 0x9a, 0x77, 0x28, 0x3d, 0x47, 0x6e, 0xca,
+        0x12, 0x97, 0x09, 0xee, 0x73, 0x2c, 0x6f, 0xd7, 0x6a, 0x76, 0x2a, 0xd0,
+        0x23, 0x1c, 0x2c, 0x68, 0xf6, 0x0e, 0xbf, 0x53, 0x90, 0x5d, 0xfa, 0x45,
+        0x6d, 0xc1, 0xfd, 0xca, 0x5f, 0x14, 0x9c, 0x86, 0xaf, 0xb7, 0x12, 0x42,
+        0x92, 0xb6, 0x8b, 0x00, 0xe3, 0xc3, 0x39, 0x38, 0x20, 0x28, 0x54, 0xf5,
+        0x5e, 0xad, 0xf9, 0xac, 0x9b, 0x68, 0x5b, 0x2f, 0xae, 0x74, 0x19, 0xab,
+        0x9d, 0xe2, 0xd5, 0x0c, 0xea, 0xab, 0x5f, 0x3c, 0x83, 0xe8, 0x7f, 0xed,
+        0x63, 0xb1, 0x8a, 0x50, 0x00, 0xbc, 0x7f, 0x7a, 0x4c, 0x8e, 0x46, 0xbe,
+        0x68, 0x06, 0x49, 0x5d, 0xf8, 0xb5, 0xf4, 0x95, 0x17, 0x98, 0x0c, 0x6d,
+        0xbb, 0xdb, 0x39, 0x53, 0xdd, 0x61, 0x7e, 0x8e, 0xdb, 0x75, 0x85, 0x5c,
+        0xbc, 0x30, 0x97, 0x61, 0x5d, 0x73, 0xc3, 0x6b, 0x25, 0x78, 0x63, 0x49,
+        0xde, 0x29, 0x97, 0x77, 0x89, 0x4b, 0xd2, 0xe7, 0xd9, 0xfa, 0xb0, 0xc9,
+        0xff, 0xf3, 0x55, 0x68, 0xa1, 0xdb, 0x08, 0x83, 0x34, 0x61, 0xdf, 0x80,
+        0x3e, 0x51, 0x4f, 0x02, 0xb8, 0x9f, 0xfb, 0x05, 0xb4, 0x48, 0xe4, 0xa4,
+        0xbb, 0xa9, 0x5e, 0x73, 0xb2, 0x5c, 0xc2, 0x3b, 0x5e, 0x66, 0x35, 0xd3,
+        0x87, 0xc0, 0xc0, 0x02, 0x68, 0x56, 0x67, 0xf0, 0xfc, 0xf0, 0xe3, 0xfd,
+        0xba, 0x28, 0x23, 0xff, 0x0b, 0x08, 0xf4, 0xc9, 0xc7, 0x3c, 0x34, 0x5d,
+        0x4d, 0x46, 0x49, 0x27, 0x47, 0x0d, 0xca, 0x55, 0x17, 0xf9, 0xb3, 0xe4,
+        0x54, 0x79, 0xac, 0x74, 0x77, 0x6d, 0x4e, 0xac, 0xa9, 0xb1, 0xf9, 0xe3,
+        0x14, 0x42, 0x75, 0x3b, 0xac, 0x1b, 0x1a, 0xa9, 0x11, 0x0a, 0x00, 0x59,
+        0xd4, 0x53, 0x1b, 0xec, 0x93, 0xfb, 0xff, 0x9e, 0x81, 0xa7, 0xca, 0xda,
+        0x7a, 0x1a, 0x87, 0xc0, 0xc5, 0x52, 0x9a, 0x81, 0xe7, 0xb2, 0x88, 0x2b,
+        0x43, 0x4a, 0x20, 0x4b, 0x18, 0x04, 0x7c, 0xfa, 0xec, 0xdb, 0xe0, 0x78,
+        0xf1, 0x7b, 0xd8, 0x7f, 0x22, 0xcc, 0x99, 0xd6, 0x87, 0x3b, 0x4c, 0x51,
+        0xa7, 0xbf, 0xed, 0xc1, 0xc3, 0x21, 0x80, 0xe0, 0xb4, 0xe3, 0x70, 0x16,
+        0x7a, 0x6c, 0x93, 0xcc, 0xcc, 0x39, 0x98, 0x5d, 0xe7, 0x77, 0xdc, 0x18,
+        0x5b, 0x3e, 0xef, 0x8b, 0x5d, 0x74, 0x7e, 0x82, 0xda, 0x76, 0xdf, 0xaa,
+        0x52, 0x21, 0x8f, 0xa9, 0xe5, 0x5e, 0x04, 0xbc, 0x15, 0x1f, 0xda, 0x06,
+        0x27, 0x01, 0xaa, 0x37, 0x12, 0xc2, 0x33, 0x24, 0x1d, 0xbc, 0x35, 0x6b,
+        0x84, 0xae, 0xf3, 0xa0, 0x22, 0x89, 0xbf, 0x10, 0x78, 0x5c, 0xfa, 0x3d,
+        0xec, 0x7e, 0xa7, 0x64, 0xcc, 0xb4, 0xca, 0xf3, 0x8b, 0x47, 0x84, 0x27,
+        0x49, 0xec, 0xd4, 0xce, 0xd8, 0x71, 0x88, 0x79, 0xa3, 0x7e, 0xe1, 0x33,
+        0x83, 0x25, 0x97, 0x67, 0xc3, 0x92, 0xaa, 0x71, 0x97, 0x99, 0xe5, 0xb0,
+        0x4d, 0xeb, 0x13, 0xd0, 0x5d, 0x3b, 0xd6, 0x19, 0xbb, 0x7c, 0xd3, 0xa4,
+        0x3b, 0xb9, 0xff, 0xf0, 0xdd, 0x00, 0xf5, 0xf0, 0x86, 0xbe, 0x59, 0x08,
+        0xa6, 0x17, 0x71, 0x53, 0xa4, 0xb1, 0xa1, 0xfc, 0x4e, 0x4b, 0xcf, 0x29,
+        0x80, 0x64, 0xec, 0xd8, 0x27, 0x59, 0x8e, 0xea, 0x69, 0xf7, 0x23, 0xba,
+        0x68, 0x70, 0x43, 0x41, 0xf5, 0x14, 0x3c, 0x7b, 0xb4, 0xca, 0xe9, 0x24,
+        0xf6, 0xac, 0x96, 0xe3, 0x86, 0x95, 0x2a, 0xdc, 0x1a, 0xa9, 0x6d, 0x2f,
+        0x07, 0x9a, 0xd9, 0xec, 0x3e, 0x95, 0x0b, 0xc2, 0x71, 0xb8, 0x97, 0xa3,
+        0x3e, 0x5b, 0xeb, 0x8b, 0x41, 0xef, 0xd1, 0xc7, 0x0b, 0x26, 0xcd, 0xc8,
+        0x8c, 0xfd, 0x78, 0x65, 0x16, 0x98, 0x26, 0x5b, 0x46, 0x5b, 0x84, 0x65,
+        0xec, 0x53, 0x0e, 0x93, 0x72, 0xec, 0x6e, 0x48, 0x83, 0xc7, 0xdb, 0xaa,
+        0xc1, 0x25, 0xc8, 0x9c, 0x16, 0x9d, 0x01, 0xbc, 0x99, 0x84, 0x70, 0xdc,
+        0x4b, 0xdf, 0x2b, 0xae, 0xc2, 0xda, 0xf6, 0x0e, 0x9e, 0xa6, 0xd2, 0x53,
+        0xef, 0xe6, 0x4b, 0x89, 0xb0, 0x3f, 0x5b, 0x97, 0xc0, 0x04, 0x92, 0xb5,
+        0x24, 0xb1, 0x17, 0x3e, 0x3a, 0xae, 0x6b, 0x66, 0xf1, 0xf0, 0xa0, 0xdd,
+        0x53, 0x16, 0x28, 0x24, 0xe1, 0xc5, 0x00, 0xa0, 0x29, 0x33, 0xfe, 0x8e,
+        0x4a, 0x79, 0x48, 0x1b, 0x9b, 0xbb, 0x9d, 0xf9, 0x36, 0x66, 0x1b, 0x63,
+        0x28, 0xfe, 0x75, 0x69, 0x46, 0xe2, 0xff, 0xa5, 0xa4, 0x99, 0xb1, 0x7c,
+        0x4b, 0x55, 0x6d, 0x6b, 0x9d, 0xca, 0xeb, 0xb0, 0x1c, 0xaf, 0x25, 0x4a,
+        0xf4, 0x4d, 0x81, 0x43, 0x17, 0x3a, 0xb9, 0x22, 0x48, 0xd2, 0x36, 0x26,
+        0xe1, 0x0a, 0xbb, 0x2f, 0x6e, 0x9d, 0x10, 0x69, 0x69, 0xe8, 0xb3, 0x89,
+        0xa3, 0xa1, 0x24, 0xa6, 0x4b, 0x4b, 0x9e, 0xf5, 0x0b, 0x16, 0x44, 0xa4,
+        0x81, 0x3e, 0x2c, 0x81, 0x91, 0xd3, 0x95, 0x5e, 0xdd, 0xe7, 0x64, 0x4e,
+        0xe7, 0x35, 0x7d, 0x31, 0xe3, 0xfb, 0x2d, 0x95, 0x16, 0xb9, 0x6d, 0x83,
+        0xcf, 0x7c, 0x16, 0x84, 0x62, 0x41, 0x79, 0x5b, 0x76, 0xb7, 0x35, 0xab,
+        0x40, 0x8a, 0x70, 0x76, 0xca, 0xeb, 0x80, 0x53, 0xab, 0x47, 0xcf, 0x10,
+        0x2d, 0x66, 0x8b, 0xcd, 0x62, 0x9a, 0xe1, 0xee, 0xf4, 0x7a, 0x87, 0x54,
+        0x09, 0xc3, 0x12, 0x3c, 0xb6, 0x57, 0xc0, 0x5f, 0x52, 0xf4, 0x3c, 0x9d,
+        0xcb, 0x01, 0xf1, 0x6b, 0xd5, 0xaa, 0xc1, 0x7d, 0x2a, 0x8a, 0x87, 0x9b,
+        0x4f, 0xcb, 0xb5, 0x09, 0x5e, 0x5b, 0x27, 0x87, 0xf5, 0x64, 0xcb, 0x83,
+        0x21, 0xa5, 0x94, 0x3c, 0x89, 0x4d, 0x9a, 0x36, 0xc3, 0x7b, 0x72, 0x4b,
+        0xf7, 0x84, 0xae, 0x1c, 0xe3, 0x52, 0x93, 0x88, 0xac, 0x43, 0x73, 0xec,
+        0xfb, 0x17, 0xbd, 0xe5, 0x63, 0x49, 0x8c, 0xa3, 0xfa, 0x0a, 0x0f, 0xe8,
+        0x26, 0x9d, 0x8c, 0xc5, 0xd5, 0xc2, 0x03, 0xe5, 0x56, 0x27, 0x5e, 0xea,
+        0x5f, 0x2c, 0x6f, 0x23, 0x2f, 0x68, 0x0b, 0xf8, 0x96, 0xc0, 0xf4, 0xab,
+        0x2b, 0xce, 0xe2, 0xe1, 0xdf, 0x06, 0xbb, 0x88, 0x78, 0x3f, 0x80, 0x70,
+        0x48, 0x0d, 0x23, 0x72, 0x29, 0xa6, 0xd3, 0x34, 0x43, 0x43, 0xb1, 0xc6,
+        0x44, 0xe2, 0xdc, 0xae, 0x6d, 0x92, 0xf2, 0x06, 0xdf, 0x22, 0x9e, 0x4c,
+        0x88, 0xb7, 0xd8, 0xa8, 0x9d, 0x48, 0x89, 0xfa, 0xdb, 0xb6, 0x44, 0x45,
+        0x28, 0x1e, 0x2f, 0x18, 0x23, 0x4a, 0x64, 0xb8, 0xf6, 0x9e, 0x20, 0x84,
+        0xd1, 0x57, 0x69, 0x8f, 0x17, 0xf1, 0x54, 0x07, 0x68, 0xf8, 0xea, 0x29,
+        0xcf, 0x20, 0xec, 0x1e, 0xc0, 0x14, 0x44, 0x86, 0xf2, 0x07, 0x9d, 0x67,
+        0x06, 0xda, 0xd5, 0xec, 0x7b, 0x77, 0x85, 0xac, 0x12, 0x02, 0x6d, 0x8b,
+        0xad, 0xc9, 0x4a, 0x12, 0x37, 0xe7, 0x06, 0xce, 0x8c, 0x51, 0xc3, 0xae,
+        0xdf, 0x41, 0x22, 0x68, 0x05, 0x41, 0x70, 0x58, 0x16, 0xe1, 0x3e, 0xee,
+        0x77, 0xd0, 0xe3, 0x17, 0x68, 0x99, 0xe5, 0x61, 0x61, 0x8f, 0xcf, 0x38,
+        0xe2, 0xfe, 0x3b, 0x05, 0x3c, 0xa5, 0xfe, 0xb9, 0x7f, 0x0a, 0xa5, 0x46,
+        0x1d, 0x42, 0xa6, 0x22, 0x74, 0x67, 0xb9, 0x67, 0xd3, 0x0c, 0x2e, 0x89,
+        0x72, 0x63, 0x82, 0xed, 0x75, 0xf0, 0xa3, 0x81, 0xc2, 0x1f, 0x68, 0x5e,
+        0x6f, 0x7a, 0xf1, 0xe9, 0x45, 0x9c, 0x07, 0x0e, 0xa5, 0x87, 0xb0, 0x2d,
+        0x46, 0x7e, 0xeb, 0x21, 0xd6, 0x99, 0x32, 0x6f, 0xf5, 0x59, 0xab, 0xd3
+};
+
+static const unsigned char quic_v1_coalesced_0[] = {
+        0xc0, 0x00, 0x00, 0x00, 0x01, 0x08, 0x83, 0x94, 0xc8, 0xf0, 0x3e, 0x51,
+        0x57, 0x08, 0x04, 0xc2, 0xb1, 0xa1, 0xf3, 0x00, 0x40, 0xae, 0xfe, 0xf4,
+        0x48, 0x62, 0x46, 0xb4, 0x51, 0x4c, 0x9b, 0x7c, 0xa2, 0xdb, 0xc0, 0xa5,
+        0x09, 0xfc, 0x52, 0x63, 0x7c, 0x8f, 0xa0, 0x0d, 0xcf, 0x88, 0x72, 0x2a,
+        0xe6, 0x68, 0x9a, 0x41, 0x97, 0x62, 0x39, 0xb6, 0x3c, 0xa2, 0x2d, 0xba,
+        0xb3, 0xaf, 0x51, 0x64, 0xd8, 0x30, 0x85, 0xc8, 0x07, 0xf7, 0x79, 0xb0,
+        0x6e, 0x6a, 0x95, 0x80, 0x61, 0x08, 0x2c, 0xee, 0x9e, 0x0a, 0x1b, 0x27,
+        0xa0, 0xa5, 0x31, 0x67, 0xdc, 0xd7, 0xe6, 0xe5, 0x63, 0x87, 0xa7, 0x79,
+        0x1a, 0x6f, 0xbe, 0x46, 0x2d, 0x7c, 0xfe, 0x2f, 0xbc, 0x52, 0xaf, 0xa7,
+        0x33, 0x2e, 0xb1, 0x3c, 0xb8, 0x90, 0x4e, 0xd7, 0xf0, 0x88, 0x88, 0x6c,
+        0xac, 0xc2, 0xa6, 0x22, 0x0d, 0x3a, 0x4f, 0xd8, 0x76, 0x22, 0xa3, 0x9c,
+        0x63, 0x10, 0x35, 0x23, 0x33, 0xf0, 0x6a, 0xed, 0x25, 0xc0, 0x49, 0x9f,
+        0x4b, 0xc3, 0xd3, 0x4a, 0x91, 0x08, 0x86, 0x0d, 0x14, 0x33, 0x81, 0x7d,
+        0x98, 0x84, 0x5e, 0xf8, 0x10, 0x79, 0x3b, 0x7e, 0x46, 0x5c, 0x30, 0xc0,
+        0xab, 0xc0, 0x28, 0x7c, 0xa2, 0xff, 0x11, 0x92, 0x2f, 0x16, 0x3f, 0x96,
+        0x3b, 0x68, 0xaa, 0xb4, 0x58, 0xb2, 0x54, 0x97, 0x76, 0xf7, 0xdd, 0xcd,
+        0x0a, 0xbb, 0xf9, 0x85, 0xc9, 0x00, 0x00, 0x00, 0x01, 0x08, 0x83, 0x94,
+        0xc8, 0xf0, 0x3e, 0x51, 0x57, 0x08, 0x04, 0xc2, 0xb1, 0xa1, 0xf3, 0x00,
+        0x43, 0xd6, 0xb7, 0xef, 0xf9, 0xab, 0x6c, 0x7a, 0x3d, 0xfd, 0x6d, 0xe8,
+        0xb0, 0xe3, 0x95, 0xb8, 0xef, 0xd0, 0x5b, 0x12, 0x81, 0x0b, 0x00, 0x03,
+        0xe4, 0xa5, 0xd0, 0x83, 0x01, 0x7c, 0xed, 0x83, 0x0a, 0x34, 0x96, 0x2d,
+        0x61, 0x86, 0x4a, 0xf5, 0xa1, 0x83, 0x2e, 0x39, 0xc7, 0xeb, 0xe4, 0x10,
+        0x47, 0x58, 0x3e, 0xfa, 0x9c, 0x6a, 0x69, 0x7b, 0xa9, 0xbf, 0xfb, 0xb8,
+        0x73, 0x36, 0x5c, 0x76, 0xd3, 0x79, 0xb9, 0xcd, 0x1a, 0x0b, 0xcb, 0xbf,
+        0xbb, 0x2f, 0x4f, 0x83, 0x87, 0x0c, 0x81, 0x3d, 0x27, 0x9a, 0x57, 0x44,
+        0x4a, 0x55, 0x7d, 0x81, 0xbc, 0x62, 0x38, 0xe6, 0x68, 0xc5, 0x83, 0x3c,
+        0x96, 0xe0, 0xac, 0x64, 0x19, 0x4e, 0x2c, 0x32, 0xf7, 0xf2, 0xad, 0xec,
+        0xaf, 0x33, 0x5a, 0x23, 0x8d, 0xd4, 0xcf, 0xe6, 0x2d, 0x3e, 0x3e, 0x73,
+        0x68, 0x60, 0x3b, 0xe2, 0x6f, 0x0e, 0x9c, 0xe9, 0xea, 0xba, 0xa5, 0x1a,
+        0x8e, 0x6c, 0x66, 0xc5, 0x0f, 0x24, 0xd6, 0xa7, 0xed, 0xd2, 0x4e, 0xa4,
+        0x64, 0xf7, 0xa5, 0xbf, 0x6c, 0x1d, 0x95, 0xc0, 0xc3, 0x68, 0xff, 0x66,
+        0xd2, 0x29, 0x1c, 0xf9, 0xc0, 0x44, 0x71, 0xf1, 0xd3, 0xf9, 0x8d, 0x48,
+        0x94, 0xec, 0xbd, 0xd3, 0xb9, 0xff, 0x59, 0x6c, 0x8e, 0x77, 0x62, 0x92,
+        0xfc, 0x5f, 0x87, 0xb9, 0xae, 0xb0, 0x9c, 0x7b, 0x2c, 0x51, 0x22, 0xcc,
+        0x5c, 0x70, 0xe4, 0x40, 0x16, 0x60, 0xb4, 0xdd, 0x0b, 0xdd, 0xe3, 0xa8,
+        0x6d, 0x20, 0x11, 0xb6, 0x84, 0xb2, 0xd6, 0x2d, 0x7a, 0xc2, 0x65, 0x81,
+        0xa2, 0xed, 0x4d, 0x4f, 0x7b, 0xf1, 0x36, 0x45, 0x66, 0x36, 0x40, 0x15,
+        0x41, 0xeb, 0x92, 0x05, 0x3c, 0x31, 0x88, 0x08, 0x5d, 0xf9, 0x1c, 0xe7,
+        0xd9, 0x66, 0x07, 0xa8, 0x82, 0x75, 0x65, 0xc2, 0x57, 0x6d, 0x77, 0xef,
+        0x70, 0xcd, 0x89, 0x45, 0x0a, 0x06, 0x45, 0x3d, 0x4a, 0x9b, 0xd7, 0x77,
+        0x1f, 0x28, 0x02, 0x2d, 0x90, 0x3c, 0x48, 0x3a, 0xb7, 0x28, 0xdc, 0xd0,
+        0xf8, 0x22, 0xf1, 0xa5, 0x44, 0xcc, 0x9f, 0xfb, 0x83, 0xf6, 0xaf, 0xeb,
+        0x19, 0x65, 0x08, 0xc7, 0xc1, 0x35, 0xa8, 0x5c, 0x9f, 0x19, 0xbc, 0x2e,
+        0x9a, 0xcf, 0xf6, 0x9f, 0x69, 0x3a, 0x05, 0xa3, 0x6b, 0x8b, 0xb1, 0x21,
+        0x1c, 0xe0, 0xce, 0xc8, 0x99, 0x86, 0xc6, 0x36, 0xd9, 0x3d, 0xab, 0x4f,
+        0x5f, 0x3e, 0xaa, 0x9f, 0x60, 0x3e, 0x2b, 0x6d, 0xae, 0xa7, 0xc0, 0x08,
+        0x93, 0x66, 0xab, 0xaf, 0xe3, 0x59, 0x96, 0x09, 0x25, 0xb6, 0x4b, 0x6b,
+        0x57, 0x2c, 0x23, 0xb5, 0x6f, 0x5c, 0x34, 0xd2, 0x83, 0xb6, 0x13, 0x91,
+        0x65, 0xaf, 0x02, 0xa6, 0xb5, 0x06, 0x11, 0x66, 0xd0, 0xc4, 0x5f, 0xb1,
+        0xa3, 0x9d, 0x75, 0x80, 0x66, 0xcc, 0x8b, 0xd8, 0xa8, 0x84, 0xe9, 0xc3,
+        0xb5, 0x4c, 0xd1, 0x33, 0xec, 0xf7, 0x58, 0x27, 0x17, 0x36, 0x96, 0x40,
+        0x0d, 0xba, 0xf8, 0x13, 0x5f, 0x1b, 0x7c, 0x66, 0x93, 0x21, 0xb8, 0x4d,
+        0x4c, 0xec, 0x45, 0x02, 0x58, 0x84, 0xb0, 0x59, 0xc2, 0x1b, 0xe4, 0xbd,
+        0x73, 0xa8, 0x08, 0x87, 0x39, 0x0e, 0x50, 0x6e, 0xb0, 0xbe, 0x4f, 0xee,
+        0x88, 0x9b, 0x00, 0x3c, 0xdd, 0x49, 0x8d, 0x20, 0xde, 0x1d, 0x7e, 0x95,
+        0x2b, 0x0c, 0x9e, 0x35, 0x02, 0xb6, 0x9b, 0xd0, 0x77, 0x9c, 0xc1, 0x00,
+        0x48, 0x9a, 0xe9, 0x29, 0x90, 0x04, 0x5b, 0xae, 0xa0, 0xc6, 0xaa, 0x17,
+        0xd0, 0x24, 0x9a, 0x28, 0x32, 0x52, 0x66, 0x99, 0x39, 0x0a, 0xb3, 0xf3,
+        0xaf, 0x42, 0x43, 0xbe, 0x8e, 0x03, 0x55, 0x7e, 0x3c, 0x67, 0x44, 0x3a,
+        0x8f, 0xfd, 0x2f, 0x3b, 0xfb, 0xe9, 0x6b, 0xd1, 0xa8, 0xc2, 0x76, 0xc2,
+        0xe8, 0x5b, 0x96, 0x38, 0xb5, 0x6d, 0x4b, 0xe2, 0x19, 0x04, 0x46, 0x0a,
+        0x19, 0xff, 0x06, 0x96, 0xcf, 0x88, 0x74, 0xfb, 0x3f, 0x3a, 0x08, 0xdf,
+        0x8a, 0x3a, 0x5a, 0xfc, 0x26, 0xa5, 0x0c, 0x0c, 0x98, 0x32, 0x59, 0x1b,
+        0x0f, 0xe2, 0x09, 0xbe, 0x62, 0x89, 0xb3, 0x0d, 0xac, 0x81, 0xce, 0xcb,
+        0x34, 0x18, 0x2c, 0xf3, 0xae, 0xff, 0x93, 0xe6, 0x91, 0x83, 0x88, 0xbe,
+        0xb0, 0x95, 0xe4, 0xf5, 0xa4, 0xda, 0x84, 0x7e, 0x91, 0x17, 0x58, 0xb6,
+        0x9b, 0xcb, 0xad, 0x97, 0x78, 0xd6, 0xa3, 0x08, 0x27, 0xd7, 0xe4, 0xb9,
+        0x17, 0xf5, 0xb7, 0xc4, 0x0c, 0x2b, 0xe0, 0xf9, 0x81, 0x78, 0x76, 0x3f,
+        0x6a, 0xa0, 0xf8, 0xdb, 0x6a, 0x9d, 0x6d, 0xf1, 0x3c, 0xa6, 0x2d, 0x45,
+        0x71, 0xbb, 0xe3, 0xa7, 0xc7, 0x51, 0xe6, 0xb1, 0x93, 0xbf, 0x44, 0xfc,
+        0xb6, 0xc1, 0xe7, 0xd7, 0xf7, 0x48, 0x02, 0x3c, 0xd8, 0x1b, 0xcb, 0xfa,
+        0x48, 0x46, 0xd4, 0xce, 0x85, 0x93, 0x6d, 0x04, 0x60, 0x4a, 0xbc, 0xd0,
+        0x4e, 0xea, 0xb2, 0xf0, 0x4d, 0x93, 0x3b, 0xf0, 0x3a, 0xe3, 0x3a, 0xf0,
+        0x14, 0x7e, 0x0b, 0x32, 0x0d, 0xb0, 0xc7, 0x37, 0x69, 0x3c, 0x33, 0x43,
+        0xa7, 0xa0, 0x3e, 0x54, 0x0a, 0x60, 0x6e, 0x1b, 0xd0, 0x93, 0x2d, 0x4e,
+        0xeb, 0xc7, 0x18, 0x81, 0xe9, 0xa2, 0xc7, 0x6e, 0xbc, 0x89, 0xaf, 0xdf,
+        0xb6, 0x15, 0x41, 0x1f, 0x69, 0xdd, 0x30, 0x68, 0x10, 0x6d, 0xcc, 0x47,
+        0xe1, 0xbf, 0x48, 0xff, 0xbe, 0xd2, 0xff, 0xb4, 0x8a, 0xcf, 0x09, 0x83,
+        0x34, 0x96, 0x37, 0xce, 0xa7, 0x4b, 0x9c, 0xd4, 0x85, 0xe4, 0x28, 0xbe,
+        0x64, 0x60, 0x26, 0xa7, 0x38, 0x35, 0xee, 0xa7, 0xfa, 0x8c, 0xf2, 0x42,
+        0x9c, 0xb2, 0x34, 0x4b, 0x8d, 0xe3, 0xc3, 0x91, 0xd4, 0xce, 0xfc, 0x6f,
+        0x2a, 0x30, 0xc8, 0x59, 0xf8, 0xfc, 0x21, 0xd0, 0x8a, 0x22, 0xc5, 0xc9,
+        0x53, 0xe1, 0xa8, 0x68, 0xcb, 0xef, 0xa1, 0x91, 0x38, 0x45, 0x7f, 0xe7,
+        0x80, 0xa4, 0xff, 0x40, 0x0d, 0xfb, 0x26, 0x34, 0xb0, 0x35, 0x3e, 0xb7,
+        0xf4, 0x55, 0xd7, 0xf5, 0x94, 0x17, 0x68, 0x47, 0x65, 0x09, 0xd3, 0x2d,
+        0x5e, 0x8e, 0xb8, 0x88, 0xb6, 0x4a, 0x21, 0x83, 0x3a, 0x8b, 0x19, 0xc5,
+        0x19, 0xfb, 0x00, 0x36, 0xfd, 0xc6, 0x0c, 0xfd, 0x0c, 0xd2, 0x7b, 0xa5,
+        0x25, 0xa4, 0x1c, 0xd2, 0x28, 0xab, 0x25, 0xab, 0x8a, 0x24, 0x28, 0xd7,
+        0xd4, 0xb6, 0x89, 0xe9, 0x1d, 0xcb, 0x16, 0x6e, 0x57, 0x41, 0xff, 0x40,
+        0x95, 0x1d, 0x72, 0xc1, 0x06, 0xf0, 0x49, 0x09, 0x1e, 0x8a, 0x1b, 0x83,
+        0x4d, 0xc4, 0xc8, 0xc9, 0xf1, 0x4f, 0xad, 0x3d, 0xac, 0xb5, 0x3f, 0x92,
+        0x7e, 0x6c, 0xa5, 0xb6, 0x24, 0x5e, 0x5a, 0x6d, 0x71, 0x1d, 0x6c, 0xd9,
+        0xba, 0x57, 0xcf, 0x6b, 0x40, 0x20, 0xf0, 0xa5, 0x88, 0x89, 0x55, 0xc2,
+        0xf1, 0xa3, 0x58, 0x08, 0x01, 0x0f, 0x91, 0x55, 0xd8, 0xe9, 0xcc, 0xe2,
+        0xdf, 0xec, 0x3a, 0x2c, 0x77, 0x35, 0xf6, 0x4c, 0xf2, 0xfa, 0x0a, 0xc9,
+        0x34, 0xd1, 0xa3, 0xe0, 0xdd, 0x35, 0x6d, 0xa2, 0xce, 0xa6, 0xe0, 0x7e,
+        0x9c, 0x0d, 0xd7, 0x76, 0x03, 0x10, 0xaa, 0x76, 0x8e, 0xc9, 0xc4, 0xdf,
+        0xba, 0xeb, 0x58, 0x53, 0x49, 0xd0, 0xe8, 0xca, 0xe6, 0x50, 0x76, 0xb6,
+        0x7c, 0xb4, 0xd5, 0x5e, 0x51, 0x71, 0x0f, 0x11, 0x86, 0xad, 0x24, 0x13,
+        0x4b, 0x24, 0xd6, 0x5d, 0x59, 0x4a, 0x31, 0x2c, 0x0c, 0x62, 0xe7, 0x8f
+};
+
+struct quic_corpus_datagram {
+    const unsigned char *data;
+    size_t len;
+};
+
+struct quic_corpus_flow {
+    const char *name;
+    const char *server_name;
+    int count;
+    struct quic_corpus_datagram datagrams[2];
+};
+
+static const struct quic_corpus_flow quic_corpus[] = {
+        {"quic_v1_single", "duckduckgo.com", 1, {{quic_v1_single_0, sizeof(quic_v1_single_0)}}},
+        {"quic_v2_reordered", "www.google.com", 1, {{quic_v2_reordered_0, sizeof(quic_v2_reordered_0)}}},
+        {"quic_v1_split", "improving.duckduckgo.com", 2, {{quic_v1_split_0, sizeof(quic_v1_split_0)}, {quic_v1_split_1, sizeof(quic_v1_split_1)}}},
+        {"quic_v1_coalesced", "a-very-long-subdomain-name-for-testing.cdn.static.assets.example-cloud-provider.net", 1, {{quic_v1_coalesced_0, sizeof(quic_v1_coalesced_0)}}},
+};
+
+#endif // QUIC_CORPUS_H
@@ -1,6 +1,21 @@
-#include <string.h>
+#include <stdlib.h>
 
-int is_valid_utf8(const char *str) {
-    const char pattern[] = {0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0};
-    return strcmp((char*)pattern, str) != 0;
-}
\ No newline at end of file
+int loglevel = 0;
+
+void __platform_log_print(int prio, const char *tag, const char *fmt, ...) {}
+
+void *ng_malloc(size_t size, const char *tag) {
+    return malloc(size);
+}
+
+void *ng_calloc(size_t count, size_t size, const char *tag) {
+    return calloc(count, size);
+}
+
+void *ng_realloc(void *ptr, size_t size, const char *tag) {
+    return realloc(ptr, size);
+}
+
+void ng_free(void *ptr, const char *file, int line) {
+    free(ptr);
+}
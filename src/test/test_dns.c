@@ -0,0 +1,281 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "../netguard/include/dns_parser.h"
+#include "../netguard/include/dns_stream.h"
+#include "dns_corpus.h"
+
+// Found by mutating the corpus, the smallest input for each error
+static const unsigned char fuzz_short_header[] = {
+        0x1a
+};
+static const unsigned char fuzz_missing_question[] = {
+        0x51, 0x51, 0x81, 0x80, 0x00, 0x02, 0x00, 0x02, 0x00, 0x00, 0x00, 0x00
+};
+static const unsigned char fuzz_reserved_label[] = {
+        0x77, 0x77, 0x81, 0x80, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00,
+        0x46
+};
+static const unsigned char fuzz_forward_pointer[] = {
+        0x51, 0x51, 0x81, 0x80, 0x00, 0x02, 0x00, 0x02, 0x00, 0x00, 0x00, 0x00,
+        0xc2, 0x6f
+};
+static const unsigned char fuzz_question_truncated[] = {
+        0x1a, 0x2b, 0x81, 0x80, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01,
+        0x00
+};
+static const unsigned char fuzz_rr_truncated[] = {
+        0x1a, 0x2b, 0x81, 0x80, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01,
+        0x0a, 0x64, 0x75, 0x63, 0x6b, 0x64, 0x75, 0x63, 0x6b, 0x67, 0x6f, 0x03,
+        0x63, 0x6f, 0x6d, 0x00
+};
+static const unsigned char fuzz_rdata_out_of_bounds[] = {
+        0x1a, 0x2b, 0x81, 0x80, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01,
+        0x0a, 0x64, 0x75, 0x63, 0x6b, 0x64, 0x75, 0x63, 0x6b, 0x67, 0x6f, 0x03,
+        0x63, 0x6f, 0x6d, 0x00, 0x00, 0x01, 0x00, 0x01, 0xc0, 0x0c, 0x00, 0x01,
+        0x00, 0x01
+};
+static const unsigned char fuzz_short_address[] = {
+        0x1a, 0x2b, 0x81, 0x80, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01,
+        0x0a, 0x64, 0x75, 0x63, 0x6b, 0x64, 0x75, 0x63, 0x6b, 0x67, 0x6f, 0x03,
+        0x63, 0x6f, 0x6d, 0x00, 0x00, 0x01, 0x00, 0x01, 0xc0, 0x0c, 0x00, 0x01,
+        0x00, 0x01, 0x00
+};
+
+// A name pointing to itself, and two names pointing to each other
+static const unsigned char pointer_loop[] = {
+        0x00, 0x01, 0x81, 0x80, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x01, 0x61, 0xc0, 0x0c, 0x00, 0x01, 0x00, 0x01
+};
+static const unsigned char pointer_cycle[] = {
+        0x00, 0x01, 0x81, 0x80, 0x00, 0x02, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x01, 0x61, 0xc0, 0x16, 0x00, 0x01, 0x00, 0x01,
+        0x01, 0x62, 0xc0, 0x0c, 0x00, 0x01, 0x00, 0x01
+};
+
+// A CNAME with a byte after its target name
+static const unsigned char cname_trailing[] = {
+        0x00, 0x01, 0x81, 0x80, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00,
+        0x01, 0x61, 0x00, 0x00, 0x05, 0x00, 0x01,
+        0xc0, 0x0c, 0x00, 0x05, 0x00, 0x01, 0x00, 0x00, 0x00, 0x3c, 0x00, 0x04,
+        0x01, 0x62, 0x00, 0x00
+};
+
+// A label with a NUL byte is valid on the wire, but not as text
+static const unsigned char name_with_nul[] = {
+        0x00, 0x01, 0x81, 0x80, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x03, 0x61, 0x00, 0x62, 0x00, 0x00, 0x01, 0x00, 0x01
+};
+
+static int parse(const unsigned char *data, size_t len) {
+    struct dns_message *msg = malloc(sizeof(struct dns_message));
+    int err = parse_dns_message(msg, data, len);
+    char name[DNS_NAME_MAX + 1];
+    for (int i = 0; i < msg->rr_count; i++)
+        if (get_dns_name(msg, msg->rr[i].name, name) >= 0)
+            assert(strlen(name) < DNS_NAME_MAX);
+    free(msg);
+    return err;
+}
+
+static size_t build_long_name(unsigned char *data, int labels) {
+    memset(data, 0, DNS_HEADER_LEN);
+    data[5] = 1; // question
+    size_t len = DNS_HEADER_LEN;
+    for (int i = 0; i < labels; i++) {
+        data[len++] = 63;
+        memset(data + len, 'a', 63);
+        len += 63;
+    }
+    data[len++] = 0;
+    data[len++] = 0;
+    data[len++] = 1;
+    data[len++] = 0;
+    data[len++] = 1;
+    return len;
+}
+
+// Blocks every other message, as parse_dns_response does: the header and question only
+static size_t block_odd(void *ctx, uint8_t *message, size_t len) {
+    int *count = ctx;
+    if ((*count)++ % 2 == 0)
+        return len;
+    struct dns_message msg;
+    assert(parse_dns_message(&msg, message, len) == 0);
+    message[6] = message[7] = message[8] = message[9] = message[10] = message[11] = 0;
+    return msg.end[DNS_SECTION_QUESTION];
+}
+
+// Frame the corpus as one TCP stream and the stream the decoder should forward
+static size_t build_stream(unsigned char *stream, unsigned char *expected, size_t *elen) {
+    size_t len = 0;
+    *elen = 0;
+    for (int i = 0; i < sizeof(dns_corpus) / sizeof(dns_corpus[0]); i++) {
+        const struct dns_corpus_message *m = &dns_corpus[i];
+        stream[len++] = (unsigned char) (m->len >> 8);
+        stream[len++] = (unsigned char) m->len;
+        memcpy(stream + len, m->data, m->len);
+        len += m->len;
+
+        int count = i;
+        unsigned char *e = expected + *elen;
+        memcpy(e + 2, m->data, m->len);
+        size_t rlen = block_odd(&count, e + 2, m->len);
+        e[0] = (unsigned char) (rlen >> 8);
+        e[1] = (unsigned char) rlen;
+        *elen += 2 + rlen;
+    }
+    return len;
+}
+
+// Feed the stream in chunks and forward at most window bytes after each
+static void check_stream(const unsigned char *stream, size_t len,
+                         const unsigned char *expected, size_t elen,
+                         size_t split, size_t window) {
+    struct dns_stream ds;
+    memset(&ds, 0, sizeof(ds));
+    unsigned char *out = malloc(elen);
+    size_t olen = 0;
+    int count = 0;
+    for (size_t off = 0; off < len; off += split) {
+        size_t chunk = (len - off < split ? len - off : split);
+        assert(decode_dns_stream(&ds, stream + off, chunk, block_odd, &count) >= 0);
+
+        const uint8_t *data;
+        size_t dlen = get_dns_stream_data(&ds, &data);
+        if (dlen > window)
+            dlen = window;
+        assert(olen + dlen <= elen);
+        memcpy(out + olen, data, dlen);
+        olen += dlen;
+        consume_dns_stream(&ds, dlen);
+    }
+
+    const uint8_t *data;
+    size_t dlen;
+    while ((dlen = get_dns_stream_data(&ds, &data)) > 0) {
+        assert(olen + dlen <= elen);
+        memcpy(out + olen, data, dlen);
+        olen += dlen;
+        consume_dns_stream(&ds, dlen);
+    }
+
+    assert(olen == elen && memcmp(out, expected, elen) == 0);
+    assert(get_dns_stream_partial(&ds) == 0);
+    assert(ds.messages == sizeof(dns_corpus) / sizeof(dns_corpus[0]));
+    free_dns_stream(&ds);
+    free(out);
+}
+
+int main() {
+    struct dns_message *msg = malloc(sizeof(struct dns_message));
+    char name[DNS_NAME_MAX + 1];
+
+    // Real responses, and every truncation of them, in buffers of exact size
+    for (int i = 0; i < sizeof(dns_corpus) / sizeof(dns_corpus[0]); i++) {
+        const struct dns_corpus_message *m = &dns_corpus[i];
+        assert(parse_dns_message(msg, m->data, m->len) == 0);
+        assert(msg->sections == 4);
+        assert(msg->end[DNS_SECTION_ADDITIONAL] == m->len);
+        int total = 0;
+        for (int s = 0; s < 4; s++) {
+            assert(msg->count[s] == m->count[s]);
+            total += m->count[s];
+        }
+        assert(msg->rr_count == total);
+        assert(get_dns_name(msg, msg->rr[0].name, name) == strlen(m->qname));
+        assert(strcmp(name, m->qname) == 0);
+        assert(msg->rr[0].section == DNS_SECTION_QUESTION);
+
+        for (size_t len = 0; len < m->len; len++) {
+            unsigned char *data = malloc(len > 0 ? len : 1);
+            memcpy(data, m->data, len);
+            assert(parse(data, len) < 0);
+            free(data);
+        }
+    }
+
+    // The CNAME chain is followed by comparing names in place
+    const struct dns_corpus_message *chain = &dns_corpus[1];
+    assert(parse_dns_message(msg, chain->data, chain->len) == 0);
+    assert(is_dns_name_equal(msg, msg->rr[0].name, msg->rr[1].name));
+    assert(!is_dns_name_equal(msg, msg->rr[0].name, msg->rr[2].name));
+    assert(is_dns_name_equal(msg, msg->rr[1].rdata, msg->rr[2].name));
+    assert(is_dns_name_equal(msg, msg->rr[2].rdata, msg->rr[3].name));
+    assert(get_dns_name(msg, msg->rr[2].rdata, name) > 0);
+    assert(strcmp(name, "edge-7.cdn.example.net") == 0);
+    assert(msg->rr[3].type == 28 && msg->rr[3].rdlength == 16 && msg->rr[3].ttl == 20);
+    assert(get_dns_u32(chain->data + msg->rr[1].rdata - 6) == 3600);
+    assert(get_dns_name(msg, msg->rr[5].name, name) == 0); // OPT, the root
+
+    // More records than indexed are still checked
+    const struct dns_corpus_message *many = &dns_corpus[5];
+    unsigned char *big = malloc(many->len * 2);
+    memcpy(big, many->data, many->len);
+    size_t rr_len = (many->len - DNS_HEADER_LEN - 22 - 11) / 40; // question and OPT
+    size_t big_len = many->len;
+    for (int i = 0; i < 40; i++, big_len += rr_len)
+        memcpy(big + big_len, many->data + DNS_HEADER_LEN + 22, rr_len);
+    big[11] = 0; // no OPT at the end anymore
+    big[7] = 80 + 1; // the OPT counted as an answer
+    assert(parse_dns_message(msg, big, big_len) == 0);
+    assert(msg->rr_count == DNS_PARSE_MAX_RR);
+    big[7]++;
+    assert(parse_dns_message(msg, big, big_len) == -2);
+    free(big);
+
+    // Regression cases
+    assert(parse(fuzz_short_header, sizeof(fuzz_short_header)) == -1);
+    assert(parse(fuzz_missing_question, sizeof(fuzz_missing_question)) == -2);
+    assert(parse(fuzz_reserved_label, sizeof(fuzz_reserved_label)) == -3);
+    assert(parse(fuzz_forward_pointer, sizeof(fuzz_forward_pointer)) == -4);
+    assert(parse(fuzz_question_truncated, sizeof(fuzz_question_truncated)) == -6);
+    assert(parse(fuzz_rr_truncated, sizeof(fuzz_rr_truncated)) == -7);
+    assert(parse(fuzz_rdata_out_of_bounds, sizeof(fuzz_rdata_out_of_bounds)) == -8);
+    assert(parse(fuzz_short_address, sizeof(fuzz_short_address)) == -9);
+    assert(parse(pointer_loop, sizeof(pointer_loop)) == -4);
+    assert(parse(pointer_cycle, sizeof(pointer_cycle)) == -4);
+    assert(parse(cname_trailing, sizeof(cname_trailing)) == -9);
+
+    assert(parse_dns_message(msg, name_with_nul, sizeof(name_with_nul)) == 0);
+    assert(get_dns_name(msg, msg->rr[0].name, name) == -1);
+    assert(*name == 0);
+
+    // Names are at most 255 bytes on the wire: three 63 byte labels fit, four do not
+    unsigned char long_name[DNS_HEADER_LEN + 4 * 64 + 5];
+    size_t len = build_long_name(long_name, 3);
+    assert(parse_dns_message(msg, long_name, len) == 0);
+    assert(get_dns_name(msg, msg->rr[0].name, name) == 3 * 63 + 2);
+    len = build_long_name(long_name, 4);
+    assert(parse_dns_message(msg, long_name, len) == -5);
+    assert(msg->sections == 0);
+
+    // The sections before an invalid record stay indexed
+    assert(parse_dns_message(msg, fuzz_short_address, sizeof(fuzz_short_address)) == -9);
+    assert(msg->sections == 1 && msg->rr_count == 0);
+
+    // Pipelined responses, split anywhere, are forwarded whole and rewritten one by one
+    unsigned char *stream = malloc(64 * 1024);
+    unsigned char *expected = malloc(64 * 1024);
+    size_t elen;
+    size_t slen = build_stream(stream, expected, &elen);
+    for (size_t split = 1; split <= slen; split++)
+        check_stream(stream, slen, expected, elen, split, split < 100 ? 1 : 1400);
+
+    // A message still incomplete is held back
+    struct dns_stream ds;
+    memset(&ds, 0, sizeof(ds));
+    int count = 0;
+    const uint8_t *data;
+    assert(decode_dns_stream(&ds, stream, 2 + dns_corpus[0].len - 1, block_odd, &count) == 0);
+    assert(get_dns_stream_data(&ds, &data) == 0);
+    assert(get_dns_stream_partial(&ds) == 2 + dns_corpus[0].len - 1);
+    free_dns_stream(&ds);
+    free(stream);
+    free(expected);
+
+    free(msg);
+    return 0;
+}
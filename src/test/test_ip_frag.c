@@ -0,0 +1,117 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <arpa/inet.h>
+#include <netinet/ip.h>
+#include "../netguard/include/ip_frag.h"
+
+#define PAYLOAD_LEN 4000
+
+static uint8_t payload[PAYLOAD_LEN];
+
+// A fragment of payload, with the header the tun would deliver
+static size_t build_fragment(uint8_t *pkt, uint16_t id, size_t offset, size_t len, int more) {
+    struct iphdr *ip4 = (struct iphdr *) pkt;
+    memset(ip4, 0, sizeof(struct iphdr));
+    ip4->version = 4;
+    ip4->ihl = 5;
+    ip4->tot_len = htons((uint16_t) (sizeof(struct iphdr) + len));
+    ip4->id = htons(id);
+    ip4->frag_off = htons((uint16_t) ((offset / 8) | (more ? IP_MF : 0)));
+    ip4->ttl = 64;
+    ip4->protocol = IPPROTO_UDP;
+    ip4->saddr = htonl(0x0a000002);
+    ip4->daddr = htonl(0x08080808);
+    memcpy(pkt + sizeof(struct iphdr), payload + offset, len);
+    return sizeof(struct iphdr) + len;
+}
+
+static ssize_t add(uint16_t id, size_t offset, size_t len, int more, long long ms, uint8_t **datagram) {
+    uint8_t pkt[sizeof(struct iphdr) + PAYLOAD_LEN];
+    size_t length = build_fragment(pkt, id, offset, len, more);
+    return add_ip_fragment(pkt, length, ms, datagram);
+}
+
+// A fragment with IP options and zero data, at any offset
+static ssize_t add_options(uint16_t id, size_t hlen, size_t offset, size_t len, int more,
+                           uint8_t **datagram) {
+    uint8_t pkt[60 + 1480];
+    size_t length = build_fragment(pkt, id, 0, 0, more);
+    struct iphdr *ip4 = (struct iphdr *) pkt;
+    ip4->ihl = (unsigned int) (hlen / 4);
+    ip4->tot_len = htons((uint16_t) (hlen + len));
+    ip4->frag_off = htons((uint16_t) ((offset / 8) | (more ? IP_MF : 0)));
+    memset(pkt + length, 0, hlen - length + len);
+    return add_ip_fragment(pkt, hlen + len, 0, datagram);
+}
+
+static void check_datagram(uint8_t *datagram, ssize_t dlen) {
+    const struct iphdr *ip4 = (const struct iphdr *) datagram;
+    assert(dlen == sizeof(struct iphdr) + PAYLOAD_LEN);
+    assert(ntohs(ip4->tot_len) == dlen);
+    assert(ip4->frag_off == 0);
+    assert(memcmp(datagram + sizeof(struct iphdr), payload, PAYLOAD_LEN) == 0);
+    free(datagram);
+}
+
+int main() {
+    for (int i = 0; i < PAYLOAD_LEN; i++)
+        payload[i] = (uint8_t) (i * 7);
+    uint8_t *datagram;
+    long long stats[IP_FRAG_STATS];
+
+    // In order, in reverse order and interleaved with another datagram
+    assert(add(1, 0, 1480, 1, 0, &datagram) == 0);
+    assert(add(1, 1480, 1480, 1, 0, &datagram) == 0);
+    check_datagram(datagram, add(1, 2960, 1040, 0, 0, &datagram));
+
+    assert(add(2, 2960, 1040, 0, 0, &datagram) == 0);
+    assert(add(3, 0, 1480, 1, 0, &datagram) == 0);
+    assert(add(2, 1480, 1480, 1, 0, &datagram) == 0);
+    check_datagram(datagram, add(2, 0, 1480, 1, 0, &datagram));
+
+    // Exact duplicates are ignored
+    assert(add(3, 0, 1480, 1, 0, &datagram) == 0);
+    assert(add(3, 2960, 1040, 0, 0, &datagram) == 0);
+    check_datagram(datagram, add(3, 1480, 1480, 1, 0, &datagram));
+
+    // Overlaps drop the whole datagram
+    assert(add(4, 0, 1480, 1, 0, &datagram) == 0);
+    assert(add(4, 1472, 1480, 1, 0, &datagram) < 0);
+    assert(add(4, 2952, 1048, 0, 0, &datagram) == 0);
+
+    // Data beyond the last fragment and misaligned fragments are invalid
+    assert(add(5, 0, 1480, 1, 0, &datagram) == 0);
+    assert(add(5, 0, 1000, 0, 0, &datagram) < 0);
+    assert(add(6, 0, 1481, 1, 0, &datagram) < 0);
+
+    // The reassembled datagram must fit the header of the first fragment, whenever it arrives
+    get_ip_frag_stats(stats);
+    long long invalid = stats[5];
+    assert(add_options(8, 20, 65000, 512, 0, &datagram) == 0);
+    assert(add_options(8, 60, 0, 1480, 1, &datagram) < 0);
+    assert(add_options(9, 60, 0, 1480, 1, &datagram) == 0);
+    assert(add_options(9, 20, 65000, 512, 0, &datagram) < 0);
+    get_ip_frag_stats(stats);
+    assert(stats[5] == invalid + 2);
+
+    // Incomplete datagrams expire
+    get_ip_frag_stats(stats);
+    assert(stats[2] == 0);
+    assert(add(7, 1480, 1480, 1, IP_FRAG_TIMEOUT + 1, &datagram) == 0);
+    get_ip_frag_stats(stats);
+    assert(stats[1] == 3 && stats[2] == 1 && stats[3] == 1);
+
+    // The number of datagrams and the memory are capped
+    for (uint16_t id = 100; id < 100 + 4 * IP_FRAG_MAX_QUEUES; id++)
+        assert(add(id, 0, 1480, 1, IP_FRAG_TIMEOUT + 1, &datagram) == 0);
+    get_ip_frag_stats(stats);
+    assert(stats[4] >= 3 * IP_FRAG_MAX_QUEUES);
+    for (uint16_t id = 1000; id < 1100; id++)
+        assert(add(id, 3000 & ~7, 1000, 0, IP_FRAG_TIMEOUT + 1, &datagram) == 0);
+
+    cleanup_ip_fragments();
+    return 0;
+}
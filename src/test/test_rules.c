@@ -0,0 +1,105 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include "../netguard/include/rules.h"
+
+static struct rule make_rule(const char *addr, int prefix, int action) {
+    struct rule r;
+    memset(&r, 0, sizeof(struct rule));
+    r.uid = RULE_ANY_UID;
+    r.protocol = RULE_ANY_PROTOCOL;
+    r.version = (strchr(addr, ':') == NULL ? 4 : 6);
+    assert(inet_pton(r.version == 4 ? AF_INET : AF_INET6, addr, r.addr) == 1);
+    r.prefix = (uint8_t) prefix;
+    r.port_min = 0;
+    r.port_max = 65535;
+    r.action = (uint8_t) action;
+    return r;
+}
+
+static int match(const char *addr, int protocol, uint16_t dport, int32_t uid, struct rule *rule) {
+    uint8_t daddr[16];
+    int version = (strchr(addr, ':') == NULL ? 4 : 6);
+    assert(inet_pton(version == 4 ? AF_INET : AF_INET6, addr, daddr) == 1);
+    return match_rule(version, protocol, daddr, dport, uid, rule);
+}
+
+int main() {
+    struct rule rules[8];
+    struct rule rule;
+    long long stats[RULES_STATS];
+
+    // Nothing is decided without rules
+    assert(match("10.0.0.1", IPPROTO_TCP, 443, 1000, &rule) == RULE_ACTION_JAVA);
+
+    // The longest prefix wins, then the order
+    rules[0] = make_rule("0.0.0.0", 0, RULE_ACTION_ALLOW);
+    rules[1] = make_rule("10.0.0.0", 8, RULE_ACTION_DENY);
+    rules[2] = make_rule("10.1.0.0", 16, RULE_ACTION_REDIRECT);
+    strcpy(rules[2].raddr, "127.0.0.1");
+    rules[2].rport = 8080;
+    rules[3] = make_rule("10.1.0.0", 16, RULE_ACTION_DENY);
+    assert(set_rules(rules, 4) == 0);
+    assert(match("192.168.1.1", IPPROTO_TCP, 443, 1000, &rule) == RULE_ACTION_ALLOW);
+    assert(match("10.2.3.4", IPPROTO_TCP, 443, 1000, &rule) == RULE_ACTION_DENY);
+    assert(match("10.1.3.4", IPPROTO_TCP, 443, 1000, &rule) == RULE_ACTION_REDIRECT);
+    assert(strcmp(rule.raddr, "127.0.0.1") == 0 && rule.rport == 8080);
+    assert(match("::1", IPPROTO_TCP, 443, 1000, &rule) == RULE_ACTION_JAVA);
+
+    // Uid, protocol and port filters fall back to shorter prefixes
+    rules[2].action = RULE_ACTION_ALLOW;
+    rules[2].uid = 1000;
+    rules[2].protocol = IPPROTO_UDP;
+    rules[2].port_min = 53;
+    rules[2].port_max = 53;
+    rules[3] = make_rule("10.1.0.0", 16, RULE_ACTION_ALLOW);
+    rules[3].protocol = IPPROTO_ICMP;
+    rules[3].port_min = rules[3].port_max = 1;
+    assert(set_rules(rules, 4) == 0);
+    assert(match("10.1.0.1", IPPROTO_UDP, 53, 1000, &rule) == RULE_ACTION_ALLOW);
+    assert(match("10.1.0.1", IPPROTO_UDP, 53, 1001, &rule) == RULE_ACTION_DENY);
+    assert(match("10.1.0.1", IPPROTO_UDP, 54, 1000, &rule) == RULE_ACTION_DENY);
+    assert(match("10.1.0.1", IPPROTO_TCP, 53, 1000, &rule) == RULE_ACTION_DENY);
+    assert(match("10.1.0.1", IPPROTO_ICMP, 1234, 1000, &rule) == RULE_ACTION_ALLOW);
+
+    // A rule deferring to Java hides shorter prefixes
+    rules[4] = make_rule("10.1.2.3", 32, RULE_ACTION_JAVA);
+    assert(set_rules(rules, 5) == 0);
+    assert(match("10.1.2.3", IPPROTO_TCP, 443, 1000, &rule) == RULE_ACTION_JAVA);
+    assert(match("10.1.2.4", IPPROTO_TCP, 443, 1000, &rule) == RULE_ACTION_DENY);
+
+    // IPv6
+    rules[0] = make_rule("2001:db8::", 32, RULE_ACTION_DENY);
+    rules[1] = make_rule("2001:db8::53", 128, RULE_ACTION_ALLOW);
+    assert(set_rules(rules, 2) == 0);
+    assert(match("2001:db8::1", IPPROTO_UDP, 53, 1000, &rule) == RULE_ACTION_DENY);
+    assert(match("2001:db8::53", IPPROTO_UDP, 53, 1000, &rule) == RULE_ACTION_ALLOW);
+    assert(match("2001:db9::53", IPPROTO_UDP, 53, 1000, &rule) == RULE_ACTION_JAVA);
+    assert(match("10.1.0.1", IPPROTO_UDP, 53, 1000, &rule) == RULE_ACTION_JAVA);
+
+    // Invalid rules leave the rules unchanged
+    rules[2] = make_rule("10.0.0.0", 33, RULE_ACTION_DENY);
+    assert(set_rules(rules, 3) < 0);
+    rules[2] = make_rule("10.0.0.0", 8, RULE_ACTION_REDIRECT);
+    assert(set_rules(rules, 3) < 0);
+    rules[2] = make_rule("10.0.0.0", 8, RULE_ACTION_DENY);
+    rules[2].port_min = 2;
+    rules[2].port_max = 1;
+    assert(set_rules(rules, 3) < 0);
+    assert(match("2001:db8::53", IPPROTO_UDP, 53, 1000, &rule) == RULE_ACTION_ALLOW);
+
+    get_rules_stats(stats);
+    assert(stats[0] == 2);
+    assert(stats[1] + stats[2] + stats[3] + stats[4] == 17);
+
+    // Clearing the rules lets Java decide again
+    assert(set_rules(NULL, 0) == 0);
+    assert(match("2001:db8::53", IPPROTO_UDP, 53, 1000, &rule) == RULE_ACTION_JAVA);
+
+    cleanup_rules();
+    return 0;
+}
@@ -4,10 +4,9 @@
 #include <string.h>
 #include <assert.h>
 #include "../netguard/include/tls.h"
-
-int loglevel = 0;
-
-void __platform_log_print(int prio, const char *tag, const char *fmt, ...) {}
+#include "../netguard/include/quic.h"
+#include "tls_corpus.h"
+#include "quic_corpus.h"
 
 struct test_packet {
     const char *packet;
@@ -500,6 +499,22 @@ const unsigned char fragmentedSNI2[] = {
 };
 
 
+// The server name view agrees with the copy and stays inside the data
+static int check_view(const unsigned char *data, size_t len) {
+    char sn[FQDN_LENGTH];
+    const uint8_t *name = NULL;
+    int copied = get_server_name(data, len, data, sn);
+    int found = find_server_name(data, len, &name);
+    assert(copied == found);
+    if (found >= 0) {
+        assert(name >= data && name + found <= data + len);
+        assert(memcmp(name, sn, (size_t) found) == 0);
+        assert(sn[found] == 0);
+    } else
+        assert(name == NULL);
+    return found;
+}
+
 int main() {
     uint8_t *pkt = (uint8_t *)good_data_1;
     int error = 0;
@@ -610,5 +625,82 @@ int main() {
     assert(strlen(sn) == 0);
     assert(error == -34);
 
+    struct test_packet cases[] = {
+            {(const char *) good_data_1, sizeof(good_data_1)},
+            {(const char *) good_data_2, sizeof(good_data_2)},
+            {(const char *) good_data_3, sizeof(good_data_3)},
+            {(const char *) good_data_4, sizeof(good_data_4)},
+            {(const char *) good_data_5, sizeof(good_data_5)},
+            {(const char *) ssl30_request, sizeof(ssl30_request)},
+            {(const char *) ssl20_client_hello, sizeof(ssl20_client_hello)},
+            {(const char *) bad_data_1, sizeof(bad_data_1)},
+            {(const char *) bad_data_2, sizeof(bad_data_2)},
+            {(const char *) bad_data_3, sizeof(bad_data_3)},
+            {(const char *) wrong_sni_length, sizeof(wrong_sni_length)},
+            {(const char *) fragmentedSNI1, sizeof(fragmentedSNI1)},
+            {(const char *) fragmentedSNI2, sizeof(fragmentedSNI2)},
+            {(const char *) sni_invalid_utf, sizeof(sni_invalid_utf)},
+    };
+    for (int i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)
+        check_view((const unsigned char *) cases[i].packet, cases[i].len);
+
+    // Real ClientHellos, and every truncation of them, in buffers of exact size
+    for (int i = 0; i < sizeof(tls_corpus) / sizeof(tls_corpus[0]); i++) {
+        const struct tls_corpus_hello *h = &tls_corpus[i];
+        const uint8_t *name = NULL;
+        error = find_server_name(h->data, h->len, &name);
+        assert(error == strlen(h->server_name));
+        assert(memcmp(name, h->server_name, (size_t) error) == 0);
+
+        for (size_t len = 0; len <= h->len; len++) {
+            unsigned char *data = malloc(len > 0 ? len : 1);
+            memcpy(data, h->data, len);
+            error = check_view(data, len);
+            assert(error < 0 || error == strlen(h->server_name));
+            free(data);
+        }
+    }
+
+    // Host names are checked byte by byte
+    unsigned char hello[sizeof(good_data_1)];
+    memcpy(hello, good_data_1, sizeof(hello));
+    hello[sizeof(hello) - 5] = ' ';
+    assert(check_view(hello, sizeof(hello)) == -34);
+    hello[sizeof(hello) - 5] = 0;
+    assert(check_view(hello, sizeof(hello)) == -34);
+    hello[sizeof(hello) - 5] = '_';
+    assert(check_view(hello, sizeof(hello)) == 9);
+    hello[sizeof(hello) - 5] = 0xc3; // start of a two byte sequence, followed by ASCII
+    assert(check_view(hello, sizeof(hello)) == -34);
+    hello[sizeof(hello) - 4] = 0xa9;
+    assert(check_view(hello, sizeof(hello)) == 9);
+    hello[sizeof(hello) - 1] = 0xc3; // truncated sequence at the end
+    assert(check_view(hello, sizeof(hello)) == -34);
+
+    // QUIC client Initials, the server name is known once all datagrams are in
+    for (int i = 0; i < sizeof(quic_corpus) / sizeof(quic_corpus[0]); i++) {
+        const struct quic_corpus_flow *f = &quic_corpus[i];
+        struct quic_hello *qh = calloc(1, sizeof(struct quic_hello));
+        const uint8_t *name = NULL;
+        for (int d = 0; d < f->count; d++) {
+            assert(find_quic_server_name(qh, &name) == -1);
+            assert(add_quic_initial(qh, f->datagrams[d].data, f->datagrams[d].len) > 0);
+        }
+        error = find_quic_server_name(qh, &name);
+        assert(error == strlen(f->server_name));
+        assert(memcmp(name, f->server_name, (size_t) error) == 0);
+
+        // Truncated or altered datagrams are not client Initials
+        memset(qh, 0, sizeof(struct quic_hello));
+        const struct quic_corpus_datagram *dg = &f->datagrams[0];
+        assert(add_quic_initial(qh, dg->data, QUIC_INITIAL_MIN - 1) < 0);
+        unsigned char *data = malloc(dg->len);
+        memcpy(data, dg->data, dg->len);
+        data[4] ^= 0x02; // unknown version
+        assert(add_quic_initial(qh, data, dg->len) < 0);
+        free(data);
+        free(qh);
+    }
+
     return 0;
 }